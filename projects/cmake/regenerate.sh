@@ -88,7 +88,7 @@ set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -O3")
 elif [ "$win" = "true" ]
 then
 echo '
-set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -O3 -msse -msse2 -msse3 -static -std=gnu++98")
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -O3 -msse -msse2 -msse3 -static -std=gnu++14")
 set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -O3 -static")
 '  >> "$HERE/CMakeLists.txt"
 else
@@ -161,6 +161,10 @@ MESSAGE("  Boost_LIBRARIES: ${Boost_LIBRARIES}")
 MESSAGE("  Boost_LIBRARY_DIRS: ${Boost_LIBRARY_DIRS}")
 LINK_DIRECTORIES(${Boost_LIBRARY_DIRS})
 
+# The shared-memory thread pool uses std::thread
+set(THREADS_PREFER_PTHREAD_FLAG ON)
+find_package(Threads REQUIRED)
+
 
 # TODO Split these up based on sub-package dependency
 INCLUDE_DIRECTORIES(' >> "$HERE/CMakeLists.txt"
@@ -192,7 +196,7 @@ then
 echo '
 add_executable(rb-help ${PROJECT_SOURCE_DIR}/help/YAMLHelpGenerator.cpp)
 
-target_link_libraries(rb-help rb-parser rb-core libs help_yaml ${Boost_LIBRARIES})
+target_link_libraries(rb-help rb-parser rb-core libs help_yaml ${Boost_LIBRARIES} ${CMAKE_THREAD_LIBS_INIT})
 set_target_properties(rb-help PROPERTIES PREFIX "../")
 ' >> $HERE/CMakeLists.txt
 elif [ "$jupyter" = "true" ]
@@ -201,7 +205,7 @@ echo "more jupyter!"
 echo '
 add_executable(rb-jupyter ${PROJECT_SOURCE_DIR}/revlanguage/main.cpp)
 
-target_link_libraries(rb-jupyter rb-parser rb-core libs ${Boost_LIBRARIES})
+target_link_libraries(rb-jupyter rb-parser rb-core libs ${Boost_LIBRARIES} ${CMAKE_THREAD_LIBS_INIT})
 set_target_properties(rb-jupyter PROPERTIES PREFIX "../")
 ' >> $HERE/CMakeLists.txt
 elif [ "$cmd" = "true" ]
@@ -231,7 +235,7 @@ ADD_EXECUTABLE(RevStudio ${PROJECT_SOURCE_DIR}/cmd/main.cpp)
 
 # Link the target to the GTK+ libraries
 echo '
-TARGET_LINK_LIBRARIES(RevStudio rb-cmd-lib rb-parser rb-core libs ${Boost_LIBRARIES} ${GTK_LIBRARIES})
+TARGET_LINK_LIBRARIES(RevStudio rb-cmd-lib rb-parser rb-core libs ${Boost_LIBRARIES} ${GTK_LIBRARIES} ${CMAKE_THREAD_LIBS_INIT})
 ' >> $HERE/CMakeLists.txt
 
 echo '
@@ -252,7 +256,7 @@ else
 echo '
 add_executable(rb ${PROJECT_SOURCE_DIR}/revlanguage/main.cpp)
 
-target_link_libraries(rb rb-parser rb-core libs ${Boost_LIBRARIES})
+target_link_libraries(rb rb-parser rb-core libs ${Boost_LIBRARIES} ${CMAKE_THREAD_LIBS_INIT})
 
 set_target_properties(rb PROPERTIES PREFIX "../")
 ' >> $HERE/CMakeLists.txt
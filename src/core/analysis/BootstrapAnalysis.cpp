@@ -1,4 +1,5 @@
 #include "DagNode.h"
+#include "JobFarm.h"
 #include "MaximumLikelihoodAnalysis.h"
 #include "MaximumLikelihoodEstimation.h"
 #include "RbException.h"
@@ -7,6 +8,7 @@
 
 #include <cmath>
 #include <typeinfo>
+#include <vector>
 
 
 using namespace RevBayesCore;
@@ -91,13 +93,51 @@ void BootstrapAnalysis::runAll(double epsilon)
     size_t run_block_end   = size_t(floor( (double(pid+1) / num_processes ) * num_runs) );
     //    size_t stone_block_size  = stone_block_end - stone_block_start;
     
-    // Run the chain
-    for (size_t i = run_block_start; i < run_block_end; ++i)
+    // we need a copy of the analysis (and thus the model) for every worker except the first one
+    JobFarm farm( run_block_end - run_block_start );
+    std::vector<MaximumLikelihoodAnalysis*> worker_analyses( farm.getNumberOfWorkers(), mle_analysis );
+    for (size_t w = 1; w < worker_analyses.size(); ++w)
     {
-        
-        // run the i-th stone
-        runSim(i, epsilon);
-        
+        worker_analyses[w] = mle_analysis->clone();
+    }
+    
+    try
+    {
+        // run the simulations
+        farm.run( [&](size_t k, size_t w)
+        {
+            size_t i = run_block_start + k;
+            
+            farm.runExclusively( [&]() { printProgress( i ); } );
+            
+            estimate( *worker_analyses[w], epsilon );
+            
+            // save the estimate with the monitors of our own analysis
+            farm.runExclusively( [&]()
+            {
+                if ( worker_analyses[w] == mle_analysis )
+                {
+                    mle_analysis->monitor( i );
+                }
+                else
+                {
+                    mle_analysis->monitor( i, worker_analyses[w]->getModel() );
+                }
+            } );
+        } );
+    }
+    catch (...)
+    {
+        for (size_t w = 1; w < worker_analyses.size(); ++w)
+        {
+            delete worker_analyses[w];
+        }
+        throw;
+    }
+    
+    for (size_t w = 1; w < worker_analyses.size(); ++w)
+    {
+        delete worker_analyses[w];
     }
     
     
@@ -108,25 +148,14 @@ void BootstrapAnalysis::runAll(double epsilon)
 
 
 
-void BootstrapAnalysis::runSim(size_t idx, double epsilon)
+/**
+ * Bootstrap the clamped stochastic nodes of the model of the analysis a and estimate the parameters.
+ */
+void BootstrapAnalysis::estimate(MaximumLikelihoodAnalysis &a, double epsilon) const
 {
-    // print some info
-    if ( process_active )
-    {
-        size_t digits = size_t( ceil( log10( num_runs ) ) );
-        std::cout << "Sim ";
-        for (size_t d = size_t( ceil( log10( idx+1.1 ) ) ); d < digits; d++ )
-        {
-            std::cout << " ";
-        }
-        std::cout << (idx+1) << " / " << num_runs;
-        std::cout << "\t\t";
-        
-        std::cout << std::endl;
-    }
     
     // get the model of the analysis
-    Model& current_model = mle_analysis->getModel();
+    Model& current_model = a.getModel();
     
     // get the DAG nodes of the model
     std::vector<DagNode *> current_ordered_nodes = current_model.getOrderedStochasticNodes();
@@ -145,22 +174,39 @@ void BootstrapAnalysis::runSim(size_t idx, double epsilon)
     
     
     // now run the analysis
-    mle_analysis->run(epsilon, false);
+    a.run(epsilon, false);
     
-    // save the estimate
-    mle_analysis->monitor( idx );
+}
+
+
+void BootstrapAnalysis::printProgress(size_t idx) const
+{
+    // print some info
+    if ( process_active )
+    {
+        size_t digits = size_t( ceil( log10( num_runs ) ) );
+        std::cout << "Sim ";
+        for (size_t d = size_t( ceil( log10( idx+1.1 ) ) ); d < digits; d++ )
+        {
+            std::cout << " ";
+        }
+        std::cout << (idx+1) << " / " << num_runs;
+        std::cout << "\t\t";
+        
+        std::cout << std::endl;
+    }
     
+}
+
+
+void BootstrapAnalysis::runSim(size_t idx, double epsilon)
+{
     
-//    for (size_t j = 0; j < current_ordered_nodes.size(); ++j)
-//    {
-//        DagNode *the_node = current_ordered_nodes[j];
-//        
-//        if ( the_node->isStochastic() == true && the_node->isClamped() )
-//        {
-//            the_node->bootstrap();
-//        }
-//        
-//    }
+    printProgress( idx );
+    
+    estimate( *mle_analysis, epsilon );
+    
+    // save the estimate
+    mle_analysis->monitor( idx );
     
 }
-
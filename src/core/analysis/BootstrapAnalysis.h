@@ -39,6 +39,9 @@ namespace RevBayesCore {
         
     private:
         
+        void                                    estimate(MaximumLikelihoodAnalysis &a, double e) const;     //!< Bootstrap the data of the model of a and estimate the parameters
+        void                                    printProgress(size_t idx) const;
+        
         // members
         size_t                                  num_runs;
         MaximumLikelihoodAnalysis*              mle_analysis;
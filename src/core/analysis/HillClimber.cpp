@@ -17,6 +17,7 @@
 
 #include <cmath>
 #include <iomanip>
+#include <map>
 #include <sstream>
 #include <typeinfo>
 #include "SequentialMoveSchedule.h"
@@ -475,6 +476,55 @@ void HillClimber::monitor(unsigned long g)
 }
 
 
+/**
+ * Monitor the values of the model m instead of our own model, where m is a copy of our model (e.g., estimated in another thread).
+ * We temporarily attach the monitors to the nodes of m with the same names.
+ * Note that we cannot use setModel() of the monitors, because some monitors then reset their variables.
+ */
+void HillClimber::monitor(unsigned long g, Model &m)
+{
+    
+    if ( process_active == false )
+    {
+        return;
+    }
+    
+    std::map<std::string, DagNode*> other_nodes;
+    const std::vector<DagNode*> &m_nodes = m.getDagNodes();
+    for (size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        if ( m_nodes[i]->getName() != "" )
+        {
+            other_nodes[ m_nodes[i]->getName() ] = m_nodes[i];
+        }
+    }
+    
+    for (size_t i = 0; i < monitors.size(); i++)
+    {
+        std::vector<DagNode*> own_nodes = monitors[i].getDagNodes();
+        std::vector<DagNode*> swapped_nodes;
+        for (size_t j = 0; j < own_nodes.size(); ++j)
+        {
+            std::map<std::string, DagNode*>::const_iterator it = other_nodes.find( own_nodes[j]->getName() );
+            if ( it == other_nodes.end() )
+            {
+                throw RbException("Could not find the variable '" + own_nodes[j]->getName() + "' in the copy of the model.");
+            }
+            monitors[i].swapNode( own_nodes[j], it->second );
+            swapped_nodes.push_back( it->second );
+        }
+        
+        monitors[i].monitor( g );
+        
+        for (size_t j = 0; j < own_nodes.size(); ++j)
+        {
+            monitors[i].swapNode( swapped_nodes[j], own_nodes[j] );
+        }
+    }
+    
+}
+
+
 void HillClimber::nextCycle( void )
 {
     
@@ -47,6 +47,7 @@ namespace RevBayesCore {
         bool                                                hasConverged(double m);
         void                                                initializeSampler(void);                                                                //!< Initialize objects for HillClimber sampling
         void                                                monitor(unsigned long g);
+        void                                                monitor(unsigned long g, Model &m);                                                     //!< Monitor the values of another copy of our model
         void                                                nextCycle(void);
         void                                                removeMonitors(void);
         void                                                reset(void);                                                                            //!< Reset the sampler and set all the counters back to 0.
@@ -136,6 +136,13 @@ void MaximumLikelihoodAnalysis::monitor( size_t i ) const
 }
 
 
+void MaximumLikelihoodAnalysis::monitor( size_t i, Model &m ) const
+{
+    
+    estimator->monitor( i, m );
+}
+
+
 void MaximumLikelihoodAnalysis::run( double epsilon, bool verbose )
 {
     
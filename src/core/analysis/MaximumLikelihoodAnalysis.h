@@ -47,6 +47,7 @@ namespace RevBayesCore {
         Model&                                              getModel(void);
         const Model&                                        getModel(void) const;
         void                                                monitor(size_t i) const;
+        void                                                monitor(size_t i, Model &m) const;                              //!< Monitor the values of another copy of the model
 //        void                                                printPerformanceSummary(void) const;
 //        void                                                removeMonitors(void);                                           //!< Remove all monitors
         void                                                run(double e, bool verbose=true);
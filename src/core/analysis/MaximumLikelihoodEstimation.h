@@ -51,6 +51,7 @@ namespace RevBayesCore {
         virtual bool                            hasConverged(double m) = 0;                         //!< Has the estimator converged to the maximum likelihood value
         virtual void                            initializeSampler(void) = 0;                        //!< Initialize objects for mcmc sampling
         virtual void                            monitor(unsigned long g) = 0;
+        virtual void                            monitor(unsigned long g, Model &m) = 0;            //!< Monitor the values of another copy of the model
         virtual void                            nextCycle(void) = 0;
         virtual void                            removeMonitors(void) = 0;
         virtual void                            reset(void) = 0;                                    //!< Reset the sampler for a new run.
@@ -7,6 +7,7 @@
 #include "MonteCarloSampler.h"
 #include "ProgressBar.h"
 #include "RlUserInterface.h"
+#include "ThreadPool.h"
 
 #include <algorithm>
 #include <cmath>
@@ -35,7 +36,8 @@ MonteCarloAnalysis::MonteCarloAnalysis(MonteCarloSampler *m, size_t r, MonteCarl
 MonteCarloAnalysis::MonteCarloAnalysis(const MonteCarloAnalysis &a) : Cloneable(), Parallelizable(a),
     replicates( a.replicates ),
     runs(a.replicates,NULL),
-    trace_combination( a.trace_combination )
+    trace_combination( a.trace_combination ),
+    replicate_jobs( a.replicate_jobs )
 {
     
     // create replicate Monte Carlo samplers
@@ -91,6 +93,7 @@ MonteCarloAnalysis& MonteCarloAnalysis::operator=(const MonteCarloAnalysis &a)
         
         replicates          = a.replicates;
         trace_combination   = a.trace_combination;
+        replicate_jobs      = a.replicate_jobs;
         
         // create replicate Monte Carlo samplers
         for (size_t i=0; i < replicates; ++i)
@@ -186,20 +189,27 @@ void MonteCarloAnalysis::burnin(size_t generations, size_t tuningInterval, bool
     }
     
     
-    // Run the chain
-    for (size_t k=1; k<=generations; ++k)
+    if ( runsReplicatesInParallel() == true )
     {
         
-        if ( verbose == true && process_active == true)
+        // the replicates do not interact during the burnin, so each replicate runs all its iterations at once
+        size_t progress_run = 0;
+        while ( progress_run < replicates && runs[progress_run] == NULL )
         {
-            progress.update(k);
+            ++progress_run;
         }
         
-        for (size_t i=0; i<replicates; ++i)
+        runReplicates( [&](size_t i)
         {
             
-            if ( runs[i] != NULL )
+            for (size_t k=1; k<=generations; ++k)
             {
+                
+                if ( verbose == true && process_active == true && i == progress_run )
+                {
+                    progress.update(k);
+                }
+                
                 runs[i]->nextCycle(false);
                 
                 // check for autotuning
@@ -210,6 +220,38 @@ void MonteCarloAnalysis::burnin(size_t generations, size_t tuningInterval, bool
                 
             }
             
+        } );
+        
+    }
+    else
+    {
+        
+        // Run the chain
+        for (size_t k=1; k<=generations; ++k)
+        {
+            
+            if ( verbose == true && process_active == true)
+            {
+                progress.update(k);
+            }
+            
+            for (size_t i=0; i<replicates; ++i)
+            {
+                
+                if ( runs[i] != NULL )
+                {
+                    runs[i]->nextCycle(false);
+                    
+                    // check for autotuning
+                    if ( k % tuningInterval == 0 && k != generations )
+                    {
+                        runs[i]->tune();
+                    }
+                    
+                }
+                
+            }
+            
         }
         
     }
@@ -699,39 +741,32 @@ void MonteCarloAnalysis::run( size_t kIterations, RbVector<StoppingRule> rules,
     do {
         
         ++gen;
-        for (size_t i=0; i<replicates; ++i)
+        runReplicates( [&](size_t i)
         {
             
-            if ( runs[i] != NULL )
+            // Sebastian: this call is very slow; a lot of work happens in nextCycle()
+            runs[i]->nextCycle(true);
+            
+            // Monitor
+            runs[i]->monitor(gen);
+            
+            // check for autotuning
+            if ( tuning_interval != 0 && (gen % tuning_interval) == 0 )
             {
                 
-                // @todo: #thread
-                // This part should be done on several threads if possible
-                // Sebastian: this call is very slow; a lot of work happens in nextCycle()
-                runs[i]->nextCycle(true);
+                runs[i]->tune();
                 
-                // Monitor
-                runs[i]->monitor(gen);
-                
-                // check for autotuning
-                if ( tuning_interval != 0 && (gen % tuning_interval) == 0 )
-                {
-                    
-                    runs[i]->tune();
-                    
-                }
+            }
+            
+            // check for autotuning
+            if ( checkpoint_interval != 0 && (gen % checkpoint_interval) == 0 )
+            {
                 
-                // check for autotuning
-                if ( checkpoint_interval != 0 && (gen % checkpoint_interval) == 0 )
-                {
-                    
-                    runs[i]->checkpoint();
-                    
-                }
+                runs[i]->checkpoint();
                 
             }
             
-        }
+        } );
         
         converged = true;
         size_t numConvergenceRules = 0;
@@ -895,25 +930,21 @@ void MonteCarloAnalysis::runPriorSampler( size_t kIterations, RbVector<StoppingR
     bool converged = false;
     do {
         ++gen;
-        for (size_t i=0; i<replicates; ++i)
+        runReplicates( [&](size_t i)
         {
-            if ( runs[i] != NULL )
+            runs[i]->nextCycle(true);
+            
+            // Monitor
+            runs[i]->monitor(gen);
+            
+            // check for autotuning
+            if ( tuning_interval != 0 && (gen % tuning_interval) == 0 )
             {
-                runs[i]->nextCycle(true);
                 
-                // Monitor
-                runs[i]->monitor(gen);
+                runs[i]->tune();
                 
-                // check for autotuning
-                if ( tuning_interval != 0 && (gen % tuning_interval) == 0 )
-                {
-                    
-                    runs[i]->tune();
-                    
-                }
             }
-
-        }
+        } );
         
         converged = true;
         size_t numConvergenceRules = 0;
@@ -965,6 +996,63 @@ void MonteCarloAnalysis::runPriorSampler( size_t kIterations, RbVector<StoppingR
 }
 
 
+/**
+ * Call f(i) for each replicate i that this process runs.
+ * The replicates are independent, so if there are several and we have several threads we run them as jobs on the thread pool.
+ * Each replicate then draws from its own random number stream, so the samples do not depend on the number of threads.
+ * Otherwise the replicates run one after the other on the global random number generator (and a single replicate may use the threads for its likelihood computations).
+ */
+void MonteCarloAnalysis::runReplicates(const std::function<void (size_t)> &f)
+{
+    
+    if ( runsReplicatesInParallel() == false )
+    {
+        for (size_t i=0; i<replicates; ++i)
+        {
+            if ( runs[i] != NULL )
+            {
+                f(i);
+            }
+        }
+        return;
+    }
+    
+    if ( replicate_jobs.getNumberOfJobs() != replicates )
+    {
+        replicate_jobs = JobFarm( replicates );
+    }
+    
+    replicate_jobs.run( [&](size_t i, size_t w)
+    {
+        if ( runs[i] != NULL )
+        {
+            f(i);
+        }
+    } );
+    
+}
+
+
+/**
+ * Do we run the replicates of this process as parallel jobs?
+ * This is the case if this process runs several replicates and we have several threads.
+ */
+bool MonteCarloAnalysis::runsReplicatesInParallel( void ) const
+{
+    
+    size_t num_local_runs = 0;
+    for (size_t i=0; i<replicates; ++i)
+    {
+        if ( runs[i] != NULL )
+        {
+            ++num_local_runs;
+        }
+    }
+    
+    return num_local_runs > 1 && ThreadPool::globalInstance().getNumberOfThreads() > 1;
+}
+
+
 /**
  * Set the active PID of this specific Monte Carlo analysis.
  */
@@ -1007,3 +1095,17 @@ void MonteCarloAnalysis::setModel(Model *m, bool redraw)
     resetReplicates();
     
 }
+
+
+/**
+ * Write the time spent in the moves and probability computations of the first replicate to a file.
+ */
+void MonteCarloAnalysis::writeProfile( const std::string &fn, const std::string &format ) const
+{
+    
+    if ( runs[0] != NULL )
+    {
+        runs[0]->writeProfile( fn, format );
+    }
+    
+}
@@ -2,12 +2,14 @@
 #define MonteCarloAnalysis_H
 
 #include "Cloneable.h"
+#include "JobFarm.h"
 #include "MonteCarloAnalysisOptions.h"
 #include "Parallelizable.h"
 #include "RbVector.h"
 #include "StoppingRule.h"
 #include "Trace.h"
 
+#include <functional>
 #include <vector>
 
 
@@ -65,14 +67,18 @@ namespace RevBayesCore {
 #endif
         void                                                runPriorSampler(size_t k, RbVector<StoppingRule> r, size_t ti);
         void                                                setModel(Model *m, bool redraw);
+        void                                                writeProfile(const std::string &fn, const std::string &format) const; //!< Write the time spent in the moves to a file
         
     protected:
         void                                                setActivePIDSpecialized(size_t i, size_t n);                    //!< Set the number of processes for this class.
         void                                                resetReplicates(void);
+        void                                                runReplicates(const std::function<void (size_t)> &f);           //!< Call f(i) for the replicates of this process, in parallel if there are several
+        bool                                                runsReplicatesInParallel(void) const;                           //!< Do we run the replicates of this process as parallel jobs?
         
         size_t                                              replicates;
         std::vector<MonteCarloSampler*>                     runs;
         MonteCarloAnalysisOptions::TraceCombinationTypes    trace_combination;
+        JobFarm                                             replicate_jobs;                                                 //!< Runs the replicates in parallel, each with its own random number stream
     };
     
     // Global functions using the class
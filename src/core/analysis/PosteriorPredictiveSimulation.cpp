@@ -1,5 +1,6 @@
 #include "DagNode.h"
 #include "HomologousDiscreteCharacterData.h"
+#include "JobFarm.h"
 #include "PosteriorPredictiveSimulation.h"
 #include "StateDependentSpeciationExtinctionProcess.h"
 #include "RbFileManager.h"
@@ -69,8 +70,6 @@ void RevBayesCore::PosteriorPredictiveSimulation::run( int thinning )
     }
 
     
-    std::vector<DagNode*> nodes = model.getDagNodes();
-
     size_t sim_pid_start = size_t(floor( (double(pid) / num_processes * n_samples ) ) );
     size_t sim_pid_end   = std::max( int(sim_pid_start), int(floor( (double(pid+1) / num_processes * n_samples ) ) - 1) );
     
@@ -78,113 +77,153 @@ void RevBayesCore::PosteriorPredictiveSimulation::run( int thinning )
     while ( index_sample % thinning > 0 ) ++index_sample;
     size_t current_pp_sim = size_t( floor( index_sample / thinning ) );
     
-    
+    // collect the samples for which this process simulates
+    std::vector<size_t> samples;
+    std::vector<size_t> pp_sims;
     for ( ; index_sample <= sim_pid_end; ++current_pp_sim, index_sample += thinning)
     {
-        
-        
-        // create a new directory name for this simulation
-        std::stringstream s;
-        s << directory << path_separator << "posterior_predictive_sim_" << (current_pp_sim + 1);
-        std::string sim_directory_name = s.str();
-        
-        // now for the numerical parameters
-        for ( size_t j=0; j<n_traces; ++j )
+        samples.push_back( index_sample );
+        pp_sims.push_back( current_pp_sim );
+    }
+    
+    // the simulations are independent, so we run them in parallel with one copy of the model per worker
+    JobFarm farm( samples.size() );
+    size_t num_workers = farm.getNumberOfWorkers();
+    std::vector<Model*> worker_models( num_workers, &model );
+    for (size_t w = 1; w < num_workers; ++w)
+    {
+        worker_models[w] = model.clone();
+    }
+    
+    try
+    {
+        farm.run( [&](size_t j, size_t w)
         {
-            std::string parameter_name = traces[j].getParameterName();
+            size_t index_sample = samples[j];
+            std::vector<DagNode*> nodes = worker_models[w]->getDagNodes();
             
-            // iterate over all DAG nodes (variables)
-            for ( std::vector<DagNode*>::iterator it = nodes.begin(); it!=nodes.end(); ++it )
+            // create a new directory name for this simulation
+            std::stringstream s;
+            s << directory << path_separator << "posterior_predictive_sim_" << (pp_sims[j] + 1);
+            std::string sim_directory_name = s.str();
+            
+            // now for the numerical parameters
+            for ( size_t k=0; k<n_traces; ++k )
             {
-                DagNode *the_node = *it;
+                std::string parameter_name = traces[k].getParameterName();
                 
-                if ( the_node->getName() == parameter_name )
+                // iterate over all DAG nodes (variables)
+                for ( std::vector<DagNode*>::iterator it = nodes.begin(); it!=nodes.end(); ++it )
                 {
-                    // set the value for the variable with the i-th sample
-                    the_node->setValueFromString( traces[j].objectAt( index_sample ) );
+                    DagNode *the_node = *it;
+                    
+                    if ( the_node->getName() == parameter_name )
+                    {
+                        // set the value for the variable with the i-th sample
+                        the_node->setValueFromString( traces[k].objectAt( index_sample ) );
+                    }
+                
                 }
             
             }
-        
-        }
-        
-        // next we need to simulate the data and store it
-        // iterate over all DAG nodes (variables)
-        for ( std::vector<DagNode*>::iterator it = nodes.begin(); it!=nodes.end(); ++it )
-        {
-            DagNode *the_node = *it;
             
-            if ( the_node->isClamped() == true )
+            // next we need to simulate the data and store it
+            // iterate over all DAG nodes (variables)
+            for ( std::vector<DagNode*>::iterator it = nodes.begin(); it!=nodes.end(); ++it )
             {
-                // check if the PP simulation must condition on sampled tip states
-                if (condition_on_tips == true && typeid(the_node->getDistribution()) == typeid(StateDependentSpeciationExtinctionProcess))
+                DagNode *the_node = *it;
+                
+                if ( the_node->isClamped() == true )
                 {
-                    // set the tip states to the values sampled during this iteration
-                    AncestralStateTrace* tip_state_trace;
-                    StateDependentSpeciationExtinctionProcess* sse = static_cast<StateDependentSpeciationExtinctionProcess*>( &the_node->getDistribution() );
-                    std::vector<std::string> tips = sse->getValue().getTipNames();
-                    size_t num_states = static_cast<TreeDiscreteCharacterData*>( &sse->getValue() )->getCharacterData().getNumberOfStates();
-                    HomologousDiscreteCharacterData<NaturalNumbersState> *tip_data = new HomologousDiscreteCharacterData<NaturalNumbersState>();
-
-                    // read the ancestral state trace
-                    for (size_t i = 0; i < tips.size(); ++i)
+                    // check if the PP simulation must condition on sampled tip states
+                    if (condition_on_tips == true && typeid(the_node->getDistribution()) == typeid(StateDependentSpeciationExtinctionProcess))
                     {
-                        size_t tip_index = sse->getValue().getTipIndex(tips[i]);
-                        std::string tip_index_anc_str = StringUtilities::toString(tip_index + 1);
-                        std::string tip_index_end_str = "end_" + StringUtilities::toString(tip_index + 1);
-  
-                        if (ancestral_state_traces_lookup.find(tip_index_anc_str) != ancestral_state_traces_lookup.end())
+                        // set the tip states to the values sampled during this iteration
+                        AncestralStateTrace* tip_state_trace;
+                        StateDependentSpeciationExtinctionProcess* sse = static_cast<StateDependentSpeciationExtinctionProcess*>( &the_node->getDistribution() );
+                        std::vector<std::string> tips = sse->getValue().getTipNames();
+                        size_t num_states = static_cast<TreeDiscreteCharacterData*>( &sse->getValue() )->getCharacterData().getNumberOfStates();
+                        HomologousDiscreteCharacterData<NaturalNumbersState> *tip_data = new HomologousDiscreteCharacterData<NaturalNumbersState>();
+
+                        // read the ancestral state trace
+                        for (size_t i = 0; i < tips.size(); ++i)
                         {
-                            size_t idx = ancestral_state_traces_lookup[tip_index_anc_str];
-                            tip_state_trace = &ancestral_state_traces[idx];
+                            size_t tip_index = sse->getValue().getTipIndex(tips[i]);
+                            std::string tip_index_anc_str = StringUtilities::toString(tip_index + 1);
+                            std::string tip_index_end_str = "end_" + StringUtilities::toString(tip_index + 1);
+      
+                            if (ancestral_state_traces_lookup.find(tip_index_anc_str) != ancestral_state_traces_lookup.end())
+                            {
+                                size_t idx = ancestral_state_traces_lookup.find(tip_index_anc_str)->second;
+                                tip_state_trace = &ancestral_state_traces[idx];
+                            }
+                            else if (ancestral_state_traces_lookup.find(tip_index_end_str) != ancestral_state_traces_lookup.end())
+                            {
+                                size_t idx = ancestral_state_traces_lookup.find(tip_index_end_str)->second;
+                                tip_state_trace = &ancestral_state_traces[idx];
+                            }
+                            else
+                                throw RbException("Can't find tip_state_trace!");
+                            const std::vector<std::string>& tip_state_vector = tip_state_trace->getValues();
+                            std::string state_str = tip_state_vector[index_sample];
+      
+                            // create a taxon data object for each tip
+                            DiscreteTaxonData<NaturalNumbersState> this_tip_data = DiscreteTaxonData<NaturalNumbersState>(tips[tip_index]);
+                            NaturalNumbersState state = NaturalNumbersState(0, num_states);
+                            state.setState(state_str);
+                            this_tip_data.addCharacter(state);
+                            tip_data->addTaxonData(this_tip_data);
                         }
-                        else if (ancestral_state_traces_lookup.find(tip_index_end_str) != ancestral_state_traces_lookup.end())
-                        {
-                            size_t idx = ancestral_state_traces_lookup[tip_index_end_str];
-                            tip_state_trace = &ancestral_state_traces[idx];
-                        }
-                        else
-                            throw RbException("Can't find tip_state_trace!");
-                        const std::vector<std::string>& tip_state_vector = tip_state_trace->getValues();
-                        std::string state_str = tip_state_vector[index_sample];
-  
-                        // create a taxon data object for each tip
-                        DiscreteTaxonData<NaturalNumbersState> this_tip_data = DiscreteTaxonData<NaturalNumbersState>(tips[tip_index]);
-                        NaturalNumbersState state = NaturalNumbersState(0, num_states);
-                        state.setState(state_str);
-                        this_tip_data.addCharacter(state);
-                        tip_data->addTaxonData(this_tip_data);
+                       
+                        // finally set the tip data to the sampled values
+                        static_cast<TreeDiscreteCharacterData*>( &sse->getValue() )->setCharacterData(tip_data);
                     }
                    
-                    // finally set the tip data to the sampled values
-                    static_cast<TreeDiscreteCharacterData*>( &sse->getValue() )->setCharacterData(tip_data);
-                }
-               
-                try 
-                {
-                    // redraw new values
-                    the_node->redraw();
-                
-                    // we need to store the new simulated data
-                    the_node->writeToFile(sim_directory_name);
-                }
-                catch (RbException &e)
-                {
-                    
-                    std::cerr << "Problem in Posterior Predictive Simulation:" << std::endl;
-                    std::cerr << e.getMessage() << std::endl;
-                    // skip this simulation
-                }
-                catch (...)
-                {
+                    try 
+                    {
+                        // redraw new values
+                        the_node->redraw();
                     
-                    std::cerr << "Problem occurred." << std::endl;
-                    // skip this simulation
+                        // we need to store the new simulated data
+                        the_node->writeToFile(sim_directory_name);
+                    }
+                    catch (RbException &e)
+                    {
+                        
+                        farm.runExclusively( [&]()
+                        {
+                            std::cerr << "Problem in Posterior Predictive Simulation:" << std::endl;
+                            std::cerr << e.getMessage() << std::endl;
+                        } );
+                        // skip this simulation
+                    }
+                    catch (...)
+                    {
+                        
+                        farm.runExclusively( [&]()
+                        {
+                            std::cerr << "Problem occurred." << std::endl;
+                        } );
+                        // skip this simulation
+                    }
                 }
+                
             }
             
+        } ); // end for over all samples
+    }
+    catch (...)
+    {
+        for (size_t w = 1; w < num_workers; ++w)
+        {
+            delete worker_models[w];
         }
-        
-    } // end for over all samples
+        throw;
+    }
+    
+    for (size_t w = 1; w < num_workers; ++w)
+    {
+        delete worker_models[w];
+    }
     
 }
@@ -1,4 +1,5 @@
 #include "DagNode.h"
+#include "JobFarm.h"
 #include "VariableMonitor.h"
 #include "MonteCarloSampler.h"
 #include "MoveSchedule.h"
@@ -10,8 +11,12 @@
 #include "RbConstants.h"
 #include "RbException.h"
 #include "RbFileManager.h"
+#include "RbMathLogic.h"
 #include "RbOptions.h"
+#include "ThreadPool.h"
+#include <algorithm>
 #include <cmath>
+#include <fstream>
 #include <typeinfo>
 #include "SequentialMoveSchedule.h"
 
@@ -27,7 +32,8 @@ PowerPosteriorAnalysis::PowerPosteriorAnalysis(MonteCarloSampler *m, const std::
     powers(),
     sampler( m ),
     sampleFreq( 100 ),
-    processors_per_likelihood( k )
+    processors_per_likelihood( k ),
+    num_adaptive_stones( 0 )
 {
     
     initMPI();
@@ -39,7 +45,8 @@ PowerPosteriorAnalysis::PowerPosteriorAnalysis(const PowerPosteriorAnalysis &a)
     powers( a.powers ),
     sampler( a.sampler->clone() ),
     sampleFreq( a.sampleFreq ),
-    processors_per_likelihood( a.processors_per_likelihood )
+    processors_per_likelihood( a.processors_per_likelihood ),
+    num_adaptive_stones( a.num_adaptive_stones )
 {
     
 }
@@ -70,6 +77,7 @@ PowerPosteriorAnalysis& PowerPosteriorAnalysis::operator=(const PowerPosteriorAn
         sampler                         = a.sampler->clone();
         sampleFreq                      = a.sampleFreq;
         processors_per_likelihood       = a.processors_per_likelihood;
+        num_adaptive_stones             = a.num_adaptive_stones;
         
     }
     
@@ -144,6 +152,134 @@ PowerPosteriorAnalysis* PowerPosteriorAnalysis::clone( void ) const
 }
 
 
+/**
+ * Compute the powers of the next n adaptive stones.
+ * The path sampler integrates the mean log-likelihood over the powers with the trapezoidal rule,
+ * whose error in the interval between two neighbouring powers is h^3 |f''| / 12.
+ * We estimate the curvature f'' from the divided differences of the stone means and split the n intervals with the largest error in half.
+ */
+std::vector<double> PowerPosteriorAnalysis::computeAdaptivePowers(size_t n) const
+{
+    
+    // sort the stones by decreasing power, as in the summary
+    std::vector<size_t> order;
+    for (size_t i = 0; i < powers.size(); ++i)
+    {
+        order.push_back( i );
+    }
+    std::stable_sort( order.begin(), order.end(), [this](size_t a, size_t b) { return powers[a] > powers[b]; } );
+    
+    std::vector<double> beta;
+    std::vector<double> mean;
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        double b = powers[ order[i] ];
+        if ( beta.empty() == false && b == beta.back() )
+        {
+            continue;
+        }
+        
+        double m = computeStoneMean( order[i] );
+        if ( RbMath::isFinite( m ) == false )
+        {
+            std::stringstream ss;
+            ss << "Could not compute the mean log-likelihood of stone " << (order[i]+1) << ", so we cannot place the adaptive stones.";
+            throw RbException( ss.str() );
+        }
+        
+        beta.push_back( b );
+        mean.push_back( m );
+    }
+    
+    if ( beta.size() < 3 )
+    {
+        throw RbException("We need at least three different powers to place adaptive stones.");
+    }
+    
+    // the second divided differences at the inner stones
+    std::vector<double> curvature = std::vector<double>(beta.size(), 0.0);
+    for (size_t i = 1; i < beta.size()-1; ++i)
+    {
+        double slope_left  = (mean[i]   - mean[i-1]) / (beta[i]   - beta[i-1]);
+        double slope_right = (mean[i+1] - mean[i])   / (beta[i+1] - beta[i]);
+        curvature[i] = fabs( 2.0 * (slope_right - slope_left) / (beta[i+1] - beta[i-1]) );
+    }
+    
+    // the error of each interval, using the larger curvature of its two ends (the outer stones have none)
+    std::vector< std::pair<double, size_t> > errors;
+    for (size_t i = 0; i < beta.size()-1; ++i)
+    {
+        double h = beta[i] - beta[i+1];
+        double c = ( curvature[i] > curvature[i+1] ? curvature[i] : curvature[i+1] );
+        errors.push_back( std::make_pair( h * h * h * c / 12.0, i ) );
+    }
+    std::stable_sort( errors.begin(), errors.end(), [](const std::pair<double, size_t> &a, const std::pair<double, size_t> &b) { return a.first > b.first; } );
+    
+    std::vector<double> new_powers;
+    for (size_t k = 0; k < n && k < errors.size(); ++k)
+    {
+        size_t i = errors[k].second;
+        new_powers.push_back( (beta[i] + beta[i+1]) / 2.0 );
+    }
+    
+    return new_powers;
+}
+
+
+/**
+ * The mean of the log-likelihood samples in the file of a stone (or NaN if there are no samples).
+ */
+double PowerPosteriorAnalysis::computeStoneMean(size_t idx) const
+{
+    
+    std::ifstream inStream;
+    inStream.open( getStoneFileName( idx ).c_str(), std::fstream::in );
+    if ( inStream.is_open() == false )
+    {
+        return RbConstants::Double::nan;
+    }
+    
+    double sum = 0.0;
+    size_t n = 0;
+    bool header = true;
+    std::string line = "";
+    while ( std::getline(inStream,line) )
+    {
+        // we need to skip the header line
+        if ( header == true )
+        {
+            header = false;
+            continue;
+        }
+        
+        std::stringstream ss( line );
+        double state = 0.0;
+        double power = 0.0;
+        double likelihood = 0.0;
+        if ( ss >> state >> power >> likelihood )
+        {
+            sum += likelihood;
+            ++n;
+        }
+    }
+    inStream.close();
+    
+    return ( n > 0 ? sum / n : RbConstants::Double::nan );
+}
+
+
+std::string PowerPosteriorAnalysis::getStoneFileName(size_t idx) const
+{
+    
+    RbFileManager fm = RbFileManager(filename);
+    std::string stoneFileName = fm.getFileNameWithoutExtension() + "_stone_" + idx + "." + fm.getFileExtension();
+    
+    RbFileManager f = RbFileManager(fm.getFilePath(), stoneFileName);
+    
+    return f.getFullFileName();
+}
+
+
 void PowerPosteriorAnalysis::initMPI( void )
 {
     
@@ -181,20 +317,35 @@ void PowerPosteriorAnalysis::runAll(size_t gen, double burnin_fraction, size_t p
         std::cout << "Running power posterior analysis ..." << std::endl;
     }
     
-    // compute which block of the data this process needs to compute
-//    size_t stone_block_start = size_t(floor( (double(pid)   / num_processes ) * powers.size()) );
-//    size_t stone_block_end   = size_t(floor( (double(pid+1) / num_processes ) * powers.size()) );
+    // run the stones we were given
+    runStones(0, powers.size(), gen, burnin_fraction, pre_burnin_generations, tuning_interval);
     
-    size_t stone_block_start =  floor( ( floor( pid   /double(processors_per_likelihood)) / (double(num_processes) / processors_per_likelihood) ) * powers.size() );
-    size_t stone_block_end   =  floor( ( ceil( (pid+1)/double(processors_per_likelihood)) / (double(num_processes) / processors_per_likelihood) ) * powers.size() );
-    
-    // Run the chain
-    for (size_t i = stone_block_start; i < stone_block_end; ++i)
+    // add the adaptive stones, in rounds of one stone per thread and group of processes
+    size_t num_groups = num_processes / processors_per_likelihood;
+    size_t stones_per_round = ThreadPool::globalInstance().getNumberOfThreads() * ( num_groups > 1 ? num_groups : 1 );
+    size_t num_added = 0;
+    while ( num_added < num_adaptive_stones )
     {
-    
-        // run the i-th stone
-        runStone(i, gen, burnin_fraction, pre_burnin_generations, tuning_interval);
         
+#ifdef RB_MPI
+        // all processes need the stones of the previous round
+        MPI_Barrier(MPI_COMM_WORLD);
+#endif
+        
+        size_t n = std::min( stones_per_round, num_adaptive_stones - num_added );
+        std::vector<double> new_powers = computeAdaptivePowers( n );
+        
+        size_t first = powers.size();
+        powers.insert( powers.end(), new_powers.begin(), new_powers.end() );
+        
+        if ( process_active == true )
+        {
+            std::cout << "Adding " << new_powers.size() << " stone" << ( new_powers.size() > 1 ? "s" : "" ) << " where the likelihood curve is most curved ..." << std::endl;
+        }
+        
+        runStones(first, powers.size(), gen, burnin_fraction, pre_burnin_generations, tuning_interval);
+        
+        num_added += n;
     }
     
 #ifdef RB_MPI
@@ -211,6 +362,18 @@ void PowerPosteriorAnalysis::runAll(size_t gen, double burnin_fraction, size_t p
 
 
 void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen, double burnin_fraction, size_t pre_burnin_generations, size_t tuning_interval)
+{
+    
+    runStone(idx, *sampler, gen, burnin_fraction, pre_burnin_generations, tuning_interval, true);
+    
+}
+
+
+/**
+ * Run the idx-th stone with the sampler s.
+ * We print the progress of the stone only if we are asked to, because the stones of several threads would otherwise be mixed up on the screen.
+ */
+void PowerPosteriorAnalysis::runStone(size_t idx, MonteCarloSampler &s, size_t gen, double burnin_fraction, size_t pre_burnin_generations, size_t tuning_interval, bool show_progress)
 {
     
     // create the directory if necessary
@@ -219,9 +382,8 @@ void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen, double burnin_frac
     {
         throw(RbException("Please provide a filename with an extension"));
     }
-    std::string stoneFileName = fm.getFileNameWithoutExtension() + "_stone_" + idx + "." + fm.getFileExtension();
 
-    RbFileManager f = RbFileManager(fm.getFilePath(), stoneFileName);
+    RbFileManager f = RbFileManager( getStoneFileName( idx ) );
     f.createDirectoryForFile();
     
     std::fstream outStream;
@@ -229,7 +391,7 @@ void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen, double burnin_frac
     outStream << "state\t" << "power\t" << "likelihood" << std::endl;
     
     // reset the sampler
-    sampler->reset();
+    s.reset();
 
     
     size_t burnin = size_t( ceil( burnin_fraction*gen ) );
@@ -238,7 +400,7 @@ void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen, double burnin_frac
     size_t digits = size_t( ceil( log10( powers.size() ) ) );
     
     // print output for users
-    if ( process_active ==true )
+    if ( process_active == true && show_progress == true )
     {
         std::cout << "Step ";
         for (size_t d = size_t( ceil( log10( idx+1.1 ) ) ); d < digits; d++ )
@@ -250,36 +412,36 @@ void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen, double burnin_frac
     }
     
     // set the power of this sampler
-    sampler->setLikelihoodHeat( powers[idx] );
+    s.setLikelihoodHeat( powers[idx] );
     
     std::stringstream ss;
     ss << "_stone_" << idx;
-    sampler->addFileMonitorExtension( ss.str(), false);
+    s.addFileMonitorExtension( ss.str(), false);
     
     // let's do a pre-burnin
     for (size_t k=1; k<=pre_burnin_generations; k++)
     {
         
-        sampler->nextCycle(false);
+        s.nextCycle(false);
         
         // check for autotuning
         if ( k % tuning_interval == 0 && k != pre_burnin_generations )
         {
-            sampler->tune();
+            s.tune();
         }
         
     }
     
     // Monitor
-    sampler->startMonitors(gen, false);
-    sampler->writeMonitorHeaders( false );
-    sampler->monitor(0);
+    s.startMonitors(gen, false);
+    s.writeMonitorHeaders( false );
+    s.monitor(0);
     
     double p = powers[idx];
     for (size_t k=1; k<=gen; ++k)
     {
         
-        if ( process_active == true )
+        if ( process_active == true && show_progress == true )
         {
             if ( k % printInterval == 0 )
             {
@@ -288,22 +450,22 @@ void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen, double burnin_frac
             }
         }
         
-        sampler->nextCycle( true );
+        s.nextCycle( true );
 
         // Monitor
-        sampler->monitor(k);
+        s.monitor(k);
         
         // sample the likelihood
         if ( k > burnin && k % sampleFreq == 0 )
         {
             // compute the joint likelihood
-            double likelihood = sampler->getModelLnProbability(true);
+            double likelihood = s.getModelLnProbability(true);
             outStream << k << "\t" << p << "\t" << likelihood << std::endl;
         }
             
     }
     
-    if ( process_active == true )
+    if ( process_active == true && show_progress == true )
     {
         std::cout << std::endl;
     }
@@ -311,7 +473,96 @@ void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen, double burnin_frac
     outStream.close();
     
     // Monitor
-    sampler->finishMonitors( 1, MonteCarloAnalysisOptions::NONE );
+    s.finishMonitors( 1, MonteCarloAnalysisOptions::NONE );
+    
+}
+
+
+/**
+ * Run the stones [first,last), or rather the block of them that this process needs to compute.
+ * As in a plain power posterior analysis, each stone continues from the state in which the previous stone ended.
+ * With a single thread we run the stones one after the other in their order, as before.
+ * With several threads we sort the stones by decreasing power and split them into one contiguous chain of stones per thread.
+ * Each chain starts from the current state of the sampler (the first chain with the sampler itself, the others with a copy) and runs its stones one after the other.
+ * The chains are fixed in advance (and not stolen by idle threads), so the results only depend on the seed and the number of threads.
+ */
+void PowerPosteriorAnalysis::runStones(size_t first, size_t last, size_t gen, double burnin_fraction, size_t pre_burnin_generations, size_t tuning_interval)
+{
+    
+    // compute which block of the stones this process needs to compute
+    size_t num_stones = last - first;
+    size_t stone_block_start = first + size_t( floor( ( floor( pid   /double(processors_per_likelihood)) / (double(num_processes) / processors_per_likelihood) ) * num_stones ) );
+    size_t stone_block_end   = first + size_t( floor( ( ceil( (pid+1)/double(processors_per_likelihood)) / (double(num_processes) / processors_per_likelihood) ) * num_stones ) );
+    
+    std::vector<size_t> stones;
+    for (size_t i = stone_block_start; i < stone_block_end; ++i)
+    {
+        stones.push_back( i );
+    }
+    
+    size_t num_chains = std::min( ThreadPool::globalInstance().getNumberOfThreads(), stones.size() );
+    
+    if ( num_chains <= 1 )
+    {
+        for (size_t k = 0; k < stones.size(); ++k)
+        {
+            runStone(stones[k], *sampler, gen, burnin_fraction, pre_burnin_generations, tuning_interval, true);
+        }
+        return;
+    }
+    
+    std::stable_sort( stones.begin(), stones.end(), [this](size_t a, size_t b) { return powers[a] > powers[b]; } );
+    
+    // the first chain continues with our own sampler, the other chains with a copy of it
+    std::vector<MonteCarloSampler*> chain_samplers( num_chains, sampler );
+    for (size_t c = 1; c < num_chains; ++c)
+    {
+        chain_samplers[c] = sampler->clone();
+    }
+    
+    // with several threads we only report when a stone is finished
+    size_t digits = size_t( ceil( log10( powers.size() ) ) );
+    
+    try
+    {
+        JobFarm chain_farm( num_chains );
+        chain_farm.run( [&](size_t c, size_t w)
+        {
+            size_t chain_start = ( stones.size() * c ) / num_chains;
+            size_t chain_end   = ( stones.size() * (c+1) ) / num_chains;
+            for (size_t k = chain_start; k < chain_end; ++k)
+            {
+                size_t idx = stones[k];
+                runStone(idx, *chain_samplers[c], gen, burnin_fraction, pre_burnin_generations, tuning_interval, false);
+                
+                if ( process_active == true )
+                {
+                    chain_farm.runExclusively( [&]()
+                    {
+                        std::cout << "Step ";
+                        for (size_t d = size_t( ceil( log10( idx+1.1 ) ) ); d < digits; d++ )
+                        {
+                            std::cout << " ";
+                        }
+                        std::cout << (idx+1) << " / " << powers.size() << "\t\t(power " << powers[idx] << ")" << std::endl;
+                    } );
+                }
+            }
+        } );
+    }
+    catch (...)
+    {
+        for (size_t c = 1; c < num_chains; ++c)
+        {
+            delete chain_samplers[c];
+        }
+        throw;
+    }
+    
+    for (size_t c = 1; c < num_chains; ++c)
+    {
+        delete chain_samplers[c];
+    }
     
 }
 
@@ -326,17 +577,23 @@ void PowerPosteriorAnalysis::summarizeStones( void )
     outStream.open( f.getFullFileName().c_str(), std::fstream::out);
     outStream << "state\t" << "power\t" << "likelihood" << std::endl;
 
-    // Append each stone
+    // the estimators expect the stones ordered by decreasing power (the adaptive stones were appended at the end)
+    std::vector<size_t> order;
     for (size_t idx = 0; idx < powers.size(); ++idx)
     {
-        RbFileManager fm = RbFileManager(filename);
-        std::string stoneFileName = fm.getFileNameWithoutExtension() + "_stone_" + idx + "." + fm.getFileExtension();
-        
-        RbFileManager f = RbFileManager(fm.getFilePath(), stoneFileName);
+        order.push_back( idx );
+    }
+    std::stable_sort( order.begin(), order.end(), [this](size_t a, size_t b) { return powers[a] > powers[b]; } );
+    
+    // Append each stone
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        size_t idx = order[i];
+        std::string stoneFileName = getStoneFileName( idx );
 
         // read the i-th stone
         std::ifstream inStream;
-        inStream.open( f.getFullFileName().c_str(), std::fstream::in);
+        inStream.open( stoneFileName.c_str(), std::fstream::in);
         if (inStream.is_open())
         {
             bool header = true;
@@ -369,6 +626,12 @@ void PowerPosteriorAnalysis::summarizeStones( void )
 }
 
 
+void PowerPosteriorAnalysis::setAdaptiveStones(size_t n)
+{
+    num_adaptive_stones = n;
+}
+
+
 void PowerPosteriorAnalysis::setPowers(const std::vector<double> &p)
 {
     powers = p;
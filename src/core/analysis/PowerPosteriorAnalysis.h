@@ -16,6 +16,15 @@ namespace RevBayesCore {
      * where the likelihood during each analysis run is raised to the given power.
      * The likelihood values and the current powers are stored in a file.
      *
+     * With a single thread, the stones run in order on the sampler, each continuing where the previous one ended.
+     * With several threads, the stones are sorted by decreasing power and split into one contiguous chain of (about) equally many stones per thread.
+     * Each chain runs its stones one after the other on its own copy of the sampler, so that the results only depend on the seed and the number of threads.
+     * The chains are fixed in advance and there is no dynamic load balancing (e.g. work stealing) between the threads:
+     * stones with a large power mix slowest, so the thread with the chain of the largest powers usually finishes last while the other threads idle.
+     * Optionally, we add further stones (in rounds of as many stones as we have threads) in the intervals
+     * where the mean log-likelihood curve is most curved, i.e., where the numerical integration error is largest.
+     * The additional powers are appended to the powers, and the stones are sorted by power when they are summarized.
+     *
      *
      * @copyright Copyright 2009-
      * @author The RevBayes Development Core Team (Sebastian Hoehna)
@@ -37,12 +46,18 @@ namespace RevBayesCore {
         void                                    runAll(size_t g, double burn_frac, size_t preburn_gen, size_t tune_int);
         void                                    runStone(size_t idx, size_t g, double burn_frac, size_t preburn_gen, size_t tune_int);
         void                                    summarizeStones(void);
+        void                                    setAdaptiveStones(size_t n);                                                    //!< Set the number of stones added where the likelihood curve is most curved
         void                                    setPowers(const std::vector<double> &p);
         void                                    setSampleFreq(size_t sf);
         
     private:
         
+        std::vector<double>                     computeAdaptivePowers(size_t n) const;                                          //!< Compute the powers of the next n adaptive stones
+        double                                  computeStoneMean(size_t idx) const;                                             //!< The mean log-likelihood of the samples of a stone
+        std::string                             getStoneFileName(size_t idx) const;
         void                                    initMPI(void);
+        void                                    runStone(size_t idx, MonteCarloSampler &s, size_t g, double burn_frac, size_t preburn_gen, size_t tune_int, bool show_progress);
+        void                                    runStones(size_t first, size_t last, size_t g, double burn_frac, size_t preburn_gen, size_t tune_int);
         
         // members
         std::string                             filename;
@@ -50,6 +65,7 @@ namespace RevBayesCore {
         MonteCarloSampler*                      sampler;
         size_t                                  sampleFreq;                                                                     //!< The rate of the distribution
         size_t                                  processors_per_likelihood;
+        size_t                                  num_adaptive_stones;
 
     };
     
@@ -1,6 +1,7 @@
 #include "DagNode.h"
 #include "DistributionBinomial.h"
 #include "DistributionUniform.h"
+#include "JobFarm.h"
 #include "MaxIterationStoppingRule.h"
 #include "MonteCarloAnalysis.h"
 #include "MonteCarloSampler.h"
@@ -216,9 +217,12 @@ void ValidationAnalysis::burnin(size_t generations, size_t tuningInterval)
     size_t run_block_end   = std::max( int(run_block_start), int(floor( (double(pid+1) / num_processes ) * num_runs) ) - 1);
     
     // Run the chain
-    size_t numStars = 0;
-    for (size_t i = run_block_start; i <= run_block_end; ++i)
+    // the simulations are independent and have their own models, so we run them in parallel
+    size_t num_finished = 0;
+    JobFarm farm( run_block_end - run_block_start + 1 );
+    farm.run( [&](size_t j, size_t w)
     {
+        size_t i = run_block_start + j;
         if ( runs[i] == NULL ) std::cerr << "Runing bad burnin (pid=" << pid <<", run="<< i << ") of runs.size()=" << runs.size() << "." << std::endl;
         // run the i-th analyses
 #ifdef RB_MPI
@@ -226,14 +230,16 @@ void ValidationAnalysis::burnin(size_t generations, size_t tuningInterval)
 #else
         runs[i]->burnin(generations, tuningInterval, false, false);
 #endif
-        if ( process_active == true )
+        farm.runExclusively( [&]()
         {
-            progress.update( i );
-            
-        }
-        
+            ++num_finished;
+            if ( process_active == true )
+            {
+                progress.update( num_finished );
+            }
+        } );
         
-    }
+    } );
     
     if ( process_active == true )
     {
@@ -266,13 +272,34 @@ void ValidationAnalysis::runAll(size_t gen)
     size_t run_block_end   = std::max( int(run_block_start), int(floor( (double(pid+1) / num_processes ) * num_runs) ) - 1);
     
     // Run the chain
-    for (size_t i = run_block_start; i <= run_block_end; ++i)
+    // the simulations are independent and have their own models, so we run them in parallel
+    JobFarm farm( run_block_end - run_block_start + 1 );
+    farm.run( [&](size_t j, size_t w)
     {
+        size_t i = run_block_start + j;
+        
+        // print some info
+        farm.runExclusively( [&]()
+        {
+            if ( process_active )
+            {
+                size_t digits = size_t( ceil( log10( num_runs ) ) );
+                std::cout << "Sim ";
+                for (size_t d = size_t( ceil( log10( i+1.1 ) ) ); d < digits; d++ )
+                {
+                    std::cout << " ";
+                }
+                std::cout << (i+1) << " / " << num_runs;
+                std::cout << "\t\t";
+                
+                std::cout << std::endl;
+            }
+        } );
         
-        // run the i-th stone
+        // run the i-th simulation
         runSim(i, gen);
         
-    }    
+    } );
     
 }
 
@@ -280,20 +307,6 @@ void ValidationAnalysis::runAll(size_t gen)
 
 void ValidationAnalysis::runSim(size_t idx, size_t gen)
 {
-    // print some info
-    if ( process_active )
-    {
-        size_t digits = size_t( ceil( log10( num_runs ) ) );
-        std::cout << "Sim ";
-        for (size_t d = size_t( ceil( log10( idx+1.1 ) ) ); d < digits; d++ )
-        {
-            std::cout << " ";
-        }
-        std::cout << (idx+1) << " / " << num_runs;
-        std::cout << "\t\t";
-        
-        std::cout << std::endl;
-    }
     
     // get the current sample
     MonteCarloAnalysis *analysis = runs[idx];
@@ -0,0 +1,326 @@
+#include "BinaryCheckpointFile.h"
+#include "RbException.h"
+#include "RbFileManager.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#	ifdef RB_WIN
+#include <io.h>
+#include <windows.h>
+#   else
+#include <fcntl.h>
+#include <unistd.h>
+#   endif
+
+using namespace RevBayesCore;
+
+
+namespace {
+
+    const char      checkpoint_magic[8] = { 'R', 'B', 'C', 'H', 'K', 'P', 'T', '\0' };
+    const size_t    header_size         = 8 + 4 + 8;
+    const size_t    footer_size         = 8;
+
+    void appendLittleEndian(std::string &s, std::uint64_t v, size_t num_bytes)
+    {
+        for (size_t i = 0; i < num_bytes; ++i)
+        {
+            s.push_back( char( (v >> (8*i)) & 0xFF ) );
+        }
+    }
+
+    std::uint64_t parseLittleEndian(const std::string &s, size_t pos, size_t num_bytes)
+    {
+        std::uint64_t v = 0;
+        for (size_t i = 0; i < num_bytes; ++i)
+        {
+            v |= std::uint64_t( (unsigned char)s[pos+i] ) << (8*i);
+        }
+        return v;
+    }
+
+    /*
+     * Write the content to the file and make sure that it reached the disk before we return true.
+     */
+    bool writeFileToDisk(const std::string &fn, const std::string &content)
+    {
+#	ifdef RB_WIN
+        FILE *f = fopen( fn.c_str(), "wb" );
+        if ( f == NULL )
+        {
+            return false;
+        }
+        bool ok = ( fwrite( content.data(), 1, content.size(), f ) == content.size() );
+        ok = ( fflush( f ) == 0 && ok );
+        ok = ( _commit( _fileno( f ) ) == 0 && ok );
+        ok = ( fclose( f ) == 0 && ok );
+        return ok;
+#   else
+        int fd = open( fn.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+        if ( fd < 0 )
+        {
+            return false;
+        }
+        bool ok = true;
+        size_t written = 0;
+        while ( ok == true && written < content.size() )
+        {
+            ssize_t n = write( fd, content.data() + written, content.size() - written );
+            if ( n < 0 )
+            {
+                ok = false;
+            }
+            else
+            {
+                written += size_t( n );
+            }
+        }
+        ok = ( fsync( fd ) == 0 && ok );
+        ok = ( close( fd ) == 0 && ok );
+        return ok;
+#   endif
+    }
+
+    /*
+     * Replace the file 'to' by the file 'from' in a single step, so that 'to' is either the old or the new file, even after a crash.
+     */
+    bool replaceFile(const std::string &from, const std::string &to, const std::string &directory)
+    {
+#	ifdef RB_WIN
+        return MoveFileExA( from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) != 0;
+#   else
+        if ( std::rename( from.c_str(), to.c_str() ) != 0 )
+        {
+            return false;
+        }
+
+        // the rename itself is only durable once the directory is on disk
+        int fd = open( ( directory == "" ? "." : directory.c_str() ), O_RDONLY );
+        if ( fd >= 0 )
+        {
+            fsync( fd );
+            close( fd );
+        }
+        return true;
+#   endif
+    }
+
+}
+
+
+BinaryCheckpointFile::BinaryCheckpointFile( void ) :
+    file_name( "" ),
+    payload( "" ),
+    read_position( 0 )
+{
+
+}
+
+
+void BinaryCheckpointFile::checkAvailable(size_t n) const
+{
+
+    if ( n > payload.size() - read_position )
+    {
+        throw RbException("The checkpoint file \"" + file_name + "\" ended unexpectedly.");
+    }
+
+}
+
+
+/**
+ * 64-bit FNV-1a hash of the payload.
+ */
+std::uint64_t BinaryCheckpointFile::computeChecksum(const std::string &data)
+{
+
+    std::uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        h ^= std::uint64_t( (unsigned char)data[i] );
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+
+bool BinaryCheckpointFile::isAtEnd( void ) const
+{
+    return read_position == payload.size();
+}
+
+
+bool BinaryCheckpointFile::isBinaryCheckpointFile(const std::string &fn)
+{
+
+    std::ifstream in( fn.c_str(), std::ios::in | std::ios::binary );
+    if ( !in )
+    {
+        return false;
+    }
+
+    char magic[8];
+    in.read( magic, 8 );
+
+    return in.gcount() == 8 && std::memcmp( magic, checkpoint_magic, 8 ) == 0;
+}
+
+
+void BinaryCheckpointFile::load(const std::string &fn)
+{
+
+    file_name = fn;
+    payload.clear();
+    read_position = 0;
+
+    std::ifstream in( fn.c_str(), std::ios::in | std::ios::binary );
+    if ( !in )
+    {
+        throw RbException( "Could not open file \"" + fn + "\"" );
+    }
+
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string content = buffer.str();
+
+    if ( content.size() < header_size + footer_size || std::memcmp( content.data(), checkpoint_magic, 8 ) != 0 )
+    {
+        throw RbException( "The file \"" + fn + "\" is not a RevBayes checkpoint file." );
+    }
+
+    std::uint64_t version = parseLittleEndian(content, 8, 4);
+    if ( version != VERSION )
+    {
+        std::stringstream ss;
+        ss << "The checkpoint file \"" << fn << "\" has format version " << version << " but this version of RevBayes can only read version " << VERSION << ".";
+        throw RbException( ss.str() );
+    }
+
+    std::uint64_t length = parseLittleEndian(content, 12, 8);
+    if ( length != content.size() - header_size - footer_size )
+    {
+        throw RbException( "The checkpoint file \"" + fn + "\" is truncated." );
+    }
+
+    payload = content.substr( header_size, size_t(length) );
+    if ( computeChecksum( payload ) != parseLittleEndian(content, header_size + size_t(length), 8) )
+    {
+        payload.clear();
+        throw RbException( "The checksum of the checkpoint file \"" + fn + "\" does not match. The file is corrupted." );
+    }
+
+}
+
+
+double BinaryCheckpointFile::readDouble( void )
+{
+
+    std::uint64_t bits = readUInt64();
+    double v;
+    std::memcpy( &v, &bits, sizeof(double) );
+
+    return v;
+}
+
+
+std::string BinaryCheckpointFile::readString( void )
+{
+
+    std::uint64_t length = readUInt64();
+    checkAvailable( size_t(length) );
+
+    std::string s = payload.substr( read_position, size_t(length) );
+    read_position += size_t(length);
+
+    return s;
+}
+
+
+std::uint8_t BinaryCheckpointFile::readUInt8( void )
+{
+
+    checkAvailable( 1 );
+
+    return std::uint8_t( payload[read_position++] );
+}
+
+
+std::uint64_t BinaryCheckpointFile::readUInt64( void )
+{
+
+    checkAvailable( 8 );
+
+    std::uint64_t v = parseLittleEndian(payload, read_position, 8);
+    read_position += 8;
+
+    return v;
+}
+
+
+/**
+ * Write the checkpoint file.
+ * We first write everything into a temporary file next to the target, flush it to disk,
+ * and only then replace the old checkpoint, so that a crash leaves either the old or the new checkpoint.
+ */
+void BinaryCheckpointFile::save(const std::string &fn) const
+{
+
+    RbFileManager fm = RbFileManager( fn );
+    fm.createDirectoryForFile();
+
+    std::string content;
+    content.reserve( header_size + payload.size() + footer_size );
+    content.append( checkpoint_magic, 8 );
+    appendLittleEndian( content, VERSION, 4 );
+    appendLittleEndian( content, payload.size(), 8 );
+    content.append( payload );
+    appendLittleEndian( content, computeChecksum( payload ), 8 );
+
+    std::string tmp_file_name = fn + ".tmp";
+    if ( writeFileToDisk( tmp_file_name, content ) == false )
+    {
+        std::remove( tmp_file_name.c_str() );
+        throw RbException( "Could not write the checkpoint file \"" + tmp_file_name + "\"." );
+    }
+
+    if ( replaceFile( tmp_file_name, fn, fm.getFilePath() ) == false )
+    {
+        throw RbException( "Could not rename the checkpoint file \"" + tmp_file_name + "\" to \"" + fn + "\"." );
+    }
+
+}
+
+
+void BinaryCheckpointFile::writeDouble(double v)
+{
+
+    std::uint64_t bits;
+    std::memcpy( &bits, &v, sizeof(double) );
+    writeUInt64( bits );
+
+}
+
+
+void BinaryCheckpointFile::writeString(const std::string &s)
+{
+
+    writeUInt64( s.size() );
+    payload.append( s );
+
+}
+
+
+void BinaryCheckpointFile::writeUInt8(std::uint8_t v)
+{
+    payload.push_back( char(v) );
+}
+
+
+void BinaryCheckpointFile::writeUInt64(std::uint64_t v)
+{
+    appendLittleEndian( payload, v, 8 );
+}
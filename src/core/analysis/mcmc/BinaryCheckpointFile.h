@@ -0,0 +1,71 @@
+#ifndef BinaryCheckpointFile_H
+#define BinaryCheckpointFile_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Binary checkpoint file with header, version and checksum.
+     *
+     * A checkpoint file consists of
+     *   - the magic string "RBCHKPT" (8 bytes including the terminating zero),
+     *   - the format version (uint32),
+     *   - the length of the payload in bytes (uint64),
+     *   - the payload,
+     *   - the 64-bit FNV-1a checksum of the payload (uint64).
+     * All numbers are stored in little-endian byte order independent of the machine,
+     * doubles are stored by their IEEE-754 bit pattern, so values are restored exactly.
+     *
+     * The payload is assembled in memory using the write functions and then written
+     * to a temporary file which is renamed to the final name once it is complete.
+     * Thus, a crash during checkpointing never leaves a truncated checkpoint behind.
+     * Reading a file verifies the header, the version and the checksum before any
+     * value can be read, and every read is bounds checked.
+     *
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since Version 1.0, 2026-10-18
+     *
+     */
+    class BinaryCheckpointFile {
+
+    public:
+        BinaryCheckpointFile(void);
+
+        static const std::uint32_t      VERSION = 1;                                                //!< The current version of the file format
+
+        static bool                     isBinaryCheckpointFile(const std::string &fn);              //!< Does the file start with the magic string?
+
+        // functions to write a checkpoint
+        void                            save(const std::string &fn) const;                          //!< Write the payload to the file (atomically)
+        void                            writeDouble(double v);
+        void                            writeString(const std::string &s);
+        void                            writeUInt8(std::uint8_t v);
+        void                            writeUInt64(std::uint64_t v);
+
+        // functions to read a checkpoint
+        bool                            isAtEnd(void) const;                                        //!< Have all values of the payload been read?
+        void                            load(const std::string &fn);                                //!< Read and verify the file
+        double                          readDouble(void);
+        std::string                     readString(void);
+        std::uint8_t                    readUInt8(void);
+        std::uint64_t                   readUInt64(void);
+
+    private:
+
+        static std::uint64_t            computeChecksum(const std::string &data);
+        void                            checkAvailable(size_t n) const;
+
+        std::string                     file_name;                                                  //!< The name of the file last loaded (for error messages)
+        std::string                     payload;
+        size_t                          read_position;
+
+    };
+
+}
+
+#endif
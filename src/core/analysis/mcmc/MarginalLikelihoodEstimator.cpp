@@ -4,6 +4,8 @@
 #include "RbFileManager.h"
 #include "StringUtilities.h"
 
+#include <algorithm>
+
 using namespace RevBayesCore;
 
 
@@ -118,6 +120,24 @@ MarginalLikelihoodEstimator::MarginalLikelihoodEstimator(const std::string &fn,
         }
     
         inFile.close();
+        
+        // the estimators need the stones ordered by decreasing power, but the file might list them in another order (e.g., after adding adaptive stones)
+        std::vector<size_t> order;
+        for (size_t i = 0; i < powers.size(); ++i)
+        {
+            order.push_back( i );
+        }
+        std::stable_sort( order.begin(), order.end(), [this](size_t a, size_t b) { return powers[a] > powers[b]; } );
+        
+        std::vector< double >                   sorted_powers;
+        std::vector< std::vector< double> >     sorted_samples;
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            sorted_powers.push_back( powers[order[i]] );
+            sorted_samples.push_back( likelihoodSamples[order[i]] );
+        }
+        powers              = sorted_powers;
+        likelihoodSamples   = sorted_samples;
     }
     
 }
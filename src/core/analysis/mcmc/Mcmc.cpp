@@ -1,7 +1,10 @@
+#include "AsyncFileWriter.h"
+#include "BinaryCheckpointFile.h"
 #include "DagNode.h"
 #include "VariableMonitor.h"
 #include "Mcmc.h"
 #include "MoveSchedule.h"
+#include "Profiler.h"
 #include "RandomMoveSchedule.h"
 #include "RandomNumberFactory.h"
 #include "RandomNumberGenerator.h"
@@ -11,6 +14,7 @@
 #include "RbOptions.h"
 #include "RlUserInterface.h"
 #include "SingleRandomMoveSchedule.h"
+#include "StochasticNode.h"
 #include "RandomMoveSchedule.h"
 #include "ExtendedNewickTreeMonitor.h"
 
@@ -188,114 +192,74 @@ Mcmc* Mcmc::clone( void ) const
 }
 
 
+/**
+ * Write the current state of the chain into the (binary) checkpoint file.
+ * The checkpoint contains the generation, the state of the random number generator,
+ * the values of all variable nodes and the tuning information of all moves.
+ * See BinaryCheckpointFile for the layout of the file.
+ */
 void Mcmc::checkpoint( void ) const
 {
-    // initialize variables
-    std::string separator = "\t";
-    bool flatten = false;
     
-    RbFileManager fm = RbFileManager(checkpoint_file_name);
-    fm.createDirectoryForFile();
+    BinaryCheckpointFile cp;
     
-    // open the stream to the file
-    std::fstream out_stream;
-    out_stream.open( fm.getFullFileName().c_str(), std::fstream::out);
+    cp.writeUInt64( generation );
+    cp.writeString( GLOBAL_RNG->getState() );
     
-
-    // first, we write the names of the variables
-    for (std::vector<DagNode *>::const_iterator it=variable_nodes.begin(); it!=variable_nodes.end(); ++it)
+    // the values of the variables
+    cp.writeUInt64( variable_nodes.size() );
+    for (std::vector<DagNode*>::const_iterator it = variable_nodes.begin(); it != variable_nodes.end(); ++it)
     {
-        // add a separator before every new element
-        if ( it != variable_nodes.begin() )
-        {
-            out_stream << separator;
-        }
+        const DagNode *the_node = *it;
         
-        const DagNode* the_node = *it;
+        cp.writeString( the_node->getName() );
         
-        // print the header
-        if (the_node->getName() != "")
+        // we store real numbers and vectors of real numbers by their bits so that the chain continues exactly
+        const StochasticNode<double>* real_node = dynamic_cast< const StochasticNode<double>* >( the_node );
+        const StochasticNode<RbVector<double> >* real_vector_node = dynamic_cast< const StochasticNode<RbVector<double> >* >( the_node );
+        if ( real_node != NULL )
         {
-            the_node->printName(out_stream,separator, -1, true, flatten);
+            cp.writeUInt8( CHECKPOINT_VALUE_REAL );
+            cp.writeDouble( real_node->getValue() );
         }
-        else
+        else if ( real_vector_node != NULL )
         {
-            out_stream << "Unnamed";
+            const RbVector<double> &v = real_vector_node->getValue();
+            cp.writeUInt8( CHECKPOINT_VALUE_REAL_VECTOR );
+            cp.writeUInt64( v.size() );
+            for (size_t i = 0; i < v.size(); ++i)
+            {
+                cp.writeDouble( v[i] );
+            }
         }
-        
-    }
-    out_stream << std::endl;
-    
-    
-    // second, we write the values of the variables
-    for (std::vector<DagNode*>::const_iterator it = variable_nodes.begin(); it != variable_nodes.end(); ++it)
-    {
-        // add a separator before every new element
-        if ( it != variable_nodes.begin() )
+        else
         {
-            out_stream << separator;
+            std::stringstream ss;
+            the_node->printValue(ss, "\t", -1, false, false, false);
+            cp.writeUInt8( CHECKPOINT_VALUE_STRING );
+            cp.writeString( ss.str() );
         }
-        
-        // get the node
-        DagNode *node = *it;
-        
-        // print the value
-        node->printValue(out_stream, separator, -1, false, false, flatten);
     }
     
-    
-    // clean up
-    out_stream.close();
-    
-    
-    /////////
-    // Now we also write the MCMC information into a file
-    /////////
-
-    // assemble the new filename
-    std::string mcmc_checkpoint_file_name = fm.getFilePath() + fm.getPathSeparator() + fm.getFileNameWithoutExtension() + "_mcmc." + fm.getFileExtension();
-    
-    RbFileManager fm_mcmc = RbFileManager(mcmc_checkpoint_file_name);
-    fm_mcmc.createDirectoryForFile();
-    
-    // open the stream to the file
-    std::fstream out_stream_mcmc;
-    out_stream_mcmc.open( fm_mcmc.getFullFileName().c_str(), std::fstream::out);
-    
-    out_stream_mcmc << "iter = " << generation << std::endl;
-    
-    // clean up
-    out_stream_mcmc.close();
-    
-    
-    /////////
-    // Next we also write the moves information into a file
-    /////////
-    
-    // assemble the new filename
-    std::string moves_checkpoint_file_name = fm.getFilePath() + fm.getPathSeparator() + fm.getFileNameWithoutExtension() + "_moves." + fm.getFileExtension();
-    
-    RbFileManager fm_moves = RbFileManager(moves_checkpoint_file_name);
-    fm_moves.createDirectoryForFile();
-    
-    // open the stream to the file
-    std::fstream out_stream_moves;
-    out_stream_moves.open( fm_moves.getFullFileName().c_str(), std::fstream::out);
-    
+    // the tuning information of the moves
+    cp.writeUInt64( moves.size() );
     for (size_t i = 0; i < moves.size(); ++i)
     {
-        out_stream_moves << moves[i].getMoveName();
-        out_stream_moves << "(variable="                << moves[i].getDagNodes()[0]->getName();
-        out_stream_moves << ",num_tried_current="       << moves[i].getNumberTriedCurrentPeriod();
-        out_stream_moves << ",num_tried_total="         << moves[i].getNumberTriedTotal();
-        out_stream_moves << ",num_accepted_current="    << moves[i].getNumberAcceptedCurrentPeriod();
-        out_stream_moves << ",num_accepted_total="      << moves[i].getNumberAcceptedTotal();
-        out_stream_moves << ",tuning_value="            << moves[i].getMoveTuningParameter();
-        out_stream_moves << ")" << std::endl;
+        cp.writeString( moves[i].getMoveName() );
+        cp.writeString( moves[i].getDagNodes()[0]->getName() );
+        cp.writeUInt64( moves[i].getNumberTriedCurrentPeriod() );
+        cp.writeUInt64( moves[i].getNumberTriedTotal() );
+        cp.writeUInt64( moves[i].getNumberAcceptedCurrentPeriod() );
+        cp.writeUInt64( moves[i].getNumberAcceptedTotal() );
+        cp.writeDouble( moves[i].getMoveTuningParameter() );
     }
     
-    // clean up
-    out_stream_moves.close();
+    // the monitor files must contain all samples up to the checkpoint before the checkpoint exists
+    AsyncFileWriter::globalInstance().flushAll();
+    
+    RbFileManager fm = RbFileManager(checkpoint_file_name);
+    cp.save( fm.getFullFileName() );
+    
 }
 
 
@@ -347,6 +311,18 @@ void Mcmc::finishMonitors( size_t n_reps, MonteCarloAnalysisOptions::TraceCombin
             }
             
         }
+        else if ( process_active == true )
+        {
+            // the other chains of an MC^3 analysis opened the same file, so they have to release it too
+            // before it is written completely, but without finishing it (e.g. the end of a nexus file)
+            bool was_enabled = monitors[i].isEnabled();
+            monitors[i].disable();
+            monitors[i].closeStream();
+            if ( was_enabled == true )
+            {
+                monitors[i].enable();
+            }
+        }
         
     }
     
@@ -690,6 +666,167 @@ void Mcmc::initializeSampler( bool prior_only )
 
 
 void Mcmc::initializeSamplerFromCheckpoint( void )
+{
+    
+    // check that the file/path name has been correctly specified
+    RevBayesCore::RbFileManager fm( checkpoint_file_name );
+    if ( !fm.testFile() || !fm.testDirectory() )
+    {
+        std::string errorStr = "";
+        fm.formatError( errorStr );
+        throw( RbException(errorStr) );
+    }
+    
+    // checkpoints written by older versions are plain text files
+    if ( BinaryCheckpointFile::isBinaryCheckpointFile( fm.getFullFileName() ) == true )
+    {
+        initializeSamplerFromBinaryCheckpoint();
+    }
+    else
+    {
+        initializeSamplerFromTextCheckpoint();
+    }
+    
+    // we also need to tell our monitors to append after the last sample
+    for (size_t j = 0; j < monitors.size(); ++j)
+    {
+        if ( monitors[j].isFileMonitor() )
+        {
+            // set file monitors to append
+            AbstractFileMonitor* m = dynamic_cast< AbstractFileMonitor *>( &monitors[j] );
+            m->setAppend(true);
+        }
+    }
+    
+}
+
+
+void Mcmc::initializeSamplerFromBinaryCheckpoint( void )
+{
+    
+    RevBayesCore::RbFileManager fm( checkpoint_file_name );
+    
+    BinaryCheckpointFile cp;
+    cp.load( fm.getFullFileName() );
+    
+    size_t last_generation = size_t( cp.readUInt64() );
+    std::string rng_state = cp.readString();
+    
+    // the values of the variables
+    const std::vector<DagNode*> &nodes = getModel().getDagNodes();
+    size_t n_parameters = size_t( cp.readUInt64() );
+    for ( size_t i = 0; i < n_parameters; ++i )
+    {
+        std::string parameter_name = cp.readString();
+        unsigned char value_type = cp.readUInt8();
+        
+        double real_value = 0.0;
+        RbVector<double> real_vector_value;
+        std::string string_value;
+        if ( value_type == CHECKPOINT_VALUE_REAL )
+        {
+            real_value = cp.readDouble();
+        }
+        else if ( value_type == CHECKPOINT_VALUE_REAL_VECTOR )
+        {
+            size_t n = size_t( cp.readUInt64() );
+            for (size_t k = 0; k < n; ++k)
+            {
+                real_vector_value.push_back( cp.readDouble() );
+            }
+        }
+        else if ( value_type == CHECKPOINT_VALUE_STRING )
+        {
+            string_value = cp.readString();
+        }
+        else
+        {
+            throw RbException("Unknown type of the stored value for variable '" + parameter_name + "' in the checkpoint file.");
+        }
+        
+        // iterate over all DAG nodes (variables)
+        for ( size_t j = 0; j < nodes.size(); ++j )
+        {
+            if ( nodes[j]->getName() == parameter_name )
+            {
+                if ( value_type == CHECKPOINT_VALUE_REAL )
+                {
+                    StochasticNode<double>* real_node = dynamic_cast< StochasticNode<double>* >( nodes[j] );
+                    if ( real_node == NULL )
+                    {
+                        throw RbException("The variable '" + parameter_name + "' stored in the checkpoint file is not a real number in this model.");
+                    }
+                    real_node->getValue() = real_value;
+                    real_node->setValue( &real_node->getValue() );
+                }
+                else if ( value_type == CHECKPOINT_VALUE_REAL_VECTOR )
+                {
+                    StochasticNode<RbVector<double> >* real_vector_node = dynamic_cast< StochasticNode<RbVector<double> >* >( nodes[j] );
+                    if ( real_vector_node == NULL )
+                    {
+                        throw RbException("The variable '" + parameter_name + "' stored in the checkpoint file is not a vector of real numbers in this model.");
+                    }
+                    real_vector_node->getValue() = real_vector_value;
+                    real_vector_node->setValue( &real_vector_node->getValue() );
+                }
+                else
+                {
+                    nodes[j]->setValueFromString( string_value );
+                }
+                nodes[j]->keep();
+                break;
+            }
+        }
+    }
+    
+    // the tuning information of the moves
+    size_t n_moves = size_t( cp.readUInt64() );
+    if ( moves.size() != n_moves )
+    {
+        throw RbException("The number of stored moves from the checkpoint file doesn't match the number of moves for this MCMC analysis.");
+    }
+    
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        std::string move_name = cp.readString();
+        std::string variable_name = cp.readString();
+        
+        if ( moves[i].getMoveName() != move_name )
+        {
+            throw RbException("The order of the moves from the checkpoint file does not match.");
+        }
+        if ( moves[i].getDagNodes()[0]->getName() != variable_name )
+        {
+            throw RbException("The order of the moves from the checkpoint file does not match. A move working on node '" + moves[i].getDagNodes()[0]->getName() + "' received a stored counterpart working on node '" + variable_name + "'.");
+        }
+        
+        moves[i].setNumberTriedCurrentPeriod( size_t( cp.readUInt64() ) );
+        moves[i].setNumberTriedTotal( size_t( cp.readUInt64() ) );
+        moves[i].setNumberAcceptedCurrentPeriod( size_t( cp.readUInt64() ) );
+        moves[i].setNumberAcceptedTotal( size_t( cp.readUInt64() ) );
+        moves[i].setMoveTuningParameter( cp.readDouble() );
+    }
+    
+    if ( cp.isAtEnd() == false )
+    {
+        throw RbException("The checkpoint file \"" + checkpoint_file_name + "\" contains more data than expected.");
+    }
+    
+    // set iteration num
+    setCurrentGeneration( last_generation );
+    
+    // continue with the same random numbers as the original run
+    GLOBAL_RNG->setState( rng_state );
+    
+}
+
+
+/**
+ * Read the plain text checkpoint files written by older versions of RevBayes.
+ * These consist of the checkpoint file itself with the names and values of the variables,
+ * and the two files '<name>_mcmc.<ext>' and '<name>_moves.<ext>' with the generation and the move tuning information.
+ */
+void Mcmc::initializeSamplerFromTextCheckpoint( void )
 {
     
     //    size_t n_samples = traces[0].size();
@@ -700,14 +837,7 @@ void Mcmc::initializeSamplerFromCheckpoint( void )
     std::vector<std::string> parameter_values;
     
     
-    // check that the file/path name has been correctly specified
     RevBayesCore::RbFileManager fm( checkpoint_file_name );
-    if ( !fm.testFile() || !fm.testDirectory() )
-    {
-        std::string errorStr = "";
-        fm.formatError( errorStr );
-        throw( RbException(errorStr) );
-    }
     
     // Open file
     std::ifstream inFile( fm.getFullFileName().c_str() );
@@ -816,19 +946,8 @@ void Mcmc::initializeSamplerFromCheckpoint( void )
     in_file_mcmc.close();
     
     
-    // we also need to tell our monitors to append after the last sample
     // set iteration num
     setCurrentGeneration( last_generation );
-        
-    for (size_t j = 0; j < monitors.size(); ++j)
-    {
-        if ( monitors[j].isFileMonitor() )
-        {
-            // set file monitors to append
-            AbstractFileMonitor* m = dynamic_cast< AbstractFileMonitor *>( &monitors[j] );
-            m->setAppend(true);
-        }
-    }
     
     
     
@@ -985,6 +1104,12 @@ void Mcmc::printOperatorSummary(bool current_period)
         
         std::cout << std::endl;
         std::cout.flush();
+        
+        // print where the time went, if we were asked to measure it
+        if ( Profiler::isActive() == true )
+        {
+            Profiler::globalInstance().printSummary(std::cout, moves);
+        }
     }
     
 }
@@ -1423,3 +1548,17 @@ void Mcmc::tune( void )
     
 }
 
+
+/**
+ * Write the time spent in each move and in the probability computations to a file (see Profiler).
+ */
+void Mcmc::writeProfile(const std::string &fn, const std::string &format)
+{
+    
+    if ( process_active == true )
+    {
+        Profiler::globalInstance().writeSummary(fn, format, moves);
+    }
+    
+}
+
@@ -80,9 +80,15 @@ namespace RevBayesCore {
         void                                                startMonitors(size_t numCycles, bool reopen);                                           //!< Start the monitors
         void                                                tune(void);                                                                             //!< Tune the sampler and its moves.
         void                                                writeMonitorHeaders(bool screen_only);                                                              //!< Write the headers of the monitors
+        void                                                writeProfile(const std::string &fn, const std::string &format);                         //!< Write the time spent in the moves to a file
         
         
     protected:
+        
+        enum CheckpointValueType { CHECKPOINT_VALUE_STRING = 0, CHECKPOINT_VALUE_REAL = 1, CHECKPOINT_VALUE_REAL_VECTOR = 2 };  //!< How the value of a variable is stored in the checkpoint file
+        
+        void                                                initializeSamplerFromBinaryCheckpoint(void);                                            //!< Read the binary checkpoint file
+        void                                                initializeSamplerFromTextCheckpoint(void);                                              //!< Read the text checkpoint files of older versions
         void                                                resetVariableDagNodes(void);                                                //!< Extract the variable to be monitored again.
         void                                                initializeMonitors(void);                                                               //!< Assign model and mcmc ptrs to monitors
         void                                                replaceDag(const RbVector<Move> &mvs, const RbVector<Monitor> &mons);
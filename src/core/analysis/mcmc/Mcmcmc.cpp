@@ -1,14 +1,17 @@
 #include "DagNode.h"
 #include "MetropolisHastingsMove.h"
 #include "Mcmcmc.h"
+#include "Profiler.h"
 #include "Proposal.h"
 #include "RandomNumberFactory.h"
 #include "RandomNumberGenerator.h"
 #include "RlUserInterface.h"
+#include "ThreadPool.h"
 #include "RbConstants.h"
 #include "RbException.h"
 #include "RbMathLogic.h"
 
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <vector>
@@ -111,6 +114,7 @@ Mcmcmc::Mcmcmc(const Mcmcmc &m) : MonteCarloSampler(m)
         
     }
     
+    chain_rngs              = m.chain_rngs;
     chain_values            = m.chain_values;
     chain_heats             = m.chain_heats;
     chain_moves_tuningInfo  = m.chain_moves_tuningInfo;
@@ -179,13 +183,29 @@ Mcmcmc* Mcmcmc::clone(void) const
 void Mcmcmc::checkpoint( void ) const
 {
     
+    // if the chains have their own random number generators, then each chain stores the state of its own one
+    RandomNumberFactory &factory = RandomNumberFactory::randomNumberFactoryInstance();
     for (size_t i = 0; i < num_chains; ++i)
     {
         
-        if ( chains[i] != NULL )
+        if ( chains[i] != NULL && chain_rngs.empty() == true )
         {
             chains[i]->checkpoint();
         }
+        else if ( chains[i] != NULL )
+        {
+            RandomNumberGenerator *previous_rng = factory.setThreadRandomNumberGenerator( &chain_rngs[i] );
+            try
+            {
+                chains[i]->checkpoint();
+            }
+            catch (...)
+            {
+                factory.setThreadRandomNumberGenerator( previous_rng );
+                throw;
+            }
+            factory.setThreadRandomNumberGenerator( previous_rng );
+        }
         
     }
     
@@ -357,6 +377,9 @@ void Mcmcmc::initializeChains(void)
 void Mcmcmc::initializeSampler( bool priorOnly )
 {
     
+    // the chains get their own random number generators when we run them for the first time
+    chain_rngs.clear();
+    
     // initialize each chain
     for (size_t i = 0; i < num_chains; ++i)
     {
@@ -374,12 +397,34 @@ void Mcmcmc::initializeSampler( bool priorOnly )
 void Mcmcmc::initializeSamplerFromCheckpoint( void )
 {
     
+    // if the chains have their own random number generators, then each chain restores its values and the state of its own one
+    chain_rngs.clear();
+    if ( usesChainRandomNumberGenerators() == true )
+    {
+        seedChainRandomNumberGenerators();
+    }
+    
+    RandomNumberFactory &factory = RandomNumberFactory::randomNumberFactoryInstance();
     for (size_t i = 0; i < num_chains; ++i)
     {
             
-        if ( chains[i] != NULL )
+        if ( chains[i] != NULL && chain_rngs.empty() == true )
         {
-            chains[i]->checkpoint();
+            chains[i]->initializeSamplerFromCheckpoint();
+        }
+        else if ( chains[i] != NULL )
+        {
+            RandomNumberGenerator *previous_rng = factory.setThreadRandomNumberGenerator( &chain_rngs[i] );
+            try
+            {
+                chains[i]->initializeSamplerFromCheckpoint();
+            }
+            catch (...)
+            {
+                factory.setThreadRandomNumberGenerator( previous_rng );
+                throw;
+            }
+            factory.setThreadRandomNumberGenerator( previous_rng );
         }
         
     }
@@ -402,25 +447,59 @@ void Mcmcmc::monitor(unsigned long g)
     
 }
 
+/**
+ * Advance all chains of this process by one cycle.
+ * We run the chains as separate jobs on the thread pool, because they are independent between swaps.
+ * If there are several chains, then each chain draws from its own random number generator, hence the chains produce
+ * the same samples no matter how many threads we use (including a single one). The swaps happen afterwards on the calling thread,
+ * once all chains have finished their cycle.
+ */
 void Mcmcmc::nextCycle(bool advanceCycle)
 {
     
+    // the chains get their own random number generators the first time we run them
+    if ( chain_rngs.empty() == true && usesChainRandomNumberGenerators() == true )
+    {
+        seedChainRandomNumberGenerators();
+    }
+    
     // run each chain for this process
+    std::vector< std::function<void (void)> > jobs;
     for (size_t i = 0; i < num_chains; ++i)
     {
         
-        if ( chains[i] != NULL )
+        if ( chains[i] != NULL && chain_rngs.empty() == true )
         {
-            // @todo: #thread
-            // This part should be done on several threads if possible
-            // Sebastian: this call is very slow; a lot of work happens in nextCycle()
-
             // advance chain j by a single cycle
             chains[i]->nextCycle( advanceCycle );
         }
+        else if ( chains[i] != NULL )
+        {
+            Mcmc *chain = chains[i];
+            RandomNumberGenerator *chain_rng = &chain_rngs[i];
+            jobs.push_back( [chain, chain_rng, advanceCycle]()
+            {
+                RandomNumberFactory &factory = RandomNumberFactory::randomNumberFactoryInstance();
+                RandomNumberGenerator *previous_rng = factory.setThreadRandomNumberGenerator( chain_rng );
+                try
+                {
+                    // advance chain j by a single cycle
+                    chain->nextCycle( advanceCycle );
+                }
+                catch (...)
+                {
+                    factory.setThreadRandomNumberGenerator( previous_rng );
+                    throw;
+                }
+                factory.setThreadRandomNumberGenerator( previous_rng );
+            } );
+        }
         
     } // loop over chains for this process
     
+    ThreadPool::globalInstance().runJobs( jobs );
+    
+    
     if ( advanceCycle == true )
     {
         // advance gen counter
@@ -687,6 +766,12 @@ void Mcmcmc::printOperatorSummary(bool current_period)
             std::cout.flush();
         }
         
+        // print where the time of our chain went, if we were asked to measure it
+        if ( Profiler::isActive() == true && chains[active_chainIdx] != NULL )
+        {
+            Profiler::globalInstance().printSummary(std::cout, base_moves);
+        }
+        
         if (num_chains > 1)
         {
             printSwapSummary(std::cout);
@@ -1015,6 +1100,32 @@ void Mcmcmc::setModel( Model *m, bool redraw )
 }
 
 
+/**
+ * Does each chain draw from its own random number generator?
+ * This is the case whenever we have several chains, independent of the number of threads, so that the samples do not depend on it.
+ * It only depends on the total number of chains, so that all processes agree.
+ */
+bool Mcmcmc::usesChainRandomNumberGenerators( void ) const
+{
+    
+    return num_chains > 1;
+}
+
+
+/**
+ * Give each chain its own, independent Philox stream.
+ * The key of the streams is drawn from the global random number generator,
+ * also for chains of other processes, so that all processes stay in sync.
+ */
+void Mcmcmc::seedChainRandomNumberGenerators( void )
+{
+    
+    chain_rngs.resize( num_chains );
+    RandomNumberFactory::randomNumberFactoryInstance().createIndependentStreams( chain_rngs );
+    
+}
+
+
 void Mcmcmc::setActivePIDSpecialized(size_t i, size_t n)
 {
     
@@ -1854,3 +1965,21 @@ void Mcmcmc::writeMonitorHeaders( bool screen_monitor_only )
     
 }
 
+
+/**
+ * Write the time spent in the moves of the chain run by this process and in the probability computations to a file (see Profiler).
+ */
+void Mcmcmc::writeProfile(const std::string &fn, const std::string &format)
+{
+    
+    if ( process_active == true )
+    {
+        size_t active_chainIdx = std::find(pid_per_chain.begin(), pid_per_chain.end(), active_PID) - pid_per_chain.begin();
+        if ( chains[active_chainIdx] != NULL )
+        {
+            Profiler::globalInstance().writeSummary(fn, format, chains[active_chainIdx]->getMoves());
+        }
+    }
+    
+}
+
@@ -6,6 +6,7 @@
 #include "Monitor.h"
 #include "MonteCarloSampler.h"
 #include "Move.h"
+#include "RandomNumberGenerator.h"
 
 #include <vector>
 
@@ -63,6 +64,7 @@ namespace RevBayesCore {
         void                                    startMonitors(size_t numCycles, bool reopen);                                   //!< Start the monitors
         void                                    tune(void);                                                                     //!< Tune the sampler and its moves.
         void                                    writeMonitorHeaders(bool screen_only);                                                      //!< Write the headers of the monitors.
+        void                                    writeProfile(const std::string &fn, const std::string &format);                             //!< Write the time spent in the moves of our chain to a file
 
         
     protected:
@@ -71,6 +73,8 @@ namespace RevBayesCore {
         
     private:
         void                                    initializeChains(void);
+        bool                                    usesChainRandomNumberGenerators(void) const;                                    //!< Does each chain draw from its own random number generator?
+        void                                    seedChainRandomNumberGenerators(void);                                          //!< Give each chain its own random number stream
         void                                    swapChains(const std::string swap_method);
         void                                    swapMovesTuningInfo(RbVector<Move> &mvsj, RbVector<Move> &mvsk);
         void                                    swapNeighborChains(void);
@@ -85,6 +89,7 @@ namespace RevBayesCore {
         std::vector<size_t>                     heat_ranks;
         std::vector<size_t>                     pid_per_chain;
         std::vector<Mcmc*>                      chains;
+        mutable std::vector<RandomNumberGenerator> chain_rngs;                                      // the random number generator of each chain if there are several chains, empty otherwise (mutable so that checkpoint() can store their state)
         std::vector<double>                     chain_values;
         std::vector<double>                     chain_heats;
         std::string                             schedule_type;
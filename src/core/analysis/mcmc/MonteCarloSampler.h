@@ -67,6 +67,7 @@ namespace RevBayesCore {
         virtual void                            startMonitors(size_t numCycles, bool reopen) = 0;           //!< Start the monitors
         virtual void                            tune(void) = 0;                                             //!< Tune the sampler and its moves.
         virtual void                            writeMonitorHeaders(bool screen_only) = 0;                              //!< Write the headers of the monitors
+        virtual void                            writeProfile(const std::string &fn, const std::string &format) = 0;     //!< Write the time spent in the moves to a file
 
         // public methods
         size_t                                  getCurrentGeneration(void) const;                           //!< Get the current generations number
@@ -2,6 +2,7 @@
 #define BurninEstimatorContinuous_H
 
 #include "Cloneable.h"
+#include "OnlineTraceStatistics.h"
 #include "TraceNumeric.h"
 
 #include <vector>
@@ -29,6 +30,7 @@ namespace RevBayesCore {
     
         virtual BurninEstimatorContinuous*      clone(void) const = 0;                                              //!< Clone function. This is similar to the copy constructor but useful in inheritance.
         virtual std::size_t                     estimateBurnin(const TraceNumeric& trace) = 0;
+        virtual std::size_t                     estimateBurnin(const OnlineTraceStatistics& trace) = 0;            //!< Estimate the burnin among the block boundaries of the running statistics
     };
     
 }
@@ -8,6 +8,7 @@
 #ifndef ConvergenceDiagnosticContinuous_H
 #define ConvergenceDiagnosticContinuous_H
 
+#include "OnlineTraceStatistics.h"
 #include "TraceNumeric.h"
 
 #include <vector>
@@ -22,6 +23,8 @@ namespace RevBayesCore {
     
         virtual bool                assessConvergence(const TraceNumeric& trace) { return false; }
         virtual bool                assessConvergence(const std::vector<TraceNumeric>& traces) { return false; }
+        virtual bool                assessConvergence(const OnlineTraceStatistics& trace, std::size_t burnin) { return false; }
+        virtual bool                assessConvergence(const std::vector<OnlineTraceStatistics>& traces, std::size_t burnin) { return false; }
 
     };
 
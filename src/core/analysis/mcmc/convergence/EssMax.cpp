@@ -34,6 +34,11 @@ EssMax* EssMax::clone( void ) const
     return new EssMax( *this );
 }
 
+/**
+ * Estimate the burnin as the one that maximizes the ESS of the remaining samples.
+ * We use the overlapping batch means estimator of the ESS, because its prefix sums are computed once
+ * for the trace and then each candidate burnin costs constant time.
+ */
 size_t EssMax::estimateBurnin(const TraceNumeric& trace)
 {
     
@@ -44,7 +49,7 @@ size_t EssMax::estimateBurnin(const TraceNumeric& trace)
     // iterate over possible burnins
     for (size_t i=0; i<frac*trace.size(); i+=blockSize) {
         // analyse trace for this burnin
-        double ess = trace.getESS(i, trace.size());
+        double ess = trace.getESSBatchMeans(i, trace.size());
         
         // check if the new ess is better than any previous ones
         if (RbMath::isFinite(ess) && max_ess < ess) {
@@ -56,3 +61,34 @@ size_t EssMax::estimateBurnin(const TraceNumeric& trace)
     // return the best burnin
     return best_burnin;
 }
+
+
+/**
+ * Estimate the burnin from the running statistics.
+ * The candidates are the block boundaries instead of multiples of the block size.
+ */
+size_t EssMax::estimateBurnin(const OnlineTraceStatistics& trace)
+{
+
+    // init
+    double  max_ess     = 0;
+    size_t  best_burnin = 0;
+
+    // iterate over possible burnins
+    std::vector<size_t> candidates = trace.getBlockBoundaries();
+    for (size_t i=0; i<candidates.size() && candidates[i]<frac*trace.size(); ++i)
+    {
+        // analyse trace for this burnin
+        double ess = trace.getESS(candidates[i], trace.size());
+
+        // check if the new ess is better than any previous ones
+        if (RbMath::isFinite(ess) && max_ess < ess)
+        {
+            max_ess = ess;
+            best_burnin = candidates[i];
+        }
+    }
+
+    // return the best burnin
+    return best_burnin;
+}
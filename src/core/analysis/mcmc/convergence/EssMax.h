@@ -14,6 +14,7 @@ namespace RevBayesCore {
     
         EssMax*         clone(void) const;                                              //!< Clone function. This is similar to the copy constructor but useful in inheritance.
         std::size_t     estimateBurnin(const TraceNumeric& trace);
+        std::size_t     estimateBurnin(const OnlineTraceStatistics& trace);
     
     private:
     
@@ -18,3 +18,9 @@ bool EssTest::assessConvergence(const TraceNumeric& trace)
     return  trace.getESS() > k;
 }
 
+
+bool EssTest::assessConvergence(const OnlineTraceStatistics& trace, size_t burnin)
+{
+
+    return  trace.getESS(burnin, trace.size()) > k;
+}
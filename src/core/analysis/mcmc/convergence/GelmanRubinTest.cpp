@@ -85,3 +85,47 @@ bool GelmanRubinTest::assessConvergence(const std::vector<TraceNumeric>& traces)
     
     return psrf < R;
 }
+
+
+/**
+ * The same statistic for the running statistics of the chains.
+ * The sums of squares are computed from the size, mean and variance of each chain after the burnin.
+ */
+bool GelmanRubinTest::assessConvergence(const std::vector<OnlineTraceStatistics>& traces, size_t burnin)
+{
+
+    double within_chain_variance     = 0;
+    double between_chain_variance    = 0;
+    double total_mean                = 0;
+    size_t total_sample_size         = 0;
+
+    // get number of chains
+    size_t nChains = traces.size();
+
+    // get the mean, variance and size of each chain
+    std::vector<double> chain_means     = std::vector<double>(nChains,0.0);
+    std::vector<double> chain_variances = std::vector<double>(nChains,0.0);
+    std::vector<size_t> chain_sizes     = std::vector<size_t>(nChains,0);
+    for (size_t i=0; i<nChains; i++)
+    {
+        chain_means[i]     = traces[i].getMean(burnin, traces[i].size());
+        chain_variances[i] = traces[i].getVariance(burnin, traces[i].size());
+        chain_sizes[i]     = traces[i].getRangeSize(burnin, traces[i].size());
+
+        total_mean += chain_means[i]*chain_sizes[i];
+        total_sample_size += chain_sizes[i];
+    }
+
+    total_mean /= double(total_sample_size);
+
+    // iterate over all chains
+    for (size_t i=0; i<nChains; i++)
+    {
+        within_chain_variance     += chain_sizes[i] * chain_variances[i];
+        between_chain_variance    += chain_sizes[i] * ( chain_variances[i] + (chain_means[i] - total_mean)*(chain_means[i] - total_mean) );
+    }
+
+    double psrf = ((total_sample_size-nChains) / (total_sample_size-1.0)) * (between_chain_variance/within_chain_variance);
+
+    return psrf < R;
+}
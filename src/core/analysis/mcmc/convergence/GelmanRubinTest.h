@@ -30,6 +30,7 @@ namespace RevBayesCore {
         // implementen functions from convergence diagnostic
         bool                assessConvergence(const TraceNumeric& trace);
         bool                assessConvergence(const std::vector<TraceNumeric>& traces);
+        bool                assessConvergence(const std::vector<OnlineTraceStatistics>& traces, std::size_t burnin);
     
     private:
     
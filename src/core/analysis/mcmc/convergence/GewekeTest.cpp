@@ -44,3 +44,33 @@ bool GewekeTest::assessConvergence(const TraceNumeric& trace)
     
     return cdf > p/2.0 && cdf < (1.0 - p/2.0);
 }
+
+
+/**
+ * The same test for the running statistics.
+ * The windows are rounded to the block boundaries of the statistics.
+ */
+bool GewekeTest::assessConvergence(const OnlineTraceStatistics& trace, size_t burnin)
+{
+    // get the sample size
+    size_t sampleSize = trace.size() - burnin;
+
+    // get mean and variance of the first window
+    size_t endWindow1   = size_t(sampleSize * frac1) + burnin;
+    double meanWindow1  = trace.getMean(burnin, endWindow1);
+    double varWindow1   = trace.getSEM(burnin, endWindow1);
+    varWindow1 *= varWindow1;
+
+    // get mean and variance of the second window
+    size_t startWindow2 = trace.size() - size_t(sampleSize * frac2);
+    double meanWindow2  = trace.getMean(startWindow2, trace.size());
+    double varWindow2   = trace.getSEM(startWindow2, trace.size());
+    varWindow2 *= varWindow2;
+
+    // get z
+    double z            = (meanWindow1 - meanWindow2)/sqrt(varWindow1 + varWindow2);
+    // check if z is standard normally distributed
+    double cdf          = RbStatistics::Normal::cdf(z);
+
+    return cdf > p/2.0 && cdf < (1.0 - p/2.0);
+}
@@ -27,6 +27,7 @@ namespace RevBayesCore {
     
         // implementen functions from convergence diagnostic
         bool        assessConvergence(const TraceNumeric& trace);
+        bool        assessConvergence(const OnlineTraceStatistics& trace, std::size_t burnin);
     
         // setters
         void        setFraction1(double f1) { frac1 = f1; }
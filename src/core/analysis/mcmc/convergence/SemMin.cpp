@@ -38,6 +38,10 @@ SemMin* SemMin::clone( void ) const
 }
 
 
+/**
+ * Estimate the burnin as the one that minimizes the SEM of the remaining samples.
+ * As in EssMax, we use the overlapping batch means so that each candidate burnin costs constant time.
+ */
 size_t SemMin::estimateBurnin(const TraceNumeric& trace) {
     // init
     double  min_sem     = RbConstants::Double::max;
@@ -46,7 +50,7 @@ size_t SemMin::estimateBurnin(const TraceNumeric& trace) {
     // iterate over possible burnins
     for (size_t i=0; i<trace.size(); i+=blockSize) {
         // make mean invalid for recalculation
-        double sem = trace.getSEM(i, trace.size());
+        double sem = trace.getSEMBatchMeans(i, trace.size());
         
         // check if the new ess is better than any previous ones
         if (RbMath::isFinite(sem) && sem > 0 && min_sem > sem) {
@@ -58,3 +62,33 @@ size_t SemMin::estimateBurnin(const TraceNumeric& trace) {
     // return the best burnin
     return best_burnin;
 }
+
+
+/**
+ * Estimate the burnin from the running statistics.
+ * The candidates are the block boundaries instead of multiples of the block size.
+ */
+size_t SemMin::estimateBurnin(const OnlineTraceStatistics& trace)
+{
+
+    // init
+    double  min_sem     = RbConstants::Double::max;
+    size_t  best_burnin = 0;
+
+    // iterate over possible burnins
+    std::vector<size_t> candidates = trace.getBlockBoundaries();
+    for (size_t i=0; i<candidates.size(); ++i)
+    {
+        double sem = trace.getSEM(candidates[i], trace.size());
+
+        // check if the new sem is better than any previous ones
+        if (RbMath::isFinite(sem) && sem > 0 && min_sem > sem)
+        {
+            min_sem = sem;
+            best_burnin = candidates[i];
+        }
+    }
+
+    // return the best burnin
+    return best_burnin;
+}
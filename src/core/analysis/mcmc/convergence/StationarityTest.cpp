@@ -90,3 +90,82 @@ bool StationarityTest::assessConvergence(const std::vector<TraceNumeric>& traces
     
     return true;
 }
+
+
+/**
+ * The same test for the running statistics.
+ * The blocks are rounded to the block boundaries of the statistics.
+ */
+bool StationarityTest::assessConvergence(const OnlineTraceStatistics& trace, size_t burnin)
+{
+    // calculate the block size
+    size_t blockSize = (trace.size() - burnin) / nBlocks;
+
+    // use correction for multiple sampling
+    double p_corrected = pow(1.0-p, 1.0/nBlocks);
+
+    // get the mean for the trace
+    double traceMean = trace.getMean(burnin, trace.size());
+
+    for (size_t i=0; i<nBlocks; i++)
+    {
+        size_t begin = i*blockSize+burnin;
+        size_t end = (i+1)*blockSize+burnin;
+
+        double blockMean = trace.getMean(begin, end);
+        double blockSem  = trace.getSEM(begin, end);
+
+        // get the quantile of a normal with mu=0, var=sem and p=(1-p_corrected)/2
+        double quantile = RbStatistics::Normal::quantile(0.0, blockSem, p_corrected);
+        // check if the trace mean is outside this confidence interval
+        if (blockMean-quantile > traceMean || blockMean+quantile < traceMean)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool StationarityTest::assessConvergence(const std::vector<OnlineTraceStatistics>& traces, size_t burnin)
+{
+
+    // get number of chains
+    size_t nChains = traces.size();
+
+    // get the mean between all traces
+    double total_mean = 0.0;
+    size_t total_sample_size = 0;
+
+    // get the mean and standard error for each chain
+    std::vector<double> chainMeans =  std::vector<double>(nChains,0.0);
+    std::vector<double> chainSem =  std::vector<double>(nChains,0.0);
+    for (size_t i=0; i<nChains; i++)
+    {
+        size_t n = traces[i].getRangeSize(burnin, traces[i].size());
+        chainMeans[i] = traces[i].getMean(burnin, traces[i].size());
+        chainSem[i]   = traces[i].getSEM(burnin, traces[i].size());
+
+        total_mean += chainMeans[i]*n;
+        total_sample_size += n;
+    }
+
+    total_mean /= double(total_sample_size);
+
+    // use correction for multiple sampling
+    double p_corrected = pow(1.0-p, 1.0/nChains);
+
+    for (size_t i=0; i<nChains; i++)
+    {
+        // get the quantile of a normal with mu=0, var=sem and p=(1-p_corrected)/2
+        double quantile = RbStatistics::Normal::quantile(0.0, chainSem[i], p_corrected);
+        // check if the trace mean is outside this confidence interval
+        if (chainMeans[i]-quantile > total_mean || chainMeans[i]+quantile < total_mean)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -28,6 +28,8 @@ namespace RevBayesCore {
         // implementen functions from convergence diagnostic
         bool            assessConvergence(const TraceNumeric& trace);
         bool            assessConvergence(const std::vector<TraceNumeric>& traces);
+        bool            assessConvergence(const OnlineTraceStatistics& trace, std::size_t burnin);
+        bool            assessConvergence(const std::vector<OnlineTraceStatistics>& traces, std::size_t burnin);
     
         // setters
         void            setNBlocks(std::size_t n) { nBlocks = n; }
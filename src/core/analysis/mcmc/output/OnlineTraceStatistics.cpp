@@ -0,0 +1,324 @@
+#include "OnlineTraceStatistics.h"
+#include "RbConstants.h"
+
+#include <cmath>
+
+using namespace RevBayesCore;
+
+
+OnlineTraceStatistics::OnlineTraceStatistics(size_t l, size_t b) :
+    max_lag( l > 0 ? l : 1 ),
+    max_blocks( b > 2 ? b + b % 2 : 2 ),
+    block_size( max_lag ),
+    num_samples( 0 ),
+    shift( 0.0 ),
+    blocks(),
+    recent( max_lag, 0.0 )
+{
+
+}
+
+
+void OnlineTraceStatistics::addValue(double x)
+{
+
+    if ( num_samples == 0 )
+    {
+        shift = x;
+    }
+    x -= shift;
+
+    if ( blocks.empty() == true || blocks.back().n >= block_size )
+    {
+        blocks.push_back( Block(num_samples, max_lag) );
+    }
+    Block &b = blocks.back();
+
+    // the products with the previous samples; these are either in this block or in the previous one, because blocks hold at least L samples
+    size_t k_max = ( num_samples < max_lag ? num_samples : max_lag );
+    for (size_t k=1; k<=k_max; ++k)
+    {
+        double y = recent[ (num_samples - k) % max_lag ];
+        if ( num_samples - k >= b.start )
+        {
+            b.inner[k] += x * y;
+        }
+        else
+        {
+            blocks[blocks.size()-2].outer[k] += x * y;
+        }
+    }
+    b.inner[0] += x * x;
+    b.sum += x;
+    ++b.n;
+    if ( b.head.size() <= max_lag )
+    {
+        b.head.push_back( b.head.back() + x );
+    }
+
+    recent[ num_samples % max_lag ] = x;
+    ++num_samples;
+
+    if ( b.n == block_size )
+    {
+        closeBlock();
+    }
+
+}
+
+
+void OnlineTraceStatistics::closeBlock( void )
+{
+
+    blocks.back().tail = recentSums();
+
+    if ( blocks.size() < max_blocks )
+    {
+        return;
+    }
+
+    // merge neighbouring blocks; the products running out of the first block all end in the second one
+    std::vector<Block> merged;
+    for (size_t i=0; i+1<blocks.size(); i+=2)
+    {
+        Block a = blocks[i];
+        const Block &b = blocks[i+1];
+
+        a.n += b.n;
+        a.sum += b.sum;
+        for (size_t k=0; k<=max_lag; ++k)
+        {
+            a.inner[k] += b.inner[k] + a.outer[k];
+        }
+        a.outer = b.outer;
+        a.tail = b.tail;
+
+        merged.push_back( a );
+    }
+
+    blocks = merged;
+    block_size *= 2;
+
+}
+
+
+/**
+ * Compute the statistics of the blocks closest to [begin,end).
+ * The autocovariance at lag k is computed from the sums of the lagged products and the sums of the first and last k samples.
+ */
+OnlineTraceStatistics::RangeStatistics OnlineTraceStatistics::computeStatistics(size_t begin, size_t end) const
+{
+
+    RangeStatistics s;
+    s.n        = 0;
+    s.mean     = RbConstants::Double::nan;
+    s.gamma0   = RbConstants::Double::nan;
+    s.var_stat = RbConstants::Double::nan;
+
+    size_t first = nearestBlock( begin );
+    size_t last  = nearestBlock( end );
+    if ( first >= last )
+    {
+        return s;
+    }
+
+    double sum = 0.0;
+    for (size_t i=first; i<last; ++i)
+    {
+        s.n += blocks[i].n;
+        sum += blocks[i].sum;
+    }
+    double n = double(s.n);
+    double mean = sum / n;
+    s.mean = mean + shift;
+
+    const std::vector<double> &head = blocks[first].head;
+    std::vector<double> tail = ( blocks[last-1].tail.empty() ? recentSums() : blocks[last-1].tail );
+
+    // the same stopping criterion as in TraceNumeric, but for at most L lags
+    size_t num_lags = ( s.n - 1 < max_lag + 1 ? s.n - 1 : max_lag + 1 );
+    std::vector<double> gamma = std::vector<double>(num_lags, 0.0);
+    double var_stat = 0.0;
+    bool truncated = ( num_lags == max_lag + 1 );
+    for (size_t lag=0; lag<num_lags; ++lag)
+    {
+        double products = 0.0;
+        for (size_t i=first; i<last; ++i)
+        {
+            products += blocks[i].inner[lag];
+            if ( i+1 < last )
+            {
+                products += blocks[i].outer[lag];
+            }
+        }
+
+        double m = n - lag;
+        gamma[lag] = ( products - mean * (sum - tail[lag]) - mean * (sum - head[lag]) + m * mean * mean ) / m;
+
+        if ( lag == 0 )
+        {
+            var_stat = gamma[0];
+        }
+        else if ( lag % 2 == 0 )
+        {
+            if ( gamma[lag-1] + gamma[lag] > 0 )
+            {
+                var_stat += 2.0 * (gamma[lag-1] + gamma[lag]);
+            }
+            else
+            {
+                truncated = false;
+                break;
+            }
+        }
+    }
+
+    if ( num_lags == 0 )
+    {
+        return s;
+    }
+    s.gamma0 = gamma[0];
+
+    // the autocorrelation reaches beyond lag L, so we use the batch means of the full blocks if they give a larger variance
+    if ( truncated == true )
+    {
+        std::vector<double> batch_means;
+        for (size_t i=first; i<last; ++i)
+        {
+            if ( blocks[i].n == block_size )
+            {
+                batch_means.push_back( blocks[i].sum / blocks[i].n );
+            }
+        }
+
+        if ( batch_means.size() > 1 )
+        {
+            double batch_mean = 0.0;
+            for (size_t i=0; i<batch_means.size(); ++i)
+            {
+                batch_mean += batch_means[i];
+            }
+            batch_mean /= batch_means.size();
+
+            double var_batch = 0.0;
+            for (size_t i=0; i<batch_means.size(); ++i)
+            {
+                var_batch += (batch_means[i] - batch_mean) * (batch_means[i] - batch_mean);
+            }
+            var_batch *= block_size / (batch_means.size() - 1.0);
+
+            if ( var_batch > var_stat )
+            {
+                var_stat = var_batch;
+            }
+        }
+    }
+    s.var_stat = var_stat;
+
+    return s;
+}
+
+
+std::vector<size_t> OnlineTraceStatistics::getBlockBoundaries( void ) const
+{
+
+    std::vector<size_t> boundaries;
+    for (size_t i=0; i<blocks.size(); ++i)
+    {
+        boundaries.push_back( blocks[i].start );
+    }
+
+    return boundaries;
+}
+
+
+double OnlineTraceStatistics::getESS(size_t begin, size_t end) const
+{
+
+    RangeStatistics s = computeStatistics( begin, end );
+
+    return s.n * s.gamma0 / s.var_stat;
+}
+
+
+double OnlineTraceStatistics::getMean(size_t begin, size_t end) const
+{
+
+    return computeStatistics( begin, end ).mean;
+}
+
+
+size_t OnlineTraceStatistics::getRangeSize(size_t begin, size_t end) const
+{
+
+    size_t first = nearestBlock( begin );
+    size_t last  = nearestBlock( end );
+
+    size_t n = 0;
+    for (size_t i=first; i<last; ++i)
+    {
+        n += blocks[i].n;
+    }
+
+    return n;
+}
+
+
+double OnlineTraceStatistics::getSEM(size_t begin, size_t end) const
+{
+
+    RangeStatistics s = computeStatistics( begin, end );
+
+    return sqrt( s.var_stat / s.n );
+}
+
+
+double OnlineTraceStatistics::getVariance(size_t begin, size_t end) const
+{
+
+    return computeStatistics( begin, end ).gamma0;
+}
+
+
+/**
+ * Find the block boundary closest to sample i.
+ * The boundaries are the starts of the blocks and the end of the trace (index blocks.size()).
+ */
+size_t OnlineTraceStatistics::nearestBlock(size_t i) const
+{
+
+    size_t best = blocks.size();
+    size_t best_distance = ( i > num_samples ? i - num_samples : num_samples - i );
+    for (size_t j=0; j<blocks.size(); ++j)
+    {
+        size_t distance = ( i > blocks[j].start ? i - blocks[j].start : blocks[j].start - i );
+        if ( distance < best_distance )
+        {
+            best = j;
+            best_distance = distance;
+        }
+    }
+
+    return best;
+}
+
+
+std::vector<double> OnlineTraceStatistics::recentSums( void ) const
+{
+
+    size_t k_max = ( num_samples < max_lag ? num_samples : max_lag );
+    std::vector<double> sums = std::vector<double>(k_max+1, 0.0);
+    for (size_t k=1; k<=k_max; ++k)
+    {
+        sums[k] = sums[k-1] + recent[ (num_samples - k) % max_lag ];
+    }
+
+    return sums;
+}
+
+
+size_t OnlineTraceStatistics::size( void ) const
+{
+
+    return num_samples;
+}
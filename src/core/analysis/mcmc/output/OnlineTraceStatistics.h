@@ -0,0 +1,86 @@
+#ifndef OnlineTraceStatistics_H
+#define OnlineTraceStatistics_H
+
+#include <cstddef>
+#include <vector>
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Running statistics of the trace of one continuous parameter.
+     *
+     * The statistics are kept with online accumulators, so adding a sample costs O(L) and memory is bounded,
+     * where L is the maximum lag of the autocovariances. The trace is split into consecutive blocks, and for each block
+     * we store the sum of the values and the sums of the lagged products within the block and into the next block.
+     * Once there are too many blocks, neighbouring blocks are merged exactly and the block size is doubled.
+     *
+     * The mean, variance, autocovariances, ESS and SEM can be computed for any range of blocks in O(blocks * L),
+     * i.e., the ranges are rounded to the nearest block boundaries. The ESS and SEM use the same
+     * initial positive sequence estimator as TraceNumeric. If the autocovariances are still positive at lag L,
+     * we use the batch means estimator over the blocks instead whenever it gives a larger variance.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since Version 1.0, 2026-10-18
+     *
+     */
+    class OnlineTraceStatistics {
+
+    public:
+        OnlineTraceStatistics(size_t l = 50, size_t b = 32);
+
+        void                            addValue(double x);                                             //!< Add the next sample
+        std::vector<size_t>             getBlockBoundaries(void) const;                                 //!< The indices at which the blocks start (the candidates for the burnin)
+        double                          getESS(size_t begin, size_t end) const;                         //!< The effective sample size of the samples [begin,end)
+        double                          getMean(size_t begin, size_t end) const;                        //!< The mean of the samples [begin,end)
+        double                          getSEM(size_t begin, size_t end) const;                         //!< The standard error of the mean of the samples [begin,end)
+        double                          getVariance(size_t begin, size_t end) const;                    //!< The variance (divided by n) of the samples [begin,end)
+        size_t                          getRangeSize(size_t begin, size_t end) const;                   //!< The number of samples in [begin,end) after rounding to the block boundaries
+        size_t                          size(void) const;                                               //!< The number of samples
+
+    private:
+
+        /*
+         * The accumulators of one block. All values are shifted by the first sample to avoid cancellation.
+         */
+        struct Block {
+
+            Block(size_t s, size_t l) : start( s ), n( 0 ), sum( 0.0 ), inner( l+1, 0.0 ), outer( l+1, 0.0 ), head( 1, 0.0 ), tail() {}
+
+            size_t                      start;                                                          //!< Index of the first sample
+            size_t                      n;                                                              //!< Number of samples
+            double                      sum;
+            std::vector<double>         inner;                                                          //!< Sums of x[t]*x[t+k] with both samples in this block
+            std::vector<double>         outer;                                                          //!< Sums of x[t]*x[t+k] with x[t+k] in the next block
+            std::vector<double>         head;                                                           //!< Sums of the first k samples
+            std::vector<double>         tail;                                                           //!< Sums of the last k samples (once the block is full)
+        };
+
+        /*
+         * The statistics of a range of samples.
+         */
+        struct RangeStatistics {
+
+            size_t                      n;
+            double                      mean;
+            double                      gamma0;                                                         //!< The variance
+            double                      var_stat;                                                       //!< The variance of the mean times n
+        };
+
+        RangeStatistics                 computeStatistics(size_t begin, size_t end) const;
+        void                            closeBlock(void);                                               //!< The last block is full: store its tail and merge blocks if necessary
+        size_t                          nearestBlock(size_t i) const;                                   //!< The index of the block boundary closest to sample i
+        std::vector<double>             recentSums(void) const;                                         //!< Sums of the last k samples of the trace
+
+        size_t                          max_lag;                                                        //!< L
+        size_t                          max_blocks;
+        size_t                          block_size;
+        size_t                          num_samples;
+        double                          shift;
+        std::vector<Block>              blocks;                                                         //!< All blocks but the last are full
+        std::vector<double>             recent;                                                         //!< The last L samples (ring buffer)
+    };
+
+}
+
+#endif
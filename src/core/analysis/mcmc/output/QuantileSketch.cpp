@@ -0,0 +1,233 @@
+#include "QuantileSketch.h"
+#include "RbConstants.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+using namespace RevBayesCore;
+
+
+QuantileSketch::QuantileSketch(size_t c) :
+    capacity( std::max<size_t>(c, 1) ),
+    num_samples( 0 ),
+    sum( 0.0 ),
+    is_sorted( true )
+{
+
+}
+
+
+void QuantileSketch::addValue(double x)
+{
+
+    sum += x;
+    ++num_samples;
+
+    if ( is_sorted == true && values.empty() == false && x < values.back() )
+    {
+        is_sorted = false;
+    }
+
+    values.push_back( x );
+    if ( weights.empty() == false )
+    {
+        weights.push_back( 1 );
+    }
+
+    if ( values.size() > 4*capacity )
+    {
+        compress();
+    }
+
+}
+
+
+/**
+ * Merge neighbouring values into centroids (with the weighted mean as value)
+ * as long as the centroid weighs at most 1/capacity of all samples.
+ */
+void QuantileSketch::compress( void )
+{
+
+    sort();
+
+    if ( weights.empty() == true )
+    {
+        weights = std::vector<size_t>( values.size(), 1 );
+    }
+
+    size_t max_weight = std::max<size_t>( 1, num_samples / capacity );
+
+    size_t n = 0;
+    double current_sum    = values[0] * weights[0];
+    size_t current_weight = weights[0];
+    for (size_t i = 1; i < values.size(); ++i)
+    {
+        if ( current_weight + weights[i] <= max_weight )
+        {
+            current_sum    += values[i] * weights[i];
+            current_weight += weights[i];
+        }
+        else
+        {
+            values[n]  = current_sum / current_weight;
+            weights[n] = current_weight;
+            ++n;
+            current_sum    = values[i] * weights[i];
+            current_weight = weights[i];
+        }
+    }
+    values[n]  = current_sum / current_weight;
+    weights[n] = current_weight;
+    ++n;
+
+    values.resize( n );
+    weights.resize( n );
+
+}
+
+
+/**
+ * Compute the smallest interval that contains (int)(p*n) of the n samples,
+ * using the same rules as for a sorted vector of all samples.
+ * If the interval would contain less than two samples, both bounds are the median sample.
+ */
+void QuantileSketch::getHPDInterval(double p, double &lower, double &upper) const
+{
+
+    if ( num_samples == 0 )
+    {
+        lower = RbConstants::Double::nan;
+        upper = RbConstants::Double::nan;
+        return;
+    }
+
+    sort();
+
+    lower = getValueAtRank( size_t(0.5 * double(num_samples)) );
+    upper = lower;
+
+    size_t interval_size = size_t( p * double(num_samples) );
+    if ( interval_size > 1 )
+    {
+        double min_range = std::numeric_limits<double>::max();
+
+        // slide a window over the sorted values that holds at least interval_size samples
+        size_t end = 0;
+        size_t window_weight = 0;
+        for (size_t start = 0; start < values.size(); ++start)
+        {
+            while ( end < values.size() && window_weight < interval_size )
+            {
+                window_weight += ( weights.empty() ? 1 : weights[end] );
+                ++end;
+            }
+            if ( window_weight < interval_size )
+            {
+                break;
+            }
+
+            double range = std::fabs( values[end-1] - values[start] );
+            if ( range < min_range )
+            {
+                min_range = range;
+                lower = values[start];
+                upper = values[end-1];
+            }
+
+            window_weight -= ( weights.empty() ? 1 : weights[start] );
+        }
+    }
+
+}
+
+
+double QuantileSketch::getMean( void ) const
+{
+    return sum / num_samples;
+}
+
+
+double QuantileSketch::getMedian( void ) const
+{
+
+    if ( num_samples == 0 )
+    {
+        return RbConstants::Double::nan;
+    }
+
+    sort();
+
+    size_t idx = num_samples / 2;
+    if ( num_samples % 2 == 1 )
+    {
+        return getValueAtRank( idx );
+    }
+    else
+    {
+        return ( getValueAtRank( idx-1 ) + getValueAtRank( idx ) ) / 2;
+    }
+
+}
+
+
+double QuantileSketch::getValueAtRank(size_t r) const
+{
+
+    if ( weights.empty() == true )
+    {
+        return values[r];
+    }
+
+    size_t cumulative_weight = 0;
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        cumulative_weight += weights[i];
+        if ( r < cumulative_weight )
+        {
+            return values[i];
+        }
+    }
+
+    return values.back();
+}
+
+
+size_t QuantileSketch::size( void ) const
+{
+    return num_samples;
+}
+
+
+void QuantileSketch::sort( void ) const
+{
+
+    if ( is_sorted == true )
+    {
+        return;
+    }
+
+    if ( weights.empty() == true )
+    {
+        std::sort( values.begin(), values.end() );
+    }
+    else
+    {
+        std::vector<std::pair<double, size_t> > centroids( values.size() );
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            centroids[i] = std::make_pair( values[i], weights[i] );
+        }
+        std::sort( centroids.begin(), centroids.end() );
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            values[i]  = centroids[i].first;
+            weights[i] = centroids[i].second;
+        }
+    }
+
+    is_sorted = true;
+
+}
@@ -0,0 +1,53 @@
+#ifndef QuantileSketch_H
+#define QuantileSketch_H
+
+#include <cstddef>
+#include <vector>
+
+namespace RevBayesCore {
+
+    /**
+     * @brief A summary of a stream of values with bounded memory.
+     *
+     * The sketch stores all values exactly until it holds more than 4 times its capacity.
+     * Then the sorted values are merged greedily into weighted centroids such that no centroid
+     * weighs more than 1/capacity of all samples (similar to a t-digest with a uniform size limit).
+     * Hence, the sketch never stores more than about 4*capacity values,
+     * and quantiles are accurate to about 1/capacity in rank.
+     * The mean is always computed exactly.
+     *
+     * As long as no values were merged, the median and HPD interval are identical to those computed from all samples.
+     * Note that the sketch only bounds the memory of the summary; the tree trace it summarizes still holds all samples (see TraceTree).
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since Version 1.0, 2026-10-18
+     *
+     */
+    class QuantileSketch {
+
+    public:
+        QuantileSketch(size_t c = 256);
+
+        void                            addValue(double x);                                             //!< Add a sample
+        void                            getHPDInterval(double p, double &lower, double &upper) const;   //!< The smallest interval containing (about) the fraction p of the samples
+        double                          getMean(void) const;
+        double                          getMedian(void) const;
+        size_t                          size(void) const;                                               //!< The number of samples (not the number of stored values)
+
+    private:
+        void                            compress(void);                                                 //!< Merge the values into weighted centroids
+        void                            sort(void) const;                                               //!< Sort the values (and weights) in ascending order
+        double                          getValueAtRank(size_t r) const;                                 //!< The value of the r-th smallest sample
+
+        size_t                          capacity;
+        size_t                          num_samples;
+        double                          sum;
+        mutable bool                    is_sorted;
+        mutable std::vector<double>     values;
+        mutable std::vector<size_t>     weights;                                                        //!< Empty as long as all values have weight 1
+    };
+
+}
+
+#endif
@@ -53,7 +53,7 @@ namespace RevBayesCore {
         const std::vector<valueType>&   getValues() const                               { return values; }
 
         virtual void                    setBurnin(long b);
-        void                            setValues(std::vector<valueType> v)             { values = v; }
+        void                            setValues(std::vector<valueType> v)             { values = v; ++num_value_changes; }
         
 
         // getters and setters
@@ -69,6 +69,7 @@ namespace RevBayesCore {
         std::string                     fileName;
         std::string                     parmName;
         std::vector<valueType>          values;                                     //!< the values of this trace
+        size_t                          num_value_changes;                          //!< counts every change of the values, so that derived traces know when their cached statistics are outdated
 
         mutable bool                    dirty;
 
@@ -117,6 +118,7 @@ RevBayesCore::Trace<valueType>::Trace() :
     burnin( 0 ),
     fileName( "" ),
     parmName( "" ),
+    num_value_changes( 0 ),
     dirty( true )
 {
 }
@@ -126,6 +128,7 @@ template <class valueType>
 void RevBayesCore::Trace<valueType>::addObject(valueType t)
 {
     values.push_back(t);
+    ++num_value_changes;
     dirty = true;
 }
 
@@ -171,6 +174,7 @@ void RevBayesCore::Trace<valueType>::removeObjectAtIndex (int index)
 {
     // remove the element
     values.erase(values.begin() + index);
+    ++num_value_changes;
     dirty = true;
 }
 
@@ -180,6 +184,7 @@ void RevBayesCore::Trace<valueType>::removeLastObject()
 {
     // remove object from list
     values.pop_back();
+    ++num_value_changes;
     dirty = true;
 }
 
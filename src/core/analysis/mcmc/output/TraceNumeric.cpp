@@ -1,6 +1,7 @@
 #include "TraceNumeric.h"
 #include "DistributionNormal.h"
 #include "RbConstants.h"
+#include "RbException.h"
 #include "RbMathLogic.h"
 
 #include "GewekeTest.h"
@@ -9,6 +10,7 @@
 #include "StationarityTest.h"
 
 #include <cmath>
+#include <complex>
 #include <math.h>
 
 using namespace RevBayesCore;
@@ -16,6 +18,99 @@ using namespace std;
 
 #define MAX_LAG 1000
 
+// the number of lags that we compute directly before we switch to the FFT
+#define DIRECT_LAGS 16
+
+
+namespace {
+
+    /*
+     * In-place radix-2 fast Fourier transform (the size must be a power of 2).
+     */
+    void fft(std::vector<std::complex<double> > &x, bool inverse)
+    {
+
+        size_t n = x.size();
+
+        // bit reversal permutation
+        for (size_t i=1, j=0; i<n; ++i)
+        {
+            size_t bit = n >> 1;
+            for ( ; j & bit; bit >>= 1)
+            {
+                j ^= bit;
+            }
+            j ^= bit;
+
+            if (i < j)
+            {
+                std::swap(x[i], x[j]);
+            }
+        }
+
+        // the roots of unity for the largest stage; the smaller stages use every k-th of them
+        std::vector<std::complex<double> > w = std::vector<std::complex<double> >(n/2);
+        double sign = (inverse ? 1.0 : -1.0);
+        for (size_t i=0; i<n/2; ++i)
+        {
+            w[i] = std::polar(1.0, sign * 2.0 * M_PI * i / double(n));
+        }
+
+        for (size_t len=2; len<=n; len <<= 1)
+        {
+            size_t step = n / len;
+            for (size_t i=0; i<n; i+=len)
+            {
+                for (size_t j=0; j<len/2; ++j)
+                {
+                    std::complex<double> u = x[i+j];
+                    std::complex<double> v = x[i+j+len/2] * w[j*step];
+                    x[i+j]         = u + v;
+                    x[i+j+len/2]   = u - v;
+                }
+            }
+        }
+
+    }
+
+
+    /*
+     * Compute the autocovariances of the n values for all lags smaller than max_lag by FFT.
+     * We pad the values with zeros so that the circular correlation equals the linear one for these lags.
+     */
+    std::vector<double> computeAutocovariances(const double* x, size_t n, double m, size_t max_lag)
+    {
+
+        size_t size = 1;
+        while (size < n + max_lag)
+        {
+            size <<= 1;
+        }
+
+        std::vector<std::complex<double> > f = std::vector<std::complex<double> >(size, 0.0);
+        for (size_t i=0; i<n; ++i)
+        {
+            f[i] = x[i] - m;
+        }
+
+        fft(f, false);
+        for (size_t i=0; i<size; ++i)
+        {
+            f[i] = std::norm(f[i]);
+        }
+        fft(f, true);
+
+        std::vector<double> gamma = std::vector<double>(max_lag, 0.0);
+        for (size_t lag=0; lag<max_lag; ++lag)
+        {
+            gamma[lag] = f[lag].real() / double(size) / double(n - lag);
+        }
+
+        return gamma;
+    }
+
+}
+
 /**
  * 
  */
@@ -31,7 +126,9 @@ TraceNumeric::TraceNumeric() :
     passedStationarityTest( false ),
     passedGewekeTest( false ),
     stats_dirty( true ),
-    statsw_dirty( true )
+    statsw_dirty( true ),
+    batch_size( 0 ),
+    batch_means_changes( 0 )
 {
     
 }
@@ -60,6 +157,169 @@ void TraceNumeric::computeStatistics( void )
 }
 
 
+/**
+ * Compute the prefix sums needed for the overlapping batch means of any range.
+ * The batch size is the square root of the number of values. The prefix sums are computed once
+ * and reused for every range (e.g., every candidate burnin), so that the statistics of a range cost constant time.
+ */
+void TraceNumeric::computeBatchMeans( void ) const
+{
+
+    // the prefix sums are up to date if nobody changed the values since we computed them
+    if ( prefix_sums.empty() == false && batch_means_changes == num_value_changes )
+    {
+        return;
+    }
+
+    size_t n = values.size();
+    batch_size = size_t( sqrt( double(n) ) );
+    if ( batch_size < 1 )
+    {
+        batch_size = 1;
+    }
+
+    double shift = ( n > 0 ? values[0] : 0.0 );
+    prefix_sums     = std::vector<double>(n+1, 0.0);
+    prefix_squares  = std::vector<double>(n+1, 0.0);
+    for (size_t i=0; i<n; ++i)
+    {
+        double y = values[i] - shift;
+        prefix_sums[i+1]    = prefix_sums[i] + y;
+        prefix_squares[i+1] = prefix_squares[i] + y*y;
+    }
+
+    size_t num_batches = ( n >= batch_size ? n - batch_size + 1 : 0 );
+    prefix_batch_means   = std::vector<double>(num_batches+1, 0.0);
+    prefix_batch_squares = std::vector<double>(num_batches+1, 0.0);
+    for (size_t j=0; j<num_batches; ++j)
+    {
+        double batch_mean = (prefix_sums[j+batch_size] - prefix_sums[j]) / batch_size;
+        prefix_batch_means[j+1]   = prefix_batch_means[j] + batch_mean;
+        prefix_batch_squares[j+1] = prefix_batch_squares[j] + batch_mean*batch_mean;
+    }
+
+    batch_means_changes = num_value_changes;
+}
+
+
+/**
+ * Compute the standard error of the mean and the effective sample size of the values [begin,end)
+ * with the overlapping batch means estimator of the variance of the mean.
+ * Ranges that are too short for a single batch use the autocorrelation estimator.
+ */
+void TraceNumeric::computeBatchMeansStatistics(long begin, long end, double &s, double &e) const
+{
+
+    if ( begin < 0 || end > long( values.size() ) )
+    {
+        throw RbException("Cannot compute the effective sample size of values outside of the trace.");
+    }
+
+    computeBatchMeans();
+
+    size_t n = ( end > begin ? end - begin : 0 );
+    size_t b = batch_size;
+    if ( n <= b )
+    {
+        s = getSEM(begin, end);
+        e = getESS(begin, end);
+        return;
+    }
+
+    double m        = (prefix_sums[end] - prefix_sums[begin]) / n;
+    double gamma0   = (prefix_squares[end] - prefix_squares[begin]) / n - m*m;
+
+    // the batches starting in [begin, end-b]
+    size_t num_batches  = n - b + 1;
+    double sum          = prefix_batch_means[end-b+1] - prefix_batch_means[begin];
+    double sum_squares  = prefix_batch_squares[end-b+1] - prefix_batch_squares[begin];
+    double ss           = sum_squares - 2.0 * m * sum + num_batches * m*m;
+
+    double varStat = n * double(b) / ((n - b) * (n - b + 1.0)) * ss;
+
+    s = sqrt(varStat / n);
+    e = n * gamma0 / varStat;
+}
+
+
+/**
+ * Compute the standard error of the mean and the effective sample size of the samples starting at 'first'.
+ * We sum the autocovariances with the initial positive sequence criterion. The first lags are computed directly,
+ * which is cheap because most traces decorrelate quickly. If more lags are needed, we compute all autocovariances at once by FFT.
+ */
+void TraceNumeric::computeCorrelationStatistics(size_t first, size_t samples, double m, double &s, double &e) const
+{
+
+    if ( first > values.size() || samples > values.size() - first )
+    {
+        throw RbException("Cannot compute the effective sample size of values outside of the trace.");
+    }
+
+    // we need at least two samples for the autocorrelation
+    if ( samples < 2 )
+    {
+        s = RbConstants::Double::nan;
+        e = RbConstants::Double::nan;
+        return;
+    }
+
+    const double* x = values.data() + first;
+    size_t maxLag = (samples - 1 < MAX_LAG ? samples - 1 : MAX_LAG);
+
+    std::vector<double> gammaStat = std::vector<double>(maxLag > 0 ? maxLag : 1, 0.0);
+    std::vector<double> autocovariances;
+    double varStat = 0.0;
+
+    for (size_t lag = 0; lag < maxLag; lag++)
+    {
+        if (lag < DIRECT_LAGS)
+        {
+            for (size_t j = 0; j < samples - lag; j++)
+            {
+                gammaStat[lag] += (x[j] - m) * (x[j + lag] - m);
+            }
+            gammaStat[lag] /= ((double) (samples - lag));
+        }
+        else
+        {
+            if (autocovariances.empty() == true)
+            {
+                autocovariances = computeAutocovariances(x, samples, m, maxLag);
+            }
+            gammaStat[lag] = autocovariances[lag];
+        }
+
+        if (lag == 0)
+        {
+            varStat = gammaStat[0];
+        }
+        else if (lag % 2 == 0)
+        {
+            // fancy stopping criterion :)
+            if (gammaStat[lag - 1] + gammaStat[lag] > 0)
+            {
+                varStat += 2.0 * (gammaStat[lag - 1] + gammaStat[lag]);
+            }
+            // stop
+            else
+            {
+                maxLag = lag;
+            }
+        }
+    }
+
+    // standard error of mean
+    s = sqrt(varStat / samples);
+
+    // auto correlation time
+    double act = varStat / gammaStat[0];
+
+    // effective sample size
+    e = samples / act;
+
+}
+
+
 double TraceNumeric::getMean() const
 {
     if( isDirty() == false ) return mean;
@@ -68,7 +328,7 @@ double TraceNumeric::getMean() const
     size_t size = values.size();
     for (size_t i=burnin; i<size; i++)
     {
-        m += values.at(i);
+        m += values[i];
     }
     
     mean = m/double(size-burnin);
@@ -91,7 +351,7 @@ double TraceNumeric::getMean(long inbegin, long inend) const
         double m = 0;
         for (size_t i=begin; i<end; i++)
         {
-            m += values.at(i);
+            m += values[i];
         }
 
         meanw = m/(end-begin);
@@ -119,6 +379,24 @@ double TraceNumeric::getESS(long begin, long end) const
 }
 
 
+/**
+ * Compute the effective sample size within a range of values using the overlapping batch means.
+ *
+ * @param begin     begin index for analysis
+ * @param end       end index for analysis
+ *
+ */
+double TraceNumeric::getESSBatchMeans(long begin, long end) const
+{
+
+    double s = 0.0;
+    double e = 0.0;
+    computeBatchMeansStatistics(begin, end, s, e);
+
+    return e;
+}
+
+
 /**
  * @return the ESS
  */
@@ -146,6 +424,24 @@ double TraceNumeric::getSEM(long begin, long end) const
 }
 
 
+/**
+ * Compute the standard error of the mean within a range of values using the overlapping batch means.
+ *
+ * @param begin     begin index for analysis
+ * @param end       end index for analysis
+ *
+ */
+double TraceNumeric::getSEMBatchMeans(long begin, long end) const
+{
+
+    double s = 0.0;
+    double e = 0.0;
+    computeBatchMeansStatistics(begin, end, s, e);
+
+    return s;
+}
+
+
 /**
  * @return the standard error of the mean
  */
@@ -169,51 +465,10 @@ void TraceNumeric::update() const
 
     if( stats_dirty == false ) return;
 
-    size_t samples = values.size() - burnin;
-    size_t maxLag = (samples - 1 < MAX_LAG ? samples - 1 : MAX_LAG);
-
-    double* gammaStat = new double[maxLag];
-    // setting values to 0
-    for (size_t i=0; i<maxLag; i++)
-    {
-        gammaStat[i] = 0;
-    }
-    double varStat = 0.0;
-
-    for (size_t lag = 0; lag < maxLag; lag++) {
-        for (size_t j = 0; j < samples - lag; j++) {
-            double del1 = values.at(burnin + j) - mean;
-            double del2 = values.at(burnin + j + lag) - mean;
-            gammaStat[lag] += (del1 * del2);
-        }
-
-        gammaStat[lag] /= ((double) (samples - lag));
-
-        if (lag == 0) {
-            varStat = gammaStat[0];
-        } else if (lag % 2 == 0) {
-            // fancy stopping criterion :)
-            if (gammaStat[lag - 1] + gammaStat[lag] > 0) {
-                varStat += 2.0 * (gammaStat[lag - 1] + gammaStat[lag]);
-            }
-            // stop
-            else
-                maxLag = lag;
-        }
-    }
-
-    // standard error of mean
-    sem = sqrt(varStat / samples);
-
-    // auto correlation time
-    double act = varStat / gammaStat[0];
-
-    // effective sample size
-    ess = samples / act;
+    size_t samples = ( values.size() > burnin ? values.size() - burnin : 0 );
+    computeCorrelationStatistics(burnin, samples, mean, sem, ess);
 
     stats_dirty = false;
-
-    delete[] gammaStat;
 }
 
 /**
@@ -227,48 +482,8 @@ void TraceNumeric::update(long inbegin, long inend) const
 
     if( statsw_dirty == false ) return;
 
-    size_t samples = end - begin;
-    size_t maxLag = (samples - 1 < MAX_LAG ? samples - 1 : MAX_LAG);
-
-    double* gammaStat = new double[maxLag];
-    // setting values to 0
-    for (size_t i=0; i<maxLag; i++) {
-        gammaStat[i] = 0;
-    }
-    double varStat = 0.0;
-
-    for (size_t lag = 0; lag < maxLag; lag++) {
-        for (size_t j = 0; j < samples - lag; j++) {
-            double del1 = values.at(begin + j) - meanw;
-            double del2 = values.at(begin + j + lag) - meanw;
-            gammaStat[lag] += (del1 * del2);
-        }
-
-        gammaStat[lag] /= ((double) (samples - lag));
-
-        if (lag == 0) {
-            varStat = gammaStat[0];
-        } else if (lag % 2 == 0) {
-            // fancy stopping criterion :)
-            if (gammaStat[lag - 1] + gammaStat[lag] > 0) {
-                varStat += 2.0 * (gammaStat[lag - 1] + gammaStat[lag]);
-            }
-            // stop
-            else
-                maxLag = lag;
-        }
-    }
-
-    // standard error of mean
-    semw = sqrt(varStat / samples);
-
-    // auto correlation time
-    double act = varStat / gammaStat[0];
-
-    // effective sample size
-    essw = samples / act;
-
-    delete[] gammaStat;
+    size_t samples = ( end > begin ? end - begin : 0 );
+    computeCorrelationStatistics(begin, samples, meanw, semw, essw);
 
     statsw_dirty = false;
 }
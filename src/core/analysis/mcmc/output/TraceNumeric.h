@@ -22,6 +22,8 @@ namespace RevBayesCore {
         double                  getMean(long begin, long end) const;            //!< compute the mean for the trace with begin and end indices of the values
         double                  getESS(long begin, long end) const;             //!< compute the effective sample size with begin and end indices of the values
         double                  getSEM(long begin, long end) const;             //!< compute the effective sample size with begin and end indices of the values
+        double                  getESSBatchMeans(long begin, long end) const;   //!< compute the effective sample size with the overlapping batch means estimator
+        double                  getSEMBatchMeans(long begin, long end) const;   //!< compute the standard error of the mean with the overlapping batch means estimator
 
         void                    computeStatistics(void);
 
@@ -37,6 +39,9 @@ namespace RevBayesCore {
 
         void                    update() const;                                 //!< compute the correlation statistics (act,ess,sem,...)
         void                    update(long begin, long end) const;             //!< compute the correlation statistics (act,ess,sem,...)
+        void                    computeCorrelationStatistics(size_t first, size_t samples, double m, double &s, double &e) const;  //!< compute the sem and ess of the samples starting at first
+        void                    computeBatchMeans(void) const;                  //!< compute the prefix sums for the overlapping batch means
+        void                    computeBatchMeansStatistics(long begin, long end, double &s, double &e) const;  //!< compute the sem and ess of a range from the batch means
 
         // variable holding the data
         mutable double          ess;                                            //!< effective sample size
@@ -61,6 +66,15 @@ namespace RevBayesCore {
 
         mutable bool            stats_dirty;
         mutable bool            statsw_dirty;
+
+        // prefix sums of the values, their squares, and the overlapping batch means (and their squares)
+        // all values are shifted by the first value to avoid cancellation
+        mutable std::vector<double> prefix_sums;
+        mutable std::vector<double> prefix_squares;
+        mutable std::vector<double> prefix_batch_means;
+        mutable std::vector<double> prefix_batch_squares;
+        mutable size_t          batch_size;
+        mutable size_t          batch_means_changes;                            //!< the number of value changes when we computed the batch means
     
     };
 
@@ -0,0 +1,118 @@
+#include "RbException.h"
+#include "RbFileManager.h"
+#include "TraceStatisticsCollector.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+using namespace RevBayesCore;
+
+
+TraceStatisticsCollector::TraceStatisticsCollector(char d) :
+    delimiter( d ),
+    partial_line( "" ),
+    has_header( false ),
+    names(),
+    statistics()
+{
+
+}
+
+
+void TraceStatisticsCollector::addData(const std::string &data)
+{
+
+    std::lock_guard<std::mutex> lock( mutex );
+
+    size_t begin = 0;
+    size_t end = data.find( '\n' );
+    while ( end != std::string::npos )
+    {
+        partial_line.append( data, begin, end - begin );
+        addLine( partial_line );
+        partial_line.clear();
+
+        begin = end + 1;
+        end = data.find( '\n', begin );
+    }
+    partial_line.append( data, begin, std::string::npos );
+
+}
+
+
+void TraceStatisticsCollector::addLine(const std::string &line)
+{
+
+    // skip blank lines
+    if ( line.find_first_not_of( " \t\r\n" ) == std::string::npos )
+    {
+        return;
+    }
+
+    std::vector<std::string> fields;
+    std::stringstream ss( line );
+    std::string field = "";
+    while ( std::getline(ss, field, delimiter) )
+    {
+        size_t first = field.find_first_not_of( " \t\r" );
+        size_t last  = field.find_last_not_of( " \t\r" );
+        fields.push_back( first == std::string::npos ? "" : field.substr(first, last - first + 1) );
+    }
+
+    // the first column holds the iteration
+    if ( has_header == false )
+    {
+        for (size_t j=1; j<fields.size(); ++j)
+        {
+            names.push_back( fields[j] );
+            statistics.push_back( OnlineTraceStatistics() );
+        }
+        has_header = true;
+    }
+    else
+    {
+        for (size_t j=1; j<fields.size() && j<=statistics.size(); ++j)
+        {
+            statistics[j-1].addValue( atof( fields[j].c_str() ) );
+        }
+    }
+
+}
+
+
+std::vector<std::string> TraceStatisticsCollector::getParameterNames( void ) const
+{
+
+    std::lock_guard<std::mutex> lock( mutex );
+
+    return names;
+}
+
+
+std::vector<OnlineTraceStatistics> TraceStatisticsCollector::getStatistics( void ) const
+{
+
+    std::lock_guard<std::mutex> lock( mutex );
+
+    return statistics;
+}
+
+
+void TraceStatisticsCollector::readFile(const std::string &fn)
+{
+
+    std::ifstream in;
+    RbFileManager f = RbFileManager(fn);
+    if ( f.openFile(in) == false )
+    {
+        throw RbException( "Could not open file " + fn );
+    }
+
+    std::stringstream content;
+    content << in.rdbuf();
+    f.closeFile( in );
+
+    addData( content.str() );
+
+}
@@ -0,0 +1,50 @@
+#ifndef TraceStatisticsCollector_H
+#define TraceStatisticsCollector_H
+
+#include "OnlineTraceStatistics.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Online statistics of all parameters of a trace file.
+     *
+     * The collector parses the text of a continuous trace file (as written by the model or file monitors) piece by piece,
+     * e.g. as the records are handed to the AsyncFileWriter, and adds the values to an OnlineTraceStatistics per column.
+     * The format is the one read by the TraceContinuousReader: the first non-empty line contains the column names,
+     * and the first column (the iteration) is skipped.
+     *
+     * The collector may be fed by the thread that writes the file while another thread requests the statistics.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since Version 1.0, 2026-10-18
+     *
+     */
+    class TraceStatisticsCollector {
+
+    public:
+        TraceStatisticsCollector(char d = '\t');
+
+        void                                        addData(const std::string &data);                       //!< Parse the next piece of the file
+        std::vector<std::string>                    getParameterNames(void) const;
+        std::vector<OnlineTraceStatistics>          getStatistics(void) const;                              //!< A copy of the statistics of all parameters
+        void                                        readFile(const std::string &fn);                        //!< Parse the whole file from disk
+
+    private:
+        void                                        addLine(const std::string &line);
+
+        char                                        delimiter;
+        std::string                                 partial_line;                                           //!< The beginning of a line that was not yet complete
+        bool                                        has_header;
+        std::vector<std::string>                    names;
+        std::vector<OnlineTraceStatistics>          statistics;
+        mutable std::mutex                          mutex;
+    };
+
+}
+
+#endif
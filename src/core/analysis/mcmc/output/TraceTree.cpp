@@ -609,6 +609,7 @@ void TraceTree::annotateTree( Tree &tree, AnnotationReport report, bool verbose
     RBOUT("Annotating tree ...");
     
     std::string newick;
+    std::map<Fingerprint, QuantileSketch> tree_ages;
     
     if ( report.conditional_tree_ages )
     {
@@ -638,10 +639,27 @@ void TraceTree::annotateTree( Tree &tree, AnnotationReport report, bool verbose
         
         delete tmp_tree;
         
-        if ( tree_clade_ages.find(newick) == tree_clade_ages.end() )
+        Fingerprint topology = computeFingerprint( newick );
+        if ( topology_first_samples.find(topology) == topology_first_samples.end() )
         {
             throw(RbException("Could not find input tree in tree sample"));
         }
+        
+        // collect the ages from all samples with this topology
+        for (size_t i = 0; i < sample_topologies.size(); ++i)
+        {
+            if ( sample_topologies[i] == topology )
+            {
+                Tree sample_tree = getSummaryTree( burnin + i );
+                std::vector<std::pair<Fingerprint, double> > sample_splits;
+                RbBitSet b( sample_tree.getNumberOfTips(), false );
+                collectTreeSplits( sample_tree.getRoot(), b, sample_splits );
+                for (size_t j = 0; j < sample_splits.size(); ++j)
+                {
+                    tree_ages[ sample_splits[j].first ].addValue( sample_splits[j].second );
+                }
+            }
+        }
     }
     
     const std::vector<TopologyNode*> &nodes = tree.getNodes();
@@ -654,6 +672,7 @@ void TraceTree::annotateTree( Tree &tree, AnnotationReport report, bool verbose
         
         Clade clade = n->getClade();
         Split split( clade.getBitRepresentation(), clade.getMrca(), rooted);
+        Fingerprint split_fingerprint = computeFingerprint( split );
         
         // annotate clade posterior prob
         if ( ( !n->isTip() || ( n->isRoot() && !clade.getMrca().empty() ) ) && report.clade_probs )
@@ -675,63 +694,40 @@ void TraceTree::annotateTree( Tree &tree, AnnotationReport report, bool verbose
         }
         
         // annotate conditional clade probs and get node ages
-        std::vector<double> node_ages;
+        QuantileSketch node_ages;
         
         if ( !n->isRoot() )
         {
             Clade parent_clade = n->getParent().getClade();
             Split parent_split = Split( parent_clade.getBitRepresentation(), parent_clade.getMrca(), rooted);
+            Fingerprint parent_fingerprint = computeFingerprint( parent_split );
 
-            std::map<Split, std::vector<double> >& condCladeAges = conditional_clade_ages[parent_split];
-            node_ages = report.conditional_clade_ages ? condCladeAges[split] : clade_ages[split];
+            std::map<Fingerprint, QuantileSketch>& condCladeAges = conditional_clade_ages[parent_fingerprint];
+            node_ages = report.conditional_clade_ages ? condCladeAges[split_fingerprint] : clade_ages[split_fingerprint];
             
             // annotate CCPs
             if ( !n->isTip() && report.conditional_clade_probs )
             {
-                double parentCladeFreq = splitFrequency( parent_split );
-                double ccp = condCladeAges[split].size() / parentCladeFreq;
+                double parentCladeFreq = splitFrequency( parent_fingerprint );
+                double ccp = condCladeAges[split_fingerprint].size() / parentCladeFreq;
                 n->addNodeParameter("ccp",ccp);
             }
         }
         else
         {
-            node_ages = clade_ages[split];
+            node_ages = clade_ages[split_fingerprint];
         }
         
         if ( report.conditional_tree_ages )
         {
-            node_ages = tree_clade_ages[newick][split];
+            node_ages = tree_ages[split_fingerprint];
         }
         
         // set the node ages/branch lengths
         if ( report.node_ages )
         {
-            double age = 0.0;
-            
-            if ( report.mean_node_ages )
-            {
-                // finally, we compute the mean conditional age
-                for (size_t i = 0; i<node_ages.size(); ++i)
-                {
-                    age += node_ages[i];
-                }
-                age /= node_ages.size();
-            }
-            else // use median
-            {
-                
-                size_t idx = node_ages.size() / 2;
-                std::sort( node_ages.begin(), node_ages.end() );
-                if (node_ages.size() % 2 == 1)
-                {
-                    age = node_ages[idx];
-                }
-                else
-                {
-                    age = (node_ages[idx-1] + node_ages[idx]) / 2;
-                }
-                
-            }
+            // use either the mean or the median age
+            double age = ( report.mean_node_ages ? node_ages.getMean() : node_ages.getMedian() );
             
             // finally, we set the age/length
             if ( clock )
@@ -747,39 +743,10 @@ void TraceTree::annotateTree( Tree &tree, AnnotationReport report, bool verbose
         // annotate the HPD node age intervals
         if ( report.node_ages_HPD )
         {
-            //node_ages = cladeAges[c];
-            
-            std::sort(node_ages.begin(), node_ages.end());
-            
-            size_t total_branch_lengths = node_ages.size();
-            double min_range = std::numeric_limits<double>::max();
-            
-            size_t interval_start = 0;
-            double lower = node_ages[(int)(0.5 * (double)total_branch_lengths)];
-            double upper = node_ages[(int)(0.5 * (double)total_branch_lengths)];
-            
-            int interval_size = (int)(report.node_ages_HPD * (double)total_branch_lengths);
-            // we need to make sure that we sampled more than one age
-            if ( interval_size > 1 )
-            {
-
-                // find the smallest interval that contains x% of the samples
-                for (size_t j = 0; j <= (total_branch_lengths - interval_size); j++)
-                {
-                    double temp_lower = node_ages[j];
-                    double temp_upper = node_ages[j + interval_size - 1];
-                    double temp_range = std::fabs(temp_upper - temp_lower);
-                    if (temp_range < min_range)
-                    {
-                        min_range = temp_range;
-                        interval_start = j;
-                    }
-                
-                }
-                lower = node_ages[interval_start];
-                upper = node_ages[interval_start + interval_size - 1];
-
-            }
+            // find the smallest interval that contains x% of the samples
+            double lower = 0.0;
+            double upper = 0.0;
+            node_ages.getHPDInterval( report.node_ages_HPD, lower, upper );
             
             // make node age annotation
             std::string interval = "{" + StringUtilities::toString(lower)
@@ -838,11 +805,17 @@ double TraceTree::cladeProbability(const RevBayesCore::Clade &c, bool verbose )
 }
 
 
-TraceTree::Split TraceTree::collectTreeSample(const TopologyNode& n, RbBitSet& intaxa, std::string newick, std::map<Split, long>& cladeCountMap)
+/**
+ * Collect the splits of this subtree and their ages.
+ * The ages are added to the quantile sketches of the split (and of the split conditional on its parent)
+ * and the first occurrence of each split is stored so that we can later build the clade summary.
+ */
+TraceTree::Fingerprint TraceTree::collectTreeSample(const TopologyNode& n, RbBitSet& intaxa, std::map<Fingerprint, Split>& splits)
 {
     double age = (clock ? n.getAge() : n.getBranchLength() );
 
-    std::vector<Split> child_splits;
+    std::vector<Fingerprint> child_splits;
+    std::vector<double> child_ages;
 
     RbBitSet taxa(intaxa.size());
     std::set<Taxon> mrca;
@@ -864,7 +837,8 @@ TraceTree::Split TraceTree::collectTreeSample(const TopologyNode& n, RbBitSet& i
         {
             const TopologyNode &child_node = n.getChild(i);
 
-            child_splits.push_back( collectTreeSample(child_node, taxa, newick, cladeCountMap) );
+            child_splits.push_back( collectTreeSample(child_node, taxa, splits) );
+            child_ages.push_back( clock ? child_node.getAge() : child_node.getBranchLength() );
 
             if ( rooted && child_node.isSampledAncestor() )
             {
@@ -876,27 +850,116 @@ TraceTree::Split TraceTree::collectTreeSample(const TopologyNode& n, RbBitSet& i
     intaxa |= taxa;
 
     Split parent_split(taxa, mrca, rooted);
+    Fingerprint parent_fingerprint = computeFingerprint( parent_split );
 
     if ( taxa.size() > 0 )
     {
         // store the age for this split
-        clade_ages[parent_split].push_back( age );
+        clade_ages[parent_fingerprint].addValue( age );
 
         // increment split count
-        cladeCountMap[parent_split]++;
+        if ( split_counts[parent_fingerprint]++ == 0 )
+        {
+            splits.insert( std::pair<Fingerprint, Split>(parent_fingerprint, parent_split) );
+        }
 
         // add conditional clade ages
-        for (std::vector<Split>::iterator child=child_splits.begin(); child !=child_splits.end(); ++child )
+        std::map<Fingerprint, QuantileSketch>& conditional_ages = conditional_clade_ages[parent_fingerprint];
+        for (size_t i = 0; i < child_splits.size(); ++i)
         {
             // inserts new entries if doesn't already exist
-            conditional_clade_ages[parent_split][*child].push_back( clade_ages[*child].back() );
+            conditional_ages[ child_splits[i] ].addValue( child_ages[i] );
         }
-
-        // store the age for this split, conditional on the tree topology
-        tree_clade_ages[newick][parent_split].push_back( age );
     }
     
-    return parent_split;
+    return parent_fingerprint;
+}
+
+
+/**
+ * Collect the fingerprints of all splits of this subtree together with their ages.
+ */
+TraceTree::Fingerprint TraceTree::collectTreeSplits(const TopologyNode& n, RbBitSet& intaxa, std::vector<std::pair<Fingerprint, double> >& splits) const
+{
+    RbBitSet taxa(intaxa.size());
+    std::set<Taxon> mrca;
+
+    if ( n.isTip() )
+    {
+        n.getTaxa(taxa);
+
+        if ( rooted && n.isSampledAncestor() )
+        {
+            mrca.insert( n.getTaxon() );
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < n.getNumberOfChildren(); i++)
+        {
+            const TopologyNode &child_node = n.getChild(i);
+
+            collectTreeSplits(child_node, taxa, splits);
+
+            if ( rooted && child_node.isSampledAncestor() )
+            {
+                mrca.insert(child_node.getTaxon());
+            }
+        }
+    }
+
+    intaxa |= taxa;
+
+    Fingerprint f = computeFingerprint( Split(taxa, mrca, rooted) );
+    splits.push_back( std::pair<Fingerprint, double>( f, clock ? n.getAge() : n.getBranchLength() ) );
+
+    return f;
+}
+
+
+/**
+ * Compute the fingerprint of a split from two independent hashes of its bits and the names of the sampled ancestors.
+ */
+TraceTree::Fingerprint TraceTree::computeFingerprint(const Split &s)
+{
+    Fingerprint f( s.first.getHash( 0x243F6A8885A308D3ULL ), s.first.getHash( 0x13198A2E03707344ULL ) );
+
+    for (std::set<Taxon>::const_iterator it = s.second.begin(); it != s.second.end(); ++it)
+    {
+        Fingerprint name = computeFingerprint( it->getName() );
+        f.high = (f.high ^ name.high) * 0xBF58476D1CE4E5B9ULL;
+        f.low  = (f.low  ^ name.low)  * 0x94D049BB133111EBULL;
+    }
+
+    return f;
+}
+
+
+/**
+ * Compute the fingerprint of a string (e.g., the newick string of a topology).
+ * We hash the string twice, 8 bytes at a time, starting from two different seeds.
+ */
+TraceTree::Fingerprint TraceTree::computeFingerprint(const std::string &newick)
+{
+    std::uint64_t h[2] = { 0xA4093822299F31D0ULL, 0x082EFA98EC4E6C89ULL };
+
+    for (size_t k = 0; k < 2; ++k)
+    {
+        h[k] ^= std::uint64_t(newick.size()) * 0x9E3779B97F4A7C15ULL;
+        for (size_t i = 0; i < newick.size(); i += 8)
+        {
+            std::uint64_t w = 0;
+            for (size_t j = i; j < newick.size() && j < i + 8; ++j)
+            {
+                w |= std::uint64_t( (unsigned char)newick[j] ) << (8*(j-i));
+            }
+            h[k] ^= w;
+            h[k] *= ( k == 0 ? 0xBF58476D1CE4E5B9ULL : 0x94D049BB133111EBULL );
+            h[k] ^= h[k] >> 31;
+        }
+    }
+
+    return Fingerprint( h[0], h[1] );
 }
 
 
@@ -1016,12 +1079,35 @@ void TraceTree::enforceNonnegativeBranchLengths(TopologyNode& node) const
 }
 
 
+Tree TraceTree::getSummaryTree(size_t i) const
+{
+    Tree tree = objectAt(i);
+    
+    // unrooted trees are rooted at the first taxon (in alphabetical order) so that equal topologies have equal newick strings
+    if ( rooted == false )
+    {
+        std::vector<std::string> tip_names = objectAt(0).getTipNames();
+        std::string outgroup = *std::min_element(tip_names.begin(), tip_names.end());
+        tree.reroot( outgroup, true );
+    }
+    
+    return tree;
+}
+
+
 long TraceTree::splitFrequency(const Split &n) const
 {
     
-    std::set<Sample<Split> >::const_iterator it = find_if (clade_samples.begin(), clade_samples.end(), n );
+    return splitFrequency( computeFingerprint( n ) );
+}
+
+
+long TraceTree::splitFrequency(const Fingerprint &f) const
+{
+    
+    std::map<Fingerprint, long>::const_iterator it = split_counts.find( f );
     
-    if ( it != clade_samples.end() )
+    if ( it != split_counts.end() )
     {
         return it->second;
     }
@@ -1336,17 +1422,26 @@ Tree* TraceTree::mccTree( AnnotationReport report, bool verbose )
     // find the clade credibility score for each tree
     for (std::set<Sample<std::string> >::reverse_iterator it = tree_samples.rbegin(); it != tree_samples.rend(); ++it)
     {
-        std::string newick = it->first;
+        const std::string &newick = it->first;
+        
+        // now we get the clades of the tree from its first sample
+        Tree sample_tree = getSummaryTree( topology_first_samples[ computeFingerprint(newick) ] );
+        std::vector<std::pair<Fingerprint, double> > sample_splits;
+        RbBitSet b( sample_tree.getNumberOfTips(), false );
+        collectTreeSplits( sample_tree.getRoot(), b, sample_splits );
         
-        // now we summarize the clades for the best tree
-        std::map<Split, std::vector<double> > cladeAges = tree_clade_ages[newick];
+        std::set<Fingerprint> clades;
+        for (size_t i = 0; i < sample_splits.size(); ++i)
+        {
+            clades.insert( sample_splits[i].first );
+        }
         
         double cc = 0;
         
         // find the product of the clade frequencies
-        for (std::map<Split, std::vector<double> >::iterator clade = cladeAges.begin(); clade != cladeAges.end(); clade++)
+        for (std::set<Fingerprint>::iterator clade = clades.begin(); clade != clades.end(); clade++)
         {
-            cc += log( splitFrequency(clade->first) );
+            cc += log( splitFrequency(*clade) );
         }
         
         if (cc > max_cc)
@@ -1689,10 +1784,6 @@ void TraceTree::summarize( bool verbose )
 {
     if ( isDirty() == false ) return;
     
-    std::vector<std::string> tip_names = objectAt(0).getTipNames();
-    std::sort(tip_names.begin(),tip_names.end());
-    std::string outgroup = tip_names[0];
-
     rooted = objectAt(0).isRooted();
     size_t num_taxa = objectAt(0).getNumberOfTips();
 
@@ -1701,12 +1792,14 @@ void TraceTree::summarize( bool verbose )
 
     sampled_ancestor_counts.clear();
 
+    split_counts.clear();
     clade_ages.clear();
     conditional_clade_ages.clear();
-    tree_clade_ages.clear();
+    sample_topologies.clear();
+    topology_first_samples.clear();
     
-    std::map<Split, long>       clade_counts;
-    std::map<std::string, long> tree_counts;
+    std::map<Fingerprint, Split>                clade_splits;
+    std::map<Fingerprint, Sample<std::string> > tree_counts;
 
     
     ProgressBar progress = ProgressBar(size(), burnin);
@@ -1723,37 +1816,43 @@ void TraceTree::summarize( bool verbose )
             progress.update(i);
         }
         
-        Tree tree = objectAt(i);
-        
-        if ( rooted == false )
-        {
-            tree.reroot( outgroup, true );
-        }
+        Tree tree = getSummaryTree(i);
         
         std::string newick = tree.getPlainNewickRepresentation();
+        Fingerprint topology = computeFingerprint( newick );
+        sample_topologies.push_back( topology );
 
-        tree_counts[newick]++;
+        std::map<Fingerprint, Sample<std::string> >::iterator it = tree_counts.find( topology );
+        if ( it == tree_counts.end() )
+        {
+            tree_counts.insert( std::pair<Fingerprint, Sample<std::string> >( topology, Sample<std::string>(newick, 1) ) );
+            topology_first_samples[topology] = i;
+        }
+        else
+        {
+            it->second.second++;
+        }
 
         // get the clades for this tree
         RbBitSet b( tree.getNumberOfTips(), false );
-        collectTreeSample(tree.getRoot(), b, newick, clade_counts);
+        collectTreeSample(tree.getRoot(), b, clade_splits);
     }
     
     // sort the clade samples in ascending frequency
-    for (std::map<Split, long>::iterator it = clade_counts.begin(); it != clade_counts.end(); ++it)
+    for (std::map<Fingerprint, long>::iterator it = split_counts.begin(); it != split_counts.end(); ++it)
     {
 //        if ( it->first.first.getNumberSetBits() > 0 )
 //        if ( it->first.first.getNumberSetBits() > 0 && it->first.first.getNumberSetBits() < (num_taxa-1) )
         {
-            clade_samples.insert( Sample<Split>(it->first, it->second) );
+            clade_samples.insert( Sample<Split>(clade_splits.find(it->first)->second, it->second) );
         }
         
     }
 
     // sort the tree samples in ascending frequency
-    for (std::map<std::string, long>::iterator it = tree_counts.begin(); it != tree_counts.end(); ++it)
+    for (std::map<Fingerprint, Sample<std::string> >::iterator it = tree_counts.begin(); it != tree_counts.end(); ++it)
     {
-        tree_samples.insert( Sample<std::string>(it->first, it->second) );
+        tree_samples.insert( it->second );
     }
 
     // finish progress bar
@@ -2,11 +2,24 @@
 #define TraceTree_H
 
 #include "Clade.h"
+#include "QuantileSketch.h"
 #include "Trace.h"
 #include "Tree.h"
 
+#include <cstdint>
+
 namespace RevBayesCore {
 
+    /**
+     * @brief A trace of trees and the summaries of its samples (clades, topologies, node ages).
+     *
+     * The summary keeps its per-split and per-topology data small: splits and topologies are keyed by fingerprints
+     * and the clade ages are stored in quantile sketches, so the summary itself does not grow with the number of samples per clade.
+     * However, the summary is not computed from a stream of trees. As every Trace, this trace keeps all of its samples in memory,
+     * and the summary passes (e.g. getSummaryTree, mapParameters or the conditional tree ages) read the samples again via objectAt(i).
+     * The memory needed for a tree trace therefore still grows linearly with the number of samples.
+     *
+     */
     class TraceTree : public Trace<Tree> {
 
         /*
@@ -39,6 +52,27 @@ namespace RevBayesCore {
             }
         };
 
+        /*
+         * This struct represents a 128-bit hash of a split or of a tree topology (its newick string)
+         */
+        struct Fingerprint
+        {
+            Fingerprint(std::uint64_t h = 0, std::uint64_t l = 0) : high(h), low(l) {}
+
+            inline bool operator<(const Fingerprint& rhs) const
+            {
+                return high < rhs.high || ( high == rhs.high && low < rhs.low );
+            }
+
+            inline bool operator==(const Fingerprint& rhs) const
+            {
+                return high == rhs.high && low == rhs.low;
+            }
+
+            std::uint64_t high;
+            std::uint64_t low;
+        };
+
     public:
         
         /*
@@ -88,9 +122,14 @@ namespace RevBayesCore {
 
     private:
 
-        Split                                      collectTreeSample(const TopologyNode&, RbBitSet&, std::string, std::map<Split, long>&);
+        Fingerprint                                collectTreeSample(const TopologyNode&, RbBitSet&, std::map<Fingerprint, Split>&);
+        Fingerprint                                collectTreeSplits(const TopologyNode&, RbBitSet&, std::vector<std::pair<Fingerprint, double> >&) const;
+        static Fingerprint                         computeFingerprint(const Split &s);
+        static Fingerprint                         computeFingerprint(const std::string &newick);
         void                                       enforceNonnegativeBranchLengths(TopologyNode& tree) const;
+        Tree                                       getSummaryTree(size_t i) const;
         long                                       splitFrequency(const Split &n) const;
+        long                                       splitFrequency(const Fingerprint &f) const;
         TopologyNode*                              findParentNode(TopologyNode&, const Split &, std::vector<TopologyNode*>&, RbBitSet& ) const;
         void                                       mapContinuous(Tree &inputTree, const std::string &n, size_t paramIndex, double hpd, bool np, bool verbose ) const;
         void                                       mapDiscrete(Tree &inputTree, const std::string &n, size_t paramIndex, size_t num, bool np, bool verbose ) const;
@@ -104,9 +143,11 @@ namespace RevBayesCore {
         std::map<Taxon, long >                     sampled_ancestor_counts;
         std::set<Sample<std::string> >             tree_samples;
 
-        std::map<Split, std::vector<double> >                           clade_ages;
-        std::map<Split, std::map<Split, std::vector<double> > >         conditional_clade_ages;
-        std::map<std::string, std::map<Split, std::vector<double> > >   tree_clade_ages;
+        std::map<Fingerprint, long>                                     split_counts;
+        std::map<Fingerprint, QuantileSketch>                           clade_ages;
+        std::map<Fingerprint, std::map<Fingerprint, QuantileSketch> >   conditional_clade_ages;
+        std::vector<Fingerprint>                                        sample_topologies;              //!< The topology of each sample after the burnin
+        std::map<Fingerprint, size_t>                                   topology_first_samples;         //!< The index of the first sample of each topology
     };
 
 }
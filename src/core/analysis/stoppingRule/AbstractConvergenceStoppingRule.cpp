@@ -1,8 +1,10 @@
 #include "EssTest.h"
 #include "AbstractConvergenceStoppingRule.h"
+#include "AsyncFileWriter.h"
+#include "RbConstants.h"
 #include "RbFileManager.h"
 #include "StringUtilities.h"
-#include "TraceContinuousReader.h"
+#include "TraceStatisticsCollector.h"
 
 
 using namespace RevBayesCore;
@@ -12,7 +14,9 @@ AbstractConvergenceStoppingRule::AbstractConvergenceStoppingRule(const std::stri
     burninEst( be ),
     checkFrequency( f ),
     filename( fn ),
-    numReplicates( 1 )
+    numReplicates( 1 ),
+    collectors(),
+    observers()
 {
     
 }
@@ -22,9 +26,11 @@ AbstractConvergenceStoppingRule::AbstractConvergenceStoppingRule(const AbstractC
     burninEst( sr.burninEst->clone() ),
     checkFrequency( sr.checkFrequency ),
     filename( sr.filename ),
-    numReplicates( sr.numReplicates )
+    numReplicates( sr.numReplicates ),
+    collectors(),
+    observers()
 {
-    
+    // a copy subscribes to the files itself once its run starts
 }
 
 
@@ -32,6 +38,8 @@ AbstractConvergenceStoppingRule::AbstractConvergenceStoppingRule(const AbstractC
 AbstractConvergenceStoppingRule::~AbstractConvergenceStoppingRule()
 {
     
+    unsubscribe();
+
     delete burninEst;
 }
 
@@ -45,6 +53,7 @@ AbstractConvergenceStoppingRule& AbstractConvergenceStoppingRule::operator=(cons
         StoppingRule::operator=( sr );
         
         delete burninEst;
+        unsubscribe();
         
         burninEst       = sr.burninEst->clone();
         checkFrequency  = sr.checkFrequency;
@@ -68,6 +77,65 @@ bool AbstractConvergenceStoppingRule::checkAtIteration(size_t g) const
 }
 
 
+/**
+ * Estimate the burnin for each parameter and take the largest one.
+ */
+size_t AbstractConvergenceStoppingRule::estimateBurnin(const std::vector<OnlineTraceStatistics> &traces) const
+{
+
+    size_t maxBurnin = 0;
+
+    for ( size_t j = 0; j < traces.size(); ++j)
+    {
+        size_t b = burninEst->estimateBurnin( traces[j] );
+
+        if ( maxBurnin < b )
+        {
+            maxBurnin = b;
+        }
+    }
+
+    return maxBurnin;
+}
+
+
+/**
+ * Get the name of the file of the i-th replicate.
+ * The monitors append "_run_i" to their file names if there is more than one replicate.
+ */
+std::string AbstractConvergenceStoppingRule::getReplicateFileName(size_t i) const
+{
+
+    std::string fn = filename;
+    if ( numReplicates > 1 )
+    {
+        RbFileManager fm = RbFileManager(filename);
+        fn = fm.getFilePath() + fm.getPathSeparator() + fm.getFileNameWithoutExtension() + "_run_" + StringUtilities::to_string(i) + "." + fm.getFileExtension();
+    }
+
+    return fn;
+}
+
+
+/**
+ * Get the statistics of all parameters of the i-th replicate.
+ * If we did not subscribe to the file, e.g., because another process writes it, then we read the file.
+ */
+std::vector<OnlineTraceStatistics> AbstractConvergenceStoppingRule::getReplicateStatistics(size_t i) const
+{
+
+    if ( i <= collectors.size() && collectors[i-1] != NULL )
+    {
+        return collectors[i-1]->getStatistics();
+    }
+
+    TraceStatisticsCollector reader;
+    reader.readFile( getReplicateFileName(i) );
+
+    return reader.getStatistics();
+}
+
+
 /**
  * Is this a stopping rule? Yes!
  */
@@ -78,11 +146,31 @@ bool AbstractConvergenceStoppingRule::isConvergenceRule( void ) const
 
 
 /**
- * The run just started. For this rule we do not need to do anything.
+ * The run just started. We subscribe to the trace file of each replicate that is written by this process.
+ * The monitors have already opened their files and written the headers at this point.
  */
 void AbstractConvergenceStoppingRule::runStarted( void )
 {
-    // nothing to do
+
+    unsubscribe();
+
+    for ( size_t i = 1; i <= numReplicates; ++i)
+    {
+        std::string fn = RbFileManager( getReplicateFileName(i) ).getFullFileName();
+
+        TraceStatisticsCollector* c = new TraceStatisticsCollector();
+        size_t id = AsyncFileWriter::globalInstance().addObserver( fn, [c](const std::string &data) { c->addData( data ); } );
+
+        if ( id == RbConstants::Size_t::max )
+        {
+            delete c;
+            c = NULL;
+        }
+
+        collectors.push_back( c );
+        observers.push_back( id );
+    }
+
 }
 
 
@@ -94,3 +182,21 @@ void AbstractConvergenceStoppingRule::setNumberOfRuns(size_t n)
 {
     numReplicates = n;
 }
+
+
+void AbstractConvergenceStoppingRule::unsubscribe( void )
+{
+
+    for ( size_t i = 0; i < observers.size(); ++i)
+    {
+        if ( observers[i] != RbConstants::Size_t::max )
+        {
+            AsyncFileWriter::globalInstance().removeObserver( observers[i] );
+        }
+        delete collectors[i];
+    }
+
+    collectors.clear();
+    observers.clear();
+
+}
@@ -2,18 +2,26 @@
 #define AbstractConvergenceStoppingRule_H
 
 #include "BurninEstimatorContinuous.h"
+#include "OnlineTraceStatistics.h"
 #include "StoppingRule.h"
 
+#include <string>
 #include <vector>
 
 namespace RevBayesCore {
     
+    class TraceStatisticsCollector;
+    
     /**
      * @brief Abstract base class for convergence stopping rules.
      *
      * This class provides the abstract base class for (all) convergence stopping rules.
      * This is, we provide some common member variables and some common virtual function.
      *
+     * When the run starts, the rule subscribes to the trace file of each replicate at the AsyncFileWriter
+     * and keeps running statistics of all parameters (see TraceStatisticsCollector), so that a check does not need to
+     * read the files again. Replicates that write their file in another process are read from disk at every check.
+     *
      *
      * @copyright Copyright 2009-
      * @author The RevBayes Development Core Team (Sebastian Hoehna)
@@ -32,7 +40,7 @@ namespace RevBayesCore {
         // public methods
         virtual bool                                        checkAtIteration(size_t g) const;                           //!< Should we check for convergence at the given iteration?
         virtual bool                                        isConvergenceRule(void) const;                              //!< No, this is a threshold rule.
-        virtual void                                        runStarted(void);                                           //!< The run just started. Here we do not need to do anything.
+        virtual void                                        runStarted(void);                                           //!< The run just started. Here we subscribe to the trace files.
         virtual void                                        setNumberOfRuns(size_t n);                                  //!< Set how many runs/replicates there are.
 
         virtual AbstractConvergenceStoppingRule*            clone(void) const = 0;                                          //!< Clone function. This is similar to the copy constructor but useful in inheritance.
@@ -40,11 +48,22 @@ namespace RevBayesCore {
         
     protected:
         
+        size_t                                              estimateBurnin(const std::vector<OnlineTraceStatistics> &traces) const;    //!< The maximum burnin over all parameters
+        std::string                                         getReplicateFileName(size_t i) const;                       //!< The name of the trace file of the i-th replicate (starting at 1)
+        std::vector<OnlineTraceStatistics>                  getReplicateStatistics(size_t i) const;                     //!< The statistics of all parameters of the i-th replicate (starting at 1)
+
         BurninEstimatorContinuous*                          burninEst;                                                  //!< The method for estimating the burnin
         size_t                                              checkFrequency;                                             //!< The frequency for checking for convergence
         std::string                                         filename;                                                   //!< The filename from which to read in the data
         size_t                                              numReplicates;
         
+    private:
+
+        void                                                unsubscribe(void);                                          //!< Stop observing the trace files
+
+        std::vector<TraceStatisticsCollector*>              collectors;                                                 //!< The running statistics of each replicate (NULL if read from disk)
+        std::vector<size_t>                                 observers;                                                  //!< The ids of our observers at the file writer
+
     };
     
     // Global functions using the class
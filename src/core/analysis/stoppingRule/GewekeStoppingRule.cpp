@@ -1,8 +1,5 @@
 #include "GewekeTest.h"
 #include "GewekeStoppingRule.h"
-#include "RbFileManager.h"
-#include "StringUtilities.h"
-#include "TraceContinuousReader.h"
 
 
 using namespace RevBayesCore;
@@ -48,38 +45,18 @@ bool GewekeStoppingRule::stop( size_t g )
     
     for ( size_t i = 1; i <= numReplicates; ++i)
     {
-        std::string fn = filename;
-        if ( numReplicates > 1 )
-        {
-            RbFileManager fm = RbFileManager(filename);
-            fn = fm.getFilePath() + fm.getPathSeparator() + fm.getFileNameWithoutExtension() + "_run_" + StringUtilities::to_string(i) + "." + fm.getFileExtension();
-        }
-        
-        TraceContinuousReader reader = TraceContinuousReader( fn );
-        
-        // get the vector of traces from the reader
-        std::vector<TraceNumeric> &data = reader.getTraces();
-        
-        size_t maxBurnin = 0;
+        // get the running statistics of all parameters
+        std::vector<OnlineTraceStatistics> data = getReplicateStatistics( i );
         
         // find the max burnin
-        for ( size_t j = 0; j < data.size(); ++j)
-        {
-            size_t b = burninEst->estimateBurnin( data[j] );
-
-            if ( maxBurnin < b )
-            {
-                maxBurnin = b;
-            }
-        }
+        size_t maxBurnin = estimateBurnin( data );
         
         GewekeTest gTest = GewekeTest( alpha, frac1, frac2 );
         
-        // set the burnins and conduct the tests
+        // conduct the tests
         for ( size_t j = 0; j < data.size(); ++j)
         {
-            data[j].setBurnin( maxBurnin );
-            passed &= gTest.assessConvergence( data[j] );
+            passed &= gTest.assessConvergence( data[j], maxBurnin );
         }
         
     }
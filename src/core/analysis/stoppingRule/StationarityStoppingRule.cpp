@@ -1,9 +1,6 @@
 #include "StationarityTest.h"
 #include "StationarityStoppingRule.h"
 #include "RbException.h"
-#include "RbFileManager.h"
-#include "StringUtilities.h"
-#include "TraceContinuousReader.h"
 
 
 using namespace RevBayesCore;
@@ -63,43 +60,16 @@ bool StationarityStoppingRule::stop( size_t g )
 
     bool passed = true;
     
-    std::vector<std::vector<std::vector<double> > > values;
-    std::vector<std::vector<size_t> > burnins;
     for ( size_t i = 1; i <= numReplicates; ++i)
     {
-        std::string fn = filename;
-        if ( numReplicates > 1 )
-        {
-            RbFileManager fm = RbFileManager(filename);
-            fn = fm.getFilePath() + fm.getPathSeparator() + fm.getFileNameWithoutExtension() + "_run_" + StringUtilities::to_string(i) + "." + fm.getFileExtension();
-        }
-        
-        TraceContinuousReader reader = TraceContinuousReader( fn );
-        
-        // get the vector of traces from the reader
-        std::vector<TraceNumeric> &data = reader.getTraces();
-        
-        size_t maxBurnin = 0;
+        // get the running statistics of all parameters
+        std::vector<OnlineTraceStatistics> data = getReplicateStatistics( i );
         
         // find the max burnin
-        for ( size_t j = 0; j < data.size(); ++j)
-        {
-            size_t b = burninEst->estimateBurnin( data[j] );
-
-            if ( maxBurnin < b )
-            {
-                maxBurnin = b;
-            }
-        }
+        size_t maxBurnin = estimateBurnin( data );
         
-        // set the burnins
-        for ( size_t j = 0; j < data.size(); ++j)
-        {
-            data[j].setBurnin( maxBurnin );
-        }
-
         // conduct the test
-        passed &= sTest.assessConvergence(data);
+        passed &= sTest.assessConvergence(data, maxBurnin);
     }
     
     return passed;
@@ -71,11 +71,14 @@ namespace RevBayesCore {
 }
 
 
+#include "Profiler.h"
 #include "RbConstants.h"
 #include "RbOptions.h"
 #include "RbMathLogic.h"
 #include "TypedDistribution.h"
 
+#include <typeinfo>
+
 
 template<class valueType>
 RevBayesCore::StochasticNode<valueType>::StochasticNode( const std::string &n, TypedDistribution<valueType> *d ) : DynamicNode<valueType>( n ),
@@ -287,6 +290,7 @@ double RevBayesCore::StochasticNode<valueType>::getLnProbability( void )
         // compute and store log-probability
         if ( this->prior_only == false || this->clamped == false )
         {
+            Profiler::ComputationTimer timer( typeid( *distribution ) );
             lnProb = distribution->computeLnProbability();
         }
         else
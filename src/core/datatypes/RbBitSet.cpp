@@ -1,29 +1,81 @@
 #include "RbBitSet.h"
 #include "RbException.h"
 
+#include <algorithm>
+#include <sstream>
+
 using namespace RevBayesCore;
 
 
+namespace {
+
+    inline size_t countBits(std::uint64_t w)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return size_t( __builtin_popcountll( w ) );
+#else
+        size_t n = 0;
+        while ( w != 0 )
+        {
+            w &= w - 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    inline size_t indexOfLowestBit(std::uint64_t w)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return size_t( __builtin_ctzll( w ) );
+#else
+        size_t i = 0;
+        while ( (w & 1) == 0 )
+        {
+            w >>= 1;
+            ++i;
+        }
+        return i;
+#endif
+    }
+
+}
+
 
 RbBitSet::RbBitSet(void) :
-    num_set_bits( 0 )
+    num_bits( 0 ),
+    num_words( 0 )
 {
 
+    local_words[0] = 0;
+    local_words[1] = 0;
+
 }
 
 
 RbBitSet::RbBitSet(size_t n, bool def) :
-    value(n, def),
-    num_set_bits( 0 )
+    num_bits( 0 ),
+    num_words( 0 )
 {
 
+    local_words[0] = 0;
+    local_words[1] = 0;
+
+    setSize( n );
+    if ( def == true )
+    {
+        std::uint64_t *w = getWords();
+        std::fill( w, w + num_words, ~std::uint64_t(0) );
+        clearUnusedBits();
+    }
+
 }
 
 
 bool RbBitSet::operator[](size_t i) const
 {
     // get the internal value
-    return value[i];
+    return ( (getWords()[i >> 6] >> (i & 63)) & 1 ) != 0;
 }
 
 
@@ -31,7 +83,7 @@ bool RbBitSet::operator[](size_t i) const
 bool RbBitSet::operator==(const RbBitSet& x) const
 {
 
-    return x.value == value;
+    return num_bits == x.num_bits && std::equal( getWords(), getWords() + num_words, x.getWords() );
 }
 
 /** Not-Equals comparison */
@@ -42,76 +94,73 @@ bool RbBitSet::operator!=(const RbBitSet& x) const
 }
 
 
-/** Smaller than comparison */
+/**
+ * Smaller than comparison.
+ * Note that this order is the reverse lexicographical order of the bits (starting with bit 0),
+ * i.e., at the first bit where the two sets differ, the set with this bit set is the smaller one.
+ * If one set is the beginning of the other, then the longer set is the smaller one.
+ */
 bool RbBitSet::operator<(const RbBitSet& x) const
 {
 
-    return x.value < value;
-}
+    size_t common_bits = std::min( num_bits, x.num_bits );
+    size_t common_words = (common_bits + 63) / 64;
 
-/** Bitwise and */
-RbBitSet RbBitSet::operator&(const RbBitSet& x) const
-{
-    if (x.value.size() != value.size())
+    const std::uint64_t *a = getWords();
+    const std::uint64_t *b = x.getWords();
+    for (size_t i = 0; i < common_words; ++i)
     {
-        throw(RbException("Cannot and RbBitSets of unequal size"));
-    }
-    RbBitSet r(value.size());
-    for (size_t i = 0; i < value.size(); i++)
-    {
-        if ( value[i] && x.value[i] )
+        std::uint64_t diff = a[i] ^ b[i];
+        if ( i == common_words-1 && (common_bits & 63) != 0 )
         {
-            r.set(i);
+            diff &= ( std::uint64_t(1) << (common_bits & 63) ) - 1;
+        }
+
+        if ( diff != 0 )
+        {
+            size_t bit = indexOfLowestBit( diff );
+            return ( (a[i] >> bit) & 1 ) != 0;
         }
     }
+
+    return x.num_bits < num_bits;
+}
+
+/** Bitwise and */
+RbBitSet RbBitSet::operator&(const RbBitSet& x) const
+{
+
+    RbBitSet r = *this;
+    r &= x;
+
     return r;
 }
 
 /** Bitwise or */
 RbBitSet RbBitSet::operator|(const RbBitSet& x) const
 {
-    if (x.value.size() != value.size())
-    {
-        throw(RbException("Cannot or RbBitSets of unequal sizes"));
-    }
-    RbBitSet r(value.size());
-    for (size_t i = 0; i < value.size(); i++)
-    {
-        if ( value[i] || x.value[i] )
-        {
-            r.set(i);
-        }
-    }
+
+    RbBitSet r = *this;
+    r |= x;
+
     return r;
 }
 
 /** Bitwise xor */
 RbBitSet RbBitSet::operator^(const RbBitSet& x) const
 {
-    if (x.value.size() != value.size())
-    {
-        throw(RbException("Cannot xor RbBitSets of unequal size"));
-    }
-    RbBitSet r(value.size());
-    for (size_t i = 0; i < value.size(); i++)
-    {
-        if ( value[i] != x.value[i] )
-        {
-            r.set(i);
-        }
-    }
+
+    RbBitSet r = *this;
+    r ^= x;
+
     return r;
 }
 
 /** Unary not */
 RbBitSet& RbBitSet::operator~()
 {
-    for (size_t i = 0; i < value.size(); i++)
-    {
-        value[i] = !value[i];
-    }
 
-    num_set_bits = value.size() - num_set_bits;
+    flip();
 
     return *this;
 }
@@ -119,12 +168,17 @@ RbBitSet& RbBitSet::operator~()
 /** Bitwise and assignment */
 RbBitSet& RbBitSet::operator&=(const RbBitSet& x)
 {
-    if (x.value.size() != value.size())
+    if (x.num_bits != num_bits)
     {
         throw(RbException("Cannot and RbBitSets of unequal size"));
     }
 
-    *this = *this & x;
+    std::uint64_t *a = getWords();
+    const std::uint64_t *b = x.getWords();
+    for (size_t i = 0; i < num_words; ++i)
+    {
+        a[i] &= b[i];
+    }
 
     return *this;
 }
@@ -132,12 +186,35 @@ RbBitSet& RbBitSet::operator&=(const RbBitSet& x)
 /** Bitwise or assignment */
 RbBitSet& RbBitSet::operator|=(const RbBitSet& x)
 {
-    if (x.value.size() != value.size())
+    if (x.num_bits != num_bits)
     {
         throw(RbException("Cannot or RbBitSets of unequal size"));
     }
 
-    *this = *this | x;
+    std::uint64_t *a = getWords();
+    const std::uint64_t *b = x.getWords();
+    for (size_t i = 0; i < num_words; ++i)
+    {
+        a[i] |= b[i];
+    }
+
+    return *this;
+}
+
+/** Bitwise xor assignment */
+RbBitSet& RbBitSet::operator^=(const RbBitSet& x)
+{
+    if (x.num_bits != num_bits)
+    {
+        throw(RbException("Cannot xor RbBitSets of unequal size"));
+    }
+
+    std::uint64_t *a = getWords();
+    const std::uint64_t *b = x.getWords();
+    for (size_t i = 0; i < num_words; ++i)
+    {
+        a[i] ^= b[i];
+    }
 
     return *this;
 }
@@ -146,95 +223,161 @@ RbBitSet& RbBitSet::operator|=(const RbBitSet& x)
 void RbBitSet::clear(void)
 {
     // reset the bitset
-    value = std::vector<bool>(value.size(),false);
-    num_set_bits = 0;
+    std::uint64_t *w = getWords();
+    std::fill( w, w + num_words, std::uint64_t(0) );
+}
+
+void RbBitSet::clearUnusedBits(void)
+{
+
+    if ( (num_bits & 63) != 0 )
+    {
+        getWords()[num_words-1] &= ( std::uint64_t(1) << (num_bits & 63) ) - 1;
+    }
+
 }
 
 bool RbBitSet::empty(void) const
 {
-    return value.empty();
+    return num_bits == 0;
 }
 
 void RbBitSet::flip(size_t i)
 {
-    value[i] = ( value[i] == false );
-    num_set_bits += ( value[i] ? 1 : -1 );
+    getWords()[i >> 6] ^= std::uint64_t(1) << (i & 63);
 }
 
 void RbBitSet::flip()
 {
-    for (size_t i = 0; i < value.size(); i++)
+    std::uint64_t *w = getWords();
+    for (size_t i = 0; i < num_words; ++i)
     {
-        value[i] = ( value[i] == false );
-        num_set_bits += ( value[i] ? 1 : -1 );
+        w[i] = ~w[i];
     }
+    clearUnusedBits();
 }
 
 size_t RbBitSet::getFirstSetBit( void ) const
 {
-    size_t index = 0;
-    while ( index < value.size() && value[index] == false )
+    const std::uint64_t *w = getWords();
+    for (size_t i = 0; i < num_words; ++i)
     {
-        ++index;
+        if ( w[i] != 0 )
+        {
+            return i * 64 + indexOfLowestBit( w[i] );
+        }
     }
 
-    return index;
+    return num_bits;
+}
+
+/**
+ * Get a hash value of the bits and the size (64-bit multiply-xorshift mixing of the words).
+ */
+size_t RbBitSet::getHash( void ) const
+{
+    return size_t( getHash( 0 ) );
+}
+
+
+/**
+ * Different seeds give (practically) independent hash values,
+ * which can be combined into longer fingerprints.
+ */
+std::uint64_t RbBitSet::getHash( std::uint64_t seed ) const
+{
+
+    std::uint64_t h = (std::uint64_t(num_bits) * 0x9E3779B97F4A7C15ULL) ^ seed;
+    const std::uint64_t *w = getWords();
+    for (size_t i = 0; i < num_words; ++i)
+    {
+        h ^= w[i];
+        h *= 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 31;
+    }
+
+    return h;
 }
 
 size_t RbBitSet::getNumberSetBits( void ) const
 {
-    // get the internal value
-    return num_set_bits;
+    size_t n = 0;
+    const std::uint64_t *w = getWords();
+    for (size_t i = 0; i < num_words; ++i)
+    {
+        n += countBits( w[i] );
+    }
+
+    return n;
 }
 
 
 bool RbBitSet::isSet(size_t i) const
 {
     // get the internal value
-    return value[i];
+    return ( (getWords()[i >> 6] >> (i & 63)) & 1 ) != 0;
 }
 
 void RbBitSet::resize(size_t size)
 {
-    value.resize(size);
+    setSize( size );
 }
 
 void RbBitSet::set(size_t i)
 {
 
-    if ( i >= value.size() )
+    if ( i >= num_bits )
     {
         std::ostringstream ss;
         ss << i;
         throw RbException("Index " + ss.str() +" out of bounds in bitset. This will likely cause unexpected behavior.");
     }
 
-    if (value[i] == false)
+    // set the internal value
+    getWords()[i >> 6] |= std::uint64_t(1) << (i & 63);
+}
+
+
+void RbBitSet::setSize(size_t n)
+{
+
+    size_t new_num_words = (n + 63) / 64;
+    if ( new_num_words != num_words )
     {
-        ++num_set_bits;
+        size_t num_copy = std::min( num_words, new_num_words );
+        if ( new_num_words > NUM_LOCAL_WORDS )
+        {
+            std::vector<std::uint64_t> w( new_num_words, 0 );
+            std::copy( getWords(), getWords() + num_copy, w.begin() );
+            heap_words.swap( w );
+        }
+        else
+        {
+            std::uint64_t w[NUM_LOCAL_WORDS] = { 0, 0 };
+            std::copy( getWords(), getWords() + num_copy, w );
+            std::copy( w, w + NUM_LOCAL_WORDS, local_words );
+            std::vector<std::uint64_t>().swap( heap_words );
+        }
+        num_words = new_num_words;
     }
 
-    // set the internal value
-    value[i] = true;
+    num_bits = n;
+    clearUnusedBits();
+
 }
 
 
 size_t RbBitSet::size(void) const
 {
     // get the size from the actual bitset
-    return value.size();
+    return num_bits;
 }
 
 
 void RbBitSet::unset(size_t i)
 {
-    if (value[i] == true)
-    {
-        --num_set_bits;
-    }
-
     // set the internal value
-    value[i] = false;
+    getWords()[i >> 6] &= ~( std::uint64_t(1) << (i & 63) );
 }
 
 
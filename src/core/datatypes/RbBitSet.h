@@ -1,6 +1,9 @@
 #ifndef RbRbBitSet_H
 #define RbRbBitSet_H
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <ostream>
 #include <vector>
 
@@ -9,7 +12,11 @@ namespace RevBayesCore {
     /**
      * RevBayes class for bit sets.
      *
-     * This class is essentially a wrapper of a std::vector<bool> with some additional functional.
+     * The bits are packed into 64-bit words. Bit sets with up to 128 bits (e.g., the states of a character
+     * or the ranges of a biogeographic model) store their words inside the object and thus never allocate memory;
+     * larger bit sets (e.g., clades of large trees) store them in a vector.
+     * The bits beyond the size of the bit set are always zero, so that comparisons, hashing and counting work on whole words.
+     * The number of set bits is computed with the hardware popcount instruction (if available).
      *
      * @copyright Copyright 2009-
      * @author The RevBayes Development Core Team (Sebastian Hoehna)
@@ -20,7 +27,6 @@ namespace RevBayesCore {
     public:
         RbBitSet(void);                                                                                         //!< Constructor requires character type
         RbBitSet(size_t n, bool def = false);                                                                   //!< Constructor requires character type
-        virtual                        ~RbBitSet(void) {}
         
         bool                            operator[](size_t i) const;
 
@@ -34,12 +40,15 @@ namespace RevBayesCore {
         RbBitSet&                       operator~();
         RbBitSet&                       operator&=(const RbBitSet &bs);
         RbBitSet&                       operator|=(const RbBitSet &bs);
+        RbBitSet&                       operator^=(const RbBitSet &bs);
 
 
         void                            clear(void);
         bool                            empty(void) const;
         void                            flip();
         void                            flip(size_t i);
+        size_t                          getHash(void) const;                                                    //!< Get a hash value of the bits (used by std::hash)
+        std::uint64_t                   getHash(std::uint64_t seed) const;                                      //!< Get a 64-bit hash value of the bits, starting from this seed
         size_t                          getNumberSetBits(void) const;                                           //!< Get the number of bits set.
         size_t                          getFirstSetBit(void) const;                                             //!< Get the number of bits set.
         bool                            isSet(size_t i) const;
@@ -51,8 +60,17 @@ namespace RevBayesCore {
         
     private:
 
-        std::vector<bool>               value;
-        size_t                          num_set_bits;
+        static const size_t             NUM_LOCAL_WORDS = 2;                                                    //!< The number of words stored in the object itself (128 bits)
+
+        void                            clearUnusedBits(void);                                                  //!< Set the bits in the last word beyond the size to zero
+        std::uint64_t*                  getWords(void)              { return ( num_words > NUM_LOCAL_WORDS ? &heap_words[0] : local_words ); }
+        const std::uint64_t*            getWords(void) const        { return ( num_words > NUM_LOCAL_WORDS ? &heap_words[0] : local_words ); }
+        void                            setSize(size_t n);                                                      //!< Change the size; new bits are zero
+
+        size_t                          num_bits;
+        size_t                          num_words;
+        std::uint64_t                   local_words[NUM_LOCAL_WORDS];
+        std::vector<std::uint64_t>      heap_words;
 
         
     };
@@ -62,4 +80,14 @@ namespace RevBayesCore {
     
 }
 
+
+namespace std {
+    
+    template<>
+    struct hash<RevBayesCore::RbBitSet> {
+        size_t                                  operator()(const RevBayesCore::RbBitSet &bs) const { return bs.getHash(); }
+    };
+    
+}
+
 #endif
@@ -6,13 +6,14 @@
 #include "RbConstants.h"
 #include "TypedDagNode.h"
 
+#include <algorithm>
 #include <cstring>
 #include <iomanip>
 
 using namespace RevBayesCore;
 
 
-MatrixReal::MatrixReal( void ) : elements( RbVector<RbVector<double> >() ),
+MatrixReal::MatrixReal( void ) : elements(),
     n_rows( 0 ),
     n_cols( 0 ),
     eigensystem( NULL ),
@@ -25,7 +26,7 @@ MatrixReal::MatrixReal( void ) : elements( RbVector<RbVector<double> >() ),
 }
 
 
-MatrixReal::MatrixReal( size_t n ) : elements( RbVector<RbVector<double> >(n, RbVector<double>(n,0.0) ) ),
+MatrixReal::MatrixReal( size_t n ) : elements( n*n, 0.0 ),
     n_rows( n ),
     n_cols( n ),
     eigensystem( NULL ),
@@ -38,7 +39,7 @@ MatrixReal::MatrixReal( size_t n ) : elements( RbVector<RbVector<double> >(n, Rb
 }
 
 
-MatrixReal::MatrixReal( size_t n, size_t k) : elements( RbVector<RbVector<double> >(n, RbVector<double>(k,0.0) ) ),
+MatrixReal::MatrixReal( size_t n, size_t k) : elements( n*k, 0.0 ),
     n_rows( n ),
     n_cols( k ),
     eigensystem( NULL ),
@@ -52,7 +53,7 @@ MatrixReal::MatrixReal( size_t n, size_t k) : elements( RbVector<RbVector<double
 
 
 MatrixReal::MatrixReal( size_t n, size_t k, double v) :
-    elements( RbVector<RbVector<double> >(n, RbVector<double>(k,v) ) ),
+    elements( n*k, v ),
     n_rows( n ),
     n_cols( k ),
     eigensystem( NULL ),
@@ -102,20 +103,20 @@ MatrixReal& MatrixReal::operator=(const MatrixReal &m)
 }
 
 
-RbVector<double>& MatrixReal::operator[]( size_t index )
+MatrixReal::Row MatrixReal::operator[]( size_t index )
 {
     // to be safe
     eigen_needs_update = true;
     cholesky_needs_update = true;
     
-    return elements[index];
+    return Row( elements.data() + index * n_cols, n_cols );
 }
 
 
 
-const RbVector<double>& MatrixReal::operator[]( size_t index ) const
+MatrixReal::ConstRow MatrixReal::operator[]( size_t index ) const
 {
-    return elements[index];
+    return ConstRow( elements.data() + index * n_cols, n_cols );
 }
 
 
@@ -126,6 +127,8 @@ void MatrixReal::clear( void )
     cholesky_needs_update = true;
     
     elements.clear();
+    n_rows = 0;
+    n_cols = 0;
 }
 
 
@@ -171,7 +174,7 @@ void MatrixReal::executeMethod(const std::string &n, const std::vector<const Dag
     if ( n == "[]" )
     {
         int index = (int)static_cast<const TypedDagNode<long> *>( args[0] )->getValue()-1;
-        rv = elements[index];
+        rv = (*this)[index];
     }
     else if ( n == "upperTriangle" )
     {
@@ -218,7 +221,7 @@ RbVector<double> MatrixReal::getColumn( size_t columnIndex ) const
 
     for (size_t i = 0; i < n_rows; ++i)
     {
-        col[i] = elements[i][columnIndex];
+        col[i] = elements[i * n_cols + columnIndex];
     }
     
     return col;
@@ -235,7 +238,7 @@ RbVector<double> MatrixReal::getDiagonal( void ) const
     
     for (size_t i = 0; i < n_rows; ++i)
     {
-        diagonal_elements[i] = elements[i][i];
+        diagonal_elements[i] = elements[i * n_cols + i];
     }
     
     return diagonal_elements;
@@ -292,7 +295,7 @@ double MatrixReal::getDet() const
     {
         for (int i=0; i<n_rows; ++i)
         {
-            logDet += log(elements[i][i]);
+            logDet += log(elements[i * n_cols + i]);
         }
     }
     else
@@ -332,7 +335,7 @@ double MatrixReal::getLogDet() const
         double logDet = 0;
         for (int i = 0; i < n_rows; ++i)
         {
-            logDet += log(elements[i][i]);
+            logDet += log(elements[i * n_cols + i]);
         }
         return logDet;
     }
@@ -378,14 +381,11 @@ double MatrixReal::getMax( void ) const
 {
     
     double max = RbConstants::Double::neginf;
-    for (size_t i = 0; i < n_rows; ++i)
+    for (size_t i = 0; i < elements.size(); ++i)
     {
-        for (size_t j = 0; j < n_cols; ++j)
+        if ( max < elements[i] )
         {
-            if ( max < elements[i][j] )
-            {
-                max = elements[i][j];
-            }
+            max = elements[i];
         }
     }
     
@@ -399,14 +399,11 @@ double MatrixReal::getMin( void ) const
 {
     
     double min = RbConstants::Double::inf;
-    for (size_t i = 0; i < n_rows; ++i)
+    for (size_t i = 0; i < elements.size(); ++i)
     {
-        for (size_t j = 0; j < n_cols; ++j)
+        if ( min > elements[i] )
         {
-            if ( min > elements[i][j] )
-            {
-                min = elements[i][j];
-            }
+            min = elements[i];
         }
     }
     
@@ -435,7 +432,7 @@ MatrixReal MatrixReal::getTranspose( void )
     {
         for (size_t j = 0; j < n_cols; ++j)
         {
-            T[j][i] = elements[i][j];
+            T.elements[j * n_rows + i] = elements[i * n_cols + j];
         }
     }
     
@@ -457,7 +454,7 @@ RbVector<double> MatrixReal::getUpperTriangle( void ) const
     {
         for (size_t j = i + 1; j < n_cols; ++j)
         {
-            upper_triangle_elements[k++] = elements[i][j];
+            upper_triangle_elements[k++] = elements[i * n_cols + j];
         }
     }
     
@@ -478,7 +475,7 @@ bool MatrixReal::isDiagonal(void) const
     {
         for (int j = i + 1; j < n_cols; ++j)
         {
-            if (elements[i][j] != 0.0 || elements[j][i] != 0.0)
+            if (elements[i * n_cols + j] != 0.0 || elements[j * n_cols + i] != 0.0)
             {
                 return false;
             }
@@ -523,7 +520,7 @@ bool MatrixReal::isSymmetric( void ) const
     {
         for (int j = i + 1; j < n_cols; ++j)
         {
-            if (elements[i][j] != elements[j][i])
+            if (elements[i * n_cols + j] != elements[j * n_cols + i])
             {
                 return false;
             }
@@ -536,10 +533,10 @@ bool MatrixReal::isSymmetric( void ) const
 void MatrixReal::resize(size_t r, size_t c)
 {
     
-    elements = RbVector<RbVector<double> >(r, RbVector<double>(c,0.0) );
+    elements.assign( r * c, 0.0 );
     
     n_rows = r;
-    n_rows = c;
+    n_cols = c;
     
     eigen_needs_update = true;
     cholesky_needs_update = true;
@@ -944,12 +941,9 @@ MatrixReal operator/(const MatrixReal& A, const MatrixReal& B)
 MatrixReal& MatrixReal::operator+=(double b)
 {
     
-	for (size_t i=0; i<n_rows; i++)
+	for (size_t i=0; i<elements.size(); i++)
     {
-		for (size_t j=0; j<n_cols; j++)
-        {
-			elements[i][j] += b;
-        }
+		elements[i] += b;
     }
     
 	return *this;
@@ -968,12 +962,9 @@ MatrixReal& MatrixReal::operator+=(double b)
 MatrixReal& MatrixReal::operator-=(double b)
 {
     
-	for (size_t i=0; i<n_rows; i++)
+	for (size_t i=0; i<elements.size(); i++)
     {
-		for (size_t j=0; j<n_cols; j++)
-        {
-			elements[i][j] -= b;
-        }
+		elements[i] -= b;
     }
     
 	return *this;
@@ -992,12 +983,9 @@ MatrixReal& MatrixReal::operator-=(double b)
 MatrixReal& MatrixReal::operator*=(double b)
 {
     
-	for (size_t i=0; i<n_rows; i++)
+	for (size_t i=0; i<elements.size(); i++)
     {
-		for (size_t j=0; j<n_cols; j++)
-        {
-			elements[i][j] *= b;
-        }
+		elements[i] *= b;
     }
     
 	return *this;
@@ -1104,12 +1092,9 @@ MatrixReal&  MatrixReal::operator+=(const MatrixReal& B)
     
 	if (B.getNumberOfRows() == n_rows && B.getNumberOfColumns() == n_cols)
     {
-		for (size_t i=0; i<n_rows; i++)
+		for (size_t i=0; i<elements.size(); i++)
         {
-			for (size_t j=0; j<n_cols; j++)
-            {
-				elements[i][j] += B[i][j];
-            }
+			elements[i] += B.elements[i];
         }
     }
     else
@@ -1136,12 +1121,9 @@ MatrixReal& MatrixReal::operator-=(const MatrixReal& B)
     
 	if (B.getNumberOfRows() == n_rows && B.getNumberOfColumns() == n_cols)
     {
-		for (size_t i=0; i<n_rows; i++)
+		for (size_t i=0; i<elements.size(); i++)
         {
-			for (size_t j=0; j<n_cols; j++)
-            {
-				elements[i][j] -= B[i][j];
-            }
+			elements[i] -= B.elements[i];
         }
     }
     else
@@ -1171,20 +1153,42 @@ MatrixReal& MatrixReal::operator*=(const MatrixReal& B)
 	if ( n_cols == b_rows )
     {
 		MatrixReal C(n_rows, b_cols, 0.0 );
-		for (size_t i=0; i<n_rows; i++)
+        
+        // We multiply block by block so that the rows of B that we need stay in the cache,
+        // and the innermost loop runs over contiguous rows of B and C so that it can be vectorized.
+        // Every element still sums its products in the order k=0,...,n-1.
+        const size_t block_size = 64;
+        const double* a = elements.data();
+        const double* b = B.elements.data();
+        double*       c = C.elements.data();
+        for (size_t kk=0; kk<n_cols; kk+=block_size)
         {
-			for (size_t j=0; j<b_cols; j++)
+            size_t k_end = std::min( kk + block_size, n_cols );
+            for (size_t jj=0; jj<b_cols; jj+=block_size)
             {
-				double sum = 0.0;
-				for (size_t k=0; k<n_cols; k++)
-					sum += elements[i][k] * B[k][j];
-				C[i][j] = sum;
+                size_t j_end = std::min( jj + block_size, b_cols );
+                for (size_t i=0; i<n_rows; i++)
+                {
+                    double* c_row = c + i * b_cols;
+                    for (size_t k=kk; k<k_end; k++)
+                    {
+                        const double  a_ik  = a[i * n_cols + k];
+                        const double* b_row = b + k * b_cols;
+                        for (size_t j=jj; j<j_end; j++)
+                        {
+                            c_row[j] += a_ik * b_row[j];
+                        }
+                    }
+                }
             }
         }
         
         n_cols = C.n_cols;
         n_rows = C.n_rows;
-        elements = C.elements;
+        elements.swap( C.elements );
+        
+        eigen_needs_update = true;
+        cholesky_needs_update = true;
     }
     else
     {
@@ -1203,7 +1207,7 @@ std::vector<double> MatrixReal::operator*(const std::vector<double> &V) const
     {
         for (unsigned int j = 0; j < V.size(); j++)
         {
-            E[i] = E[i] + elements[j][i] * V[j];
+            E[i] = E[i] + elements[j * n_cols + i] * V[j];
         }
     }
     
@@ -20,8 +20,10 @@
 
 #include "Cloneable.h"
 #include "MemberObject.h"
+#include "RbException.h"
 #include "RbVector.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <iostream>
 #include <vector>
@@ -42,10 +44,43 @@ namespace RevBayesCore {
         virtual                                ~MatrixReal(void);
         
         
+        /**
+         * @brief View of one row of a matrix.
+         *
+         * The view refers to the storage of the matrix; it is invalidated when the matrix is resized or destroyed.
+         * Assigning a vector (or another row) copies the values into the row.
+         */
+        template <class valueType>
+        class RowView {
+            
+        public:
+            RowView(valueType* d, size_t n) : data( d ), length( n ) {}
+            RowView(const RowView<double> &r) : data( r.begin() ), length( r.size() ) {}
+            
+            RowView&                            operator=(const RowView &r) { assign( r.begin(), r.size() ); return *this; }
+            RowView&                            operator=(const std::vector<double> &v) { assign( v.data(), v.size() ); return *this; }
+            valueType&                          operator[](size_t j) const { return data[j]; }
+                                                operator RbVector<double>(void) const { return RbVector<double>( std::vector<double>( data, data + length ) ); }
+                                                operator std::vector<double>(void) const { return std::vector<double>( data, data + length ); }
+            
+            valueType*                          begin(void) const { return data; }
+            valueType*                          end(void) const { return data + length; }
+            size_t                              size(void) const { return length; }
+            
+        private:
+            void                                assign(const double* v, size_t n) const { if ( n != length ) throw RbException("Cannot assign a vector of a different size to a row of a matrix."); std::copy( v, v + n, data ); }
+            
+            valueType*                          data;
+            size_t                              length;
+        };
+        
+        typedef RowView<double>                 Row;
+        typedef RowView<const double>           ConstRow;
+        
         // overloaded operators
         MatrixReal&                             operator=(const MatrixReal& m);
-        RbVector<double>&                       operator[](size_t index);
-        const RbVector<double>&                 operator[](size_t index) const;
+        Row                                     operator[](size_t index);
+        ConstRow                                operator[](size_t index) const;
 
         bool                                    operator==(const MatrixReal &m) const { return this == &m; }
         bool                                    operator!=(const MatrixReal &m) const { return !operator==(m); }
@@ -86,6 +121,7 @@ namespace RevBayesCore {
         const EigenSystem&                      getEigenSystem(void) const ;
         CholeskyDecomposition&                  getCholeskyDecomposition(void);
         const CholeskyDecomposition&            getCholeskyDecomposition(void) const ;
+        const double*                           getData(void) const { return elements.data(); }                                                         //!< The contiguous values in row-major order
         double                                  getDet() const;
         double                                  getLogDet() const;
         size_t                                  getNumberOfColumns(void) const;
@@ -109,7 +145,7 @@ namespace RevBayesCore {
         void                                    update(void) const;
         
         // members
-        RbVector<RbVector<double> >             elements;
+        std::vector<double>                     elements;                                                                                               //!< The values in row-major order, i.e., element (i,j) is at i*n_cols+j
 
         size_t                                  n_rows;
         size_t                                  n_cols;
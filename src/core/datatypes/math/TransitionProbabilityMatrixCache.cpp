@@ -0,0 +1,236 @@
+#include "TransitionProbabilityMatrixCache.h"
+#include "RbSettings.h"
+
+#include <cstring>
+#include <functional>
+
+using namespace RevBayesCore;
+
+
+/** Default constructor: an empty cache. */
+TransitionProbabilityMatrixCache::TransitionProbabilityMatrixCache( void ) :
+    num_hits( 0 ),
+    num_misses( 0 )
+{
+
+}
+
+
+/**
+ * Two keys are equal if all members are equal.
+ * We compare the doubles bitwise so that a key always finds itself.
+ */
+bool TransitionProbabilityMatrixCache::Key::operator==(const Key &k) const
+{
+
+    return fingerprint_high == k.fingerprint_high && fingerprint_low == k.fingerprint_low &&
+           std::memcmp(&start_age, &k.start_age, sizeof(double)) == 0 &&
+           std::memcmp(&end_age, &k.end_age, sizeof(double)) == 0 &&
+           std::memcmp(&rate, &k.rate, sizeof(double)) == 0;
+}
+
+
+size_t TransitionProbabilityMatrixCache::KeyHash::operator()(const Key &k) const
+{
+
+    size_t h = std::hash<std::uint64_t>()( k.fingerprint_high );
+
+    // combine the hashes of the other members (as in boost::hash_combine)
+    std::uint64_t values[4];
+    values[0] = k.fingerprint_low;
+    std::memcpy(&values[1], &k.start_age, sizeof(double));
+    std::memcpy(&values[2], &k.end_age, sizeof(double));
+    std::memcpy(&values[3], &k.rate, sizeof(double));
+    for (size_t i = 0; i < 4; ++i)
+    {
+        h ^= std::hash<std::uint64_t>()( values[i] ) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+
+    return h;
+}
+
+
+/** Remove all entries and reset the hit and miss counters. */
+void TransitionProbabilityMatrixCache::clear( void )
+{
+
+    for (size_t i = 0; i < NUM_SHARDS; ++i)
+    {
+        std::lock_guard<std::mutex> lock( shards[i].shard_mutex );
+
+        shards[i].index.clear();
+        shards[i].entries.clear();
+        shards[i].memory_used = 0;
+    }
+
+    num_hits   = 0;
+    num_misses = 0;
+
+}
+
+
+/**
+ * Look up the transition probability matrix for this key.
+ * If we find it, then we copy it into P, mark it as the most recently used entry of its shard and return true.
+ */
+bool TransitionProbabilityMatrixCache::get(std::uint64_t fingerprint_high, std::uint64_t fingerprint_low, double start_age, double end_age, double rate, TransitionProbabilityMatrix &P)
+{
+
+    Key k = makeKey( fingerprint_high, fingerprint_low, start_age, end_age, rate );
+    Shard &shard = getShard( k );
+
+    std::lock_guard<std::mutex> lock( shard.shard_mutex );
+
+    EntryMap::iterator it = shard.index.find( k );
+    if ( it == shard.index.end() || it->second->P.num_states != P.num_states )
+    {
+        ++num_misses;
+        return false;
+    }
+
+    ++num_hits;
+
+    // move the entry to the front of the list
+    shard.entries.splice( shard.entries.begin(), shard.entries, it->second );
+
+    std::memcpy(P.theMatrix, it->second->P.theMatrix, P.nElements*sizeof(double));
+
+    return true;
+}
+
+
+size_t TransitionProbabilityMatrixCache::getEntrySize( const TransitionProbabilityMatrix &P )
+{
+
+    // the matrix itself, the list node and the hash map node
+    return P.nElements*sizeof(double) + sizeof(Entry) + sizeof(Key) + 4*sizeof(void*);
+}
+
+
+size_t TransitionProbabilityMatrixCache::getMaximumMemory( void ) const
+{
+
+    return RbSettings::userSettings().getTransitionProbabilityCacheSize() * 1024 * 1024;
+}
+
+
+size_t TransitionProbabilityMatrixCache::getMemoryUsage( void ) const
+{
+
+    size_t memory_used = 0;
+    for (size_t i = 0; i < NUM_SHARDS; ++i)
+    {
+        std::lock_guard<std::mutex> lock( shards[i].shard_mutex );
+        memory_used += shards[i].memory_used;
+    }
+
+    return memory_used;
+}
+
+
+size_t TransitionProbabilityMatrixCache::getNumberOfEntries( void ) const
+{
+
+    size_t num_entries = 0;
+    for (size_t i = 0; i < NUM_SHARDS; ++i)
+    {
+        std::lock_guard<std::mutex> lock( shards[i].shard_mutex );
+        num_entries += shards[i].entries.size();
+    }
+
+    return num_entries;
+}
+
+
+size_t TransitionProbabilityMatrixCache::getNumberOfHits( void ) const
+{
+
+    return num_hits;
+}
+
+
+size_t TransitionProbabilityMatrixCache::getNumberOfMisses( void ) const
+{
+
+    return num_misses;
+}
+
+
+/**
+ * Get the shard of a key.
+ * We use the high bits of the hash because the hash map of the shard uses the low bits for its buckets.
+ */
+TransitionProbabilityMatrixCache::Shard& TransitionProbabilityMatrixCache::getShard( const Key &k ) const
+{
+
+    std::uint64_t h = KeyHash()( k );
+
+    return shards[ (h >> 32) % NUM_SHARDS ];
+}
+
+
+/**
+ * Store a copy of P as the most recently used entry of its shard.
+ * Each shard may use an equal part of the memory cap. If the shard exceeds its part,
+ * then we remove its least recently used entries.
+ */
+void TransitionProbabilityMatrixCache::insert(std::uint64_t fingerprint_high, std::uint64_t fingerprint_low, double start_age, double end_age, double rate, const TransitionProbabilityMatrix &P)
+{
+
+    size_t max_memory = getMaximumMemory() / NUM_SHARDS;
+    size_t entry_size = getEntrySize( P );
+
+    // we do not store matrices that are larger than the complete shard
+    if ( entry_size > max_memory )
+    {
+        return;
+    }
+
+    Key k = makeKey( fingerprint_high, fingerprint_low, start_age, end_age, rate );
+    Shard &shard = getShard( k );
+
+    std::lock_guard<std::mutex> lock( shard.shard_mutex );
+
+    EntryMap::iterator it = shard.index.find( k );
+    if ( it != shard.index.end() )
+    {
+        // someone else already stored this matrix
+        shard.entries.splice( shard.entries.begin(), shard.entries, it->second );
+        return;
+    }
+
+    // make space for the new entry
+    while ( shard.entries.empty() == false && shard.memory_used + entry_size > max_memory )
+    {
+        Entry &last = shard.entries.back();
+        shard.memory_used -= getEntrySize( last.P );
+        shard.index.erase( last.key );
+        shard.entries.pop_back();
+    }
+
+    shard.entries.push_front( Entry(k, P) );
+    shard.index[k] = shard.entries.begin();
+    shard.memory_used += entry_size;
+
+}
+
+
+bool TransitionProbabilityMatrixCache::isEnabled( void ) const
+{
+
+    return RbSettings::userSettings().getTransitionProbabilityCacheSize() > 0;
+}
+
+
+TransitionProbabilityMatrixCache::Key TransitionProbabilityMatrixCache::makeKey(std::uint64_t fingerprint_high, std::uint64_t fingerprint_low, double start_age, double end_age, double rate)
+{
+
+    Key k;
+    k.fingerprint_high = fingerprint_high;
+    k.fingerprint_low  = fingerprint_low;
+    k.start_age        = start_age;
+    k.end_age          = end_age;
+    k.rate             = rate;
+
+    return k;
+}
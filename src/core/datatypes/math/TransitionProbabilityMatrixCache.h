@@ -0,0 +1,110 @@
+#ifndef TransitionProbabilityMatrixCache_H
+#define TransitionProbabilityMatrixCache_H
+
+#include "TransitionProbabilityMatrix.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace RevBayesCore {
+
+
+    /**
+     * @brief Process wide least-recently-used cache of transition probability matrices.
+     *
+     * Computing P(t) = exp(Qt) is the most expensive part of a likelihood computation for models with many states.
+     * Often the same matrix is needed again, e.g., for all ancestors of a branch whose length was changed,
+     * after a rejected proposal, or by another chain of an MC^3 analysis that currently has the same rate matrix.
+     * This cache stores the computed matrices keyed by (rate generator fingerprint, start age, end age, rate).
+     *
+     * The fingerprint is a 128-bit hash of all values that determine the transition probabilities
+     * (see RateGenerator::computeFingerprint), so equal rate matrices share their entries
+     * no matter which model or chain they belong to, and a changed rate matrix simply gets a new key.
+     * Outdated entries will eventually be dropped by the least-recently-used policy.
+     *
+     * The memory used by the cache is limited by the user setting 'transitionProbabilityCacheSize' (in MB).
+     * A size of 0 disables the cache.
+     * All functions are thread safe. The entries are split into shards by their key,
+     * each with its own lock and its own share of the memory, so that threads rarely wait for each other.
+     *
+     */
+    class TransitionProbabilityMatrixCache {
+
+    public:
+        static TransitionProbabilityMatrixCache&    globalInstance(void)                                                        //!< Return a reference to the singleton cache
+                                                    {
+                                                        static TransitionProbabilityMatrixCache single_cache;
+                                                        return single_cache;
+                                                    }
+
+        void                                        clear(void);                                                                //!< Remove all entries and reset the counters
+        bool                                        get(std::uint64_t fingerprint_high, std::uint64_t fingerprint_low, double start_age, double end_age, double rate, TransitionProbabilityMatrix &P); //!< Copy the cached matrix into P; returns false if there is none
+        size_t                                      getMemoryUsage(void) const;                                                 //!< The current size of the cache in bytes
+        size_t                                      getNumberOfEntries(void) const;                                             //!< The current number of cached matrices
+        size_t                                      getNumberOfHits(void) const;                                                //!< The number of successful lookups
+        size_t                                      getNumberOfMisses(void) const;                                              //!< The number of unsuccessful lookups
+        void                                        insert(std::uint64_t fingerprint_high, std::uint64_t fingerprint_low, double start_age, double end_age, double rate, const TransitionProbabilityMatrix &P); //!< Store a copy of P
+        bool                                        isEnabled(void) const;                                                      //!< Is the cache size larger than 0?
+
+    private:
+
+        struct Key {
+
+            bool                                    operator==(const Key &k) const;
+
+            std::uint64_t                           fingerprint_high;
+            std::uint64_t                           fingerprint_low;
+            double                                  start_age;
+            double                                  end_age;
+            double                                  rate;
+        };
+
+        struct KeyHash {
+            size_t                                  operator()(const Key &k) const;
+        };
+
+        struct Entry {
+
+                                                    Entry(const Key &k, const TransitionProbabilityMatrix &p) : key( k ), P( p ) {}
+
+            Key                                     key;
+            TransitionProbabilityMatrix             P;
+        };
+
+        typedef std::list<Entry>                                            EntryList;
+        typedef std::unordered_map<Key, EntryList::iterator, KeyHash>       EntryMap;
+
+        struct Shard {
+
+                                                    Shard(void) : entries(), index(), memory_used( 0 ) {}
+
+            EntryList                               entries;                                                                    //!< The entries with the most recently used at the front
+            EntryMap                                index;
+            size_t                                  memory_used;
+            std::mutex                              shard_mutex;
+        };
+
+        static const size_t                         NUM_SHARDS = 16;
+
+                                                    TransitionProbabilityMatrixCache(void);                                     //!< Default constructor
+                                                    TransitionProbabilityMatrixCache(const TransitionProbabilityMatrixCache&);  //!< Prevent copy
+        TransitionProbabilityMatrixCache&           operator=(const TransitionProbabilityMatrixCache&);                         //!< Prevent assignment
+
+        size_t                                      getMaximumMemory(void) const;                                               //!< The memory cap in bytes from the user settings
+        static size_t                               getEntrySize(const TransitionProbabilityMatrix &P);                         //!< The approximate number of bytes used for one entry
+        Shard&                                      getShard(const Key &k) const;                                               //!< The shard holding this key
+        static Key                                  makeKey(std::uint64_t fingerprint_high, std::uint64_t fingerprint_low, double start_age, double end_age, double rate);  //!< Collect the members of a key
+
+        mutable Shard                               shards[NUM_SHARDS];
+        std::atomic<size_t>                         num_hits;
+        std::atomic<size_t>                         num_misses;
+
+    };
+
+}
+
+#endif
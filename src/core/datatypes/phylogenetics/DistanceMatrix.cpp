@@ -91,14 +91,14 @@ size_t DistanceMatrix::size(void) const
 }
 
 
-RbVector<double>& DistanceMatrix::operator[]( size_t index )
+MatrixReal::Row DistanceMatrix::operator[]( size_t index )
 {
 	
 	return matrix[index];
 }
 
 
-const RbVector<double>& DistanceMatrix::operator[]( size_t index ) const
+MatrixReal::ConstRow DistanceMatrix::operator[]( size_t index ) const
 {
 	return matrix[index];
 }
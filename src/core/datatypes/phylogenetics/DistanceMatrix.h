@@ -30,8 +30,8 @@ namespace RevBayesCore {
 		size_t                                          getSize(void) const;
         std::string                                     getFilename(void) const;
         //std::string                                     getDatatype(void) const;
-        RbVector<double>&                       		operator[](size_t index);
-        const RbVector<double>&                 		operator[](size_t index) const;
+        MatrixReal::Row                         		operator[](size_t index);
+        MatrixReal::ConstRow                    		operator[](size_t index) const;
         double& 										getElement( size_t i, size_t j ) ;
         void                                            setTaxon(const Taxon &t, size_t i);
         size_t 											size(void) const;
@@ -44,6 +44,9 @@ namespace RevBayesCore {
         virtual void                                                concatenate(const AbstractDiscreteTaxonData &d) = 0;                //!< Concatenate sequences
         virtual const DiscreteCharacterState&                       getCharacter(size_t index) const = 0;                               //!< Get the character at position index
         virtual DiscreteCharacterState&                             getCharacter(size_t index) = 0;                                     //!< Get the character at position index (non-const to return non-const character)
+        virtual size_t                                              getCharacterCode(size_t index) const = 0;                           //!< Get the code of the character at position index (identical codes mean identical characters)
+        virtual const DiscreteCharacterState&                       getCharacterForCode(size_t code) const = 0;                         //!< Get the character with this code
+        virtual size_t                                              getNumberOfCharacterCodes(void) const = 0;                          //!< How many different codes are used
         virtual size_t                                              getNumberOfCharacters(void) const = 0;                              //!< How many characters
         virtual double                                              getPercentageMissing(void) const = 0;                               //!< Returns the percentage of missing data for this sequence
         virtual std::string                                         getStateLabels(void) = 0;                                           //!< Get the possible state labels
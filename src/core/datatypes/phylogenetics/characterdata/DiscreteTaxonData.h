@@ -3,14 +3,32 @@
 
 #include "AbstractDiscreteTaxonData.h"
 #include "DiscreteCharacterState.h"
+#include "PackedCodeVector.h"
 #include "RbOptions.h"
 
 
+#include <deque>
+#include <map>
 #include <string>
 #include <vector>
 
 namespace RevBayesCore {
 
+    /**
+     * Data of a single taxon for discrete characters.
+     *
+     * The characters are not stored as one object per character. Instead, we keep a table of the
+     * distinct character objects of this taxon (e.g., A, C, G, T and N for a DNA sequence)
+     * and store for each character only the index (code) into this table, bit-packed into 2 to 32 bits.
+     * Characters are only shared if they are identical in every respect (state, string value, gap/missing flag, weights, labels).
+     * PoMo states carry position information and are thus never shared.
+     *
+     * The const access functions return a reference to the shared object.
+     * The non-const access functions first give the character its own copy (copy-on-write),
+     * so that changes to the returned character do not affect any other character.
+     * Hence, use const access wherever the characters are only read.
+     * Classes that need speed (e.g., the likelihood functions) can also read the codes directly.
+     */
     template<class charType>
     class DiscreteTaxonData : public AbstractDiscreteTaxonData {
 
@@ -37,6 +55,9 @@ namespace RevBayesCore {
         void                                            concatenate(const DiscreteTaxonData &d);                            //!< Concatenate sequences
         const charType&                                 getCharacter(size_t index) const;                                   //!< Get the character at position index
         charType&                                       getCharacter(size_t index);                                         //!< Get the character at position index (non-const to return non-const character)
+        size_t                                          getCharacterCode(size_t index) const;                               //!< Get the code of the character at position index
+        const charType&                                 getCharacterForCode(size_t code) const;                             //!< Get the character with this code
+        size_t                                          getNumberOfCharacterCodes(void) const;                              //!< How many different codes are used
         size_t                                          getNumberOfCharacters(void) const;                                  //!< How many characters
         double                                          getPercentageMissing(void) const;                                   //!< Returns the percentage of missing data for this sequence
         std::string                                     getStringRepresentation(size_t idx) const;
@@ -48,7 +69,15 @@ namespace RevBayesCore {
         
     private:
 
-        std::vector<charType>                           sequence;
+        void                                            appendCharacter(const charType &c);                                 //!< Append the code of the character (creating it if needed)
+        static std::string                              computeSharingKey(const charType &c);                               //!< The key under which identical characters are shared
+        charType&                                       getPrivateCharacter(size_t index);                                  //!< Give the character its own object and return it
+        void                                            rebuildSharingKeys(void);
+
+        std::deque<charType>                            states;                                                             //!< The distinct character objects (a deque so that references stay valid)
+        std::vector<bool>                               is_private_state;                                                   //!< Is the object used by a single character only (after non-const access)?
+        std::map<std::string, size_t>                   shared_state_codes;                                                 //!< The codes of the shared objects
+        PackedCodeVector                                sequence;                                                           //!< The code of each character
         std::vector<bool>                               is_resolved;
 
     };
@@ -77,6 +106,129 @@ RevBayesCore::DiscreteTaxonData<charType>::DiscreteTaxonData(const Taxon &t) : A
 }
 
 
+/**
+ * Append a character to the sequence.
+ * If an identical character is already stored, we only append its code.
+ */
+template<class charType>
+void RevBayesCore::DiscreteTaxonData<charType>::appendCharacter(const charType &c)
+{
+
+    std::string key = computeSharingKey( c );
+    if ( key.empty() == false )
+    {
+        std::map<std::string, size_t>::const_iterator it = shared_state_codes.find( key );
+        if ( it != shared_state_codes.end() )
+        {
+            sequence.push_back( it->second );
+            return;
+        }
+        shared_state_codes.insert( std::pair<std::string, size_t>( key, states.size() ) );
+    }
+
+    states.push_back( c );
+    is_private_state.push_back( key.empty() );
+    sequence.push_back( states.size()-1 );
+
+}
+
+
+/**
+ * Compute the key of a character such that two characters with the same key are identical.
+ * An empty key means that the character should not be shared.
+ */
+template<class charType>
+std::string RevBayesCore::DiscreteTaxonData<charType>::computeSharingKey(const charType &c)
+{
+
+    std::string type = c.getDataType();
+    if ( type != "DNA" && type != "RNA" && type != "Protein" && type != "CODON" && type != "Standard" && type != "NaturalNumbers" )
+    {
+        return "";
+    }
+
+    std::string key = c.getStringValue();
+    key += '\0';
+    key += ( c.isGapState()     ? '1' : '0' );
+    key += ( c.isMissingState() ? '1' : '0' );
+    key += ( c.isWeighted()     ? '1' : '0' );
+
+    RbBitSet bits = c.getState();
+    for (size_t i = 0; i < bits.size(); ++i)
+    {
+        key += ( bits.isSet(i) ? '1' : '0' );
+    }
+
+    key += '\0';
+    key += c.getStateLabels();
+
+    // PoMo states hide getWeights() with a declaration that is never defined, so we ask the base class
+    const std::vector<double> &weights = static_cast<const DiscreteCharacterState&>( c ).getWeights();
+    for (size_t i = 0; i < weights.size(); ++i)
+    {
+        key += '\0';
+        key += std::string( reinterpret_cast<const char*>( &weights[i] ), sizeof(double) );
+    }
+
+    if ( type == "NaturalNumbers" )
+    {
+        std::vector<std::string> descriptions = c.getStateDescriptions();
+        for (size_t i = 0; i < descriptions.size(); ++i)
+        {
+            key += '\0';
+            key += descriptions[i];
+        }
+    }
+
+    return key;
+}
+
+
+/**
+ * Make sure that the character at this position has its own object, which can then be changed.
+ */
+template<class charType>
+charType& RevBayesCore::DiscreteTaxonData<charType>::getPrivateCharacter(size_t index)
+{
+
+    if (index >= sequence.size())
+    {
+        throw RbException("Index out of bounds");
+    }
+
+    size_t code = sequence[index];
+    if ( is_private_state[code] == false )
+    {
+        // references to the elements of a deque stay valid when we append
+        states.push_back( states[code] );
+        is_private_state.push_back( true );
+        code = states.size()-1;
+        sequence.set( index, code );
+    }
+
+    return states[code];
+}
+
+
+/**
+ * Recompute the keys of the shared characters after they have been changed.
+ */
+template<class charType>
+void RevBayesCore::DiscreteTaxonData<charType>::rebuildSharingKeys( void )
+{
+
+    shared_state_codes.clear();
+    for (size_t i = 0; i < states.size(); ++i)
+    {
+        if ( is_private_state[i] == false )
+        {
+            shared_state_codes.insert( std::pair<std::string, size_t>( computeSharingKey( states[i] ), i ) );
+        }
+    }
+
+}
+
+
 /**
  * Subscript const operator for convenience access.
  *
@@ -88,12 +240,7 @@ template<class charType>
 charType& RevBayesCore::DiscreteTaxonData<charType>::operator[](size_t i)
 {
 
-    if (i >= sequence.size())
-    {
-        throw RbException("Index out of bounds");
-    }
-
-    return sequence[i];
+    return getPrivateCharacter( i );
 }
 
 
@@ -113,7 +260,7 @@ const charType& RevBayesCore::DiscreteTaxonData<charType>::operator[](size_t i)
         throw RbException("Index out of bounds");
     }
 
-    return sequence[i];
+    return states[ sequence[i] ];
 }
 
 
@@ -251,7 +398,12 @@ template<class charType>
 void RevBayesCore::DiscreteTaxonData<charType>::concatenate(const DiscreteTaxonData<charType> &obsd)
 {
 
-    sequence.insert( sequence.end(), obsd.sequence.begin(), obsd.sequence.end() );
+    size_t n = obsd.sequence.size();
+    sequence.reserve( sequence.size() + n );
+    for (size_t i = 0; i < n; ++i)
+    {
+        appendCharacter( obsd.states[ obsd.sequence[i] ] );
+    }
 
 }
 
@@ -307,7 +459,7 @@ template<class charType>
 void RevBayesCore::DiscreteTaxonData<charType>::addCharacter( const charType &newChar )
 {
 
-    sequence.push_back( newChar );
+    appendCharacter( newChar );
     is_resolved.push_back(true);
 }
 
@@ -362,7 +514,7 @@ template<class charType>
 void RevBayesCore::DiscreteTaxonData<charType>::addCharacter( const charType &newChar, bool tf )
 {
 
-    sequence.push_back( newChar );
+    appendCharacter( newChar );
     is_resolved.push_back(tf);
 }
 
@@ -376,12 +528,8 @@ void RevBayesCore::DiscreteTaxonData<charType>::addCharacter( const charType &ne
 template<class charType>
 charType& RevBayesCore::DiscreteTaxonData<charType>::getCharacter(size_t index)
 {
-    if (index >= sequence.size())
-    {
-        throw RbException("Index out of bounds");
-    }
 
-    return sequence[index];
+    return getPrivateCharacter( index );
 }
 
 
@@ -401,10 +549,51 @@ const charType& RevBayesCore::DiscreteTaxonData<charType>::getCharacter(size_t i
         throw RbException("Index out of bounds");
     }
 
+    return states[ sequence[index] ];
+}
+
+
+/**
+ * Get the code of the character at this position.
+ * Characters with the same code are identical.
+ * Characters with different codes may still be identical, e.g., after one of them had been accessed non-const.
+ *
+ * \param[in]    index  The position of the character.
+ */
+template<class charType>
+size_t RevBayesCore::DiscreteTaxonData<charType>::getCharacterCode(size_t index) const
+{
+
+    if (index >= sequence.size())
+    {
+        throw RbException("Index out of bounds");
+    }
+
     return sequence[index];
 }
 
 
+template<class charType>
+const charType& RevBayesCore::DiscreteTaxonData<charType>::getCharacterForCode(size_t code) const
+{
+
+    if (code >= states.size())
+    {
+        throw RbException("Character code out of bounds");
+    }
+
+    return states[code];
+}
+
+
+template<class charType>
+size_t RevBayesCore::DiscreteTaxonData<charType>::getNumberOfCharacterCodes( void ) const
+{
+
+    return states.size();
+}
+
+
 /**
  * Get the number of character stored in this object
  *
@@ -429,7 +618,8 @@ double RevBayesCore::DiscreteTaxonData<charType>::getPercentageMissing( void ) c
     double numMissing = 0.0;
     for (size_t i = 0; i < sequence.size(); ++i)
     {
-        if ( sequence[i].isMissingState() == true || sequence[i].isGapState() == true )
+        const charType &c = states[ sequence[i] ];
+        if ( c.isMissingState() == true || c.isGapState() == true )
         {
             ++numMissing;
         }
@@ -448,7 +638,7 @@ std::string RevBayesCore::DiscreteTaxonData<charType>::getStateLabels(void)
         return "";
     }
 
-    return sequence[0].getStateLabels();
+    return states[ sequence[0] ].getStateLabels();
 }
 
 
@@ -457,7 +647,7 @@ template<class charType>
 std::string RevBayesCore::DiscreteTaxonData<charType>::getStringRepresentation(size_t idx) const
 {
 
-    return sequence[idx].getStringValue();
+    return states[ sequence[idx] ].getStringValue();
 }
 
 
@@ -490,7 +680,8 @@ bool RevBayesCore::DiscreteTaxonData<charType>::isSequenceMissing( void ) const
 
     for (size_t i = 0; i < sequence.size(); ++i)
     {
-        if ( sequence[i].isMissingState() == false && sequence[i].isGapState() == false )
+        const charType &c = states[ sequence[i] ];
+        if ( c.isMissingState() == false && c.isGapState() == false )
         {
             return false;
         }
@@ -516,7 +707,7 @@ void RevBayesCore::DiscreteTaxonData<charType>::removeCharacters(const std::set<
 //        ++alreadyRemoved;
 //    }
 
-    std::vector<charType> included;
+    PackedCodeVector included;
     for (size_t i = 0; i < sequence.size(); ++i)
     {
         if ( idx.find(i) == idx.end() )
@@ -538,11 +729,14 @@ template<class charType>
 void RevBayesCore::DiscreteTaxonData<charType>::setAllCharactersMissing( void )
 {
 
-    for (size_t i = 0; i < sequence.size(); ++i)
+    for (size_t i = 0; i < states.size(); ++i)
     {
-        sequence[i].setMissingState( true );
+        states[i].setMissingState( true );
     }
 
+    // the shared characters have changed
+    rebuildSharingKeys();
+
 }
 
 template<class charType>
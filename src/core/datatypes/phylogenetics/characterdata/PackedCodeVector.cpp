@@ -0,0 +1,112 @@
+#include "PackedCodeVector.h"
+#include "RbException.h"
+
+using namespace RevBayesCore;
+
+
+PackedCodeVector::PackedCodeVector( void ) :
+    num_codes( 0 ),
+    bits_log( 1 ),
+    codes_per_word_log( 5 ),
+    codes_per_word_mask( 31 ),
+    code_mask( 0x3 )
+{
+
+}
+
+
+void PackedCodeVector::clear( void )
+{
+
+    words.clear();
+    num_codes           = 0;
+    bits_log            = 1;
+    codes_per_word_log  = 5;
+    codes_per_word_mask = 31;
+    code_mask           = 0x3;
+
+}
+
+
+size_t PackedCodeVector::getBitsPerCode( void ) const
+{
+    return size_t(1) << bits_log;
+}
+
+
+size_t PackedCodeVector::getMemoryUsage( void ) const
+{
+    return words.capacity() * sizeof(std::uint64_t);
+}
+
+
+void PackedCodeVector::push_back(size_t code)
+{
+
+    if ( (num_codes >> codes_per_word_log) == words.size() )
+    {
+        words.push_back( 0 );
+    }
+    ++num_codes;
+    set( num_codes-1, code );
+
+}
+
+
+void PackedCodeVector::reserve(size_t n)
+{
+
+    words.reserve( (n + codes_per_word_mask) >> codes_per_word_log );
+
+}
+
+
+void PackedCodeVector::set(size_t i, size_t code)
+{
+
+    if ( code > code_mask )
+    {
+        widen( code );
+    }
+
+    size_t shift = (i & codes_per_word_mask) << bits_log;
+    std::uint64_t &w = words[i >> codes_per_word_log];
+    w = (w & ~(code_mask << shift)) | (std::uint64_t(code) << shift);
+
+}
+
+
+size_t PackedCodeVector::size( void ) const
+{
+    return num_codes;
+}
+
+
+void PackedCodeVector::widen(size_t code)
+{
+
+    if ( std::uint64_t(code) > 0xFFFFFFFFULL )
+    {
+        throw RbException("Too many different character states for the packed character storage.");
+    }
+
+    size_t new_bits_log = bits_log;
+    while ( (std::uint64_t(code) >> (size_t(1) << new_bits_log)) != 0 )
+    {
+        ++new_bits_log;
+    }
+
+    PackedCodeVector wider;
+    wider.bits_log            = new_bits_log;
+    wider.codes_per_word_log  = 6 - new_bits_log;
+    wider.codes_per_word_mask = (size_t(1) << wider.codes_per_word_log) - 1;
+    wider.code_mask           = (std::uint64_t(1) << (size_t(1) << new_bits_log)) - 1;
+    wider.words.reserve( (num_codes + wider.codes_per_word_mask) >> wider.codes_per_word_log );
+    for (size_t i = 0; i < num_codes; ++i)
+    {
+        wider.push_back( (*this)[i] );
+    }
+
+    *this = wider;
+
+}
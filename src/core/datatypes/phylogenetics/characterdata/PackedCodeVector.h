@@ -0,0 +1,53 @@
+#ifndef PackedCodeVector_H
+#define PackedCodeVector_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace RevBayesCore {
+
+    /**
+     * @brief A vector of small unsigned integer codes packed into 64-bit words.
+     *
+     * Each code uses 2, 4, 8, 16 or 32 bits. We start with 2 bits per code and
+     * widen all codes (i.e., repack the whole vector) once a larger code is stored.
+     * Thus, a DNA sequence uses 2 or 4 bits per site, a binary morphological matrix 2 bits per character, etc.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since Version 1.0, 2026-10-18
+     *
+     */
+    class PackedCodeVector {
+
+    public:
+        PackedCodeVector(void);
+
+        size_t                          operator[](size_t i) const                              //!< Get the code at position i
+                                        {
+                                            return size_t( (words[i >> codes_per_word_log] >> ((i & codes_per_word_mask) << bits_log)) & code_mask );
+                                        }
+
+        void                            clear(void);
+        size_t                          getBitsPerCode(void) const;                             //!< The current number of bits used per code
+        size_t                          getMemoryUsage(void) const;                             //!< The number of bytes used for the codes
+        void                            push_back(size_t code);
+        void                            reserve(size_t n);
+        void                            set(size_t i, size_t code);
+        size_t                          size(void) const;
+
+    private:
+        void                            widen(size_t code);                                     //!< Repack the codes with enough bits for this code
+
+        std::vector<std::uint64_t>      words;
+        size_t                          num_codes;
+        size_t                          bits_log;                                               //!< log2 of the number of bits per code
+        size_t                          codes_per_word_log;                                     //!< log2 of the number of codes per word
+        size_t                          codes_per_word_mask;
+        std::uint64_t                   code_mask;
+    };
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+#include "CladogeneticEventArrays.h"
+#include "RbException.h"
+
+#include <atomic>
+
+using namespace RevBayesCore;
+
+
+namespace {
+    
+    /** Get a new, unique version number. */
+    size_t newEventArraysVersion( void )
+    {
+        static std::atomic<size_t> next_version( 1 );
+        return next_version++;
+    }
+    
+}
+
+
+CladogeneticEventArrays::CladogeneticEventArrays( void ) :
+    num_states( 0 ),
+    ancestor_offsets( 1, 0 ),
+    version( newEventArraysVersion() )
+{
+    
+}
+
+
+/**
+ * Compile the event map.
+ * The event map is sorted by (ancestor, daughter 1, daughter 2), so the events of each ancestor state are contiguous
+ * and we can fill the arrays in a single pass. States larger than n-1 increase the number of states.
+ */
+CladogeneticEventArrays::CladogeneticEventArrays( const std::map<std::vector<unsigned>, double> &m, size_t n ) :
+    num_states( n ),
+    version( newEventArraysVersion() )
+{
+    
+    size_t num_events = m.size();
+    ancestor_states.reserve( num_events );
+    daughter_1_states.reserve( num_events );
+    daughter_2_states.reserve( num_events );
+    event_rates.reserve( num_events );
+    
+    for (std::map<std::vector<unsigned>, double>::const_iterator it = m.begin(); it != m.end(); ++it)
+    {
+        const std::vector<unsigned>& states = it->first;
+        if ( states.size() != 3 )
+        {
+            throw RbException("A cladogenetic event must have one ancestor and two daughter states.");
+        }
+        
+        for (size_t i = 0; i < 3; ++i)
+        {
+            if ( states[i] >= num_states )
+            {
+                num_states = states[i] + 1;
+            }
+        }
+        
+        ancestor_states.push_back( states[0] );
+        daughter_1_states.push_back( states[1] );
+        daughter_2_states.push_back( states[2] );
+        event_rates.push_back( it->second );
+    }
+    
+    // count the events of each ancestor and sum their rates in the order of the event map
+    ancestor_offsets = std::vector<size_t>( num_states + 1, 0 );
+    speciation_rates = std::vector<double>( num_states, 0.0 );
+    for (size_t k = 0; k < num_events; ++k)
+    {
+        ++ancestor_offsets[ ancestor_states[k] + 1 ];
+        speciation_rates[ ancestor_states[k] ] += event_rates[k];
+    }
+    for (size_t i = 0; i < num_states; ++i)
+    {
+        ancestor_offsets[i+1] += ancestor_offsets[i];
+    }
+    
+}
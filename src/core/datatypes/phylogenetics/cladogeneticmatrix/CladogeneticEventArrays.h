@@ -0,0 +1,54 @@
+#ifndef CladogeneticEventArrays_H
+#define CladogeneticEventArrays_H
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace RevBayesCore {
+    
+    /**
+     * @brief Cladogenetic event map compiled into flat arrays.
+     *
+     * A cladogenetic event map stores the speciation rate of each event (ancestor, daughter 1, daughter 2)
+     * in a std::map, which is slow to traverse in the inner loop of an ODE solver.
+     * This class stores the same events in compressed sparse row (CSR) format:
+     * the events of ancestor state i are the entries getAncestorOffsets()[i] to getAncestorOffsets()[i+1]-1
+     * of the daughter and rate arrays. The events keep the order of the event map.
+     * We also store the total speciation rate of each ancestor state.
+     *
+     * Each compilation gets a new, unique version number, so users can check cheaply whether the events changed.
+     *
+     */
+    class CladogeneticEventArrays {
+        
+    public:
+                                                    CladogeneticEventArrays(void);                                                              //!< Construct empty arrays
+                                                    CladogeneticEventArrays(const std::map<std::vector<unsigned>, double> &m, size_t n);        //!< Compile the event map for n states
+        
+        const std::vector<unsigned>&                getAncestorStates(void) const { return ancestor_states; }                                   //!< The ancestor state of each event
+        const std::vector<size_t>&                  getAncestorOffsets(void) const { return ancestor_offsets; }                                 //!< The first event of each ancestor state (num_states+1 entries)
+        const std::vector<unsigned>&                getDaughter1States(void) const { return daughter_1_states; }                                //!< The state of the first daughter of each event
+        const std::vector<unsigned>&                getDaughter2States(void) const { return daughter_2_states; }                                //!< The state of the second daughter of each event
+        const std::vector<double>&                  getEventRates(void) const { return event_rates; }                                           //!< The speciation rate of each event
+        size_t                                      getNumberOfEvents(void) const { return event_rates.size(); }
+        size_t                                      getNumberOfStates(void) const { return num_states; }
+        const std::vector<double>&                  getSpeciationRates(void) const { return speciation_rates; }                                 //!< The sum of the event rates of each ancestor state
+        size_t                                      getVersion(void) const { return version; }                                                  //!< The unique version of this compilation
+        
+    private:
+        
+        size_t                                      num_states;
+        std::vector<size_t>                         ancestor_offsets;
+        std::vector<unsigned>                       ancestor_states;
+        std::vector<unsigned>                       daughter_1_states;
+        std::vector<unsigned>                       daughter_2_states;
+        std::vector<double>                         event_rates;
+        std::vector<double>                         speciation_rates;
+        size_t                                      version;
+        
+    };
+    
+}
+
+#endif
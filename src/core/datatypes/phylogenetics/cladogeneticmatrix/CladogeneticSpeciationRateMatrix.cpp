@@ -64,6 +64,11 @@ const std::map<std::vector<unsigned>, double>& CladogeneticSpeciationRateMatrix:
     return event_map;
 }
 
+const CladogeneticEventArrays& CladogeneticSpeciationRateMatrix::getEventArrays( void ) const
+{
+    return event_arrays;
+}
+
 size_t CladogeneticSpeciationRateMatrix::getNumberOfStates( void ) const
 {
     return num_states;
@@ -77,6 +82,9 @@ void CladogeneticSpeciationRateMatrix::initFromString( const std::string &s )
 void CladogeneticSpeciationRateMatrix::setEventMap(std::map<std::vector<unsigned>, double> m)
 {
     event_map = m;
+    
+    // compile the events once here instead of every time they are used
+    event_arrays = CladogeneticEventArrays( event_map, num_states );
 }
 
 
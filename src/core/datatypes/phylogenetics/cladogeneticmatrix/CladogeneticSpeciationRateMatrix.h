@@ -8,6 +8,7 @@
 #define CladogeneticSpeciationRateMatrix_h
 
 #include "Assignable.h"
+#include "CladogeneticEventArrays.h"
 #include "Cloneable.h"
 #include "MatrixReal.h"
 #include "Printable.h"
@@ -38,6 +39,7 @@ namespace RevBayesCore {
         virtual void                                            update(void) {};
         virtual std::map<std::vector<unsigned>, double>         getEventMap(double t=0.0);
         virtual const std::map<std::vector<unsigned>, double>&  getEventMap(double t=0.0) const;
+        const CladogeneticEventArrays&                          getEventArrays(void) const;         //!< The event map compiled into flat arrays
         void                                                    setEventMap(std::map<std::vector<unsigned>, double> m);
         
         // public methods
@@ -53,6 +55,7 @@ namespace RevBayesCore {
         // protected members available for derived classes
         size_t                                                  num_states;                         //!< The number of character states
         std::map<std::vector<unsigned>, double>                 event_map;
+        CladogeneticEventArrays                                 event_arrays;                       //!< The compiled event map, updated by setEventMap()
         
     };
     
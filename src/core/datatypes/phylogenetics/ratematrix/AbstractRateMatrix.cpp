@@ -10,9 +10,11 @@
 
 #include <cmath>
 #include <fstream>
+#include <functional>
 #include <sstream>
 #include <string>
 #include <iomanip>
+#include <typeinfo>
 
 using namespace RevBayesCore;
 
@@ -230,6 +232,35 @@ bool AbstractRateMatrix::checkTimeReversibity(double tolerance)
 }
 
 
+/**
+ * Mix the values that determine the transition probabilities into the fingerprint.
+ * For most rate matrices these are the type (which determines how we exponentiate) and the rates.
+ * If the rates are out of date, then we cannot say anything and return false.
+ */
+bool AbstractRateMatrix::computeFingerprint(std::uint64_t &high, std::uint64_t &low) const
+{
+
+    if ( needs_update == true )
+    {
+        return false;
+    }
+
+    mixFingerprint( high, low, std::uint64_t( std::hash<std::string>()( typeid(*this).name() ) ) );
+    mixFingerprint( high, low, std::uint64_t( num_states ) );
+
+    const MatrixReal &m = *the_rate_matrix;
+    for (size_t i = 0; i < num_states; ++i)
+    {
+        for (size_t j = 0; j < num_states; ++j)
+        {
+            mixFingerprint( high, low, m[i][j] );
+        }
+    }
+
+    return true;
+}
+
+
 double AbstractRateMatrix::getDominatingRate(void) const
 {
     return dominating_rate;
@@ -618,3 +649,83 @@ void AbstractRateMatrix::setDiagonal(void)
     // set flags
     needs_update = true;
 }
+
+
+/**
+ * Calculate the transition probabilities P[b] = exp(Q t[b]) for several times at once from the eigen system (real case),
+ * where c_ijk holds the precomputed products of the eigenvectors and their inverse.
+ * We pass only once over c_ijk and use each of its rows for all times before moving on.
+ * For each matrix we sum in the same order as the single matrix computation, so the results are identical.
+ */
+void AbstractRateMatrix::tiProbsEigensBatch(const std::vector<double> &eigen_values, const std::vector<double> &c_ijk, const std::vector<double> &t, std::vector<TransitionProbabilityMatrix*> &P) const
+{
+
+    size_t num_times = t.size();
+
+    // precalculate the product of the eigenvalue and the branch length
+    std::vector<double> eig_val_exp(num_times*num_states);
+    for (size_t b=0; b<num_times; b++)
+    {
+        for (size_t s=0; s<num_states; s++)
+        {
+            eig_val_exp[b*num_states+s] = exp(eigen_values[s] * t[b]);
+        }
+    }
+
+    // calculate the transition probabilities
+    const double* ptr = &c_ijk[0];
+    for (size_t ij=0; ij<num_states*num_states; ij++, ptr+=num_states)
+    {
+        for (size_t b=0; b<num_times; b++)
+        {
+            const double* e = &eig_val_exp[b*num_states];
+            double sum = 0.0;
+            for (size_t s=0; s<num_states; s++)
+            {
+                sum += ptr[s] * e[s];
+            }
+
+            P[b]->theMatrix[ij] = (sum < 0.0) ? 0.0 : sum;
+        }
+    }
+
+}
+
+
+/**
+ * Calculate the transition probabilities P[b] = exp(Q t[b]) for several times at once from the eigen system (complex case).
+ */
+void AbstractRateMatrix::tiProbsComplexEigensBatch(const std::vector<double> &eigen_values_real, const std::vector<double> &eigen_values_imag, const std::vector<std::complex<double> > &cc_ijk, const std::vector<double> &t, std::vector<TransitionProbabilityMatrix*> &P) const
+{
+
+    size_t num_times = t.size();
+
+    // precalculate the product of the eigenvalue and the branch length
+    std::vector<std::complex<double> > ceig_val_exp(num_times*num_states);
+    for (size_t s=0; s<num_states; s++)
+    {
+        std::complex<double> ev = std::complex<double>(eigen_values_real[s], eigen_values_imag[s]);
+        for (size_t b=0; b<num_times; b++)
+        {
+            ceig_val_exp[b*num_states+s] = exp(ev * t[b]);
+        }
+    }
+
+    // calculate the transition probabilities
+    const std::complex<double>* ptr = &cc_ijk[0];
+    for (size_t ij=0; ij<num_states*num_states; ij++, ptr+=num_states)
+    {
+        for (size_t b=0; b<num_times; b++)
+        {
+            const std::complex<double>* e = &ceig_val_exp[b*num_states];
+            std::complex<double> sum = std::complex<double>(0.0, 0.0);
+            for (size_t s=0; s<num_states; s++)
+            {
+                sum += ptr[s] * e[s];
+            }
+
+            P[b]->theMatrix[ij] = (sum.real() < 0.0) ? 0.0 : sum.real();
+        }
+    }
+
+}
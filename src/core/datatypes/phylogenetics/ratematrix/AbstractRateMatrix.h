@@ -3,6 +3,7 @@
 
 #include "MatrixReal.h"
 #include "RateMatrix.h"
+#include <complex>
 #include <vector>
 
 
@@ -40,6 +41,7 @@ namespace RevBayesCore {
 //        std::vector<std::vector<double> >::iterator             end(void);
         
         // public methods
+        virtual bool                        computeFingerprint(std::uint64_t &high, std::uint64_t &low) const;                          //!< Mix the type, the number of states and the rates into the fingerprint
         double                              getRate(size_t from, size_t to, double rate=1.0) const;
         double                              getRate(size_t from, size_t to, double age, double rate) const;         //!< Calculate the rate from state i to state j over the given time interval scaled by a rate
         void                                rescaleToAverageRate(double r);                                                             //!< Rescale the rate matrix such that the average rate is "r"
@@ -70,6 +72,8 @@ namespace RevBayesCore {
         virtual void                        computeDominatingRate(void);
         virtual void                        exponentiateMatrixByScalingAndSquaring(double t,  TransitionProbabilityMatrix& p) const;
         virtual void                        multiplyMatrices(TransitionProbabilityMatrix& p,  TransitionProbabilityMatrix& q,  TransitionProbabilityMatrix& r) const;
+        void                                tiProbsEigensBatch(const std::vector<double> &eigen_values, const std::vector<double> &c_ijk, const std::vector<double> &t, std::vector<TransitionProbabilityMatrix*> &P) const;    //!< Calculate transition probabilities for several times from the eigen system (real case)
+        void                                tiProbsComplexEigensBatch(const std::vector<double> &eigen_values_real, const std::vector<double> &eigen_values_imag, const std::vector<std::complex<double> > &cc_ijk, const std::vector<double> &t, std::vector<TransitionProbabilityMatrix*> &P) const; //!< Calculate transition probabilities for several times from the eigen system (complex case)
         
         // protected members available for derived classes
         MatrixReal*                         the_rate_matrix;                                                                            //!< Holds the rate matrix
@@ -7,6 +7,7 @@
 #include "TypedDagNode.h"
 
 
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -47,6 +48,51 @@ void RateGenerator::calculateTransitionProbabilities(double t, TransitionProbabi
     calculateTransitionProbabilities(t, 0.0, 1.0, P);
 }
 
+/**
+ * Multiply the n vectors v (stored one after the other) by the transition probability matrix: w_i = sum_j P_ij v_j.
+ * By default we compute the matrix, but rate matrices with a cheaper action (e.g. large sparse ones) can
+ * overwrite this so that the matrix is never formed.
+ */
+void RateGenerator::calculateTransitionProbabilityAction(double startAge, double endAge, double rate, const double* v, double* w, size_t n) const
+{
+
+    TransitionProbabilityMatrix P(num_states);
+    calculateTransitionProbabilities(startAge, endAge, rate, P);
+
+    for (size_t k = 0; k < n; ++k)
+    {
+        const double* p = P.theMatrix;
+        for (size_t i = 0; i < num_states; ++i)
+        {
+            double sum = 0.0;
+            for (size_t j = 0; j < num_states; ++j)
+            {
+                sum += p[j] * v[j];
+            }
+            w[i] = sum;
+            p += num_states;
+        }
+
+        v += num_states;
+        w += num_states;
+    }
+
+}
+
+
+/**
+ * Mix all values that determine the transition probabilities of this rate generator into the fingerprint (high, low).
+ * Two rate generators with the same fingerprint must compute the same transition probabilities,
+ * so that, e.g., the transition probability cache can share matrices between the chains of an MC^3 analysis.
+ * By default we do not know these values and return false; derived classes overwrite this.
+ */
+bool RateGenerator::computeFingerprint(std::uint64_t &high, std::uint64_t &low) const
+{
+
+    return false;
+}
+
+
 size_t RateGenerator::getNumberOfStates( void ) const
 {
     return num_states;
@@ -182,6 +228,42 @@ void RateGenerator::executeMethod(const std::string &n, const std::vector<const
             rv.push_back(this->getRate(from_idx, to_idx, 0.0, 1.0));
         }
     }
+    else if ( n == "applyTransitionProbabilities" )
+    {
+        rv.clear();
+        
+        const RbVector<double> &v = static_cast<const TypedDagNode<RbVector<double> > *>( args[0] )->getValue();
+        double rate = static_cast<const TypedDagNode<double> *>( args[1] )->getValue();
+        double start_age = static_cast<const TypedDagNode<double> *>( args[2] )->getValue();
+        double end_age = static_cast<const TypedDagNode<double> *>( args[3] )->getValue();
+        
+        if ( v.size() != num_states )
+        {
+            std::stringstream ss;
+            ss << "The vector has " << v.size() << " values but the rate matrix has " << num_states << " states.";
+            throw RbException( ss.str() );
+        }
+        
+        if (start_age < end_age)
+        {
+            double temp = start_age;
+            start_age = end_age;
+            end_age = temp;
+        }
+        
+        std::vector<double> x( num_states, 0.0 );
+        for (size_t i = 0; i < num_states; i++)
+        {
+            x[i] = v[i];
+        }
+        std::vector<double> w( num_states, 0.0 );
+        calculateTransitionProbabilityAction( start_age, end_age, rate, &x[0], &w[0], 1 );
+        
+        for (size_t i = 0; i < num_states; i++)
+        {
+            rv.push_back( w[i] );
+        }
+    }
 
 }
 
@@ -222,6 +304,35 @@ void RateGenerator::executeMethod(const std::string &n, const std::vector<const
 //}
 
 
+/**
+ * Mix an 8-byte word into the fingerprint.
+ * The two halves use different multipliers so that they are (practically) independent hashes.
+ */
+void RateGenerator::mixFingerprint(std::uint64_t &high, std::uint64_t &low, std::uint64_t w)
+{
+
+    high ^= w;
+    high *= 0xBF58476D1CE4E5B9ULL;
+    high ^= high >> 31;
+
+    low ^= w;
+    low *= 0x94D049BB133111EBULL;
+    low ^= low >> 31;
+
+}
+
+
+/** Mix the bits of a double into the fingerprint. */
+void RateGenerator::mixFingerprint(std::uint64_t &high, std::uint64_t &low, double x)
+{
+
+    std::uint64_t w = 0;
+    std::memcpy(&w, &x, sizeof(double));
+    mixFingerprint(high, low, w);
+
+}
+
+
 size_t RateGenerator::size( void ) const
 {
     return num_states;
@@ -7,6 +7,7 @@
 #include "MatrixReal.h"
 #include "Printable.h"
 #include "Simplex.h"
+#include <cstdint>
 #include <vector>
 
 namespace RevBayesCore {
@@ -37,6 +38,9 @@ namespace RevBayesCore {
         virtual double                      getSumOfRatesDifferential(std::vector<CharacterEvent*> from, CharacterEventDiscrete* to, double age=0.0, double rate=1.0) const;
 
         // virtual methods that may need to overwritten
+        virtual void                        calculateTransitionProbabilityAction(double startAge, double endAge, double rate, const double* v, double* w, size_t n) const;  //!< Multiply n vectors by the transition probability matrix (w = P*v)
+        virtual bool                        computeFingerprint(std::uint64_t &high, std::uint64_t &low) const;                        //!< Mix all values that determine the transition probabilities into the fingerprint (false if we cannot)
+        virtual bool                        prefersTransitionProbabilityAction(void) const { return false; }                           //!< Is the action cheaper than computing the matrix (e.g. for large sparse matrices)?
         virtual bool                        simulateStochasticMapping(double startAge, double endAge, double rate,std::vector<size_t>& transition_states, std::vector<double>& transition_times);
         virtual void                        update(void) {};
 
@@ -53,6 +57,10 @@ namespace RevBayesCore {
         // prevent instantiation
         RateGenerator(size_t n);                                                                                                        //!< Construct rate matrix with n states
 
+        // protected methods available for derived classes
+        static void                         mixFingerprint(std::uint64_t &high, std::uint64_t &low, std::uint64_t w);                 //!< Mix one 8-byte word into the fingerprint
+        static void                         mixFingerprint(std::uint64_t &high, std::uint64_t &low, double x);                        //!< Mix the bits of one double into the fingerprint
+
         // protected members available for derived classes
         size_t                              num_states;                                                                                  //!< The number of character states
 
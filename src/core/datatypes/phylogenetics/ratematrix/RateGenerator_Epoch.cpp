@@ -126,6 +126,38 @@ RateGenerator_Epoch* RateGenerator_Epoch::clone( void ) const
 }
 
 
+/**
+ * Mix the values that determine the transition probabilities into the fingerprint:
+ * the epoch times and rates, and the fingerprints of the rate generators of all epochs.
+ */
+bool RateGenerator_Epoch::computeFingerprint(std::uint64_t &high, std::uint64_t &low) const
+{
+
+    mixFingerprint( high, low, std::uint64_t( epochRateGenerators.size() ) );
+    for (size_t i = 0; i < epochRateGenerators.size(); ++i)
+    {
+        if ( epochRateGenerators[i].computeFingerprint( high, low ) == false )
+        {
+            return false;
+        }
+    }
+
+    mixFingerprint( high, low, std::uint64_t( epochTimes.size() ) );
+    for (size_t i = 0; i < epochTimes.size(); ++i)
+    {
+        mixFingerprint( high, low, double( epochTimes[i] ) );
+    }
+
+    mixFingerprint( high, low, std::uint64_t( epochRates.size() ) );
+    for (size_t i = 0; i < epochRates.size(); ++i)
+    {
+        mixFingerprint( high, low, double( epochRates[i] ) );
+    }
+
+    return true;
+}
+
+
 size_t RateGenerator_Epoch::findEpochIndex( double t ) const
 {
     int i;
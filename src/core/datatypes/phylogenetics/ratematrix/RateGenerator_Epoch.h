@@ -34,6 +34,7 @@ namespace RevBayesCore {
         RateGenerator_Epoch&                assign(const Assignable &m);
         void                                calculateTransitionProbabilities(double startAge, double endAge, double rate, TransitionProbabilityMatrix& P) const;   //!< Calculate the transition matrix
         RateGenerator_Epoch*                clone(void) const;
+        bool                                computeFingerprint(std::uint64_t &high, std::uint64_t &low) const;                                                  //!< Mix the epoch times, rates and generators into the fingerprint
         double                              getRate(size_t from, size_t to, double age, double rate) const;                                    //!< Calculate the rate from state i to state j over the given time interval scaled by a rate
         virtual RbVector<double>            getEpochTimesWithinInterval(double start_age, double end_age) const;
         const RbVector<RateGenerator>&      getRateGenerators(void) const;                                                                                         //!< Return the epoch generators
@@ -1,6 +1,7 @@
 #include "RateMatrix.h"
 #include "RbException.h"
 #include "RbMathMatrix.h"
+#include "TransitionProbabilityMatrix.h"
 #include "TypedDagNode.h"
 
 #include <fstream>
@@ -39,3 +40,20 @@ RateMatrix& RateMatrix::assign(const Assignable &m)
         throw RbException("Could not assign rate matrix.");
     }
 }
+
+
+/**
+ * Calculate the transition probabilities for several times (rate times branch length) at once.
+ * The default implementation simply computes one matrix after the other.
+ * Rate matrices that use an eigen decomposition override this function
+ * so that they pass only once over the products of the eigenvectors.
+ */
+void RateMatrix::calculateBatchTransitionProbabilities(const std::vector<double> &t, std::vector<TransitionProbabilityMatrix*> &P) const
+{
+
+    for (size_t i = 0; i < t.size(); ++i)
+    {
+        calculateTransitionProbabilities( t[i], 0.0, 1.0, *P[i] );
+    }
+
+}
@@ -29,6 +29,7 @@ namespace RevBayesCore {
         virtual void                        update(void) = 0;                                                                           //!< Update the rate entries of the matrix (is needed if stationarity freqs or similar have changed)
 
         virtual RateMatrix&                 assign(const Assignable &m);
+        virtual void                        calculateBatchTransitionProbabilities(const std::vector<double> &t, std::vector<TransitionProbabilityMatrix*> &P) const;     //!< Calculate the transition probabilities P[i] for the times (rate x branch length) t[i]
 
     protected:
         // prevent instantiation
@@ -126,6 +126,21 @@ void RateMatrix_CodonSynonymousNonsynonymous::calculateCijk(void)
 }
 
 
+/** Calculate the transition probabilities for several times in one pass over the eigen system */
+void RateMatrix_CodonSynonymousNonsynonymous::calculateBatchTransitionProbabilities(const std::vector<double> &t, std::vector<TransitionProbabilityMatrix*> &P) const
+{
+    if ( eigen_system->isComplex() == false )
+    {
+        tiProbsEigensBatch( eigen_system->getRealEigenvalues(), c_ijk, t, P );
+    }
+    else
+    {
+        tiProbsComplexEigensBatch( eigen_system->getRealEigenvalues(), eigen_system->getImagEigenvalues(), cc_ijk, t, P );
+    }
+    
+}
+
+
 /** Calculate the transition probabilities */
 void RateMatrix_CodonSynonymousNonsynonymous::calculateTransitionProbabilities(double startAge, double endAge, double rate, TransitionProbabilityMatrix& P) const
 {
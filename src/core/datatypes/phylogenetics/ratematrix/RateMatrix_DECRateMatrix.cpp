@@ -41,6 +41,7 @@ RateMatrix_DECRateMatrix::RateMatrix_DECRateMatrix(size_t ns, size_t nc, bool cs
     rescaleMatrix(false),
     maxRangeSize(mrs),
     stationaryMatrix( TransitionProbabilityMatrix(num_states) ),
+    uniformizationRate( 0.0 ),
     accessedTransitionProbabilities( std::list<double>() ),
     maxSizeStoredTransitionProbabilites(1e3),
     useStoredTransitionProbabilities(true)
@@ -96,8 +97,11 @@ RateMatrix_DECRateMatrix::RateMatrix_DECRateMatrix(const RateMatrix_DECRateMatri
     maxRangeSize         = m.maxRangeSize;
     rescaleMatrix        = m.rescaleMatrix;
     scalingFactor        = m.scalingFactor;
-    storedTransitionProbabilities = m.storedTransitionProbabilities;
-    accessedTransitionProbabilities = m.accessedTransitionProbabilities;
+    sparseRowBegin       = m.sparseRowBegin;
+    sparseColumns        = m.sparseColumns;
+    sparseRates          = m.sparseRates;
+    uniformizationRate   = m.uniformizationRate;
+    copyStoredTransitionProbabilities( m );
     maxSizeStoredTransitionProbabilites = m.maxSizeStoredTransitionProbabilites;
     useStoredTransitionProbabilities = m.useStoredTransitionProbabilities;
     changedAreas = m.changedAreas;
@@ -149,8 +153,11 @@ RateMatrix_DECRateMatrix& RateMatrix_DECRateMatrix::operator=(const RateMatrix_D
         maxRangeSize         = r.maxRangeSize;
         rescaleMatrix        = r.rescaleMatrix;
         scalingFactor        = r.scalingFactor;
-        storedTransitionProbabilities = r.storedTransitionProbabilities;
-        accessedTransitionProbabilities = r.accessedTransitionProbabilities;
+        sparseRowBegin       = r.sparseRowBegin;
+        sparseColumns        = r.sparseColumns;
+        sparseRates          = r.sparseRates;
+        uniformizationRate   = r.uniformizationRate;
+        copyStoredTransitionProbabilities( r );
         maxSizeStoredTransitionProbabilites = r.maxSizeStoredTransitionProbabilites;
         useStoredTransitionProbabilities = r.useStoredTransitionProbabilities;
         changedAreas = r.changedAreas;
@@ -341,16 +348,15 @@ void RateMatrix_DECRateMatrix::calculateTransitionProbabilities(double startAge,
     
     
     // Do we already have P(t)?
-    std::map<double, TransitionProbabilityMatrix>::const_iterator it = storedTransitionProbabilities.find(t);
+    std::map<double, std::pair<TransitionProbabilityMatrix, std::list<double>::iterator> >::const_iterator it = storedTransitionProbabilities.find(t);
     bool found = it != storedTransitionProbabilities.end();
     if (found) {
         
         // update the transition probs
-        P = it->second;
+        P = it->second.first;
         
         // this time was most recently accessed
-        accessedTransitionProbabilities.remove(it->first);
-        accessedTransitionProbabilities.push_front(it->first);
+        accessedTransitionProbabilities.splice(accessedTransitionProbabilities.begin(), accessedTransitionProbabilities, it->second.second);
     }
     else {
         
@@ -390,8 +396,8 @@ void RateMatrix_DECRateMatrix::calculateTransitionProbabilities(double startAge,
         }
 
         if (useStoredTransitionProbabilities) {
-            storedTransitionProbabilities.insert( std::pair<double, TransitionProbabilityMatrix>(t, P) );
             accessedTransitionProbabilities.push_front(t);
+            storedTransitionProbabilities.insert( std::make_pair(t, std::make_pair(P, accessedTransitionProbabilities.begin())) );
         }
         if (accessedTransitionProbabilities.size() > maxSizeStoredTransitionProbabilites)
         {
@@ -405,6 +411,48 @@ void RateMatrix_DECRateMatrix::calculateTransitionProbabilities(double startAge,
     return;
 }
 
+/**
+ * Multiply the n vectors v (stored one after the other) by the transition probability matrix, w_i = sum_j P_ij v_j,
+ * without forming the dense matrix. This is what the pruning algorithm needs, and for large ranges
+ * the rate matrix is very sparse (each range can only gain or lose one area at a time).
+ */
+void RateMatrix_DECRateMatrix::calculateTransitionProbabilityAction(double startAge, double endAge, double rate, const double* v, double* w, size_t n) const
+{
+    double t = scalingFactor * rate * (startAge - endAge);
+    
+    if (conditionSurvival == false)
+    {
+        exponentiateSparse(t, v, w, n);
+        return;
+    }
+    
+    // condition P_ij on j!=0, P'_ij = P_ij / (1.0 - P_i0)
+    // for this we also apply the matrix to the indicator of the non-null ranges, which gives the denominators
+    std::vector<double> x( (n+1) * num_states, 1.0 );
+    for (size_t k = 0; k < n; ++k)
+    {
+        for (size_t j = 1; j < num_states; ++j)
+        {
+            x[k*num_states + j] = v[k*num_states + j];
+        }
+        x[k*num_states] = 0.0;
+    }
+    x[n*num_states] = 0.0;
+    
+    std::vector<double> y( (n+1) * num_states, 0.0 );
+    exponentiateSparse(t, &x[0], &y[0], n+1);
+    
+    const double* row_sums = &y[n*num_states];
+    for (size_t k = 0; k < n; ++k)
+    {
+        w[k*num_states] = v[k*num_states];
+        for (size_t i = 1; i < num_states; ++i)
+        {
+            w[k*num_states + i] = y[k*num_states + i] / row_sums[i];
+        }
+    }
+}
+
 RateMatrix_DECRateMatrix* RateMatrix_DECRateMatrix::clone( void ) const
 {
     return new RateMatrix_DECRateMatrix( *this );
@@ -415,6 +463,41 @@ RateMatrix_DECRateMatrix* RateMatrix_DECRateMatrix::clone( void ) const
 //    AbstractRateMatrix::computeStochasticMatrix(n);
 //}
 
+/**
+ * Copy the cached transition probabilities of another matrix.
+ * The cache stores the position of each time in the list of accesses, so we need to rebuild these positions for our own list.
+ */
+void RateMatrix_DECRateMatrix::copyStoredTransitionProbabilities(const RateMatrix_DECRateMatrix& m)
+{
+    storedTransitionProbabilities.clear();
+    accessedTransitionProbabilities.clear();
+    
+    for (std::list<double>::const_iterator it = m.accessedTransitionProbabilities.begin(); it != m.accessedTransitionProbabilities.end(); ++it)
+    {
+        accessedTransitionProbabilities.push_back( *it );
+        const TransitionProbabilityMatrix& P = m.storedTransitionProbabilities.find( *it )->second.first;
+        storedTransitionProbabilities.insert( std::make_pair(*it, std::make_pair(P, --accessedTransitionProbabilities.end())) );
+    }
+}
+
+/**
+ * Mix the values that determine the transition probabilities into the fingerprint.
+ * Besides the rates, these are the scaling of the branch lengths and whether we condition on survival.
+ */
+bool RateMatrix_DECRateMatrix::computeFingerprint(std::uint64_t &high, std::uint64_t &low) const
+{
+
+    if ( GeneralRateMatrix::computeFingerprint( high, low ) == false )
+    {
+        return false;
+    }
+
+    mixFingerprint( high, low, scalingFactor );
+    mixFingerprint( high, low, std::uint64_t( conditionSurvival ) );
+
+    return true;
+}
+
 void RateMatrix_DECRateMatrix::computeConditionSurvival(MatrixReal& r)
 {
     for (size_t i = 1; i < num_states; i++)
@@ -468,6 +551,106 @@ void RateMatrix_DECRateMatrix::computeConditionSurvival(TransitionProbabilityMat
 //    }
 //}
 
+/**
+ * Compute exp(Qt)*v for the n vectors v by uniformization.
+ * With lambda the largest rate of leaving a state and B = I + Q/lambda, which has no negative entries,
+ *
+ *     exp(Qt)*v = sum_k Poisson(k; lambda*t) * B^k * v.
+ *
+ * All terms are non-negative, so there is no cancellation, and each term costs one product with the sparse matrix.
+ * We split long branches into steps with lambda*t <= 32 so that the Poisson probabilities do not underflow.
+ */
+void RateMatrix_DECRateMatrix::exponentiateSparse(double t, const double* v, double* w, size_t n) const
+{
+    for (size_t i = 0; i < n*num_states; ++i)
+    {
+        w[i] = v[i];
+    }
+    
+    if (uniformizationRate * t <= 0.0)
+    {
+        return;
+    }
+    
+    size_t num_steps = size_t( std::ceil(uniformizationRate * t / 32.0) );
+    double mu = uniformizationRate * t / num_steps;
+    
+    // the Poisson probabilities, until the remaining terms are negligible
+    std::vector<double> poisson(1, std::exp(-mu));
+    double sum = poisson[0];
+    while (poisson.size() <= mu || poisson.back() > 1E-16 * sum)
+    {
+        double p = poisson.back() * mu / poisson.size();
+        poisson.push_back(p);
+        sum += p;
+    }
+    
+    std::vector<double> x(num_states, 0.0);
+    std::vector<double> y(num_states, 0.0);
+    for (size_t k = 0; k < n; ++k)
+    {
+        double* w_k = w + k*num_states;
+        
+        for (size_t step = 0; step < num_steps; ++step)
+        {
+            for (size_t i = 0; i < num_states; ++i)
+            {
+                x[i] = w_k[i];
+                w_k[i] = poisson[0] * x[i];
+            }
+            
+            for (size_t m = 1; m < poisson.size(); ++m)
+            {
+                // y = B*x
+                for (size_t i = 0; i < num_states; ++i)
+                {
+                    double qx = 0.0;
+                    for (size_t e = sparseRowBegin[i]; e < sparseRowBegin[i+1]; ++e)
+                    {
+                        qx += sparseRates[e] * x[ sparseColumns[e] ];
+                    }
+                    y[i] = x[i] + qx / uniformizationRate;
+                }
+                x.swap(y);
+                
+                for (size_t i = 0; i < num_states; ++i)
+                {
+                    w_k[i] += poisson[m] * x[i];
+                }
+            }
+        }
+    }
+}
+
+/** Collect the non-zero rates in compressed sparse row format */
+void RateMatrix_DECRateMatrix::fillSparseRateMatrix(void)
+{
+    const MatrixReal& m = *the_rate_matrix;
+    
+    sparseRowBegin = std::vector<size_t>(1, 0);
+    sparseColumns.clear();
+    sparseRates.clear();
+    uniformizationRate = 0.0;
+    
+    for (size_t i = 0; i < num_states; ++i)
+    {
+        for (size_t j = 0; j < num_states; ++j)
+        {
+            if (m[i][j] != 0.0)
+            {
+                sparseColumns.push_back(j);
+                sparseRates.push_back(m[i][j]);
+            }
+        }
+        sparseRowBegin.push_back(sparseColumns.size());
+        
+        if (-m[i][i] > uniformizationRate)
+        {
+            uniformizationRate = -m[i][i];
+        }
+    }
+}
+
 const RbVector<RbVector<double> >& RateMatrix_DECRateMatrix::getDispersalRates(void) const
 {
     return dispersalRates;
@@ -501,6 +684,15 @@ std::vector<double> RateMatrix_DECRateMatrix::getStationaryFrequencies(void) con
     return(f);
 }
 
+/**
+ * For large matrices, multiplying the partial likelihoods by exp(Qt) through the sparse rate matrix
+ * is much cheaper than computing the dense transition probabilities.
+ */
+bool RateMatrix_DECRateMatrix::prefersTransitionProbabilityAction(void) const
+{
+    return useSquaring;
+}
+
 void RateMatrix_DECRateMatrix::makeBits(void)
 {
     
@@ -718,6 +910,9 @@ void RateMatrix_DECRateMatrix::update( void ) {
         if (rescaleMatrix)
             rescaleToAverageRate(1.0);
         
+        // collect the non-zero rates for the sparse exponentiation
+        fillSparseRateMatrix();
+        
         if (!useSquaring)
             // get transition probs
             updateEigenSystem();
@@ -35,12 +35,15 @@ namespace RevBayesCore {
         // RateMatrix functions
         double                              averageRate(void) const;
         void                                calculateTransitionProbabilities(double startAge, double endAge, double rate, TransitionProbabilityMatrix& P) const;   //!< Calculate the transition matrix
+        void                                calculateTransitionProbabilityAction(double startAge, double endAge, double rate, const double* v, double* w, size_t n) const;  //!< Multiply vectors by the transition probabilities without forming the matrix
         RateMatrix_DECRateMatrix*           clone(void) const;
+        bool                                computeFingerprint(std::uint64_t &high, std::uint64_t &low) const;                 //!< Also mix in the scaling factor and the conditioning on survival
         void                                fillRateMatrix(void);
         const RbVector<RbVector<double> >&  getDispersalRates(void) const;
         const RbVector<RbVector<double> >&  getExtirpationRates(void) const;                                                   //!< Return the extirpation rates
         const std::vector<double>&          getRangeSize(void) const;                                                          //!< Return the range size simplex
         virtual std::vector<double>         getStationaryFrequencies(void) const;                                              //!< Return the stationary frequencies
+        bool                                prefersTransitionProbabilityAction(void) const;                                    //!< Yes, for large matrices
 
         void                                setDispersalRates(const RbVector<RbVector<double> >& dr);                          //!< Directly set dispersal rates
         void                                setExtirpationRates(const RbVector<RbVector<double> >& er);                        //!< Directly set extirpation rates
@@ -57,6 +60,9 @@ namespace RevBayesCore {
 //        void                                exponentiateMatrixByScalingAndSquaring(double t,  TransitionProbabilityMatrix& p) const;
 //        inline void                         multiplyMatrices(TransitionProbabilityMatrix& p,  TransitionProbabilityMatrix& q,  TransitionProbabilityMatrix& r) const;
 //=======
+        void                                copyStoredTransitionProbabilities(const RateMatrix_DECRateMatrix& m);              //!< Copy the cache of transition probabilities (and rebuild its access list)
+        void                                exponentiateSparse(double t, const double* v, double* w, size_t n) const;          //!< Compute exp(Qt)*v for n vectors by uniformization
+        void                                fillSparseRateMatrix(void);                                                        //!< Collect the non-zero rates
         void                                computeConditionSurvival(MatrixReal& r);
         void                                computeConditionSurvival(TransitionProbabilityMatrix& r);
         void                                tiProbsEigens(double t, TransitionProbabilityMatrix& P) const;                      //!< Calculate transition probabilities for real case
@@ -101,7 +107,14 @@ namespace RevBayesCore {
         size_t                                              maxRangeSize;
         TransitionProbabilityMatrix                         stationaryMatrix;
         
-        mutable std::map<double,TransitionProbabilityMatrix>  storedTransitionProbabilities;
+        // the rate matrix in compressed sparse row format
+        std::vector<size_t>                                 sparseRowBegin;
+        std::vector<size_t>                                 sparseColumns;
+        std::vector<double>                                 sparseRates;
+        double                                              uniformizationRate;             //!< The largest rate of leaving a state
+        
+        // the cached matrices with their position in the list of accesses (most recent first)
+        mutable std::map<double, std::pair<TransitionProbabilityMatrix, std::list<double>::iterator> >  storedTransitionProbabilities;
         mutable std::list<double>                             accessedTransitionProbabilities;
         unsigned                                              maxSizeStoredTransitionProbabilites;
         bool                                                  useStoredTransitionProbabilities;
@@ -39,6 +39,7 @@ namespace RevBayesCore {
         
         // RateMatrix functions
         virtual RateMatrix_Empirical&       assign(const Assignable &m);                                                                                            //!< Assign operation that can be called on a base class instance.
+        void                                calculateBatchTransitionProbabilities(const std::vector<double> &t, std::vector<TransitionProbabilityMatrix*> &P) const; //!< Calculate the transition matrices for several times at once
         void                                calculateTransitionProbabilities(double startAge, double endAge, double rate, TransitionProbabilityMatrix& P) const;    //!< Calculate the transition matrix
         RateMatrix_Empirical*               clone(void) const;
         void                                update(void);
@@ -209,6 +209,28 @@ void RateMatrix_FreeK::calculateCijk(void)
 }
 
 
+/**
+ * Calculate the transition probabilities for several times in one pass over the eigen system.
+ * Only the eigen decomposition supports this; the other methods compute the matrices one by one.
+ */
+void RateMatrix_FreeK::calculateBatchTransitionProbabilities(const std::vector<double> &t, std::vector<TransitionProbabilityMatrix*> &P) const
+{
+    if ( my_method != EIGEN )
+    {
+        RateMatrix::calculateBatchTransitionProbabilities(t, P);
+    }
+    else if ( theEigenSystem->isComplex() == false )
+    {
+        tiProbsEigensBatch( theEigenSystem->getRealEigenvalues(), c_ijk, t, P );
+    }
+    else
+    {
+        tiProbsComplexEigensBatch( theEigenSystem->getRealEigenvalues(), theEigenSystem->getImagEigenvalues(), cc_ijk, t, P );
+    }
+    
+}
+
+
 /** Calculate the transition probabilities */
 void RateMatrix_FreeK::calculateTransitionProbabilities(double startAge, double endAge, double rate, TransitionProbabilityMatrix& P) const
 {
@@ -48,6 +48,7 @@ namespace RevBayesCore {
         virtual RateMatrix_FreeK&           assign(const Assignable &m);
         
         // RateMatrix functions
+        void                                calculateBatchTransitionProbabilities(const std::vector<double> &t, std::vector<TransitionProbabilityMatrix*> &P) const; //!< Calculate the transition matrices for several times at once
         void                                calculateTransitionProbabilities(double startAge, double endAge, double rate, TransitionProbabilityMatrix& P) const;   //!< Calculate the transition matrix
         RateMatrix_FreeK*                   clone(void) const;
         void                                fillRateMatrix(void);
@@ -123,6 +123,21 @@ void RateMatrix_GTR::calculateCijk(void)
 }
 
 
+/** Calculate the transition probabilities for several times in one pass over the eigen system */
+void RateMatrix_GTR::calculateBatchTransitionProbabilities(const std::vector<double> &t, std::vector<TransitionProbabilityMatrix*> &P) const
+{
+    if ( theEigenSystem->isComplex() == false )
+    {
+        tiProbsEigensBatch( theEigenSystem->getRealEigenvalues(), c_ijk, t, P );
+    }
+    else
+    {
+        tiProbsComplexEigensBatch( theEigenSystem->getRealEigenvalues(), theEigenSystem->getImagEigenvalues(), cc_ijk, t, P );
+    }
+    
+}
+
+
 /** Calculate the transition probabilities */
 void RateMatrix_GTR::calculateTransitionProbabilities(double startAge, double endAge, double rate, TransitionProbabilityMatrix& P) const
 {
@@ -0,0 +1,43 @@
+#ifndef RegraftLikelihoodEvaluator_H
+#define RegraftLikelihoodEvaluator_H
+
+#include <vector>
+
+namespace RevBayesCore {
+
+    class DagNode;
+    class TopologyNode;
+
+    /**
+     * @brief Interface for distributions on a tree that can evaluate many regraft positions at once.
+     *
+     * Gibbs-like tree proposals (e.g. the GibbsPruneAndRegraftProposal) need the probability of every tree
+     * obtained by pruning a subtree and regrafting it at one of many places. Moving the subtree and recomputing
+     * the distribution costs a traversal of the tree for each re-attachment point. A distribution that caches
+     * its partial likelihoods can instead combine them with one pre-order pass and evaluate each re-attachment point
+     * in constant time per site pattern.
+     *
+     * The subtree is pruned together with its parent, and the parent keeps its age.
+     * A distribution may decline (return false), e.g., if its cached values are not up to date or if its
+     * model is not supported. The caller then needs to fall back to the regular computation.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since Version 1.0, 2026-10-18
+     *
+     */
+    class RegraftLikelihoodEvaluator {
+
+    public:
+        // constructors and destructors
+        RegraftLikelihoodEvaluator(void) {}
+        virtual                                    ~RegraftLikelihoodEvaluator(void) {}
+
+        // public pure virtual methods
+        virtual bool                                computeRegraftLnProbabilities(const DagNode *tree, const TopologyNode &pruned, const std::vector<TopologyNode*> &targets, std::vector<double> &ln_probs) = 0;    //!< ln-probabilities if the parent of 'pruned' was moved onto the branch above each target
+
+    };
+
+}
+
+#endif
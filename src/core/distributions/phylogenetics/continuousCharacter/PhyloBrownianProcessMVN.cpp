@@ -1,8 +1,6 @@
 #include "ConstantNode.h"
+#include "DistributionNormal.h"
 #include "PhyloBrownianProcessMVN.h"
-#include "DistributionMultivariateNormal.h"
-#include "RandomNumberFactory.h"
-#include "RandomNumberGenerator.h"
 #include "RbException.h"
 #include "StochasticNode.h"
 #include "TopologyNode.h"
@@ -12,87 +10,26 @@
 
 using namespace RevBayesCore;
 
-PhyloBrownianProcessMVN::PhyloBrownianProcessMVN(const TypedDagNode<Tree> *t, size_t ns) : AbstractPhyloBrownianProcess( t, ns ),
-    num_tips( t->getValue().getNumberOfTips() ),
-    obs( std::vector<std::vector<double> >(this->num_sites, std::vector<double>(num_tips, 0.0) ) ),
-    phylogenetic_covariance_matrix( new MatrixReal(num_tips, num_tips) ),
-    stored_phylogenetic_covariance_matrix( new MatrixReal(num_tips, num_tips) ),
-    inverse_phylogenetic_covariance_matrix( num_tips, num_tips ),
-    changed_covariance(false),
-    needs_covariance_recomputation( true ),
-    needs_scale_recomputation( true )
+PhyloBrownianProcessMVN::PhyloBrownianProcessMVN(const TypedDagNode<Tree> *t, size_t ns) : PhyloBrownianProcessREML( t, ns )
 {
     homogeneous_root_state      = new ConstantNode<double>("", new double(0.0) );
     heterogeneous_root_state    = NULL;
 
     addParameter( homogeneous_root_state );
-    phylogenetic_covariance_matrix->setCholesky( true );
-    stored_phylogenetic_covariance_matrix->setCholesky( true );
     
     // now we need to reset the value
     this->redrawValue();
 }
 
 
-PhyloBrownianProcessMVN::PhyloBrownianProcessMVN(const PhyloBrownianProcessMVN &p) : AbstractPhyloBrownianProcess( p ),
-    homogeneous_root_state( p.homogeneous_root_state ),
-    heterogeneous_root_state( p.heterogeneous_root_state ),
-    num_tips( p.num_tips ),
-    obs( p.obs ),
-    phylogenetic_covariance_matrix( p.phylogenetic_covariance_matrix->clone() ),
-    stored_phylogenetic_covariance_matrix( p.stored_phylogenetic_covariance_matrix->clone() ),
-    inverse_phylogenetic_covariance_matrix( p.inverse_phylogenetic_covariance_matrix ),
-    changed_covariance( p.changed_covariance ),
-    needs_covariance_recomputation( p.needs_covariance_recomputation ),
-    needs_scale_recomputation( p.needs_scale_recomputation )
-{
-    
-}
-
-
-/**
- * Destructor. Because we added ourselves as a reference to tau when we added a listener to its
- * TreeChangeEventHandler, we need to remove ourselves as a reference and possibly delete tau
- * when we die. All other parameters are handled by others.
- */
 PhyloBrownianProcessMVN::~PhyloBrownianProcessMVN( void )
 {
     // We don't delete the params, because they might be used somewhere else too. The model needs to do that!
-    delete phylogenetic_covariance_matrix;
-    delete stored_phylogenetic_covariance_matrix;
     
 }
 
 
 
-PhyloBrownianProcessMVN& PhyloBrownianProcessMVN::operator=(const PhyloBrownianProcessMVN &p)
-
-{
-    
-    if ( this != &p )
-    {
-        AbstractPhyloBrownianProcess::operator=( p );
-        
-        delete phylogenetic_covariance_matrix;
-        delete stored_phylogenetic_covariance_matrix;
-        
-        homogeneous_root_state                      = p.homogeneous_root_state;
-        heterogeneous_root_state                    = p.heterogeneous_root_state;
-        num_tips                                    = p.num_tips;
-        obs                                         = p.obs;
-        phylogenetic_covariance_matrix              = p.phylogenetic_covariance_matrix->clone();
-        stored_phylogenetic_covariance_matrix       = p.stored_phylogenetic_covariance_matrix->clone();
-        inverse_phylogenetic_covariance_matrix      = p.inverse_phylogenetic_covariance_matrix;
-        changed_covariance                          = p.changed_covariance;
-        needs_covariance_recomputation              = p.needs_covariance_recomputation;
-        needs_scale_recomputation                   = p.needs_scale_recomputation;
-    }
-    
-    return *this;
-}
-
-
-
 PhyloBrownianProcessMVN* PhyloBrownianProcessMVN::clone( void ) const
 {
     
@@ -100,34 +37,6 @@ PhyloBrownianProcessMVN* PhyloBrownianProcessMVN::clone( void ) const
 }
 
 
-double PhyloBrownianProcessMVN::computeLnProbability( void )
-{
-    
-    // compute the ln probability by recursively calling the probability calculation for each node
-    const TopologyNode &root = this->tau->getValue().getRoot();
-    
-    // we start with the root and then traverse down the tree
-    size_t rootIndex = root.getIndex();
-    
-    if ( needs_covariance_recomputation == true )
-    {
-        // perhaps there is a more efficient way to reset the matrix to 0.
-        delete phylogenetic_covariance_matrix;
-        phylogenetic_covariance_matrix = new MatrixReal(num_tips, num_tips);
-        phylogenetic_covariance_matrix->setCholesky( true );
-        recursiveComputeCovarianceMatrix(*phylogenetic_covariance_matrix, root, rootIndex);
-        needs_covariance_recomputation = false;
-        inverse_phylogenetic_covariance_matrix = phylogenetic_covariance_matrix->computeInverse();
-        inverse_phylogenetic_covariance_matrix.setCholesky( true );
-    }
-    
-    // sum the partials up
-    this->ln_prob = sumRootLikelihood();
-    
-    return this->ln_prob;
-}
-
-
 double PhyloBrownianProcessMVN::computeRootState(size_t siteIdx)
 {
     
@@ -146,140 +55,6 @@ double PhyloBrownianProcessMVN::computeRootState(size_t siteIdx)
 }
 
 
-
-
-void PhyloBrownianProcessMVN::keepSpecialization( DagNode* affecter )
-{
-    
-    // reset the flags
-    changed_covariance = false;
-    needs_covariance_recomputation = false;
-    
-}
-
-
-void PhyloBrownianProcessMVN::resetValue( void )
-{
-    
-    // create a vector with the correct site indices
-    // some of the sites may have been excluded
-    std::vector<size_t> site_indices = std::vector<size_t>(this->num_sites,0);
-    size_t site_index = 0;
-    for (size_t i = 0; i < this->num_sites; ++i)
-    {
-        while ( this->value->isCharacterExcluded(site_index) )
-        {
-            ++site_index;
-            if ( site_index >= this->value->getNumberOfCharacters()  )
-            {
-                throw RbException( "The character matrix cannot set to this variable because it does not have enough included characters." );
-            }
-        }
-        site_indices[i] = site_index;
-        ++site_index;
-    }
-    
-    obs = std::vector<std::vector<double> >(this->num_sites, std::vector<double>(num_tips, 0.0) );
-    
-    std::vector<TopologyNode*> nodes = this->tau->getValue().getNodes();
-    for (size_t site = 0; site < this->num_sites; ++site)
-    {
-        
-        for (std::vector<TopologyNode*>::iterator it = nodes.begin(); it != nodes.end(); ++it)
-        {
-            if ( (*it)->isTip() )
-            {
-                ContinuousTaxonData& taxon = this->value->getTaxonData( (*it)->getName() );
-                double &c = taxon.getCharacter(site_indices[site]);
-                obs[site][(*it)->getIndex()] = c;
-            }
-        }
-    }
-    
-    
-    // finally we set all the flags for recomputation
-    needs_covariance_recomputation = true;
-    needs_scale_recomputation = true;
-    
-}
-
-
-std::set<size_t> PhyloBrownianProcessMVN::recursiveComputeCovarianceMatrix(MatrixReal &m, const TopologyNode &node, size_t node_index)
-{
-    
-    // I need to know all my children
-    std::set<size_t> children;
-    
-    if ( node.isRoot() == false )
-    {
-        // get my scaled branch length
-        double v = this->computeBranchTime(node_index, node.getBranchLength() );
-        
-        if ( node.isTip() )
-        {
-            children.insert( node_index );
-            m[node_index][node_index] += v;
-        }
-        else
-        {
-            const TopologyNode &left = node.getChild(0);
-            size_t left_index = left.getIndex();
-            children = recursiveComputeCovarianceMatrix(m, left, left_index );
-            
-            const TopologyNode &right = node.getChild(1);
-            size_t right_index = right.getIndex();
-            std::set<size_t> childrenRight = recursiveComputeCovarianceMatrix(m, right, right_index );
-            
-            children.insert(childrenRight.begin(), childrenRight.end());
-            
-            // now we loop over all combination of the children pairs to add their variance terms
-            for (std::set<size_t>::iterator i_itr = children.begin(); i_itr != children.end(); ++i_itr)
-            {
-                for (std::set<size_t>::iterator j_itr = children.begin(); j_itr != children.end(); ++j_itr)
-                {
-                    m[*i_itr][*j_itr] += v;
-                }
-            }
-            
-        }
-        
-    }
-    else // this is the root node
-    {
-        
-        for (size_t i = 0; i < node.getNumberOfChildren(); ++i)
-        {
-            const TopologyNode &child = node.getChild(i);
-            size_t childIndex = child.getIndex();
-            std::set<size_t> childrenRight = recursiveComputeCovarianceMatrix(m, child, childIndex );
-        }
-        
-    }
-    
-    return children;
-    
-}
-
-
-
-void PhyloBrownianProcessMVN::restoreSpecialization( DagNode* affecter )
-{
-    
-    // reset the flags
-    if ( changed_covariance == true )
-    {
-        changed_covariance = false;
-        needs_covariance_recomputation = false;
-        
-        MatrixReal *tmp = phylogenetic_covariance_matrix;
-        phylogenetic_covariance_matrix = stored_phylogenetic_covariance_matrix;
-        stored_phylogenetic_covariance_matrix = tmp;
-        
-    }
-    
-}
-
-
 void PhyloBrownianProcessMVN::setRootState(const TypedDagNode<double> *s)
 {
     
@@ -343,17 +118,33 @@ std::vector<double> PhyloBrownianProcessMVN::simulateRootCharacters(size_t n)
 }
 
 
+/**
+ * The pruning algorithm gives us the probability of the contrasts (the REML likelihood)
+ * together with the estimate of the root value and its variance.
+ * Multiplying with the density of the root state given this estimate gives the full multivariate normal likelihood.
+ */
 double PhyloBrownianProcessMVN::sumRootLikelihood( void )
 {
+    // get the root node
+    const TopologyNode &root = this->tau->getValue().getRoot();
+    
+    // get the index of the root node
+    size_t node_index = root.getIndex();
+    
+    // get the partial likelihoods, the root estimates and their variance
+    const std::vector<double> &p_node  = this->partial_likelihoods[this->active_likelihood[node_index]][node_index];
+    const std::vector<double> &mu_node = this->contrasts[this->active_likelihood[node_index]][node_index];
+    double delta_node = this->contrast_uncertainty[this->active_likelihood[node_index]][node_index];
+    double stdev = sqrt( delta_node );
     
     // sum the log-likelihoods for all sites together
     double sum_site_probs = 0.0;
     for (size_t site = 0; site < this->num_sites; ++site)
     {
-        std::vector<double> m = std::vector<double>(num_tips, computeRootState(site) );
+        double root_state = computeRootState(site);
+        double standDev = this->computeSiteRate(site) * stdev;
         
-        double sr = this->computeSiteRate(site);
-        sum_site_probs += RbStatistics::MultivariateNormal::lnPdfPrecision(m, inverse_phylogenetic_covariance_matrix, obs[site], sr*sr);
+        sum_site_probs += p_node[site] + RbStatistics::Normal::lnPdf(root_state, standDev, mu_node[site]);
     }
     
     return sum_site_probs;
@@ -363,56 +154,14 @@ double PhyloBrownianProcessMVN::sumRootLikelihood( void )
 void PhyloBrownianProcessMVN::touchSpecialization( DagNode* affecter, bool touchAll )
 {
     
-    // if the topology wasn't the culprit for the touch, then we just flag everything as dirty
-    if ( affecter == homogeneous_root_state )
-    {
-        
-        
-    }
-    else if ( affecter == heterogeneous_root_state )
-    {
-        
-        
-    }
-    else if ( affecter == this->homogeneous_clock_rate )
+    // the root state only enters at the root, so we only need to recompute the root
+    if ( touchAll == false && ( affecter == homogeneous_root_state || affecter == heterogeneous_root_state ) )
     {
-        needs_covariance_recomputation = true;
-        if ( changed_covariance == false )
-        {
-            MatrixReal *tmp = phylogenetic_covariance_matrix;
-            phylogenetic_covariance_matrix = stored_phylogenetic_covariance_matrix;
-            stored_phylogenetic_covariance_matrix = tmp;
-        }
-        changed_covariance = true;
-        
-    }
-    else if ( affecter == this->heterogeneous_clock_rates )
-    {
-        needs_covariance_recomputation = true;
-        if ( changed_covariance == false )
-        {
-            MatrixReal *tmp = phylogenetic_covariance_matrix;
-            phylogenetic_covariance_matrix = stored_phylogenetic_covariance_matrix;
-            stored_phylogenetic_covariance_matrix = tmp;
-        }
-        changed_covariance = true;
-        
+        this->recursivelyFlagNodeDirty( this->tau->getValue().getRoot() );
     }
-    else if ( affecter == this->tau )
-    {
-        needs_covariance_recomputation = true;
-        if ( changed_covariance == false )
-        {
-            MatrixReal *tmp = phylogenetic_covariance_matrix;
-            phylogenetic_covariance_matrix = stored_phylogenetic_covariance_matrix;
-            stored_phylogenetic_covariance_matrix = tmp;
-        }
-        changed_covariance = true;
-        
-    }
-    else if ( affecter != this->tau ) // if the topology wasn't the culprit for the touch, then we just flag everything as dirty
+    else
     {
-        touchAll = true;
+        PhyloBrownianProcessREML::touchSpecialization( affecter, touchAll );
     }
     
 }
@@ -432,9 +181,7 @@ void PhyloBrownianProcessMVN::swapParameterInternal(const DagNode *oldP, const D
     }
     else
     {
-        AbstractPhyloBrownianProcess::swapParameterInternal(oldP, newP);
+        PhyloBrownianProcessREML::swapParameterInternal(oldP, newP);
     }
     
 }
-
-
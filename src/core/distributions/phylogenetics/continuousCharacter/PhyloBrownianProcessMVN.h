@@ -1,8 +1,7 @@
 #ifndef PhyloBrownianProcessMVN_H
 #define PhyloBrownianProcessMVN_H
 
-#include "AbstractPhyloBrownianProcess.h"
-#include "MatrixReal.h"
+#include "PhyloBrownianProcessREML.h"
 
 #include <vector>
 
@@ -11,38 +10,34 @@ namespace RevBayesCore {
     /**
      * @brief Homogeneous distribution of character state evolution along a tree class (PhyloCTMC).
      *
-     *
+     * The tip values follow a multivariate normal distribution with the root state as the mean
+     * and the (scaled) phylogenetic covariance matrix as the covariance.
+     * Instead of building and inverting the covariance matrix, we use the pruning algorithm of the REML process
+     * and add the density of the root state given the contrast at the root.
+     * This gives the same likelihood in linear time, and only the nodes on the path to the root
+     * need to be recomputed when a branch or a clock rate changes.
      *
      * @copyright Copyright 2009-
      * @author The RevBayes Development Core Team (Sebastian Hoehna)
      * @since 2015-01-23, version 1.0
      */
-    class PhyloBrownianProcessMVN : public AbstractPhyloBrownianProcess {
+    class PhyloBrownianProcessMVN : public PhyloBrownianProcessREML {
         
     public:
         // Note, we need the size of the alignment in the constructor to correctly simulate an initial state
         PhyloBrownianProcessMVN(const TypedDagNode<Tree> *t, size_t nSites );
-        PhyloBrownianProcessMVN(const PhyloBrownianProcessMVN &p);
         virtual                                                            ~PhyloBrownianProcessMVN(void);                                                              //!< Virtual destructor
         
-        PhyloBrownianProcessMVN&                                            operator=(const PhyloBrownianProcessMVN &p);
-
-        
         // public member functions
         // pure virtual
         virtual PhyloBrownianProcessMVN*                                    clone(void) const;                                                                      //!< Create an independent clone
         
         // non-virtual
-        double                                                              computeLnProbability(void);
         void                                                                setRootState(const TypedDagNode< double >* s);
         void                                                                setRootState(const TypedDagNode< RbVector< double > >* s);
         
     protected:
         // virtual methods that may be overwritten, but then the derived class should call this methods
-        virtual void                                                        keepSpecialization(DagNode* affecter);
-        void                                                                recursivelyFlagNodeDirty(const TopologyNode& n);
-        void                                                                resetValue( void );
-        virtual void                                                        restoreSpecialization(DagNode *restorer);
         std::vector<double>                                                 simulateRootCharacters(size_t n);
         double                                                              sumRootLikelihood(void);
         virtual void                                                        touchSpecialization(DagNode *toucher, bool touchAll);
@@ -52,19 +47,10 @@ namespace RevBayesCore {
         
     private:
         double                                                              computeRootState(size_t siteIdx);
-        std::set<size_t>                                                    recursiveComputeCovarianceMatrix( MatrixReal &m, const TopologyNode &node, size_t node_index );
         
         const TypedDagNode< double >*                                       homogeneous_root_state;
         const TypedDagNode< RbVector< double > >*                           heterogeneous_root_state;
         
-        size_t                                                              num_tips;
-        std::vector<std::vector<double> >                                   obs;
-        MatrixReal*                                                         phylogenetic_covariance_matrix;
-        MatrixReal*                                                         stored_phylogenetic_covariance_matrix;
-        MatrixReal                                                          inverse_phylogenetic_covariance_matrix;
-        bool                                                                changed_covariance;
-        bool                                                                needs_covariance_recomputation;
-        bool                                                                needs_scale_recomputation;
     };
     
 }
@@ -12,6 +12,7 @@
 #include "RbSettings.h"
 #include "RbVector.h"
 #include "RateGenerator.h"
+#include "RegraftLikelihoodEvaluator.h"
 #include "Simplex.h"
 #include "TopologyNode.h"
 #include "TransitionProbabilityMatrix.h"
@@ -19,6 +20,7 @@
 #include "TreeChangeEventListener.h"
 #include "TypedDistribution.h"
 
+#include <functional>
 #include <memory.h>
 
 namespace RevBayesCore {
@@ -64,9 +66,21 @@ namespace RevBayesCore {
      * We also use twice as much memory because we store the partial likelihood along each branch and not only for each internal node.
      * This gives us a speed improvement during MCMC proposal in the order of a factor 2.
      *
+     * The site patterns of this process (pattern_block_start to pattern_block_end) can further be split into
+     * sub-blocks that are computed by the shared thread pool (see the user option 'numThreads').
+     * Each pattern is computed independently, so the kernels only need to loop over the sub-block
+     * they are given by computeForPatternBlocks(). The per-site log-likelihoods are still summed
+     * in pattern order, so the result does not depend on the number of threads.
+     *
+     * Derived classes may opt in to store the partial likelihoods in single precision (see the user option 'useSinglePrecision')
+     * by setting use_single_precision in their constructor and writing into partialLikelihoodsSinglePrecision instead.
+     * This halves the memory (bandwidth) needed for large state spaces, e.g., amino-acid and codon models.
+     * In single precision we rescale at every node, because float underflows much sooner than double.
+     * The partials are only stored as float; all sums, and in particular the accumulation at the root, are computed in double.
+     *
      */
     template<class charType>
-    class AbstractPhyloCTMCSiteHomogeneous : public TypedDistribution< AbstractHomologousDiscreteCharacterData >, public MemberObject< RbVector<double> >, public MemberObject < MatrixReal >, public TreeChangeEventListener {
+    class AbstractPhyloCTMCSiteHomogeneous : public TypedDistribution< AbstractHomologousDiscreteCharacterData >, public MemberObject< RbVector<double> >, public MemberObject < MatrixReal >, public TreeChangeEventListener, public RegraftLikelihoodEvaluator {
 
     public:
         // Note, we need the size of the alignment in the constructor to correctly simulate an initial state
@@ -81,6 +95,7 @@ namespace RevBayesCore {
         // non-virtual
         void                                                                bootstrap(void);
         virtual double                                                      computeLnProbability(void);
+        virtual bool                                                        computeRegraftLnProbabilities(const DagNode *tree, const TopologyNode &pruned, const std::vector<TopologyNode*> &targets, std::vector<double> &ln_probs);   //!< ln-likelihoods of regrafting the parent of 'pruned' above each target, computed from the cached partial likelihoods
         virtual std::vector<charType>                                       drawAncestralStatesForNode(const TopologyNode &n);
         virtual void                                                        drawJointConditionalAncestralStates(std::vector<std::vector<charType> >& startStates, std::vector<std::vector<charType> >& endStates);
         virtual void                                                        drawStochasticCharacterMap(std::vector<std::string*>& character_histories, size_t site, bool use_simmap_default=true);
@@ -112,6 +127,17 @@ namespace RevBayesCore {
     protected:
 
         // helper method for this and derived classes
+        void                                                                allocatePartialLikelihoods(void) const;                                                 //!< Allocate the partial likelihoods in the precision we use
+        void                                                                calculateTransitionProbabilities(const RateGenerator &rm, const std::vector<double> &start_ages, const std::vector<double> &end_ages, const std::vector<double> &rates, std::vector<TransitionProbabilityMatrix*> &P) const;    //!< Compute several P at once or take them from the transition probability cache
+        void                                                                computeBranchTransitionProbabilities(const std::vector<size_t> &node_indices, const std::vector<double> &start_ages, const std::vector<double> &end_ages, std::vector<TransitionProbabilityMatrix> &P) const;  //!< Compute the matrices of all mixture categories for branches with the rate of the given nodes but arbitrary ages
+        void                                                                computeForPatternBlocks(const std::function<void (size_t, size_t)> &f) const;           //!< Apply f(begin,end) to sub-blocks of our patterns, possibly in parallel
+        void                                                                freePartialLikelihoods(void) const;                                                     //!< Free the partial likelihoods
+        const double*                                                       getNodePartialLikelihoods(size_t node_index, std::vector<double> &buffer) const;        //!< Get the partial likelihoods of a node in double precision (converted into the buffer if necessary)
+        size_t                                                              getPartialLikelihoodOffset(size_t node_index) const;                                    //!< The offset of the active partial likelihoods of this node
+        bool                                                                getTipStateLikelihoods(size_t node_index, std::vector<double> &likelihoods) const;      //!< The likelihoods of the data at a tip given each of its states (without the branch above)
+        void                                                                getBranchRateAndAges(size_t node_idx, double &rate, double &start_age, double &end_age) const;  //!< The clock rate (corrected for invariant sites) and the ages of the branch above this node
+        bool                                                                isUsingScaling(void) const;                                                             //!< Do we rescale the partial likelihoods?
+        void                                                                precomputeTransitionProbabilities(void);                                                //!< Compute the transition probabilities of all branches in one batch
         void                                                                recursivelyFlagNodeDirty(const TopologyNode& n);
         virtual void                                                        resizeLikelihoodVectors(void);
         virtual void                                                        setActivePIDSpecialized(size_t i, size_t n);                                                 //!< Set the number of processes for this distribution.
@@ -121,6 +147,7 @@ namespace RevBayesCore {
         virtual void                                                        getRootFrequencies( std::vector<std::vector<double> >& ) const;
         virtual std::vector<double>                                         getMixtureProbs( void ) const;
         virtual double                                                      getPInv(void) const;
+        std::vector<double>                                                 getInvariantSiteFrequencies(void) const;                                                //!< The mean root frequencies used for invariant sites
 
 
         // Parameter management functions.
@@ -165,6 +192,7 @@ namespace RevBayesCore {
 
         // the likelihoods
         mutable double*                                                     partialLikelihoods;
+        mutable float*                                                      partialLikelihoodsSinglePrecision;
         std::vector<size_t>                                                 activeLikelihood;
         double*                                                             marginalLikelihoods;
 
@@ -186,6 +214,8 @@ namespace RevBayesCore {
         bool                                                                touched;
         std::vector<bool>                                                   changed_nodes;
         mutable std::vector<bool>                                           dirty_nodes;
+        std::vector<TransitionProbabilityMatrix>                            precomputed_transition_prob_matrices;           //!< The transition probabilities of all branches if the whole tree is recomputed
+        bool                                                                use_precomputed_transition_probabilities;
 
         // offsets for nodes
         size_t                                                              activeLikelihoodOffset;
@@ -202,6 +232,7 @@ namespace RevBayesCore {
 
         bool                                                                useMarginalLikelihoods;
         mutable bool                                                        in_mcmc_mode;
+        bool                                                                use_single_precision;                           //!< Are the partial likelihoods stored in partialLikelihoodsSinglePrecision?
 
         // members
         const TypedDagNode< double >*                                       homogeneous_clock_rate;
@@ -238,6 +269,8 @@ namespace RevBayesCore {
         virtual void                                                        scale(size_t i);
         virtual void                                                        scale(size_t i, size_t l, size_t r);
         virtual void                                                        scale(size_t i, size_t l, size_t r, size_t m);
+        template<class partialType>
+        void                                                                scalePartialLikelihoods(partialType *p_node, std::vector<double> &node_scaling_factors);
         void                                                                simulate(const TopologyNode& node, std::vector< DiscreteTaxonData< charType > > &t, const std::vector<bool> &inv, const std::vector<size_t> &perSiteRates);
 
 
@@ -253,10 +286,14 @@ namespace RevBayesCore {
 #include "RandomNumberFactory.h"
 #include "RandomNumberGenerator.h"
 #include "RateMatrix_JC.h"
+#include "SitePatternCompressor.h"
 #include "StochasticNode.h"
+#include "ThreadPool.h"
 #include "TopologyNode.h"
 #include "TransitionProbabilityMatrix.h"
+#include "TransitionProbabilityMatrixCache.h"
 
+#include <algorithm>
 #include <cmath>
 
 #ifdef RB_MPI
@@ -279,6 +316,7 @@ tau( t ),
 transition_prob_matrices( std::vector<TransitionProbabilityMatrix>(num_site_mixtures, TransitionProbabilityMatrix(num_chars) ) ),
 //    partialLikelihoods( new double[2*num_nodes*num_site_mixtures*num_sites*num_chars] ),
 partialLikelihoods( NULL ),
+partialLikelihoodsSinglePrecision( NULL ),
 activeLikelihood( std::vector<size_t>(num_nodes, 0) ),
 //    marginalLikelihoods( new double[num_nodes*num_site_mixtures*num_sites*num_chars] ),
 marginalLikelihoods( NULL ),
@@ -296,12 +334,15 @@ taxon_name_2_tip_index_map(),
 touched( false ),
 changed_nodes( std::vector<bool>(num_nodes, false) ),
 dirty_nodes( std::vector<bool>(num_nodes, true) ),
+precomputed_transition_prob_matrices(),
+use_precomputed_transition_probabilities( false ),
 using_ambiguous_characters( amb ),
 treatUnknownAsGap( true ),
 treatAmbiguousAsGaps( false ),
 using_weighted_characters( wd ),
 useMarginalLikelihoods( false ),
 in_mcmc_mode( false ),
+use_single_precision( false ),
 pattern_block_start( 0 ),
 pattern_block_end( num_patterns ),
 pattern_block_size( num_patterns ),
@@ -370,6 +411,7 @@ tau( n.tau ),
 transition_prob_matrices( n.transition_prob_matrices ),
 //    partialLikelihoods( new double[2*num_nodes*num_site_mixtures*num_sites*num_chars] ),
 partialLikelihoods( NULL ),
+partialLikelihoodsSinglePrecision( NULL ),
 activeLikelihood( n.activeLikelihood ),
 //    marginalLikelihoods( new double[num_nodes*num_site_mixtures*num_sites*num_chars] ),
 marginalLikelihoods( NULL ),
@@ -387,12 +429,15 @@ taxon_name_2_tip_index_map( n.taxon_name_2_tip_index_map ),
 touched( false ),
 changed_nodes( n.changed_nodes ),
 dirty_nodes( n.dirty_nodes ),
+precomputed_transition_prob_matrices(),
+use_precomputed_transition_probabilities( false ),
 using_ambiguous_characters( n.using_ambiguous_characters ),
 treatUnknownAsGap( n.treatUnknownAsGap ),
 treatAmbiguousAsGaps( n.treatAmbiguousAsGaps ),
 using_weighted_characters( n.using_weighted_characters ),
 useMarginalLikelihoods( n.useMarginalLikelihoods ),
 in_mcmc_mode( n.in_mcmc_mode ),
+use_single_precision( n.use_single_precision ),
 pattern_block_start( n.pattern_block_start ),
 pattern_block_end( n.pattern_block_end ),
 pattern_block_size( n.pattern_block_size ),
@@ -427,8 +472,15 @@ template_state( n.template_state )
     // copy the partial likelihoods if necessary
     if ( in_mcmc_mode == true )
     {
-        partialLikelihoods = new double[2*activeLikelihoodOffset];
-        memcpy(partialLikelihoods, n.partialLikelihoods, 2*activeLikelihoodOffset*sizeof(double));
+        allocatePartialLikelihoods();
+        if ( use_single_precision == true )
+        {
+            memcpy(partialLikelihoodsSinglePrecision, n.partialLikelihoodsSinglePrecision, 2*activeLikelihoodOffset*sizeof(float));
+        }
+        else
+        {
+            memcpy(partialLikelihoods, n.partialLikelihoods, 2*activeLikelihoodOffset*sizeof(double));
+        }
     }
 
     // copy the marginal likelihoods if necessary
@@ -457,7 +509,7 @@ RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::~AbstractPhyloCTMCSite
     }
 
     // free the partial likelihoods
-    delete [] partialLikelihoods;
+    freePartialLikelihoods();
     delete [] marginalLikelihoods;
 }
 
@@ -518,36 +570,44 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
     // some of the sites may have been excluded
     std::vector<size_t> site_indices = getIncludedSiteIndices();
 
+    // get the data of the tips once instead of looking them up by name for every site
+    std::vector<TopologyNode*> nodes = tau->getValue().getNodes();
+    std::vector<AbstractDiscreteTaxonData*> tip_data;
+    for (std::vector<TopologyNode*>::iterator it = nodes.begin(); it != nodes.end(); ++it)
+    {
+        if ( (*it)->isTip() )
+        {
+            tip_data.push_back( &value->getTaxonData( (*it)->getName() ) );
+        }
+    }
+
     // check whether there are ambiguous characters (besides gaps)
     bool ambiguousCharacters = false;
 
     // find the unique site patterns and compute their respective frequencies
-    std::vector<TopologyNode*> nodes = tau->getValue().getNodes();
     for (size_t site = 0; site < num_sites; ++site)
     {
 
-        for (std::vector<TopologyNode*>::iterator it = nodes.begin(); it != nodes.end(); ++it)
+        for (size_t tip = 0; tip < tip_data.size(); ++tip)
         {
-            if ( (*it)->isTip() )
-            {
-                AbstractDiscreteTaxonData& taxon = value->getTaxonData( (*it)->getName() );
-                DiscreteCharacterState &c = taxon.getCharacter(site_indices[site]);
+            // we only ask for a changeable character if we need to change it, because the characters are shared
+            const AbstractDiscreteTaxonData &taxon = *tip_data[tip];
+            const DiscreteCharacterState &c = taxon.getCharacter(site_indices[site]);
 
-                // if we treat unknown characters as gaps and this is an unknown character then we change it
-                // because we might then have a pattern more
-                if ( treatAmbiguousAsGaps && (c.isAmbiguous() || c.isMissingState()) )
-                {
-                    c.setGapState( true );
-                }
-                else if ( treatUnknownAsGap && (c.getNumberOfStates() == c.getNumberObservedStates() || c.isMissingState()) )
-                {
-                    c.setGapState( true );
-                }
-                else if ( !c.isGapState() && (c.isAmbiguous() || c.isMissingState()) )
-                {
-                    ambiguousCharacters = true;
-                    break;
-                }
+            // if we treat unknown characters as gaps and this is an unknown character then we change it
+            // because we might then have a pattern more
+            if ( treatAmbiguousAsGaps && (c.isAmbiguous() || c.isMissingState()) )
+            {
+                tip_data[tip]->getCharacter(site_indices[site]).setGapState( true );
+            }
+            else if ( treatUnknownAsGap && (c.getNumberOfStates() == c.getNumberObservedStates() || c.isMissingState()) )
+            {
+                tip_data[tip]->getCharacter(site_indices[site]).setGapState( true );
+            }
+            else if ( !c.isGapState() && (c.isAmbiguous() || c.isMissingState()) )
+            {
+                ambiguousCharacters = true;
+                break;
             }
         }
 
@@ -567,18 +627,15 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
     for (size_t site = 0; site < num_sites; ++site)
     {
 
-        for (std::vector<TopologyNode*>::iterator it = nodes.begin(); it != nodes.end(); ++it)
+        for (size_t tip = 0; tip < tip_data.size(); ++tip)
         {
-            if ( (*it)->isTip() )
-            {
-                AbstractDiscreteTaxonData& taxon = value->getTaxonData( (*it)->getName() );
-                DiscreteCharacterState &c = taxon.getCharacter(site_indices[site]);
+            const AbstractDiscreteTaxonData &taxon = *tip_data[tip];
+            const DiscreteCharacterState &c = taxon.getCharacter(site_indices[site]);
 
-                if ( c.isWeighted() )
-                {
-                    weightedCharacters = true;
-                    break;
-                }
+            if ( c.isWeighted() )
+            {
+                weightedCharacters = true;
+                break;
             }
         }
 
@@ -592,62 +649,16 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
     // set the global variable if we use ambiguous characters
     using_weighted_characters = weightedCharacters;
 
-    std::vector<bool> unique(num_sites, true);
     std::vector<size_t> indexOfSitePattern;
 
     // compress the character matrix if we're asked to
     if ( compressed == true )
     {
         // find the unique site patterns and compute their respective frequencies
-        std::map<std::string,size_t> patterns;
-        for (size_t site = 0; site < num_sites; ++site)
-        {
-            // create the site pattern
-            std::string pattern = "";
-            for (std::vector<TopologyNode*>::iterator it = nodes.begin(); it != nodes.end(); ++it)
-            {
-                if ( (*it)->isTip() )
-                {
-                    AbstractDiscreteTaxonData& taxon = value->getTaxonData( (*it)->getName() );
-                    CharacterState &c = taxon.getCharacter(site_indices[site]);
-                    pattern += c.getStringValue();
-                }
-            }
-            // check if we have already seen this site pattern
-            std::map<std::string, size_t>::const_iterator index = patterns.find( pattern );
-            if ( index != patterns.end() )
-            {
-                // we have already seen this pattern
-                // increase the frequency counter
-                pattern_counts[ index->second ]++;
-
-                // obviously this site isn't unique nor the first encounter
-                unique[site] = false;
-
-                // remember which pattern this site uses
-                site_pattern[site] = index->second;
-            }
-            else
-            {
-                // create a new pattern frequency counter for this pattern
-                pattern_counts.push_back(1);
-
-                // insert this pattern with the corresponding index in the map
-                patterns.insert( std::pair<std::string,size_t>(pattern,num_patterns) );
-
-                // remember which pattern this site uses
-                site_pattern[site] = num_patterns;
-
-                // increase the pattern counter
-                num_patterns++;
-
-                // add the index of the site to our pattern-index vector
-                indexOfSitePattern.push_back( site );
-
-                // flag that this site is unique (or the first occurence of this pattern)
-                unique[site] = true;
-            }
-        }
+        std::vector<const AbstractDiscreteTaxonData*> taxa( tip_data.begin(), tip_data.end() );
+        SitePatternCompressor compressor( taxa, site_indices );
+        compressor.compress( pattern_counts, site_pattern, indexOfSitePattern );
+        num_patterns = pattern_counts.size();
     }
     else
     {
@@ -678,36 +689,58 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
         {
             size_t node_index = the_node->getIndex();
             taxon_name_2_tip_index_map.insert( std::pair<std::string,size_t>(the_node->getName(), node_index) );
-            AbstractDiscreteTaxonData& taxon = value->getTaxonData( the_node->getName() );
+            const AbstractDiscreteTaxonData& taxon = value->getTaxonData( the_node->getName() );
 
             // resize the column
             ambiguous_char_matrix[node_index].resize(pattern_block_size);
             char_matrix[node_index].resize(pattern_block_size);
             gap_matrix[node_index].resize(pattern_block_size);
+
+            // we read the packed character codes and look at each distinct character of this taxon only once
+            size_t num_codes = taxon.getNumberOfCharacterCodes();
+            std::vector<bool> code_done( num_codes, false );
+            std::vector<bool> code_is_gap( num_codes, false );
+            std::vector<unsigned long> code_state_index( num_codes, 0 );
+            std::vector<RbBitSet> code_state( using_ambiguous_characters == true ? num_codes : 0 );
             for (size_t patternIndex = 0; patternIndex < pattern_block_size; ++patternIndex)
             {
                 // set the counts for this patter
                 process_pattern_counts[patternIndex] = pattern_counts[patternIndex+pattern_block_start];
 
-                charType &c = static_cast<charType &>( taxon.getCharacter(site_indices[indexOfSitePattern[patternIndex+pattern_block_start]]) );
-                gap_matrix[node_index][patternIndex] = c.isGapState();
-
-                if ( using_ambiguous_characters == true )
+                size_t code = taxon.getCharacterCode(site_indices[indexOfSitePattern[patternIndex+pattern_block_start]]);
+                if ( code_done[code] == false )
                 {
-                    // we use the actual state
-                    ambiguous_char_matrix[node_index][patternIndex] = c.getState();
+                    const charType &c = static_cast<const charType &>( taxon.getCharacterForCode( code ) );
+                    code_is_gap[code] = c.isGapState();
+
+                    if ( using_ambiguous_characters == true )
+                    {
+                        // we use the actual state
+                        code_state[code] = c.getState();
+                    }
+                    else if ( c.isGapState() == false )
+                    {
+                        // we use the index of the state
+                        code_state_index[code] = c.getStateIndex();
+                        if ( c.getStateIndex() >= this->num_chars )
+                            throw RbException("Problem with state index in PhyloCTMC!");
+                    }
+                    else
+                    {
+                        // just to be safe
+                        code_state_index[code] = -1;
+                    }
+                    code_done[code] = true;
                 }
-                else if ( c.isGapState() == false )
+
+                gap_matrix[node_index][patternIndex] = code_is_gap[code];
+                if ( using_ambiguous_characters == true )
                 {
-                    // we use the index of the state
-                    char_matrix[node_index][patternIndex] = c.getStateIndex();
-                    if ( c.getStateIndex() >= this->num_chars )
-                        throw RbException("Problem with state index in PhyloCTMC!");
+                    ambiguous_char_matrix[node_index][patternIndex] = code_state[code];
                 }
                 else
                 {
-                    // just to be safe
-                    char_matrix[node_index][patternIndex] = -1;
+                    char_matrix[node_index][patternIndex] = code_state_index[code];
                 }
 
             }
@@ -795,223 +828,1190 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
 }
 
 
+/**
+ * Apply the function f(begin,end) to contiguous sub-blocks of the site patterns of this process.
+ * The sub-blocks are computed on the shared thread pool if the user asked for more than one thread
+ * and if there are enough patterns so that the overhead of the threads pays off.
+ * The function returns only after all sub-blocks have been computed.
+ */
 template<class charType>
-double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeLnProbability( void )
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeForPatternBlocks(const std::function<void (size_t, size_t)> &f) const
 {
-    // @todo: #thread
-    // This part should be done on several threads if possible
-    // That means we should probabily call this function as a job,
-    // where a job is defined as computing the lnProbability for a subset of the data (block)
-    // Sebastian: this call is very slow; a lot of work happens in nextCycle()
 
+    // we want at least a few thousand likelihood entries per thread
+    size_t min_block_size = std::max<size_t>( 16, 8192 / (num_chars*num_site_mixtures) );
 
-    // we need to check here if we still are listining to this tree for change events
-    // the tree could have been replaced without telling us
-    if ( tau->getValue().getTreeChangeEventHandler().isListening( this ) == false )
-    {
-        tau->getValue().getTreeChangeEventHandler().addListener( this );
-        dirty_nodes = std::vector<bool>(num_nodes, true);
-    }
+    ThreadPool::globalInstance().parallelFor( pattern_block_size, f, min_block_size );
 
+}
 
-    // if we are not in MCMC mode, then we need to (temporarily) allocate memory
-    if ( in_mcmc_mode == false )
+
+/**
+ * Allocate the memory for the partial likelihoods (both the active and the inactive copy).
+ * Depending on use_single_precision we use either the double or the float array.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::allocatePartialLikelihoods( void ) const
+{
+
+    if ( use_single_precision == true )
+    {
+        partialLikelihoodsSinglePrecision = new float[2*activeLikelihoodOffset];
+    }
+    else
     {
         partialLikelihoods = new double[2*activeLikelihoodOffset];
     }
 
-    // compute the ln probability by recursively calling the probability calculation for each node
-    const TopologyNode &root = tau->getValue().getRoot();
+}
 
-    // we start with the root and then traverse down the tree
-    size_t root_index = root.getIndex();
 
-    // only necessary if the root is actually dirty
-    if ( dirty_nodes[root_index] == true )
+/**
+ * Compute the transition probabilities of a rate matrix for several branches and/or site rate categories at once.
+ * We first copy all matrices that are in the transition probability cache, and then compute the missing ones
+ * using the batched computation of the rate matrix, which passes only once over the eigen system.
+ * The cache entries are keyed by the fingerprint of the rate matrix, so we share them with all other
+ * models and chains that currently have the same rate matrix. Rate matrices without a fingerprint are never cached.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::calculateTransitionProbabilities(const RateGenerator &rm, const std::vector<double> &start_ages, const std::vector<double> &end_ages, const std::vector<double> &rates, std::vector<TransitionProbabilityMatrix*> &P) const
+{
+
+    TransitionProbabilityMatrixCache &cache = TransitionProbabilityMatrixCache::globalInstance();
+    bool use_cache = cache.isEnabled();
+
+    std::uint64_t fingerprint_high = 0xA4093822299F31D0ULL;
+    std::uint64_t fingerprint_low  = 0x082EFA98EC4E6C89ULL;
+    if ( use_cache == true )
     {
+        use_cache = rm.computeFingerprint( fingerprint_high, fingerprint_low );
+    }
 
-        // start by filling the likelihood vector for the children of the root
-        if ( root.getNumberOfChildren() == 2 ) // rooted trees have two children for the root
+    std::vector<size_t> missing;
+    for (size_t i = 0; i < P.size(); ++i)
+    {
+        if ( use_cache == false || cache.get( fingerprint_high, fingerprint_low, start_ages[i], end_ages[i], rates[i], *P[i] ) == false )
         {
-            const TopologyNode &left = root.getChild(0);
-            size_t left_index = left.getIndex();
-            fillLikelihoodVector( left, left_index );
-            const TopologyNode &right = root.getChild(1);
-            size_t right_index = right.getIndex();
-            fillLikelihoodVector( right, right_index );
+            missing.push_back( i );
+        }
+    }
 
-            computeRootLikelihood( root_index, left_index, right_index );
-            scale(root_index, left_index, right_index);
+    const RateMatrix *rate_matrix = dynamic_cast<const RateMatrix*>( &rm );
+    if ( rate_matrix != NULL && missing.size() > 1 )
+    {
+        std::vector<double> t( missing.size() );
+        std::vector<TransitionProbabilityMatrix*> missing_P( missing.size() );
+        for (size_t i = 0; i < missing.size(); ++i)
+        {
+            size_t k = missing[i];
+            t[i] = rates[k] * (start_ages[k] - end_ages[k]);
+            missing_P[i] = P[k];
+        }
+        rate_matrix->calculateBatchTransitionProbabilities( t, missing_P );
+    }
+    else
+    {
+        for (size_t i = 0; i < missing.size(); ++i)
+        {
+            size_t k = missing[i];
+            rm.calculateTransitionProbabilities( start_ages[k], end_ages[k], rates[k], *P[k] );
+        }
+    }
 
+    if ( use_cache == true )
+    {
+        for (size_t i = 0; i < missing.size(); ++i)
+        {
+            size_t k = missing[i];
+            cache.insert( fingerprint_high, fingerprint_low, start_ages[k], end_ages[k], rates[k], *P[k] );
         }
-        else if ( root.getNumberOfChildren() == 3 ) // unrooted trees have three children for the root
+    }
+
+}
+
+
+/**
+ * Compute the transition probabilities of branches with the clock rate of the given nodes but with arbitrary start and end ages,
+ * e.g., the branches of a tree that we only consider but do not construct.
+ * The matrices of branch i are stored in P[i*num_site_mixtures + mixture], in the same order of mixture categories as transition_prob_matrices.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeBranchTransitionProbabilities(const std::vector<size_t> &node_indices, const std::vector<double> &start_ages, const std::vector<double> &end_ages, std::vector<TransitionProbabilityMatrix> &P) const
+{
+
+    size_t num_branches = node_indices.size();
+    P = std::vector<TransitionProbabilityMatrix>( num_branches*this->num_site_mixtures, TransitionProbabilityMatrix(this->num_chars) );
+
+    // the clock rates of the branches, corrected for the invariant sites
+    std::vector<double> branch_rates( num_branches, 1.0 );
+    for (size_t i = 0; i < num_branches; ++i)
+    {
+        double start_age = 0.0;
+        double end_age = 0.0;
+        getBranchRateAndAges(node_indices[i], branch_rates[i], start_age, end_age);
+    }
+
+    std::vector<double> site_rates( this->num_site_rates, 1.0 );
+    if ( this->rate_variation_across_sites == true )
+    {
+        for (size_t j = 0; j < this->num_site_rates; ++j)
         {
-            const TopologyNode &left = root.getChild(0);
-            size_t left_index = left.getIndex();
-            fillLikelihoodVector( left, left_index );
-            const TopologyNode &right = root.getChild(1);
-            size_t right_index = right.getIndex();
-            fillLikelihoodVector( right, right_index );
-            const TopologyNode &middle = root.getChild(2);
-            size_t middleIndex = middle.getIndex();
-            fillLikelihoodVector( middle, middleIndex );
+            site_rates[j] = this->site_rates->getValue()[j];
+        }
+    }
 
-            computeRootLikelihood( root_index, left_index, right_index, middleIndex );
-            scale(root_index, left_index, right_index, middleIndex);
+    RateMatrix_JC jc(this->num_chars);
+    const RateGenerator *rm = &jc;
 
+    if ( this->branch_heterogeneous_substitution_matrices == false )
+    {
+        // we collect all branches and site rate categories, so that we compute the matrices of each rate matrix in one batch
+        std::vector<double> batch_start_ages;
+        std::vector<double> batch_end_ages;
+        std::vector<double> rates;
+        for (size_t i = 0; i < num_branches; ++i)
+        {
+            for (size_t j = 0; j < this->num_site_rates; ++j)
+            {
+                batch_start_ages.push_back( start_ages[i] );
+                batch_end_ages.push_back( end_ages[i] );
+                rates.push_back( branch_rates[i] * site_rates[j] );
+            }
         }
-        else
+
+        std::vector<TransitionProbabilityMatrix*> batch_P( rates.size() );
+        for (size_t matrix = 0; matrix < this->num_matrices; ++matrix)
         {
-            throw RbException("The root node has an unexpected number of children. Only 2 (for rooted trees) or 3 (for unrooted trees) are allowed.");
+            if ( this->heterogeneous_rate_matrices != NULL )
+            {
+                rm = &this->heterogeneous_rate_matrices->getValue()[matrix];
+            }
+            else if ( this->homogeneous_rate_matrix != NULL )
+            {
+                rm = &this->homogeneous_rate_matrix->getValue();
+            }
+
+            for (size_t i = 0; i < num_branches; ++i)
+            {
+                for (size_t j = 0; j < this->num_site_rates; ++j)
+                {
+                    batch_P[i*this->num_site_rates + j] = &P[i*this->num_site_mixtures + j*this->num_matrices + matrix];
+                }
+            }
+
+            calculateTransitionProbabilities( *rm, batch_start_ages, batch_end_ages, rates, batch_P );
         }
+    }
+    else
+    {
+        std::vector<double> rates( this->num_site_rates );
+        std::vector<TransitionProbabilityMatrix*> batch_P( this->num_site_rates );
+        for (size_t i = 0; i < num_branches; ++i)
+        {
+            if ( this->heterogeneous_rate_matrices != NULL )
+            {
+                rm = &this->heterogeneous_rate_matrices->getValue()[node_indices[i]];
+            }
+            else if ( this->homogeneous_rate_matrix != NULL )
+            {
+                rm = &this->homogeneous_rate_matrix->getValue();
+            }
 
-        // sum the partials up
-        this->lnProb = sumRootLikelihood();
+            for (size_t j = 0; j < this->num_site_rates; ++j)
+            {
+                rates[j] = branch_rates[i] * site_rates[j];
+                batch_P[j] = &P[i*this->num_site_mixtures + j];
+            }
+            std::vector<double> batch_start_ages( this->num_site_rates, start_ages[i] );
+            std::vector<double> batch_end_ages( this->num_site_rates, end_ages[i] );
 
+            calculateTransitionProbabilities( *rm, batch_start_ages, batch_end_ages, rates, batch_P );
+        }
     }
 
-    // if we are not in MCMC mode, then we need to (temporarily) free memory
-    if ( in_mcmc_mode == false )
+}
+
+
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::freePartialLikelihoods( void ) const
+{
+
+    delete [] partialLikelihoods;
+    partialLikelihoods = NULL;
+
+    delete [] partialLikelihoodsSinglePrecision;
+    partialLikelihoodsSinglePrecision = NULL;
+
+}
+
+
+/**
+ * Get a pointer to the active partial likelihoods of this node in double precision.
+ * If we store the partial likelihoods in single precision, then we convert them into the buffer
+ * and return a pointer to the buffer instead.
+ */
+template<class charType>
+const double* RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getNodePartialLikelihoods( size_t node_index, std::vector<double> &buffer ) const
+{
+
+    if ( use_single_precision == true )
     {
-        // free the partial likelihoods
-        delete [] partialLikelihoods;
-        partialLikelihoods = NULL;
+        const float* p_node = this->partialLikelihoodsSinglePrecision + getPartialLikelihoodOffset(node_index);
+        buffer.assign( p_node, p_node + this->nodeOffset );
+        return &buffer[0];
     }
 
-    return this->lnProb;
+    return this->partialLikelihoods + getPartialLikelihoodOffset(node_index);
 }
 
 
 template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeMarginalNodeLikelihood( size_t node_index, size_t parentnode_index )
+size_t RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getPartialLikelihoodOffset( size_t node_index ) const
 {
 
-    // compute the transition probability matrix
-    this->updateTransitionProbabilities( node_index );
+    return this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+}
 
-    // get the pointers to the partial likelihoods and the marginal likelihoods
-    const double*   p_node                  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
-    double*         p_node_marginal         = this->marginalLikelihoods + node_index*this->nodeOffset;
-    const double*   p_parent_node_marginal  = this->marginalLikelihoods + parentnode_index*this->nodeOffset;
 
-    // get pointers the likelihood for both subtrees
-    const double*   p_mixture                   = p_node;
-    double*         p_mixture_marginal          = p_node_marginal;
-    const double*   p_parent_mixture_marginal   = p_parent_node_marginal;
+/**
+ * Get the likelihoods of the observed character of each site pattern at this tip given each state of the tip, that is,
+ * the partial likelihoods of the tip before we multiply them with the transition probabilities of its branch.
+ * The likelihoods are stored as [site*num_chars + state] and are the same for all mixture categories.
+ * We return false for weighted characters or if we do not know the taxon of the tip.
+ */
+template<class charType>
+bool RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getTipStateLikelihoods( size_t node_index, std::vector<double> &likelihoods ) const
+{
+
+    if ( this->using_weighted_characters == true )
+    {
+        return false;
+    }
+
+    std::map<std::string, size_t>::const_iterator it = this->taxon_name_2_tip_index_map.find( tau->getValue().getNode( node_index ).getName() );
+    if ( it == this->taxon_name_2_tip_index_map.end() )
+    {
+        return false;
+    }
+    size_t data_tip_index = it->second;
+
+    likelihoods.assign( this->pattern_block_size*this->num_chars, 0.0 );
+    for (size_t site = 0; site < this->pattern_block_size; ++site)
+    {
+        double *p_site = &likelihoods[site*this->num_chars];
+        if ( this->gap_matrix[data_tip_index][site] == true )
+        {
+            // the actual state could have been any state
+            std::fill( p_site, p_site + this->num_chars, 1.0 );
+        }
+        else if ( this->using_ambiguous_characters == true )
+        {
+            const RbBitSet &val = this->ambiguous_char_matrix[data_tip_index][site];
+            for (size_t i = 0; i < val.size() && i < this->num_chars; ++i)
+            {
+                p_site[i] = ( val.isSet(i) == true ? 1.0 : 0.0 );
+            }
+        }
+        else
+        {
+            p_site[ this->char_matrix[data_tip_index][site] ] = 1.0;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * Get the clock rate and the start and end ages of the branch leading to this node.
+ * The rate is rescaled by the inverse of the proportion of invariant sites.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getBranchRateAndAges( size_t node_idx, double &rate, double &start_age, double &end_age ) const
+{
+
+    const TopologyNode* node = tau->getValue().getNodes()[node_idx];
+
+    // get the clock rate for the branch
+    rate = 1.0;
+    if ( this->branch_heterogeneous_clock_rates == true )
+    {
+        rate = this->heterogeneous_clock_rates->getValue()[node_idx];
+    }
+    else if (homogeneous_clock_rate != NULL)
+    {
+        rate = this->homogeneous_clock_rate->getValue();
+    }
+
+    // we rescale the rate by the inverse of the proportion of invariant sites
+    rate /= ( 1.0 - getPInv() );
+
+    end_age = node->getAge();
+
+    // if the tree is not a time tree, then the age will be not a number
+    if ( RbMath::isFinite(end_age) == false )
+    {
+        // we assume by default that the end is at time 0
+        end_age = 0.0;
+    }
+    start_age = end_age + node->getBranchLength();
+
+}
+
+
+/**
+ * Do we rescale the partial likelihoods?
+ * Partial likelihoods in single precision underflow quickly, so we always rescale them.
+ */
+template<class charType>
+bool RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::isUsingScaling( void ) const
+{
+
+    return use_single_precision == true || RbSettings::userSettings().getUseScaling() == true;
+}
+
+
+/**
+ * Compute the transition probabilities of all branches when the whole tree needs to be recomputed.
+ * Computing them branch by branch would pass over the eigen system of the rate matrix once per branch
+ * and site rate category, whereas here we compute all matrices for a rate matrix in one batch.
+ * The matrices are kept until the end of computeLnProbability(), where updateTransitionProbabilities() copies them.
+ * We only do this for branch homogeneous substitution matrices and if the matrices for all branches fit into a moderate amount of memory.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::precomputeTransitionProbabilities( void )
+{
+
+    use_precomputed_transition_probabilities = false;
+
+    if ( this->branch_heterogeneous_substitution_matrices == true )
+    {
+        return;
+    }
+
+    // some rate generators are applied directly to the partial likelihoods and gain nothing from computing the matrices in one batch
+    if ( this->heterogeneous_rate_matrices == NULL && this->homogeneous_rate_matrix != NULL && this->homogeneous_rate_matrix->getValue().prefersTransitionProbabilityAction() == true )
+    {
+        return;
+    }
+
+    // do not use more than 64MB for the precomputed matrices
+    const size_t max_memory = 64 * 1024 * 1024;
+    size_t num_mixtures = this->num_site_rates * this->num_matrices;
+    if ( this->num_nodes * num_mixtures * this->num_chars * this->num_chars * sizeof(double) > max_memory )
+    {
+        return;
+    }
+
+    if ( precomputed_transition_prob_matrices.size() != this->num_nodes * num_mixtures || precomputed_transition_prob_matrices[0].getNumberOfStates() != this->num_chars )
+    {
+        precomputed_transition_prob_matrices = std::vector<TransitionProbabilityMatrix>( this->num_nodes * num_mixtures, TransitionProbabilityMatrix(this->num_chars) );
+    }
+
+    // collect the times of all branches and site rate categories
+    const std::vector<TopologyNode*> &nodes = tau->getValue().getNodes();
+    std::vector<size_t> node_indices;
+    std::vector<size_t> rate_categories;
+    std::vector<double> start_ages;
+    std::vector<double> end_ages;
+    std::vector<double> rates;
+    for (size_t node_idx = 0; node_idx < nodes.size(); ++node_idx)
+    {
+        if ( nodes[node_idx]->isRoot() == true )
+        {
+            continue;
+        }
+
+        double rate = 1.0;
+        double start_age = 0.0;
+        double end_age = 0.0;
+        getBranchRateAndAges(node_idx, rate, start_age, end_age);
+
+        for (size_t j = 0; j < this->num_site_rates; ++j)
+        {
+            double r = 1.0;
+            if ( this->rate_variation_across_sites == true )
+            {
+                r = this->site_rates->getValue()[j];
+            }
+
+            node_indices.push_back( node_idx );
+            rate_categories.push_back( j );
+            start_ages.push_back( start_age );
+            end_ages.push_back( end_age );
+            rates.push_back( rate * r );
+        }
+    }
+
+    RateMatrix_JC jc(this->num_chars);
+    const RateGenerator *rm = &jc;
+
+    std::vector<TransitionProbabilityMatrix*> P( node_indices.size() );
+    for (size_t matrix = 0; matrix < this->num_matrices; ++matrix)
+    {
+        if ( this->heterogeneous_rate_matrices != NULL )
+        {
+            rm = &this->heterogeneous_rate_matrices->getValue()[matrix];
+        }
+        else if ( this->homogeneous_rate_matrix != NULL )
+        {
+            rm = &this->homogeneous_rate_matrix->getValue();
+        }
+
+        for (size_t i = 0; i < node_indices.size(); ++i)
+        {
+            P[i] = &precomputed_transition_prob_matrices[node_indices[i]*num_mixtures + rate_categories[i]*this->num_matrices + matrix];
+        }
+
+        calculateTransitionProbabilities( *rm, start_ages, end_ages, rates, P );
+    }
+
+    use_precomputed_transition_probabilities = true;
+
+}
+
+
+template<class charType>
+double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeLnProbability( void )
+{
+    // @todo: #thread
+    // This part should be done on several threads if possible
+    // That means we should probabily call this function as a job,
+    // where a job is defined as computing the lnProbability for a subset of the data (block)
+    // Sebastian: this call is very slow; a lot of work happens in nextCycle()
+
+
+    // we need to check here if we still are listining to this tree for change events
+    // the tree could have been replaced without telling us
+    if ( tau->getValue().getTreeChangeEventHandler().isListening( this ) == false )
+    {
+        tau->getValue().getTreeChangeEventHandler().addListener( this );
+        dirty_nodes = std::vector<bool>(num_nodes, true);
+    }
+
+
+    // if we are not in MCMC mode, then we need to (temporarily) allocate memory
+    if ( in_mcmc_mode == false )
+    {
+        allocatePartialLikelihoods();
+    }
+
+    // compute the ln probability by recursively calling the probability calculation for each node
+    const TopologyNode &root = tau->getValue().getRoot();
+
+    // we start with the root and then traverse down the tree
+    size_t root_index = root.getIndex();
+
+    // only necessary if the root is actually dirty
+    if ( dirty_nodes[root_index] == true )
+    {
+
+        // if we recompute the whole tree, then we compute the transition probabilities of all branches at once
+        if ( std::find(dirty_nodes.begin(), dirty_nodes.end(), false) == dirty_nodes.end() )
+        {
+            precomputeTransitionProbabilities();
+        }
+
+        // start by filling the likelihood vector for the children of the root
+        if ( root.getNumberOfChildren() == 2 ) // rooted trees have two children for the root
+        {
+            const TopologyNode &left = root.getChild(0);
+            size_t left_index = left.getIndex();
+            fillLikelihoodVector( left, left_index );
+            const TopologyNode &right = root.getChild(1);
+            size_t right_index = right.getIndex();
+            fillLikelihoodVector( right, right_index );
+
+            computeRootLikelihood( root_index, left_index, right_index );
+            scale(root_index, left_index, right_index);
+
+        }
+        else if ( root.getNumberOfChildren() == 3 ) // unrooted trees have three children for the root
+        {
+            const TopologyNode &left = root.getChild(0);
+            size_t left_index = left.getIndex();
+            fillLikelihoodVector( left, left_index );
+            const TopologyNode &right = root.getChild(1);
+            size_t right_index = right.getIndex();
+            fillLikelihoodVector( right, right_index );
+            const TopologyNode &middle = root.getChild(2);
+            size_t middleIndex = middle.getIndex();
+            fillLikelihoodVector( middle, middleIndex );
+
+            computeRootLikelihood( root_index, left_index, right_index, middleIndex );
+            scale(root_index, left_index, right_index, middleIndex);
+
+        }
+        else
+        {
+            throw RbException("The root node has an unexpected number of children. Only 2 (for rooted trees) or 3 (for unrooted trees) are allowed.");
+        }
+
+        // sum the partials up
+        this->lnProb = sumRootLikelihood();
+
+        use_precomputed_transition_probabilities = false;
+
+    }
+
+    // if we are not in MCMC mode, then we need to (temporarily) free memory
+    if ( in_mcmc_mode == false )
+    {
+        // free the partial likelihoods
+        freePartialLikelihoods();
+    }
+
+    return this->lnProb;
+}
+
+
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeMarginalNodeLikelihood( size_t node_index, size_t parentnode_index )
+{
+
+    // compute the transition probability matrix
+    this->updateTransitionProbabilities( node_index );
+
+    // get the pointers to the partial likelihoods and the marginal likelihoods
+    std::vector<double> node_buffer;
+    const double*   p_node                  = getNodePartialLikelihoods( node_index, node_buffer );
+    double*         p_node_marginal         = this->marginalLikelihoods + node_index*this->nodeOffset;
+    const double*   p_parent_node_marginal  = this->marginalLikelihoods + parentnode_index*this->nodeOffset;
+
+    // get pointers the likelihood for both subtrees
+    const double*   p_mixture                   = p_node;
+    double*         p_mixture_marginal          = p_node_marginal;
+    const double*   p_parent_mixture_marginal   = p_parent_node_marginal;
+
+    // iterate over all mixture categories
+    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    {
+        // the transition probability matrix for this mixture category
+        const double*    tp_begin                = this->transition_prob_matrices[mixture].theMatrix;
+
+        // get pointers to the likelihood for this mixture category
+        const double*   p_site_mixture                  = p_mixture;
+        double*         p_site_mixture_marginal         = p_mixture_marginal;
+        const double*   p_parent_site_mixture_marginal  = p_parent_mixture_marginal;
+        // iterate over all sites
+        for (size_t site = 0; site < this->pattern_block_size; ++site)
+        {
+            // get the pointers to the likelihoods for this site and mixture category
+            const double*   p_site_j                    = p_site_mixture;
+            double*         p_site_marginal_j           = p_site_mixture_marginal;
+            // iterate over all end states
+            for (size_t j=0; j<num_chars; ++j)
+            {
+                const double*   p_parent_site_marginal_k    = p_parent_site_mixture_marginal;
+                *p_site_marginal_j = 0.0;
+
+                // iterator over all start states
+                for (size_t k=0; k<num_chars; ++k)
+                {
+                    // transition probability for k->j
+                    const double tp_kj = *p_parent_site_marginal_k * tp_begin[ k * num_chars + j ];
+
+                    // add the probability of starting from this state
+                    *p_site_marginal_j += *p_site_j * tp_kj;
+
+                    // next parent state
+                    ++p_parent_site_marginal_k;
+                }
+
+                // increment pointers
+                ++p_site_j; ++p_site_marginal_j;
+            }
+
+            // increment the pointers to the next site
+            p_site_mixture+=this->siteOffset; p_site_mixture_marginal+=this->siteOffset; p_parent_site_mixture_marginal+=this->siteOffset;
+
+        } // end-for over all sites (=patterns)
+
+        // increment the pointers to the next mixture category
+        p_mixture+=this->mixtureOffset; p_mixture_marginal+=this->mixtureOffset; p_parent_mixture_marginal+=this->mixtureOffset;
+
+    } // end-for over all mixtures (=rate categories)
+
+}
+
+
+
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeMarginalRootLikelihood( void )
+{
+    // get the root node
+    const TopologyNode &root = tau->getValue().getRoot();
+
+    // get root frequencies
+    std::vector<std::vector<double> >   ff;
+    getRootFrequencies(ff);
+
+    // get the index of the root node
+    size_t node_index = root.getIndex();
+
+    // get the pointers to the partial likelihoods and the marginal likelihoods
+    std::vector<double> node_buffer;
+    const double*   p_node           = getNodePartialLikelihoods( node_index, node_buffer );
+    double*         p_node_marginal  = this->marginalLikelihoods + node_index*this->nodeOffset;
+
+    // get pointers the likelihood for both subtrees
+    const double*   p_mixture           = p_node;
+    double*         p_mixture_marginal  = p_node_marginal;
+
+    // iterate over all mixture categories
+    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    {
+        // get root frequencies
+        const std::vector<double>&          f           = ff[mixture % ff.size()];
+        std::vector<double>::const_iterator f_end       = f.end();
+        std::vector<double>::const_iterator f_begin     = f.begin();
+
+        // get pointers to the likelihood for this mixture category
+        const double*   p_site_mixture          = p_mixture;
+        double*         p_site_mixture_marginal = p_mixture_marginal;
+        // iterate over all sites
+        for (size_t site = 0; site < this->pattern_block_size; ++site)
+        {
+            // get the pointer to the stationary frequencies
+            std::vector<double>::const_iterator f_j             = f_begin;
+            // get the pointers to the likelihoods for this site and mixture category
+            const double*   p_site_j            = p_site_mixture;
+            double*         p_site_marginal_j   = p_site_mixture_marginal;
+            // iterate over all starting states
+            for (; f_j != f_end; ++f_j)
+            {
+                // add the probability of starting from this state
+                *p_site_marginal_j = *p_site_j * *f_j;
+
+                // increment pointers
+                ++p_site_j; ++p_site_marginal_j;
+            }
+
+            // increment the pointers to the next site
+            p_site_mixture+=this->siteOffset; p_site_mixture_marginal+=this->siteOffset;
+
+        } // end-for over all sites (=patterns)
+
+        // increment the pointers to the next mixture category
+        p_mixture+=this->mixtureOffset; p_mixture_marginal+=this->mixtureOffset;
+
+    } // end-for over all mixtures (=rate categories)
+
+}
+
+
+/**
+ * Compute the ln-likelihoods of the trees that we get by pruning the parent of 'pruned' (together with the subtree of 'pruned')
+ * and regrafting it, at its current age, onto the branch above each of the targets.
+ *
+ * We use the partial likelihoods of the current tree, so these need to be up to date.
+ * Removing the subtree only extends the branch of the brother of 'pruned' and changes the partial likelihoods on the path from the grandparent to the root, which we recompute.
+ * Note that the stored partial likelihoods of a node are conditioned on the state at the start of its branch,
+ * so for a target we recompute those given its own state from its children (or from the data at a tip).
+ * Then we compute in one pre-order pass the outside partial likelihoods of the targets, that is,
+ * the likelihood of all data outside the subtree of the target given the state at the start of its branch.
+ * The likelihood of a re-attachment point is the product of the outside partials propagated down to the new parent,
+ * the partials of the target propagated up to the new parent and the partials of the pruned subtree.
+ * Thus, each re-attachment point costs only O(patterns) and we evaluate the re-attachment points in parallel.
+ *
+ * We return false if we cannot use the stored partial likelihoods, e.g., because they have been freed, or if the tree is not a binary time tree.
+ */
+template<class charType>
+bool RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRegraftLnProbabilities(const DagNode *tree, const TopologyNode &pruned, const std::vector<TopologyNode*> &targets, std::vector<double> &ln_probs)
+{
+
+    // we need the partial likelihoods of this tree
+    if ( tree != tau || in_mcmc_mode == false || ( use_single_precision == true ? partialLikelihoodsSinglePrecision == NULL : partialLikelihoods == NULL ) )
+    {
+        return false;
+    }
+
+#ifdef RB_MPI
+    // the site patterns are distributed over several processes
+    if ( num_processes > 1 )
+    {
+        return false;
+    }
+#endif
+
+    const Tree &t = tau->getValue();
+    const std::vector<TopologyNode*> &nodes = t.getNodes();
+    const TopologyNode &root = t.getRoot();
+    size_t root_index = root.getIndex();
+
+    if ( nodes.size() != this->num_nodes || dirty_nodes[root_index] == true || RbMath::isFinite( root.getAge() ) == false || pruned.isRoot() == true || pruned.getParent().isRoot() == true )
+    {
+        return false;
+    }
+
+    const TopologyNode &parent  = pruned.getParent();
+    size_t pruned_index         = pruned.getIndex();
+    size_t parent_index         = parent.getIndex();
+    size_t grandparent_index    = parent.getParent().getIndex();
+    double parent_age           = parent.getAge();
+
+    // the parent and the children of each node in the tree without the pruned subtree
+    const size_t none = this->num_nodes;
+    std::vector<size_t> pruned_parent( this->num_nodes, none );
+    std::vector<size_t> left( this->num_nodes, none );
+    std::vector<size_t> right( this->num_nodes, none );
+    for (size_t i = 0; i < this->num_nodes; ++i)
+    {
+        const TopologyNode &node = *nodes[i];
+        if ( node.isRoot() == false )
+        {
+            pruned_parent[i] = node.getParent().getIndex();
+        }
+        if ( node.isTip() == false )
+        {
+            // we only handle binary trees
+            if ( node.getNumberOfChildren() != 2 )
+            {
+                return false;
+            }
+            left[i]  = node.getChild(0).getIndex();
+            right[i] = node.getChild(1).getIndex();
+        }
+    }
+    size_t brother_index = ( left[parent_index] == pruned_index ? right[parent_index] : left[parent_index] );
+    pruned_parent[brother_index] = grandparent_index;
+    if ( left[grandparent_index] == parent_index )
+    {
+        left[grandparent_index] = brother_index;
+    }
+    else
+    {
+        right[grandparent_index] = brother_index;
+    }
+
+    // flag the targets and their ancestors, because we need the outside partial likelihoods of these nodes
+    std::vector<bool> needed( this->num_nodes, false );
+    for (size_t k = 0; k < targets.size(); ++k)
+    {
+        size_t index = targets[k]->getIndex();
+        if ( index == parent_index || index == root_index || nodes[index]->getAge() > parent_age || nodes[pruned_parent[index]]->getAge() < parent_age )
+        {
+            return false;
+        }
+
+        while ( index != root_index && needed[index] == false )
+        {
+            needed[index] = true;
+            index = pruned_parent[index];
+
+            // the target must not be within the pruned subtree
+            if ( index == parent_index )
+            {
+                return false;
+            }
+        }
+    }
+
+    // the nodes whose partial likelihoods change when we remove the subtree (the root is not needed)
+    std::vector<size_t> path;
+    for (size_t index = grandparent_index; index != root_index; index = pruned_parent[index])
+    {
+        path.push_back( index );
+    }
+
+    // the stored partial likelihoods of a node are those at the start of its branch, i.e., given the state of its parent
+    bool use_scaling = isUsingScaling();
+    std::vector<double> no_scaling( this->pattern_block_size, 0.0 );
+    std::vector< std::vector<double> > buffers( this->num_nodes );
+    std::vector<const double*> partials( this->num_nodes, NULL );
+    std::vector<const double*> scaling( this->num_nodes, NULL );
+    auto fetchPartials = [&](size_t index)
+    {
+        if ( partials[index] == NULL )
+        {
+            partials[index] = getNodePartialLikelihoods( index, buffers[index] );
+            scaling[index]  = ( use_scaling == true ? &this->perNodeSiteLogScalingFactors[this->activeLikelihood[index]][index][0] : &no_scaling[0] );
+        }
+    };
+
+    std::vector<bool> on_path( this->num_nodes, false );
+    for (size_t k = 0; k < path.size(); ++k)
+    {
+        on_path[path[k]] = true;
+    }
+
+    // collect the branches for which we need the transition probabilities
+    std::vector<size_t> branch_slot( this->num_nodes, none );
+    std::vector<size_t> branch_nodes;
+    std::vector<double> start_ages;
+    std::vector<double> end_ages;
+    auto addBranch = [&](size_t index, double start_age, double end_age)
+    {
+        branch_nodes.push_back( index );
+        start_ages.push_back( start_age );
+        end_ages.push_back( end_age );
+        return branch_nodes.size() - 1;
+    };
+
+    // the brother now hangs from the grandparent, so we extend its branch by the branch of the old parent
+    double grandparent_age = nodes[grandparent_index]->getAge();
+    size_t brother_extension_slot = addBranch( brother_index, grandparent_age, parent_age );
+    fetchPartials( brother_index );
+    fetchPartials( pruned_index );
+
+    // the branches of the nodes on the path and of the needed internal nodes in the tree without the pruned subtree
+    for (size_t i = 0; i < this->num_nodes; ++i)
+    {
+        if ( on_path[i] == true || ( needed[i] == true && left[i] != none ) )
+        {
+            double rate = 1.0;
+            double start_age = 0.0;
+            double end_age = 0.0;
+            getBranchRateAndAges( i, rate, start_age, end_age );
+            if ( i == brother_index )
+            {
+                start_age = grandparent_age;
+            }
+            branch_slot[i] = addBranch( i, start_age, end_age );
+        }
+    }
+
+    // the partial likelihoods of the children of the path nodes and of the siblings of the needed nodes
+    for (size_t k = 0; k < path.size(); ++k)
+    {
+        fetchPartials( left[path[k]] );
+        fetchPartials( right[path[k]] );
+    }
+    fetchPartials( left[root_index] );
+    fetchPartials( right[root_index] );
+    for (size_t i = 0; i < this->num_nodes; ++i)
+    {
+        if ( needed[i] == true )
+        {
+            fetchPartials( left[pruned_parent[i]] );
+            fetchPartials( right[pruned_parent[i]] );
+        }
+    }
+
+    // the partial likelihoods at the end of the branch of each target, i.e., given the state of the target itself
+    std::vector< std::vector<double> > tip_partials( targets.size() );
+    for (size_t k = 0; k < targets.size(); ++k)
+    {
+        size_t index = targets[k]->getIndex();
+        if ( left[index] == none )
+        {
+            if ( getTipStateLikelihoods( index, tip_partials[k] ) == false )
+            {
+                return false;
+            }
+        }
+        else if ( on_path[index] == false )
+        {
+            fetchPartials( left[index] );
+            fetchPartials( right[index] );
+        }
+    }
+
+    // the branches from the old parent of each target to the pruned parent, and from the pruned parent to the target
+    size_t first_target_branch = branch_nodes.size();
+    for (size_t k = 0; k < targets.size(); ++k)
+    {
+        size_t index = targets[k]->getIndex();
+        addBranch( parent_index, nodes[pruned_parent[index]]->getAge(), parent_age );
+        addBranch( index, parent_age, nodes[index]->getAge() );
+    }
+
+    std::vector<TransitionProbabilityMatrix> tp;
+    computeBranchTransitionProbabilities( branch_nodes, start_ages, end_ages, tp );
 
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    // the partial likelihoods at the start of a branch given those at its end: out[i] = sum_j P[i][j] * in[j]
+    auto propagateUp = [&](const TransitionProbabilityMatrix &P, const double *in, double *out)
     {
-        // the transition probability matrix for this mixture category
-        const double*    tp_begin                = this->transition_prob_matrices[mixture].theMatrix;
+        const double *p = P.getElements();
+        for (size_t i = 0; i < this->num_chars; ++i, p += this->num_chars)
+        {
+            double sum = 0.0;
+            for (size_t j = 0; j < this->num_chars; ++j)
+            {
+                sum += p[j] * in[j];
+            }
+            out[i] = sum;
+        }
+    };
 
-        // get pointers to the likelihood for this mixture category
-        const double*   p_site_mixture                  = p_mixture;
-        double*         p_site_mixture_marginal         = p_mixture_marginal;
-        const double*   p_parent_site_mixture_marginal  = p_parent_mixture_marginal;
-        // iterate over all sites
-        for (size_t site = 0; site < this->pattern_block_size; ++site)
+    // the outside partial likelihoods at the end of a branch given those at its start: out[j] = sum_i in[i] * P[i][j]
+    auto propagateDown = [&](const TransitionProbabilityMatrix &P, const double *in, double *out)
+    {
+        const double *p = P.getElements();
+        std::fill( out, out + this->num_chars, 0.0 );
+        for (size_t i = 0; i < this->num_chars; ++i, p += this->num_chars)
         {
-            // get the pointers to the likelihoods for this site and mixture category
-            const double*   p_site_j                    = p_site_mixture;
-            double*         p_site_marginal_j           = p_site_mixture_marginal;
-            // iterate over all end states
-            for (size_t j=0; j<num_chars; ++j)
+            for (size_t j = 0; j < this->num_chars; ++j)
             {
-                const double*   p_parent_site_marginal_k    = p_parent_site_mixture_marginal;
-                *p_site_marginal_j = 0.0;
+                out[j] += in[i] * p[j];
+            }
+        }
+    };
 
-                // iterator over all start states
-                for (size_t k=0; k<num_chars; ++k)
+    // divide the likelihoods of this site by their maximum and add -log(max) to the scaling factor
+    auto rescale = [&](double *p_node, size_t site, double &site_scaling)
+    {
+        double max = 0.0;
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+        {
+            const double *p_site = p_node + mixture*this->mixtureOffset + site*this->siteOffset;
+            max = std::max( max, *std::max_element( p_site, p_site + this->num_chars ) );
+        }
+        if ( max > 0.0 )
+        {
+            for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+            {
+                double *p_site = p_node + mixture*this->mixtureOffset + site*this->siteOffset;
+                for (size_t i = 0; i < this->num_chars; ++i)
                 {
-                    // transition probability for k->j
-                    const double tp_kj = *p_parent_site_marginal_k * tp_begin[ k * num_chars + j ];
-
-                    // add the probability of starting from this state
-                    *p_site_marginal_j += *p_site_j * tp_kj;
-
-                    // next parent state
-                    ++p_parent_site_marginal_k;
+                    p_site[i] /= max;
                 }
-
-                // increment pointers
-                ++p_site_j; ++p_site_marginal_j;
             }
+            site_scaling -= log( max );
+        }
+    };
 
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset; p_site_mixture_marginal+=this->siteOffset; p_parent_site_mixture_marginal+=this->siteOffset;
-
-        } // end-for over all sites (=patterns)
+    // extend the branch of the brother (its scaling factors do not change)
+    std::vector<double> brother_partials( this->nodeOffset, 0.0 );
+    const TransitionProbabilityMatrix *tp_extension = &tp[brother_extension_slot*this->num_site_mixtures];
+    const double *p_brother = partials[brother_index];
+    this->computeForPatternBlocks( [&](size_t site_begin, size_t site_end)
+    {
+        for (size_t site = site_begin; site < site_end; ++site)
+        {
+            for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+            {
+                size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
+                propagateUp( tp_extension[mixture], p_brother + offset, &brother_partials[offset] );
+            }
+        }
+    } );
+    partials[brother_index] = &brother_partials[0];
+
+    // recompute the partial likelihoods on the path from the grandparent to the root,
+    // both given the state of the node itself (for the targets on the path) and given the state of its parent
+    std::vector<size_t> path_slot( this->num_nodes, none );
+    std::vector<double> path_node_partials( path.size()*this->nodeOffset, 0.0 );
+    std::vector<double> path_partials( path.size()*this->nodeOffset, 0.0 );
+    std::vector<double> path_scaling( path.size()*this->pattern_block_size, 0.0 );
+    for (size_t k = 0; k < path.size(); ++k)
+    {
+        size_t l = left[path[k]];
+        size_t r = right[path[k]];
+        const TransitionProbabilityMatrix *tp_node = &tp[branch_slot[path[k]]*this->num_site_mixtures];
+        double *d_node = &path_node_partials[k*this->nodeOffset];
+        double *p_node = &path_partials[k*this->nodeOffset];
+        double *s_node = &path_scaling[k*this->pattern_block_size];
+
+        this->computeForPatternBlocks( [&](size_t site_begin, size_t site_end)
+        {
+            for (size_t site = site_begin; site < site_end; ++site)
+            {
+                for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+                {
+                    size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
+                    for (size_t i = 0; i < this->num_chars; ++i)
+                    {
+                        d_node[offset + i] = partials[l][offset + i] * partials[r][offset + i];
+                    }
+                }
+                s_node[site] = scaling[l][site] + scaling[r][site];
+                rescale( d_node, site, s_node[site] );
 
-        // increment the pointers to the next mixture category
-        p_mixture+=this->mixtureOffset; p_mixture_marginal+=this->mixtureOffset; p_parent_mixture_marginal+=this->mixtureOffset;
+                for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+                {
+                    size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
+                    propagateUp( tp_node[mixture], d_node + offset, p_node + offset );
+                }
+            }
+        } );
 
-    } // end-for over all mixtures (=rate categories)
+        // from now on we use the new partial likelihoods of this node
+        path_slot[path[k]] = k;
+        partials[path[k]]  = p_node;
+        scaling[path[k]]   = s_node;
+    }
 
-}
+    // compute the outside partial likelihoods of the needed nodes in pre-order,
+    // that is, the likelihood of all data outside the subtree of the node given the state at the start of its branch
+    std::vector<std::vector<double> > ff;
+    getRootFrequencies(ff);
+    std::vector<size_t> outside_slot( this->num_nodes, none );
+    size_t num_needed = 0;
+    for (size_t i = 0; i < this->num_nodes; ++i)
+    {
+        if ( needed[i] == true )
+        {
+            outside_slot[i] = num_needed++;
+        }
+    }
+    std::vector<double> outside_partials( num_needed*this->nodeOffset, 0.0 );
+    std::vector<double> outside_scaling( num_needed*this->pattern_block_size, 0.0 );
 
+    std::vector<size_t> stack( 1, root_index );
+    while ( stack.empty() == false )
+    {
+        size_t index = stack.back();
+        stack.pop_back();
 
+        if ( left[index] == none )
+        {
+            continue;
+        }
 
-template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeMarginalRootLikelihood( void )
-{
-    // get the root node
-    const TopologyNode &root = tau->getValue().getRoot();
+        for (size_t c = 0; c < 2; ++c)
+        {
+            size_t child   = ( c == 0 ? left[index] : right[index] );
+            size_t sibling = ( c == 0 ? right[index] : left[index] );
+            if ( needed[child] == false )
+            {
+                continue;
+            }
 
-    // get root frequencies
-    std::vector<std::vector<double> >   ff;
-    getRootFrequencies(ff);
+            const TransitionProbabilityMatrix *tp_node = ( index == root_index ? NULL : &tp[branch_slot[index]*this->num_site_mixtures] );
+            const double *q_node = ( index == root_index ? NULL : &outside_partials[outside_slot[index]*this->nodeOffset] );
+            const double *s_q_node = ( index == root_index ? &no_scaling[0] : &outside_scaling[outside_slot[index]*this->pattern_block_size] );
+            double *q_child = &outside_partials[outside_slot[child]*this->nodeOffset];
+            double *s_q_child = &outside_scaling[outside_slot[child]*this->pattern_block_size];
 
-    // get the index of the root node
-    size_t node_index = root.getIndex();
+            this->computeForPatternBlocks( [&](size_t site_begin, size_t site_end)
+            {
+                std::vector<double> p_above( this->num_chars );
+                for (size_t site = site_begin; site < site_end; ++site)
+                {
+                    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+                    {
+                        size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
+
+                        // the likelihood of everything outside the subtree of this node given its state
+                        if ( index == root_index )
+                        {
+                            const std::vector<double> &f = ff[mixture % ff.size()];
+                            std::copy( f.begin(), f.end(), p_above.begin() );
+                        }
+                        else
+                        {
+                            propagateDown( tp_node[mixture], q_node + offset, &p_above[0] );
+                        }
+
+                        for (size_t i = 0; i < this->num_chars; ++i)
+                        {
+                            q_child[offset + i] = p_above[i] * partials[sibling][offset + i];
+                        }
+                    }
+                    s_q_child[site] = s_q_node[site] + scaling[sibling][site];
+                    rescale( q_child, site, s_q_child[site] );
+                }
+            } );
 
-    // get the pointers to the partial likelihoods and the marginal likelihoods
-    const double*   p_node           = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
-    double*         p_node_marginal  = this->marginalLikelihoods + node_index*this->nodeOffset;
+            stack.push_back( child );
+        }
+    }
 
-    // get pointers the likelihood for both subtrees
-    const double*   p_mixture           = p_node;
-    double*         p_mixture_marginal  = p_node_marginal;
+    // the partial likelihoods of the pruned subtree at the pruned parent are the stored ones, because its branch does not change
+    const double *pruned_partials = partials[pruned_index];
+    const double *s_pruned = scaling[pruned_index];
 
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    std::vector<double> site_mixture_probs = getMixtureProbs();
+    double prob_invariant = getPInv();
+    double oneMinusPInv = 1.0 - prob_invariant;
+    std::vector<double> f;
+    if ( prob_invariant > 0.0 )
     {
-        // get root frequencies
-        const std::vector<double>&          f           = ff[mixture % ff.size()];
-        std::vector<double>::const_iterator f_end       = f.end();
-        std::vector<double>::const_iterator f_begin     = f.begin();
+        f = getInvariantSiteFrequencies();
+    }
 
-        // get pointers to the likelihood for this mixture category
-        const double*   p_site_mixture          = p_mixture;
-        double*         p_site_mixture_marginal = p_mixture_marginal;
-        // iterate over all sites
-        for (size_t site = 0; site < this->pattern_block_size; ++site)
+    // now evaluate the re-attachment points in parallel
+    ln_probs = std::vector<double>( targets.size(), 0.0 );
+    ThreadPool::globalInstance().parallelFor( targets.size(), [&](size_t begin, size_t end)
+    {
+        std::vector<double> d_target( this->num_chars );
+        std::vector<double> p_above( this->num_chars );
+        std::vector<double> p_target( this->num_chars );
+        for (size_t k = begin; k < end; ++k)
         {
-            // get the pointer to the stationary frequencies
-            std::vector<double>::const_iterator f_j             = f_begin;
-            // get the pointers to the likelihoods for this site and mixture category
-            const double*   p_site_j            = p_site_mixture;
-            double*         p_site_marginal_j   = p_site_mixture_marginal;
-            // iterate over all starting states
-            for (; f_j != f_end; ++f_j)
+            size_t index = targets[k]->getIndex();
+            const TransitionProbabilityMatrix *tp_above  = &tp[(first_target_branch + 2*k)*this->num_site_mixtures];
+            const TransitionProbabilityMatrix *tp_target = &tp[(first_target_branch + 2*k + 1)*this->num_site_mixtures];
+            const double *q_target = &outside_partials[outside_slot[index]*this->nodeOffset];
+            const double *s_q_target = &outside_scaling[outside_slot[index]*this->pattern_block_size];
+
+            // the partial likelihoods given the state of the target come either from its tip data, the path or its children
+            bool is_tip = ( left[index] == none );
+            const double *d_path = ( path_slot[index] != none ? &path_node_partials[path_slot[index]*this->nodeOffset] : NULL );
+            const double *s_path = ( path_slot[index] != none ? &path_scaling[path_slot[index]*this->pattern_block_size] : NULL );
+
+            // we sum the sites in the order of the patterns, as in sumRootLikelihood()
+            double ln_prob = 0.0;
+            for (size_t site = 0; site < this->pattern_block_size; ++site)
             {
-                // add the probability of starting from this state
-                *p_site_marginal_j = *p_site_j * *f_j;
+                double per_mixture_likelihood = 0.0;
+                for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+                {
+                    size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
+                    const double *d = &d_target[0];
+                    if ( is_tip == true )
+                    {
+                        d = &tip_partials[k][site*this->num_chars];
+                    }
+                    else if ( d_path != NULL )
+                    {
+                        d = d_path + offset;
+                    }
+                    else
+                    {
+                        const double *p_left  = partials[left[index]] + offset;
+                        const double *p_right = partials[right[index]] + offset;
+                        for (size_t i = 0; i < this->num_chars; ++i)
+                        {
+                            d_target[i] = p_left[i] * p_right[i];
+                        }
+                    }
 
-                // increment pointers
-                ++p_site_j; ++p_site_marginal_j;
-            }
+                    propagateDown( tp_above[mixture], q_target + offset, &p_above[0] );
+                    propagateUp( tp_target[mixture], d, &p_target[0] );
 
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset; p_site_mixture_marginal+=this->siteOffset;
+                    double tmp = 0.0;
+                    for (size_t i = 0; i < this->num_chars; ++i)
+                    {
+                        tmp += p_above[i] * p_target[i] * pruned_partials[offset + i];
+                    }
+                    per_mixture_likelihood += tmp * site_mixture_probs[mixture];
+                }
 
-        } // end-for over all sites (=patterns)
+                double site_scaling = s_q_target[site] + s_pruned[site];
+                if ( d_path != NULL )
+                {
+                    site_scaling += s_path[site];
+                }
+                else if ( is_tip == false )
+                {
+                    site_scaling += scaling[left[index]][site] + scaling[right[index]][site];
+                }
 
-        // increment the pointers to the next mixture category
-        p_mixture+=this->mixtureOffset; p_mixture_marginal+=this->mixtureOffset;
+                size_t pattern_count = this->pattern_counts[site];
+                if ( prob_invariant > 0.0 )
+                {
+                    if ( this->site_invariant[site] == true && this->invariant_site_index[site] < this->num_chars )
+                    {
+                        ln_prob += log( prob_invariant * f[ this->invariant_site_index[site] ] + oneMinusPInv * per_mixture_likelihood / exp(site_scaling) ) * pattern_count;
+                    }
+                    else if ( this->site_invariant[site] == false )
+                    {
+                        ln_prob += ( log( oneMinusPInv * per_mixture_likelihood ) - site_scaling ) * pattern_count;
+                    }
+                }
+                else
+                {
+                    ln_prob += ( log( per_mixture_likelihood ) - site_scaling ) * pattern_count;
+                }
+            }
 
-    } // end-for over all mixtures (=rate categories)
+            ln_probs[k] = ln_prob;
+        }
+    } );
 
+    return true;
 }
 
 
@@ -1124,9 +2124,10 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::drawJointConditio
     size_t left = root.getChild(1).getIndex();
 
     // get the pointers to the partial likelihoods and the marginal likelihoods
-    double*         p_node  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
-    const double*   p_left  = this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
-    const double*   p_right = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
+    std::vector<double> node_buffer, left_buffer, right_buffer;
+    const double*   p_node  = getNodePartialLikelihoods( node_index, node_buffer );
+    const double*   p_left  = getNodePartialLikelihoods( left, left_buffer );
+    const double*   p_right = getNodePartialLikelihoods( right, right_buffer );
 
     // get pointers the likelihood for both subtrees
     const double*   p_site           = p_node;
@@ -1424,7 +2425,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(con
         if ( in_mcmc_mode == false )
         {
             delete_partial_likelihoods = true;
-            partialLikelihoods = new double[2*activeLikelihoodOffset];
+            allocatePartialLikelihoods();
             in_mcmc_mode = true;
 
             for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
@@ -1444,8 +2445,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(con
         if ( delete_partial_likelihoods == true )
         {
             // free the partial likelihoods
-            delete [] partialLikelihoods;
-            partialLikelihoods = NULL;
+            freePartialLikelihoods();
             in_mcmc_mode = false;
         }
 
@@ -1475,7 +2475,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(con
         if ( in_mcmc_mode == false )
         {
             delete_partial_likelihoods = true;
-            partialLikelihoods = new double[2*activeLikelihoodOffset];
+            allocatePartialLikelihoods();
             in_mcmc_mode = true;
 
             for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
@@ -1514,8 +2514,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(con
         if ( delete_partial_likelihoods == true )
         {
             // free the partial likelihoods
-            delete [] partialLikelihoods;
-            partialLikelihoods = NULL;
+            freePartialLikelihoods();
             in_mcmc_mode = false;
         }
 
@@ -1603,7 +2602,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(con
         if ( in_mcmc_mode == false )
         {
             delete_partial_likelihoods = true;
-            partialLikelihoods = new double[2*activeLikelihoodOffset];
+            allocatePartialLikelihoods();
             in_mcmc_mode = true;
 
             for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
@@ -1631,8 +2630,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(con
         if ( delete_partial_likelihoods == true )
         {
             // free the partial likelihoods
-            delete [] partialLikelihoods;
-            partialLikelihoods = NULL;
+            freePartialLikelihoods();
             in_mcmc_mode = false;
         }
 
@@ -1657,7 +2655,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(con
         if ( in_mcmc_mode == false )
         {
             delete_partial_likelihoods = true;
-            partialLikelihoods = new double[2*activeLikelihoodOffset];
+            allocatePartialLikelihoods();
             in_mcmc_mode = true;
 
             for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
@@ -1685,8 +2683,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(con
         if ( delete_partial_likelihoods == true )
         {
             // free the partial likelihoods
-            delete [] partialLikelihoods;
-            partialLikelihoods = NULL;
+            freePartialLikelihoods();
             in_mcmc_mode = false;
         }
 
@@ -1728,8 +2725,9 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::recursivelyDrawJo
 
     // get the pointers to the partial likelihoods and the marginal likelihoods
     //    double*         p_node  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
-    const double*   p_left  = this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
-    const double*   p_right = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
+    std::vector<double> left_buffer, right_buffer;
+    const double*   p_left  = getNodePartialLikelihoods( left, left_buffer );
+    const double*   p_right = getNodePartialLikelihoods( right, right_buffer );
 
     // get pointers the likelihood for both subtrees
     //    const double*   p_site           = p_node;
@@ -2031,6 +3029,49 @@ std::vector<double> RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::ge
     return rf[mixture % rf.size()];
 }
 
+/**
+ * Get the root frequencies of invariant sites.
+ * If we have a mixture of rate matrices, then this is the mean of their root frequencies weighted by the matrix probabilities.
+ */
+template<class charType>
+std::vector<double> RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getInvariantSiteFrequencies( void ) const
+{
+
+    std::vector<double> f;
+    if (this->branch_heterogeneous_substitution_matrices == true)
+    {
+        f = this->getRootFrequencies(0);
+    }
+    else
+    {
+        std::vector<std::vector<double> > ff;
+        getRootFrequencies(ff);
+
+        std::vector<double> matrix_probs(num_matrices, 1.0/num_matrices);
+
+        if (site_matrix_probs != NULL)
+        {
+            matrix_probs = site_matrix_probs->getValue();
+        }
+
+        f = std::vector<double>(ff[0].size(), 0.0);
+
+        for (size_t matrix = 0; matrix < ff.size(); matrix++)
+        {
+            // get the root frequencies
+            const std::vector<double> &fm = ff[matrix];
+
+            for (size_t i = 0; i < fm.size(); i++)
+            {
+                f[i] += fm[i] * matrix_probs[matrix];
+            }
+        }
+    }
+
+    return f;
+}
+
+
 template<class charType>
 std::vector<double> RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getMixtureProbs( void ) const
 {
@@ -2389,14 +3430,18 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::resizeLikelihoodV
     {
 
         // we resize the partial likelihood vectors to the new dimensions
-        delete [] partialLikelihoods;
+        freePartialLikelihoods();
 
-        partialLikelihoods = new double[2*activeLikelihoodOffset];
+        allocatePartialLikelihoods();
 
         // reinitialize likelihood vectors
-        for (size_t i = 0; i < 2*activeLikelihoodOffset; i++)
+        if ( use_single_precision == true )
+        {
+            std::fill(partialLikelihoodsSinglePrecision, partialLikelihoodsSinglePrecision + 2*activeLikelihoodOffset, 0.0f);
+        }
+        else
         {
-            partialLikelihoods[i] = 0.0;
+            std::fill(partialLikelihoods, partialLikelihoods + 2*activeLikelihoodOffset, 0.0);
         }
 
     }
@@ -2434,85 +3479,51 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::restoreSpecializa
     this->lnProb = this->storedLnProb;
 
     // reset the flags
-    for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
-    {
-        (*it) = false;
-    }
-
-    // restore the active likelihoods vector
-    for (size_t index = 0; index < changed_nodes.size(); ++index)
-    {
-        // we have to restore, that means if we have changed the active likelihood vector
-        // then we need to revert this change
-        if ( changed_nodes[index] == true )
-        {
-            activeLikelihood[index] = (activeLikelihood[index] == 0 ? 1 : 0);
-        }
-
-        // set all flags to false
-        changed_nodes[index] = false;
-    }
-
-}
-
-template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t node_index)
-{
-
-    double* p_node = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
-
-    if ( RbSettings::userSettings().getUseScaling() == true && node_index % RbSettings::userSettings().getScalingDensity() == 0 )
-    {
-        // iterate over all mixture categories
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
-        {
-
-            // the max probability
-            double max = 0.0;
-
-            // compute the per site probabilities
-            for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
-            {
-                // get the pointers to the likelihood for this mixture category
-                size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
-
-                double* p_site_mixture = p_node + offset;
-
-                for ( size_t i=0; i<this->num_chars; ++i)
-                {
-                    if ( p_site_mixture[i] > max )
-                    {
-                        max = p_site_mixture[i];
-                    }
-                }
-
-            }
+    for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
+    {
+        (*it) = false;
+    }
 
-            this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] = -log(max);
+    // restore the active likelihoods vector
+    for (size_t index = 0; index < changed_nodes.size(); ++index)
+    {
+        // we have to restore, that means if we have changed the active likelihood vector
+        // then we need to revert this change
+        if ( changed_nodes[index] == true )
+        {
+            activeLikelihood[index] = (activeLikelihood[index] == 0 ? 1 : 0);
+        }
 
-            // compute the per site probabilities
-            for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
-            {
-                // get the pointers to the likelihood for this mixture category
-                size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
+        // set all flags to false
+        changed_nodes[index] = false;
+    }
 
-                double* p_site_mixture = p_node + offset;
+}
 
-                for ( size_t i=0; i<this->num_chars; ++i)
-                {
-                    p_site_mixture[i] /= max;
-                }
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t node_index)
+{
 
-            }
+    std::vector<double> &node_scaling_factors = this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index];
 
+    // in single precision we need to rescale at every node
+    if ( isUsingScaling() == true && ( use_single_precision == true || node_index % RbSettings::userSettings().getScalingDensity() == 0 ) )
+    {
+        if ( use_single_precision == true )
+        {
+            scalePartialLikelihoods( this->partialLikelihoodsSinglePrecision + getPartialLikelihoodOffset(node_index), node_scaling_factors );
+        }
+        else
+        {
+            scalePartialLikelihoods( this->partialLikelihoods + getPartialLikelihoodOffset(node_index), node_scaling_factors );
         }
     }
-    else if ( RbSettings::userSettings().getUseScaling() == true )
+    else if ( isUsingScaling() == true )
     {
         // iterate over all sites
         for (size_t site = 0; site < this->pattern_block_size ; ++site)
         {
-            this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] = 0;
+            node_scaling_factors[site] = 0;
         }
 
     }
@@ -2523,79 +3534,94 @@ template<class charType>
 void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t node_index, size_t left, size_t right )
 {
 
-    double* p_node = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+          std::vector<double> &node_scaling_factors  = this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index];
+    const std::vector<double> &left_scaling_factors  = this->perNodeSiteLogScalingFactors[this->activeLikelihood[left]][left];
+    const std::vector<double> &right_scaling_factors = this->perNodeSiteLogScalingFactors[this->activeLikelihood[right]][right];
 
-    if ( RbSettings::userSettings().getUseScaling() == true && node_index % RbSettings::userSettings().getScalingDensity() == 0 )
+    // in single precision we need to rescale at every node
+    if ( isUsingScaling() == true && ( use_single_precision == true || node_index % RbSettings::userSettings().getScalingDensity() == 0 ) )
     {
-        // iterate over all mixture categories
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
+        if ( use_single_precision == true )
         {
+            scalePartialLikelihoods( this->partialLikelihoodsSinglePrecision + getPartialLikelihoodOffset(node_index), node_scaling_factors );
+        }
+        else
+        {
+            scalePartialLikelihoods( this->partialLikelihoods + getPartialLikelihoodOffset(node_index), node_scaling_factors );
+        }
 
-            // the max probability
-            double max = 0.0;
-
-            // compute the per site probabilities
-            for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
-            {
-                // get the pointers to the likelihood for this mixture category
-                size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
-
-                double*          p_site_mixture          = p_node + offset;
-
-                for ( size_t i=0; i<this->num_chars; ++i)
-                {
-                    if ( p_site_mixture[i] > max )
-                    {
-                        max = p_site_mixture[i];
-                    }
+        // add the scaling factors of the children
+        for (size_t site = 0; site < this->pattern_block_size ; ++site)
+        {
+            node_scaling_factors[site] = left_scaling_factors[site] + right_scaling_factors[site] + node_scaling_factors[site];
+        }
 
-                }
+    }
+    else if ( isUsingScaling() == true )
+    {
+        // iterate over all mixture categories
+        for (size_t site = 0; site < this->pattern_block_size ; ++site)
+        {
+            node_scaling_factors[site] = left_scaling_factors[site] + right_scaling_factors[site];
+        }
 
-            }
+    }
 
-            this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] = this->perNodeSiteLogScalingFactors[this->activeLikelihood[left]][left][site] + this->perNodeSiteLogScalingFactors[this->activeLikelihood[right]][right][site] - log(max);
+}
 
-            // compute the per site probabilities
-            for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
-            {
-                // get the pointers to the likelihood for this mixture category
-                size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
 
-                double* p_site_mixture = p_node + offset;
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t node_index, size_t left, size_t right, size_t middle )
+{
 
-                for ( size_t i=0; i<this->num_chars; ++i)
-                {
-                    p_site_mixture[i] /= max;
-                }
+          std::vector<double> &node_scaling_factors   = this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index];
+    const std::vector<double> &left_scaling_factors   = this->perNodeSiteLogScalingFactors[this->activeLikelihood[left]][left];
+    const std::vector<double> &right_scaling_factors  = this->perNodeSiteLogScalingFactors[this->activeLikelihood[right]][right];
+    const std::vector<double> &middle_scaling_factors = this->perNodeSiteLogScalingFactors[this->activeLikelihood[middle]][middle];
 
-            }
+    // in single precision we need to rescale at every node
+    if ( isUsingScaling() == true && ( use_single_precision == true || node_index % RbSettings::userSettings().getScalingDensity() == 0 ) )
+    {
+        if ( use_single_precision == true )
+        {
+            scalePartialLikelihoods( this->partialLikelihoodsSinglePrecision + getPartialLikelihoodOffset(node_index), node_scaling_factors );
+        }
+        else
+        {
+            scalePartialLikelihoods( this->partialLikelihoods + getPartialLikelihoodOffset(node_index), node_scaling_factors );
+        }
 
+        // add the scaling factors of the children
+        for (size_t site = 0; site < this->pattern_block_size ; ++site)
+        {
+            node_scaling_factors[site] = left_scaling_factors[site] + right_scaling_factors[site] + middle_scaling_factors[site] + node_scaling_factors[site];
         }
-        
     }
-    else if ( RbSettings::userSettings().getUseScaling() == true )
+    else if ( isUsingScaling() == true )
     {
         // iterate over all mixture categories
         for (size_t site = 0; site < this->pattern_block_size ; ++site)
         {
-            this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] = this->perNodeSiteLogScalingFactors[this->activeLikelihood[left]][left][site] + this->perNodeSiteLogScalingFactors[this->activeLikelihood[right]][right][site];
+            node_scaling_factors[site] = left_scaling_factors[site] + right_scaling_factors[site] + middle_scaling_factors[site];
         }
 
     }
-    
 }
 
 
+/**
+ * Divide the partial likelihoods of each site by their maximum over all mixture categories and states
+ * and store the log scaling factor (-log(max)) of the site in node_scaling_factors.
+ */
 template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t node_index, size_t left, size_t right, size_t middle )
+template<class partialType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scalePartialLikelihoods( partialType *p_node, std::vector<double> &node_scaling_factors )
 {
 
-    double* p_node = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
-
-    if ( RbSettings::userSettings().getUseScaling() == true && node_index % RbSettings::userSettings().getScalingDensity() == 0 )
+    this->computeForPatternBlocks( [&](size_t site_begin, size_t site_end)
     {
-        // iterate over all mixture categories
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
+        // iterate over all sites of this block
+        for (size_t site = site_begin; site < site_end ; ++site)
         {
 
             // the max probability
@@ -2607,7 +3633,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t nod
                 // get the pointers to the likelihood for this mixture category
                 size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
 
-                double* p_site_mixture = p_node + offset;
+                partialType* p_site_mixture = p_node + offset;
 
                 for ( size_t i=0; i<this->num_chars; ++i)
                 {
@@ -2619,7 +3645,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t nod
 
             }
 
-            this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] = this->perNodeSiteLogScalingFactors[this->activeLikelihood[left]][left][site] + this->perNodeSiteLogScalingFactors[this->activeLikelihood[right]][right][site] + this->perNodeSiteLogScalingFactors[this->activeLikelihood[middle]][middle][site] - log(max);
+            node_scaling_factors[site] = -log(max);
 
             // compute the per site probabilities
             for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
@@ -2627,7 +3653,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t nod
                 // get the pointers to the likelihood for this mixture category
                 size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
 
-                double* p_site_mixture = p_node + offset;
+                partialType* p_site_mixture = p_node + offset;
 
                 for ( size_t i=0; i<this->num_chars; ++i)
                 {
@@ -2637,16 +3663,8 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t nod
             }
 
         }
-    }
-    else if ( RbSettings::userSettings().getUseScaling() == true )
-    {
-        // iterate over all mixture categories
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
-        {
-            this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] = this->perNodeSiteLogScalingFactors[this->activeLikelihood[left]][left][site] + this->perNodeSiteLogScalingFactors[this->activeLikelihood[right]][right][site] + this->perNodeSiteLogScalingFactors[this->activeLikelihood[middle]][middle][site];
-        }
+    } );
 
-    }
 }
 
 
@@ -2866,8 +3884,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::setMcmcMode(bool
     // free old memory
     if ( in_mcmc_mode == true )
     {
-        delete [] partialLikelihoods;
-        partialLikelihoods = NULL;
+        freePartialLikelihoods();
     }
 
     // set our internal flag
@@ -3191,7 +4208,8 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
     size_t node_index = root.getIndex();
 
     // get the pointers to the partial likelihoods of the left and right subtree
-    double*   p_node  = this->partialLikelihoods + this->activeLikelihood[node_index] * this->activeLikelihoodOffset  + node_index*this->nodeOffset;
+    std::vector<double> node_buffer;
+    const double*   p_node  = getNodePartialLikelihoods( node_index, node_buffer );
 
     // create a vector for the per mixture likelihoods
     // we need this vector to sum over the different mixture likelihoods
@@ -3199,145 +4217,117 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
 
     std::vector<double> site_mixture_probs = getMixtureProbs();
 
-    // get pointer the likelihood
-    double*   p_mixture     = p_node;
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
-    {
-
-        // get pointers to the likelihood for this mixture category
-        double*   p_site_mixture     = p_mixture;
-        // iterate over all sites
-
-        for (size_t site = 0; site < pattern_block_size; ++site)
-        {
-            // temporary variable storing the likelihood
-            double tmp = 0.0;
-            // get the pointers to the likelihoods for this site and mixture category
-            double* p_site_j   = p_site_mixture;
-            // iterate over all starting states
-            for (size_t i=0; i<num_chars; ++i)
-            {
-                // add the probability of starting from this state
-                tmp += *p_site_j;
-
-                // increment pointers
-                ++p_site_j;
-            }
-            // add the likelihood for this mixture category
-            per_mixture_Likelihoods[site] += tmp * site_mixture_probs[mixture];
-            
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset;
-
-        } // end-for over all sites (=patterns)
-
-        // increment the pointers to the next mixture category
-        p_mixture+=this->mixtureOffset;
-
-    } // end-for over all mixtures
+    const std::vector<double> &root_scaling_factors = this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index];
+    bool use_scaling = isUsingScaling();
 
     double prob_invariant = getPInv();
     double oneMinusPInv = 1.0 - prob_invariant;
-    std::vector< size_t >::const_iterator patterns = this->pattern_counts.begin();
+
+    // get the mean root frequency vector
+    std::vector<double> f;
     if ( prob_invariant > 0.0 )
     {
-        // get the mean root frequency vector
-        std::vector<double> f;
-        if (this->branch_heterogeneous_substitution_matrices == true)
-        {
-            f = this->getRootFrequencies(0);
-        }
-        else
-        {
-            std::vector<std::vector<double> > ff;
-            getRootFrequencies(ff);
+        f = getInvariantSiteFrequencies();
+    }
 
-            std::vector<double> matrix_probs(num_matrices, 1.0/num_matrices);
+    this->computeForPatternBlocks( [&](size_t site_begin, size_t site_end)
+    {
 
-            if (site_matrix_probs != NULL)
-            {
-                matrix_probs = site_matrix_probs->getValue();
-            }
+        // get pointer the likelihood
+        const double*   p_mixture     = p_node + site_begin*this->siteOffset;
+        // iterate over all mixture categories
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+        {
 
-            f = std::vector<double>(ff[0].size(), 0.0);
+            // get pointers to the likelihood for this mixture category
+            const double*   p_site_mixture     = p_mixture;
+            // iterate over all sites
 
-            for (size_t matrix = 0; matrix < ff.size(); matrix++)
+            for (size_t site = site_begin; site < site_end; ++site)
             {
-                // get the root frequencies
-                const std::vector<double> &fm = ff[matrix];
-
-                for (size_t i = 0; i < fm.size(); i++)
+                // temporary variable storing the likelihood
+                double tmp = 0.0;
+                // get the pointers to the likelihoods for this site and mixture category
+                const double* p_site_j   = p_site_mixture;
+                // iterate over all starting states
+                for (size_t i=0; i<num_chars; ++i)
                 {
-                    f[i] += fm[i] * matrix_probs[matrix];
+                    // add the probability of starting from this state
+                    tmp += *p_site_j;
+
+                    // increment pointers
+                    ++p_site_j;
                 }
-            }
-        }
+                // add the likelihood for this mixture category
+                per_mixture_Likelihoods[site] += tmp * site_mixture_probs[mixture];
 
-        for (size_t site = 0; site < pattern_block_size; ++site, ++patterns)
-        {
+                // increment the pointers to the next site
+                p_site_mixture+=this->siteOffset;
 
-            if ( RbSettings::userSettings().getUseScaling() == true )
-            {
+            } // end-for over all sites (=patterns)
 
-                if ( this->site_invariant[site] == true  && this->invariant_site_index[site] < this->num_chars )
-                {
-//                    rv[site] = log( prob_invariant * f[ this->invariant_site_index[site] ] * exp(this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site]) + oneMinusPInv * per_mixture_Likelihoods[site] ) * *patterns;
-                    rv[site] = log( prob_invariant * f[ this->invariant_site_index[site] ] + oneMinusPInv * per_mixture_Likelihoods[site] / exp(this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site]) ) * *patterns;
-                }
-                else if ( this->site_invariant[site] == false )
-                {
-                    rv[site] = log( oneMinusPInv * per_mixture_Likelihoods[site] ) * *patterns;
-                    rv[site] -= this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] * *patterns;
-                }
+            // increment the pointers to the next mixture category
+            p_mixture+=this->mixtureOffset;
 
-//                rv[site] = log( oneMinusPInv * per_mixture_Likelihoods[site] ) * *patterns;
-//                rv[site] -= this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] * *patterns;
-//
-//                if ( this->site_invariant[site] == true )
-//                {
-//                    rv[site] += log( prob_invariant * f[ this->invariant_site_index[site] ] ) * *patterns;
-//                }
+        } // end-for over all mixtures
 
-            }
-            else // no scaling
+        if ( prob_invariant > 0.0 )
+        {
+
+            for (size_t site = site_begin; site < site_end; ++site)
             {
+                size_t pattern_count = this->pattern_counts[site];
 
-                if ( this->site_invariant[site] == true && this->invariant_site_index[site] < this->num_chars )
+                if ( use_scaling == true )
                 {
-                    rv[site] = log( prob_invariant * f[ this->invariant_site_index[site] ]  + oneMinusPInv * per_mixture_Likelihoods[site] ) * *patterns;
+
+                    if ( this->site_invariant[site] == true  && this->invariant_site_index[site] < this->num_chars )
+                    {
+                        rv[site] = log( prob_invariant * f[ this->invariant_site_index[site] ] + oneMinusPInv * per_mixture_Likelihoods[site] / exp(root_scaling_factors[site]) ) * pattern_count;
+                    }
+                    else if ( this->site_invariant[site] == false )
+                    {
+                        rv[site] = log( oneMinusPInv * per_mixture_Likelihoods[site] ) * pattern_count;
+                        rv[site] -= root_scaling_factors[site] * pattern_count;
+                    }
+
                 }
-                else if ( this->site_invariant[site] == false )
+                else // no scaling
                 {
-                    rv[site] = log( oneMinusPInv * per_mixture_Likelihoods[site] ) * *patterns;
-                }
 
-//                rv[site] = log( oneMinusPInv * per_mixture_Likelihoods[site] ) * *patterns;
-//                if ( this->site_invariant[site] == true )
-//                {
-//                    rv[site] += log( prob_invariant * f[ this->invariant_site_index[site] ] ) * *patterns;
-//                }
+                    if ( this->site_invariant[site] == true && this->invariant_site_index[site] < this->num_chars )
+                    {
+                        rv[site] = log( prob_invariant * f[ this->invariant_site_index[site] ]  + oneMinusPInv * per_mixture_Likelihoods[site] ) * pattern_count;
+                    }
+                    else if ( this->site_invariant[site] == false )
+                    {
+                        rv[site] = log( oneMinusPInv * per_mixture_Likelihoods[site] ) * pattern_count;
+                    }
+
+                }
 
             }
 
         }
-
-    }
-    else
-    {
-
-        for (size_t site = 0; site < pattern_block_size; ++site, ++patterns)
+        else
         {
-            rv[site] = log( per_mixture_Likelihoods[site] ) * *patterns;
 
-            if ( RbSettings::userSettings().getUseScaling() == true )
+            for (size_t site = site_begin; site < site_end; ++site)
             {
-                rv[site] -= this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] * *patterns;
+                size_t pattern_count = this->pattern_counts[site];
+
+                rv[site] = log( per_mixture_Likelihoods[site] ) * pattern_count;
+
+                if ( use_scaling == true )
+                {
+                    rv[site] -= root_scaling_factors[site] * pattern_count;
+                }
+
             }
-                        
+
         }
 
-    }
+    } );
 
 }
 
@@ -3352,7 +4342,8 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
     size_t node_index = root.getIndex();
 
     // get the pointers to the partial likelihoods of the left and right subtree
-    double*   p_node  = this->partialLikelihoods + this->activeLikelihood[node_index] * this->activeLikelihoodOffset  + node_index*this->nodeOffset;
+    std::vector<double> node_buffer;
+    const double*   p_node  = getNodePartialLikelihoods( node_index, node_buffer );
 
     // create a vector for the per mixture likelihoods
     // we need this vector to sum over the different mixture likelihoods
@@ -3361,13 +4352,13 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
     std::vector<double> site_mixture_probs = getMixtureProbs();
 
     // get pointer the likelihood
-    double*   p_mixture     = p_node;
+    const double*   p_mixture     = p_node;
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
     {
 
         // get pointers to the likelihood for this mixture category
-        double*   p_site_mixture     = p_mixture;
+        const double*   p_site_mixture     = p_mixture;
         // iterate over all sites
 
         for (size_t site = 0; site < pattern_block_size; ++site)
@@ -3375,7 +4366,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
             // temporary variable storing the likelihood
             double tmp = 0.0;
             // get the pointers to the likelihoods for this site and mixture category
-            double* p_site_j   = p_site_mixture;
+            const double* p_site_j   = p_site_mixture;
             // iterate over all starting states
             for (size_t i=0; i<num_chars; ++i)
             {
@@ -3443,7 +4434,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
                 {
                     rv[site][site_rate_index * num_site_matrices + matrix] = log( oneMinusPInv * per_site_mixture_Likelihoods[site][site_rate_index * num_site_matrices + matrix] ) * *patterns;
 
-                    if ( RbSettings::userSettings().getUseScaling() == true )
+                    if ( isUsingScaling() == true )
                     {
                         rv[site][site_rate_index * num_site_matrices + matrix] -= this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] * *patterns;
                     }
@@ -3464,7 +4455,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
             {
                 rv[site][mixture] = log( per_site_mixture_Likelihoods[site][mixture] ) * *patterns;
 
-                if ( RbSettings::userSettings().getUseScaling() == true )
+                if ( isUsingScaling() == true )
                 {
                     rv[site][mixture] -= this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] * *patterns;
                 }
@@ -3487,7 +4478,8 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
     size_t node_index = root.getIndex();
 
     // get the pointers to the partial likelihoods of the left and right subtree
-    double*   p_node  = this->partialLikelihoods + this->activeLikelihood[node_index] * this->activeLikelihoodOffset  + node_index*this->nodeOffset;
+    std::vector<double> node_buffer;
+    const double*   p_node  = getNodePartialLikelihoods( node_index, node_buffer );
 
     size_t num_site_matrices = num_site_mixtures/num_site_rates;
 
@@ -3498,14 +4490,14 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
     std::vector<double> site_mixture_probs = getMixtureProbs();
 
     // get pointer the likelihood
-    double*   p_mixture     = p_node;
+    const double*   p_mixture     = p_node;
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
     {
         size_t site_rate_index = mixture / num_site_matrices;
 
         // get pointers to the likelihood for this mixture category
-        double*   p_site_mixture     = p_mixture;
+        const double*   p_site_mixture     = p_mixture;
         // iterate over all sites
 
         for (size_t site = 0; site < pattern_block_size; ++site)
@@ -3513,7 +4505,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
             // temporary variable storing the likelihood
             double tmp = 0.0;
             // get the pointers to the likelihoods for this site and mixture category
-            double* p_site_j   = p_site_mixture;
+            const double* p_site_j   = p_site_mixture;
             // iterate over all starting states
             for (size_t i=0; i<num_chars; ++i)
             {
@@ -3542,36 +4534,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
     if ( prob_invariant > 0.0 )
     {
         // get the mean root frequency vector
-        std::vector<double> f;
-        if (this->branch_heterogeneous_substitution_matrices == true)
-        {
-            f = this->getRootFrequencies(0);
-        }
-        else
-        {
-            std::vector<std::vector<double> > ff;
-            getRootFrequencies(ff);
-
-            std::vector<double> matrix_probs(num_matrices, 1.0/num_matrices);
-
-            if (site_matrix_probs != NULL)
-            {
-                matrix_probs = site_matrix_probs->getValue();
-            }
-
-            f = std::vector<double>(ff[0].size(), 0.0);
-
-            for (size_t matrix = 0; matrix < ff.size(); matrix++)
-            {
-                // get the root frequencies
-                const std::vector<double> &fm = ff[matrix];
-
-                for (size_t i = 0; i < fm.size(); i++)
-                {
-                    f[i] += fm[i] * matrix_probs[matrix];
-                }
-            }
-        }
+        std::vector<double> f = getInvariantSiteFrequencies();
 
         size_t num_site_rates_withInv = num_site_rates + 1;
 
@@ -3592,7 +4555,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
             {
                 rv[site][site_rate_index] = log( oneMinusPInv * per_site_rate_Likelihoods[site][site_rate_index - 1] ) * *patterns;
 
-                if ( RbSettings::userSettings().getUseScaling() == true )
+                if ( isUsingScaling() == true )
                 {
                     rv[site][site_rate_index] -= this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] * *patterns;
                 }
@@ -3611,7 +4574,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
             {
                 rv[site][site_rate_index] = log( per_site_rate_Likelihoods[site][site_rate_index] ) * *patterns;
 
-                if ( RbSettings::userSettings().getUseScaling() == true )
+                if ( isUsingScaling() == true )
                 {
                     rv[site][site_rate_index] -= this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] * *patterns;
                 }
@@ -3635,6 +4598,8 @@ double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::sumRootLikeliho
 
     double sum_partial_probs = 0.0;
 
+    // the site likelihoods may have been computed by several threads,
+    // but we always sum them up in the order of the patterns so that the result is reproducible
     for (size_t site = 0; site < pattern_block_size; ++site)
     {
         sum_partial_probs += site_likelihoods[site];
@@ -3857,29 +4822,38 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateTransitionP
 
     if (node->isRoot()) throw RbException("dnPhyloCTMC called updateTransitionProbabilities for the root node\n");
 
-    // second, get the clock rate for the branch
-    double rate = 1.0;
-    if ( this->branch_heterogeneous_clock_rates == true )
-    {
-        rate = this->heterogeneous_clock_rates->getValue()[node_idx];
-    }
-    else if (homogeneous_clock_rate != NULL)
+    // we might have computed the matrices for all branches already
+    if ( use_precomputed_transition_probabilities == true )
     {
-        rate = this->homogeneous_clock_rate->getValue();
+        size_t num_mixtures = this->num_site_rates * this->num_matrices;
+        for (size_t k = 0; k < num_mixtures; ++k)
+        {
+            this->transition_prob_matrices[k] = precomputed_transition_prob_matrices[node_idx*num_mixtures + k];
+        }
+        return;
     }
 
-    // we rescale the rate by the inverse of the proportion of invariant sites
-    rate /= ( 1.0 - getPInv() );
-
-    double end_age = node->getAge();
+    // get the clock rate and the ages of the branch
+    double rate = 1.0;
+    double start_age = 0.0;
+    double end_age = 0.0;
+    getBranchRateAndAges(node_idx, rate, start_age, end_age);
 
-    // if the tree is not a time tree, then the age will be not a number
-    if ( RbMath::isFinite(end_age) == false )
+    // we compute the matrices of all site rate categories in one batch
+    std::vector<double> start_ages( this->num_site_rates, start_age );
+    std::vector<double> end_ages( this->num_site_rates, end_age );
+    std::vector<double> rates( this->num_site_rates );
+    for (size_t j = 0; j < this->num_site_rates; ++j)
     {
-        // we assume by default that the end is at time 0
-        end_age = 0.0;
+        double r = 1.0;
+        if ( this->rate_variation_across_sites == true )
+        {
+            r = this->site_rates->getValue()[j];
+        }
+
+        rates[j] = rate * r;
     }
-    double start_age = end_age + node->getBranchLength();
+    std::vector<TransitionProbabilityMatrix*> P( this->num_site_rates );
 
     // first, get the rate matrix for this branch
     RateMatrix_JC jc(this->num_chars);
@@ -3900,14 +4874,10 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateTransitionP
 
             for (size_t j = 0; j < this->num_site_rates; ++j)
             {
-                double r = 1.0;
-                if ( this->rate_variation_across_sites == true )
-                {
-                    r = this->site_rates->getValue()[j];
-                }
-
-                rm->calculateTransitionProbabilities( start_age, end_age,  rate * r, this->transition_prob_matrices[j*this->num_matrices + matrix] );
+                P[j] = &this->transition_prob_matrices[j*this->num_matrices + matrix];
             }
+
+            calculateTransitionProbabilities( *rm, start_ages, end_ages, rates, P );
         }
     }
     else
@@ -3923,14 +4893,10 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateTransitionP
 
         for (size_t j = 0; j < this->num_site_rates; ++j)
         {
-            double r = 1.0;
-            if ( this->rate_variation_across_sites == true )
-            {
-                r = this->site_rates->getValue()[j];
-            }
-
-            rm->calculateTransitionProbabilities( start_age, end_age,  rate * r, this->transition_prob_matrices[j] );
+            P[j] = &this->transition_prob_matrices[j];
         }
+
+        calculateTransitionProbabilities( *rm, start_ages, end_ages, rates, P );
     }
 }
 
@@ -0,0 +1,514 @@
+#include "NucleotideLikelihoodKernels.h"
+#include "RbOptions.h"
+
+#if ( defined(__x86_64__) || defined(__i386__) ) && defined(__GNUC__) && !defined(RB_ARM)
+#define RB_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace RevBayesCore;
+
+
+namespace {
+
+    /* ---------------------------------------------------------------------------------------------------
+     * Portable kernels
+     * --------------------------------------------------------------------------------------------------- */
+
+    inline void matrixVectorProduct(const double *P, double x0, double x1, double x2, double x3, double *p)
+    {
+        p[0] = P[0]  * x0 + P[1]  * x1 + P[2]  * x2 + P[3]  * x3;
+        p[1] = P[4]  * x0 + P[5]  * x1 + P[6]  * x2 + P[7]  * x3;
+        p[2] = P[8]  * x0 + P[9]  * x1 + P[10] * x2 + P[11] * x3;
+        p[3] = P[12] * x0 + P[13] * x1 + P[14] * x2 + P[15] * x3;
+    }
+
+    void internal2Generic(const double *P, const double *a, const double *b, double *p, size_t num_sites)
+    {
+        for (size_t site = 0; site < num_sites; ++site)
+        {
+            matrixVectorProduct(P, a[0]*b[0], a[1]*b[1], a[2]*b[2], a[3]*b[3], p);
+            a += 4; b += 4; p += 4;
+        }
+    }
+
+    void internal3Generic(const double *P, const double *a, const double *b, const double *c, double *p, size_t num_sites)
+    {
+        for (size_t site = 0; site < num_sites; ++site)
+        {
+            matrixVectorProduct(P, a[0]*b[0]*c[0], a[1]*b[1]*c[1], a[2]*b[2]*c[2], a[3]*b[3]*c[3], p);
+            a += 4; b += 4; c += 4; p += 4;
+        }
+    }
+
+    void root2Generic(const double *f, const double *a, const double *b, double *p, size_t num_sites)
+    {
+        for (size_t site = 0; site < num_sites; ++site)
+        {
+            p[0] = a[0] * b[0] * f[0];
+            p[1] = a[1] * b[1] * f[1];
+            p[2] = a[2] * b[2] * f[2];
+            p[3] = a[3] * b[3] * f[3];
+            a += 4; b += 4; p += 4;
+        }
+    }
+
+    void root3Generic(const double *f, const double *a, const double *b, const double *c, double *p, size_t num_sites)
+    {
+        for (size_t site = 0; site < num_sites; ++site)
+        {
+            p[0] = a[0] * b[0] * c[0] * f[0];
+            p[1] = a[1] * b[1] * c[1] * f[1];
+            p[2] = a[2] * b[2] * c[2] * f[2];
+            p[3] = a[3] * b[3] * c[3] * f[3];
+            a += 4; b += 4; c += 4; p += 4;
+        }
+    }
+
+    inline size_t tipStateIndex(unsigned long state)
+    {
+        // gaps and missing data are stored with an invalid state index
+        return ( state < 4 ? state : 4 );
+    }
+
+    void tipInternalGeneric(const double *matrices, const unsigned long *tip_states, const double *b, double *p, size_t num_sites)
+    {
+        for (size_t site = 0; site < num_sites; ++site)
+        {
+            // the matrices are stored column-major
+            const double *M = matrices + 16 * tipStateIndex( tip_states[site] );
+            p[0] = M[0] * b[0] + M[4] * b[1] + M[8]  * b[2] + M[12] * b[3];
+            p[1] = M[1] * b[0] + M[5] * b[1] + M[9]  * b[2] + M[13] * b[3];
+            p[2] = M[2] * b[0] + M[6] * b[1] + M[10] * b[2] + M[14] * b[3];
+            p[3] = M[3] * b[0] + M[7] * b[1] + M[11] * b[2] + M[15] * b[3];
+            b += 4; p += 4;
+        }
+    }
+
+
+#if defined( RB_X86_KERNELS )
+
+    /* ---------------------------------------------------------------------------------------------------
+     * SSE3 kernels
+     * --------------------------------------------------------------------------------------------------- */
+
+    __attribute__((target("sse3")))
+    inline void matrixVectorProductSSE3(const double *P, __m128d p01, __m128d p23, double *p)
+    {
+        __m128d a_acgt = _mm_hadd_pd( _mm_mul_pd(p01, _mm_loadu_pd(P)),    _mm_mul_pd(p23, _mm_loadu_pd(P+2)) );
+        __m128d c_acgt = _mm_hadd_pd( _mm_mul_pd(p01, _mm_loadu_pd(P+4)),  _mm_mul_pd(p23, _mm_loadu_pd(P+6)) );
+        __m128d g_acgt = _mm_hadd_pd( _mm_mul_pd(p01, _mm_loadu_pd(P+8)),  _mm_mul_pd(p23, _mm_loadu_pd(P+10)) );
+        __m128d t_acgt = _mm_hadd_pd( _mm_mul_pd(p01, _mm_loadu_pd(P+12)), _mm_mul_pd(p23, _mm_loadu_pd(P+14)) );
+
+        _mm_storeu_pd(p,   _mm_hadd_pd(a_acgt, c_acgt));
+        _mm_storeu_pd(p+2, _mm_hadd_pd(g_acgt, t_acgt));
+    }
+
+    __attribute__((target("sse3")))
+    void internal2SSE3(const double *P, const double *a, const double *b, double *p, size_t num_sites)
+    {
+        for (size_t site = 0; site < num_sites; ++site)
+        {
+            __m128d p01 = _mm_mul_pd( _mm_loadu_pd(a),   _mm_loadu_pd(b) );
+            __m128d p23 = _mm_mul_pd( _mm_loadu_pd(a+2), _mm_loadu_pd(b+2) );
+            matrixVectorProductSSE3(P, p01, p23, p);
+            a += 4; b += 4; p += 4;
+        }
+    }
+
+    __attribute__((target("sse3")))
+    void internal3SSE3(const double *P, const double *a, const double *b, const double *c, double *p, size_t num_sites)
+    {
+        for (size_t site = 0; site < num_sites; ++site)
+        {
+            __m128d p01 = _mm_mul_pd( _mm_mul_pd( _mm_loadu_pd(a),   _mm_loadu_pd(b) ),   _mm_loadu_pd(c) );
+            __m128d p23 = _mm_mul_pd( _mm_mul_pd( _mm_loadu_pd(a+2), _mm_loadu_pd(b+2) ), _mm_loadu_pd(c+2) );
+            matrixVectorProductSSE3(P, p01, p23, p);
+            a += 4; b += 4; c += 4; p += 4;
+        }
+    }
+
+
+    /* ---------------------------------------------------------------------------------------------------
+     * AVX2 + FMA kernels
+     *
+     * We compute P*x as the linear combination of the columns of P, x0*P[,0] + ... + x3*P[,3],
+     * which needs no horizontal additions.
+     * --------------------------------------------------------------------------------------------------- */
+
+    struct ColumnsAVX2 {
+        __m256d c0, c1, c2, c3;
+    };
+
+    __attribute__((target("avx2,fma")))
+    inline ColumnsAVX2 loadColumnsAVX2(const double *P)
+    {
+        ColumnsAVX2 cols;
+        cols.c0 = _mm256_setr_pd(P[0], P[4], P[8],  P[12]);
+        cols.c1 = _mm256_setr_pd(P[1], P[5], P[9],  P[13]);
+        cols.c2 = _mm256_setr_pd(P[2], P[6], P[10], P[14]);
+        cols.c3 = _mm256_setr_pd(P[3], P[7], P[11], P[15]);
+        return cols;
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline __m256d combineColumnsAVX2(const __m256d &c0, const __m256d &c1, const __m256d &c2, const __m256d &c3, __m256d x)
+    {
+        __m256d r = _mm256_mul_pd( _mm256_permute4x64_pd(x, 0x00), c0 );
+        r = _mm256_fmadd_pd( _mm256_permute4x64_pd(x, 0x55), c1, r );
+        r = _mm256_fmadd_pd( _mm256_permute4x64_pd(x, 0xAA), c2, r );
+        r = _mm256_fmadd_pd( _mm256_permute4x64_pd(x, 0xFF), c3, r );
+        return r;
+    }
+
+    __attribute__((target("avx2,fma")))
+    void internal2AVX2(const double *P, const double *a, const double *b, double *p, size_t num_sites)
+    {
+        ColumnsAVX2 cols = loadColumnsAVX2(P);
+        for (size_t site = 0; site < num_sites; ++site)
+        {
+            __m256d x = _mm256_mul_pd( _mm256_loadu_pd(a), _mm256_loadu_pd(b) );
+            _mm256_storeu_pd( p, combineColumnsAVX2(cols.c0, cols.c1, cols.c2, cols.c3, x) );
+            a += 4; b += 4; p += 4;
+        }
+    }
+
+    __attribute__((target("avx2,fma")))
+    void internal3AVX2(const double *P, const double *a, const double *b, const double *c, double *p, size_t num_sites)
+    {
+        ColumnsAVX2 cols = loadColumnsAVX2(P);
+        for (size_t site = 0; site < num_sites; ++site)
+        {
+            __m256d x = _mm256_mul_pd( _mm256_mul_pd( _mm256_loadu_pd(a), _mm256_loadu_pd(b) ), _mm256_loadu_pd(c) );
+            _mm256_storeu_pd( p, combineColumnsAVX2(cols.c0, cols.c1, cols.c2, cols.c3, x) );
+            a += 4; b += 4; c += 4; p += 4;
+        }
+    }
+
+    __attribute__((target("avx2,fma")))
+    void root2AVX2(const double *f, const double *a, const double *b, double *p, size_t num_sites)
+    {
+        __m256d freqs = _mm256_loadu_pd(f);
+        for (size_t site = 0; site < num_sites; ++site)
+        {
+            _mm256_storeu_pd( p, _mm256_mul_pd( _mm256_mul_pd( _mm256_loadu_pd(a), _mm256_loadu_pd(b) ), freqs ) );
+            a += 4; b += 4; p += 4;
+        }
+    }
+
+    __attribute__((target("avx2,fma")))
+    void root3AVX2(const double *f, const double *a, const double *b, const double *c, double *p, size_t num_sites)
+    {
+        __m256d freqs = _mm256_loadu_pd(f);
+        for (size_t site = 0; site < num_sites; ++site)
+        {
+            __m256d x = _mm256_mul_pd( _mm256_mul_pd( _mm256_loadu_pd(a), _mm256_loadu_pd(b) ), _mm256_loadu_pd(c) );
+            _mm256_storeu_pd( p, _mm256_mul_pd( x, freqs ) );
+            a += 4; b += 4; c += 4; p += 4;
+        }
+    }
+
+    __attribute__((target("avx2,fma")))
+    void tipInternalAVX2(const double *matrices, const unsigned long *tip_states, const double *b, double *p, size_t num_sites)
+    {
+        for (size_t site = 0; site < num_sites; ++site)
+        {
+            // the matrices are stored column-major
+            const double *M = matrices + 16 * tipStateIndex( tip_states[site] );
+            __m256d x = _mm256_loadu_pd(b);
+            _mm256_storeu_pd( p, combineColumnsAVX2(_mm256_loadu_pd(M), _mm256_loadu_pd(M+4), _mm256_loadu_pd(M+8), _mm256_loadu_pd(M+12), x) );
+            b += 4; p += 4;
+        }
+    }
+
+
+    /* ---------------------------------------------------------------------------------------------------
+     * AVX-512 kernels
+     *
+     * One 512-bit register holds two sites. A remaining odd site is computed with the AVX2 kernels.
+     * --------------------------------------------------------------------------------------------------- */
+
+    __attribute__((target("avx512f,avx2,fma")))
+    inline __m512d combineColumnsAVX512(const __m512d &c0, const __m512d &c1, const __m512d &c2, const __m512d &c3, __m512d x)
+    {
+        // _mm512_permutex_pd shuffles within each 256-bit lane, i.e., within each site
+        __m512d r = _mm512_mul_pd( _mm512_permutex_pd(x, 0x00), c0 );
+        r = _mm512_fmadd_pd( _mm512_permutex_pd(x, 0x55), c1, r );
+        r = _mm512_fmadd_pd( _mm512_permutex_pd(x, 0xAA), c2, r );
+        r = _mm512_fmadd_pd( _mm512_permutex_pd(x, 0xFF), c3, r );
+        return r;
+    }
+
+    __attribute__((target("avx512f,avx2,fma")))
+    void internal2AVX512(const double *P, const double *a, const double *b, double *p, size_t num_sites)
+    {
+        ColumnsAVX2 cols = loadColumnsAVX2(P);
+        __m512d c0 = _mm512_broadcast_f64x4(cols.c0);
+        __m512d c1 = _mm512_broadcast_f64x4(cols.c1);
+        __m512d c2 = _mm512_broadcast_f64x4(cols.c2);
+        __m512d c3 = _mm512_broadcast_f64x4(cols.c3);
+
+        size_t site = 0;
+        for (; site+1 < num_sites; site += 2)
+        {
+            __m512d x = _mm512_mul_pd( _mm512_loadu_pd(a), _mm512_loadu_pd(b) );
+            _mm512_storeu_pd( p, combineColumnsAVX512(c0, c1, c2, c3, x) );
+            a += 8; b += 8; p += 8;
+        }
+
+        internal2AVX2(P, a, b, p, num_sites - site);
+    }
+
+    __attribute__((target("avx512f,avx2,fma")))
+    void internal3AVX512(const double *P, const double *a, const double *b, const double *c, double *p, size_t num_sites)
+    {
+        ColumnsAVX2 cols = loadColumnsAVX2(P);
+        __m512d c0 = _mm512_broadcast_f64x4(cols.c0);
+        __m512d c1 = _mm512_broadcast_f64x4(cols.c1);
+        __m512d c2 = _mm512_broadcast_f64x4(cols.c2);
+        __m512d c3 = _mm512_broadcast_f64x4(cols.c3);
+
+        size_t site = 0;
+        for (; site+1 < num_sites; site += 2)
+        {
+            __m512d x = _mm512_mul_pd( _mm512_mul_pd( _mm512_loadu_pd(a), _mm512_loadu_pd(b) ), _mm512_loadu_pd(c) );
+            _mm512_storeu_pd( p, combineColumnsAVX512(c0, c1, c2, c3, x) );
+            a += 8; b += 8; c += 8; p += 8;
+        }
+
+        internal3AVX2(P, a, b, c, p, num_sites - site);
+    }
+
+    __attribute__((target("avx512f,avx2,fma")))
+    void root2AVX512(const double *f, const double *a, const double *b, double *p, size_t num_sites)
+    {
+        __m512d freqs = _mm512_broadcast_f64x4( _mm256_loadu_pd(f) );
+
+        size_t site = 0;
+        for (; site+1 < num_sites; site += 2)
+        {
+            _mm512_storeu_pd( p, _mm512_mul_pd( _mm512_mul_pd( _mm512_loadu_pd(a), _mm512_loadu_pd(b) ), freqs ) );
+            a += 8; b += 8; p += 8;
+        }
+
+        root2AVX2(f, a, b, p, num_sites - site);
+    }
+
+    __attribute__((target("avx512f,avx2,fma")))
+    void root3AVX512(const double *f, const double *a, const double *b, const double *c, double *p, size_t num_sites)
+    {
+        __m512d freqs = _mm512_broadcast_f64x4( _mm256_loadu_pd(f) );
+
+        size_t site = 0;
+        for (; site+1 < num_sites; site += 2)
+        {
+            __m512d x = _mm512_mul_pd( _mm512_mul_pd( _mm512_loadu_pd(a), _mm512_loadu_pd(b) ), _mm512_loadu_pd(c) );
+            _mm512_storeu_pd( p, _mm512_mul_pd( x, freqs ) );
+            a += 8; b += 8; c += 8; p += 8;
+        }
+
+        root3AVX2(f, a, b, c, p, num_sites - site);
+    }
+
+    __attribute__((target("avx512f,avx2,fma")))
+    inline __m512d loadTwoSitesAVX512(const double *first, const double *second)
+    {
+        return _mm512_insertf64x4( _mm512_castpd256_pd512( _mm256_loadu_pd(first) ), _mm256_loadu_pd(second), 1 );
+    }
+
+    __attribute__((target("avx512f,avx2,fma")))
+    void tipInternalAVX512(const double *matrices, const unsigned long *tip_states, const double *b, double *p, size_t num_sites)
+    {
+        size_t site = 0;
+        for (; site+1 < num_sites; site += 2)
+        {
+            // the matrices are stored column-major
+            const double *M1 = matrices + 16 * tipStateIndex( tip_states[site] );
+            const double *M2 = matrices + 16 * tipStateIndex( tip_states[site+1] );
+            __m512d c0 = loadTwoSitesAVX512(M1,    M2);
+            __m512d c1 = loadTwoSitesAVX512(M1+4,  M2+4);
+            __m512d c2 = loadTwoSitesAVX512(M1+8,  M2+8);
+            __m512d c3 = loadTwoSitesAVX512(M1+12, M2+12);
+            _mm512_storeu_pd( p, combineColumnsAVX512(c0, c1, c2, c3, _mm512_loadu_pd(b)) );
+            b += 8; p += 8;
+        }
+
+        tipInternalAVX2(matrices, tip_states + site, b, p, num_sites - site);
+    }
+
+#endif
+
+
+    NucleotideLikelihoodKernels makeKernels(NucleotideLikelihoodKernels::InstructionSet isa)
+    {
+        NucleotideLikelihoodKernels k;
+        k.instruction_set   = NucleotideLikelihoodKernels::GENERIC;
+        k.name              = "generic";
+        k.internal2         = &internal2Generic;
+        k.internal3         = &internal3Generic;
+        k.root2             = &root2Generic;
+        k.root3             = &root3Generic;
+        k.tipInternal       = &tipInternalGeneric;
+
+#if defined( RB_X86_KERNELS )
+        if ( isa == NucleotideLikelihoodKernels::SSE3 )
+        {
+            k.instruction_set   = isa;
+            k.name              = "SSE3";
+            k.internal2         = &internal2SSE3;
+            k.internal3         = &internal3SSE3;
+        }
+        else if ( isa == NucleotideLikelihoodKernels::AVX2 )
+        {
+            k.instruction_set   = isa;
+            k.name              = "AVX2+FMA";
+            k.internal2         = &internal2AVX2;
+            k.internal3         = &internal3AVX2;
+            k.root2             = &root2AVX2;
+            k.root3             = &root3AVX2;
+            k.tipInternal       = &tipInternalAVX2;
+        }
+        else if ( isa == NucleotideLikelihoodKernels::AVX512 )
+        {
+            k.instruction_set   = isa;
+            k.name              = "AVX-512";
+            k.internal2         = &internal2AVX512;
+            k.internal3         = &internal3AVX512;
+            k.root2             = &root2AVX512;
+            k.root3             = &root3AVX512;
+            k.tipInternal       = &tipInternalAVX512;
+        }
+#endif
+
+        return k;
+    }
+
+
+    bool isSupported(NucleotideLikelihoodKernels::InstructionSet isa)
+    {
+
+#if defined( RB_X86_KERNELS )
+        __builtin_cpu_init();
+        switch ( isa )
+        {
+            case NucleotideLikelihoodKernels::AVX512:
+                return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+            case NucleotideLikelihoodKernels::AVX2:
+                return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+            case NucleotideLikelihoodKernels::SSE3:
+                return __builtin_cpu_supports("sse3");
+            default:
+                return true;
+        }
+#else
+        return isa == NucleotideLikelihoodKernels::GENERIC;
+#endif
+
+    }
+
+}
+
+
+/**
+ * Get the kernels for the widest instruction set supported by this CPU.
+ * The CPU is queried only once.
+ */
+const NucleotideLikelihoodKernels& NucleotideLikelihoodKernels::getKernels( void )
+{
+
+    static const NucleotideLikelihoodKernels &best = getKernels( AVX512 );
+    return best;
+}
+
+
+/**
+ * Get the kernels for the requested instruction set.
+ * If the CPU does not support it, then we return the kernels for the next narrower instruction set.
+ */
+const NucleotideLikelihoodKernels& NucleotideLikelihoodKernels::getKernels( InstructionSet isa )
+{
+
+    static const NucleotideLikelihoodKernels all_kernels[] = { makeKernels(GENERIC), makeKernels(SSE3), makeKernels(AVX2), makeKernels(AVX512) };
+
+    int i = int(isa);
+    while ( i > int(GENERIC) && isSupported( InstructionSet(i) ) == false )
+    {
+        --i;
+    }
+
+    return all_kernels[i];
+}
+
+
+void NucleotideLikelihoodKernels::computeTipStateVectors(const double *tip_P, double *tip_vectors)
+{
+
+    // the observed states
+    for (size_t c = 0; c < 4; ++c)
+    {
+        for (size_t j = 0; j < 4; ++j)
+        {
+            tip_vectors[c*4+j] = tip_P[j*4+c];
+        }
+    }
+
+    // the gap state
+    for (size_t j = 0; j < 4; ++j)
+    {
+        tip_vectors[16+j] = 1.0;
+    }
+
+}
+
+
+void NucleotideLikelihoodKernels::computeTipTipTable(const double *P, const double *left_vectors, const double *right_vectors, double *table)
+{
+
+    for (size_t cl = 0; cl < 5; ++cl)
+    {
+        const double *l = left_vectors + cl*4;
+        for (size_t cr = 0; cr < 5; ++cr)
+        {
+            const double *r = right_vectors + cr*4;
+            matrixVectorProduct(P, l[0]*r[0], l[1]*r[1], l[2]*r[2], l[3]*r[3], table + (cl*5+cr)*4);
+        }
+    }
+
+}
+
+
+void NucleotideLikelihoodKernels::computeTipInternalMatrices(const double *P, const double *tip_vectors, double *matrices)
+{
+
+    for (size_t c = 0; c < 5; ++c)
+    {
+        const double *t = tip_vectors + c*4;
+        double *M = matrices + c*16;
+
+        // we store the matrices column-major
+        for (size_t i = 0; i < 4; ++i)
+        {
+            for (size_t j = 0; j < 4; ++j)
+            {
+                M[j*4+i] = P[i*4+j] * t[j];
+            }
+        }
+    }
+
+}
+
+
+void NucleotideLikelihoodKernels::tipTip(const double *table, const unsigned long *left_states, const unsigned long *right_states, double *p, size_t num_sites)
+{
+
+    for (size_t site = 0; site < num_sites; ++site)
+    {
+        const double *t = table + ( tipStateIndex( left_states[site] ) * 5 + tipStateIndex( right_states[site] ) ) * 4;
+        p[0] = t[0];
+        p[1] = t[1];
+        p[2] = t[2];
+        p[3] = t[3];
+        p += 4;
+    }
+
+}
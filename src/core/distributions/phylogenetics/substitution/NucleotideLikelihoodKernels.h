@@ -0,0 +1,58 @@
+#ifndef NucleotideLikelihoodKernels_H
+#define NucleotideLikelihoodKernels_H
+
+#include <cstddef>
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Vectorized 4-state pruning kernels.
+     *
+     * This struct holds the inner loops of the Felsenstein pruning algorithm for nucleotide models.
+     * Each kernel works on the partial likelihoods of one mixture category for a contiguous range of sites,
+     * where the four states of a site are stored contiguously (i.e., the site offset is 4).
+     *
+     * There are several implementations of each kernel: a portable one, one for SSE3, one for AVX2+FMA
+     * and one for AVX-512. The wider implementations are compiled with function specific target attributes,
+     * so the binary itself only requires the baseline instruction set. The widest set of kernels
+     * supported by the CPU is chosen once, at the first call of getKernels(), using CPUID.
+     *
+     * Note that the different implementations sum the terms in a different order (and FMA skips an intermediate rounding),
+     * so results may differ in the last bits between machines.
+     *
+     * The cherry kernels take the observed states of a tip (as stored in the char_matrix of the CTMC).
+     * States larger than 3 denote gaps/missing data, which have the partial likelihood (1,1,1,1).
+     *
+     */
+    struct NucleotideLikelihoodKernels {
+
+        enum InstructionSet { GENERIC, SSE3, AVX2, AVX512 };
+
+        static const NucleotideLikelihoodKernels&   getKernels(void);                                                           //!< Get the widest kernels supported by this CPU
+        static const NucleotideLikelihoodKernels&   getKernels(InstructionSet isa);                                             //!< Get the kernels for a specific instruction set (falls back to narrower ones if not supported)
+
+        // build the lookup tables for the cherry kernels (these are independent of the instruction set)
+        static void                                 computeTipStateVectors(const double *tip_P, double *tip_vectors);           //!< tip_vectors[c*4+j] = P_tip[j][c] for c<4 and 1 for the gap state c=4
+        static void                                 computeTipTipTable(const double *P, const double *left_vectors, const double *right_vectors, double *table);   //!< table[(cl*5+cr)*4+i] = sum_j P[i][j]*left[cl][j]*right[cr][j]
+        static void                                 computeTipInternalMatrices(const double *P, const double *tip_vectors, double *matrices);   //!< matrices[c*16+i*4+j] = P[i][j]*tip[c][j]
+        static void                                 tipTip(const double *table, const unsigned long *left_states, const unsigned long *right_states, double *p, size_t num_sites);  //!< p = table[left,right]
+
+        InstructionSet                              instruction_set;
+        const char*                                 name;
+
+        // p = P * (a .* b)
+        void                                        (*internal2)(const double *P, const double *a, const double *b, double *p, size_t num_sites);
+        // p = P * (a .* b .* c)
+        void                                        (*internal3)(const double *P, const double *a, const double *b, const double *c, double *p, size_t num_sites);
+        // p = a .* b .* f
+        void                                        (*root2)(const double *f, const double *a, const double *b, double *p, size_t num_sites);
+        // p = a .* b .* c .* f
+        void                                        (*root3)(const double *f, const double *a, const double *b, const double *c, double *p, size_t num_sites);
+        // p = M[tip_state] * b
+        void                                        (*tipInternal)(const double *matrices, const unsigned long *tip_states, const double *b, double *p, size_t num_sites);
+
+    };
+
+}
+
+#endif
@@ -35,6 +35,7 @@ namespace RevBayesCore {
         // public member functions
         PhyloCTMCClado*                                     clone(void) const;                                                                          //!< Create an independent clone
         virtual double                                      computeLnProbability(void);
+        virtual bool                                        computeRegraftLnProbabilities(const DagNode *tree, const TopologyNode &pruned, const std::vector<TopologyNode*> &targets, std::vector<double> &ln_probs);
         virtual std::vector<charType>						drawAncestralStatesForNode(const TopologyNode &n);
         virtual void                                        drawJointConditionalAncestralStates(std::vector<std::vector<charType> >& startStates, std::vector<std::vector<charType> >& endStates);
         virtual void                                        recursivelyDrawJointConditionalAncestralStates(const TopologyNode &node, std::vector<std::vector<charType> >& startStates, std::vector<std::vector<charType> >& endStates, const std::vector<size_t>& sampledSiteRates);
@@ -53,6 +54,7 @@ namespace RevBayesCore {
 		void                                                computeInternalNodeLikelihood(const TopologyNode &n, size_t nIdx, size_t l, size_t r);
 		void                                                computeInternalNodeLikelihood(const TopologyNode &n, size_t nIdx, size_t l, size_t r, size_t m);
         void                                                computeTipLikelihood(const TopologyNode &node, size_t nIdx);
+        const RateGenerator*                                getTransitionProbabilityAction(size_t nodeIdx) const;                       //!< The rate generator of the branch if it is applied directly to the partial likelihoods (NULL otherwise)
         void                                                updateTransitionProbabilities(size_t nodeIdx, double brlen);
 
         virtual void                                        computeMarginalNodeLikelihood(size_t nodeIdx, size_t parentIdx);
@@ -241,6 +243,18 @@ double RevBayesCore::PhyloCTMCClado<charType>::computeLnProbability( void )
 
 
 
+/**
+ * The cladogenetic events happen at the nodes, so regrafting a subtree creates a new cladogenetic node.
+ * We cannot compute this from the anagenetic partial likelihoods and let the caller use the regular computation.
+ */
+template<class charType>
+bool RevBayesCore::PhyloCTMCClado<charType>::computeRegraftLnProbabilities(const DagNode *tree, const TopologyNode &pruned, const std::vector<TopologyNode*> &targets, std::vector<double> &ln_probs)
+{
+
+    return false;
+}
+
+
 template<class charType>
 void RevBayesCore::PhyloCTMCClado<charType>::computeRootLikelihood( size_t root, size_t left, size_t right)
 {
@@ -349,8 +363,21 @@ void RevBayesCore::PhyloCTMCClado<charType>::computeInternalNodeLikelihood(const
     // bypass cladogenetic probs if it's a sampled ancestor
     bool has_sampled_ancestor_child = node.getChild(0).isSampledAncestor() || node.getChild(1).isSampledAncestor();
     
-    // compute the transition probability matrix
-    this->updateTransitionProbabilities( node_index, node.getBranchLength() );
+    // compute the transition probability matrix, unless we apply the rate generator directly to the cladogenetic partial likelihoods
+    const RateGenerator* rm = getTransitionProbabilityAction( node_index );
+    double rate = 1.0;
+    double start_age = 0.0;
+    double end_age = 0.0;
+    std::vector<double> p_clado_buffer;
+    if ( rm == NULL )
+    {
+        this->updateTransitionProbabilities( node_index, node.getBranchLength() );
+    }
+    else
+    {
+        this->getBranchRateAndAges( node_index, rate, start_age, end_age );
+        p_clado_buffer.resize( this->num_patterns * this->num_chars );
+    }
     
     // get the pointers to the partial likelihoods for this node and the two descendant subtrees
     const double*   p_left  = this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
@@ -412,22 +439,33 @@ void RevBayesCore::PhyloCTMCClado<charType>::computeInternalNodeLikelihood(const
                 }
             }
             
-            // get the pointers for this mixture category and this site
-            const double*       tp_a    = tp_begin;
-            
-            // start state at older end of branch
-            for (size_t c0 = 0; c0 < this->num_chars; ++c0) {
-                double sum_ana = 0.0;
+            if ( rm == NULL )
+            {
+                // get the pointers for this mixture category and this site
+                const double*       tp_a    = tp_begin;
                 
-                for (size_t c1 = 0; c1 < this->num_chars; ++c1) {
-                    sum_ana += tp_a[c1] * p_clado_site_mixture[c1];
+                // start state at older end of branch
+                for (size_t c0 = 0; c0 < this->num_chars; ++c0) {
+                    double sum_ana = 0.0;
+                    
+                    for (size_t c1 = 0; c1 < this->num_chars; ++c1) {
+                        sum_ana += tp_a[c1] * p_clado_site_mixture[c1];
+                    }
+                    
+                    // store the likelihood for this starting state
+                    p_site_mixture[c0] = sum_ana;
+                    
+                    // increment the pointers to the next starting state
+                    tp_a+=this->num_chars;
+                }
+            }
+            else
+            {
+                // collect the cladogenetic likelihoods of all sites for the anagenetic step below
+                for (size_t c1 = 0; c1 < this->num_chars; ++c1)
+                {
+                    p_clado_buffer[site*this->num_chars + c1] = p_clado_site_mixture[c1];
                 }
-                
-                // store the likelihood for this starting state
-                p_site_mixture[c0] = sum_ana;
-                
-                // increment the pointers to the next starting state
-                tp_a+=this->num_chars;
             }
 
             // increment the pointers to the next site
@@ -437,6 +475,13 @@ void RevBayesCore::PhyloCTMCClado<charType>::computeInternalNodeLikelihood(const
             p_clado_site_mixture += this->cladoSiteOffset;
 
         } // end-for over all sites (=patterns)
+        
+        // the anagenetic changes along the branch for all sites at once
+        if ( rm != NULL )
+        {
+            double r = ( this->rate_variation_across_sites == true ? this->site_rates->getValue()[mixture] : 1.0 );
+            rm->calculateTransitionProbabilityAction( start_age, end_age, rate * r, &p_clado_buffer[0], p_node + offset, this->num_patterns );
+        }
 
     } // end-for over all mixtures (=rate-categories)
 }
@@ -617,6 +662,69 @@ void RevBayesCore::PhyloCTMCClado<charType>::computeTipLikelihood(const Topology
     const std::vector<unsigned long> &char_node = this->char_matrix[data_tip_index];
     const std::vector<RbBitSet> &amb_char_node = this->ambiguous_char_matrix[data_tip_index];
 
+    // for large state spaces we apply the rate generator directly to the observed states
+    const RateGenerator* rm = getTransitionProbabilityAction( node_index );
+    if ( rm != NULL )
+    {
+        double rate = 1.0;
+        double start_age = 0.0;
+        double end_age = 0.0;
+        this->getBranchRateAndAges( node_index, rate, start_age, end_age );
+        
+        // the indicators (or weights) of the observed states
+        std::vector<double> p_observed( this->pattern_block_size * this->num_chars, 0.0 );
+        for (size_t site = 0; site != this->pattern_block_size; ++site)
+        {
+            double* p_observed_site = &p_observed[site*this->num_chars];
+            if ( gap_node[site] == true )
+            {
+                continue;
+            }
+            else if ( this->using_weighted_characters == true )
+            {
+                const RbBitSet &val = amb_char_node[site];
+                std::vector< double > weights = this->value->getCharacter(node_index, site).getWeights();
+                for ( size_t i=0; i<val.size(); ++i )
+                {
+                    p_observed_site[i] = ( val.isSet(i) == true ? weights[i] : 0.0 );
+                }
+            }
+            else if ( this->using_ambiguous_characters == true )
+            {
+                const RbBitSet &val = amb_char_node[site];
+                for ( size_t i=0; i<val.size(); ++i )
+                {
+                    p_observed_site[i] = ( val.isSet(i) == true ? 1.0 : 0.0 );
+                }
+            }
+            else
+            {
+                p_observed_site[ char_node[site] ] = 1.0;
+            }
+        }
+        
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+        {
+            double r = ( this->rate_variation_across_sites == true ? this->site_rates->getValue()[mixture] : 1.0 );
+            double* p_mixture = p_node + mixture*this->mixtureOffset;
+            rm->calculateTransitionProbabilityAction( start_age, end_age, rate * r, &p_observed[0], p_mixture, this->pattern_block_size );
+            
+            // since gaps could have been any state, their likelihood is one
+            for (size_t site = 0; site != this->pattern_block_size; ++site)
+            {
+                if ( gap_node[site] == true )
+                {
+                    for (size_t c1 = 0; c1 < this->num_chars; ++c1)
+                    {
+                        p_mixture[site*this->siteOffset + c1] = 1.0;
+                    }
+                }
+            }
+        }
+        
+        return;
+    }
+
     // compute the transition probabilities
     this->updateTransitionProbabilities( node_index, node.getBranchLength() );
 
@@ -737,6 +845,42 @@ void RevBayesCore::PhyloCTMCClado<charType>::computeTipLikelihood(const Topology
 }
 
 
+/**
+ * Get the rate generator of the branch above this node if we multiply the partial likelihoods by exp(Qt) directly,
+ * which is much faster than computing the dense transition probabilities for large state spaces (e.g., DEC with many areas).
+ * We cannot do this if the cladogenetic events along the branch are sampled.
+ */
+template<class charType>
+const RevBayesCore::RateGenerator* RevBayesCore::PhyloCTMCClado<charType>::getTransitionProbabilityAction(size_t node_index) const
+{
+    
+    if ( useSampledCladogenesis == true )
+    {
+        return NULL;
+    }
+    
+    const RateGenerator* rm = NULL;
+    if ( this->branch_heterogeneous_substitution_matrices == true )
+    {
+        if ( this->heterogeneous_rate_matrices != NULL )
+        {
+            rm = &this->heterogeneous_rate_matrices->getValue()[node_index];
+        }
+    }
+    else if ( this->homogeneous_rate_matrix != NULL )
+    {
+        rm = &this->homogeneous_rate_matrix->getValue();
+    }
+    
+    if ( rm != NULL && rm->prefersTransitionProbabilityAction() == true )
+    {
+        return rm;
+    }
+    
+    return NULL;
+}
+
+
 /**
  * Draw a vector of ancestral states from the marginal distribution (non-conditional of the other ancestral states).
  * Here we assume that the marginal likelihoods have been updated.
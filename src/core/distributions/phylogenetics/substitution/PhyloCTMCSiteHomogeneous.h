@@ -33,7 +33,16 @@ namespace RevBayesCore {
 
     private:
 
-
+        template<class partialType>
+        void                                                computeRootPartialLikelihoods(partialType *partials, size_t root, size_t l, size_t r);
+        template<class partialType>
+        void                                                computeRootPartialLikelihoods(partialType *partials, size_t root, size_t l, size_t r, size_t m);
+        template<class partialType>
+        void                                                computeInternalNodePartialLikelihoods(partialType *partials, size_t nIdx, size_t l, size_t r);
+        template<class partialType>
+        void                                                computeInternalNodePartialLikelihoods(partialType *partials, size_t nIdx, size_t l, size_t r, size_t m);
+        template<class partialType>
+        void                                                computeTipPartialLikelihoods(partialType *partials, const TopologyNode &node, size_t nIdx);
 
     };
 
@@ -44,6 +53,7 @@ namespace RevBayesCore {
 #include "DiscreteCharacterState.h"
 #include "RateMatrix_JC.h"
 #include "RandomNumberFactory.h"
+#include "RbSettings.h"
 #include "TopologyNode.h"
 #include "TransitionProbabilityMatrix.h"
 
@@ -54,6 +64,8 @@ template<class charType>
 RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::PhyloCTMCSiteHomogeneous(const TypedDagNode<Tree> *t, size_t nChars, bool c, size_t nSites, bool amb, bool internal, bool gapmatch) : AbstractPhyloCTMCSiteHomogeneous<charType>(  t, nChars, 1, c, nSites, amb, internal, gapmatch )
 {
 
+    this->use_single_precision = RbSettings::userSettings().getUseSinglePrecision();
+
 }
 
 
@@ -78,65 +90,80 @@ template<class charType>
 void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootLikelihood( size_t root, size_t left, size_t right)
 {
 
-    // get the pointers to the partial likelihoods of the left and right subtree
-          double* p        = this->partialLikelihoods + this->activeLikelihood[root]  * this->activeLikelihoodOffset + root  * this->nodeOffset;
-    const double* p_left   = this->partialLikelihoods + this->activeLikelihood[left]  * this->activeLikelihoodOffset + left  * this->nodeOffset;
-    const double* p_right  = this->partialLikelihoods + this->activeLikelihood[right] * this->activeLikelihoodOffset + right * this->nodeOffset;
+    if ( this->use_single_precision == true )
+    {
+        computeRootPartialLikelihoods( this->partialLikelihoodsSinglePrecision, root, left, right );
+    }
+    else
+    {
+        computeRootPartialLikelihoods( this->partialLikelihoods, root, left, right );
+    }
 
-    // create a vector for the per mixture likelihoods
-    // we need this vector to sum over the different mixture likelihoods
-    std::vector<double> per_mixture_Likelihoods = std::vector<double>(this->num_patterns,0.0);
+}
+
+
+template<class charType>
+template<class partialType>
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootPartialLikelihoods( partialType *partials, size_t root, size_t left, size_t right)
+{
 
-    // get pointers the likelihood for both subtrees
-          double*   p_mixture          = p;
-    const double*   p_mixture_left     = p_left;
-    const double*   p_mixture_right    = p_right;
+    // get the pointers to the partial likelihoods of the left and right subtree
+          partialType* p        = partials + this->getPartialLikelihoodOffset(root);
+    const partialType* p_left   = partials + this->getPartialLikelihoodOffset(left);
+    const partialType* p_right  = partials + this->getPartialLikelihoodOffset(right);
 
     // get the root frequencies
     std::vector<std::vector<double> >   ff;
     this->getRootFrequencies(ff);
 
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    this->computeForPatternBlocks( [&](size_t site_begin, size_t site_end)
     {
-        // get the root frequencies
-        const std::vector<double> &f                    = ff[mixture % ff.size()];
-        std::vector<double>::const_iterator f_end       = f.end();
-        std::vector<double>::const_iterator f_begin     = f.begin();
-
-        // get pointers to the likelihood for this mixture category
-              double*   p_site_mixture          = p_mixture;
-        const double*   p_site_mixture_left     = p_mixture_left;
-        const double*   p_site_mixture_right    = p_mixture_right;
-        // iterate over all sites
-        for (size_t site = 0; site < this->pattern_block_size; ++site)
+        // get pointers the likelihood for both subtrees
+              partialType*   p_mixture          = p + site_begin*this->siteOffset;
+        const partialType*   p_mixture_left     = p_left + site_begin*this->siteOffset;
+        const partialType*   p_mixture_right    = p_right + site_begin*this->siteOffset;
+
+        // iterate over all mixture categories
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
         {
-            // get the pointer to the stationary frequencies
-            std::vector<double>::const_iterator f_j             = f_begin;
-            // get the pointers to the likelihoods for this site and mixture category
-                  double* p_site_j        = p_site_mixture;
-            const double* p_site_left_j   = p_site_mixture_left;
-            const double* p_site_right_j  = p_site_mixture_right;
-            // iterate over all starting states
-            for (; f_j != f_end; ++f_j)
+            // get the root frequencies
+            const std::vector<double> &f                    = ff[mixture % ff.size()];
+            std::vector<double>::const_iterator f_end       = f.end();
+            std::vector<double>::const_iterator f_begin     = f.begin();
+
+            // get pointers to the likelihood for this mixture category
+                  partialType*   p_site_mixture          = p_mixture;
+            const partialType*   p_site_mixture_left     = p_mixture_left;
+            const partialType*   p_site_mixture_right    = p_mixture_right;
+            // iterate over all sites
+            for (size_t site = site_begin; site < site_end; ++site)
             {
-                // add the probability of starting from this state
-                *p_site_j = *p_site_left_j * *p_site_right_j * *f_j;
-
-                // increment pointers
-                ++p_site_j; ++p_site_left_j; ++p_site_right_j;
-            }
+                // get the pointer to the stationary frequencies
+                std::vector<double>::const_iterator f_j             = f_begin;
+                // get the pointers to the likelihoods for this site and mixture category
+                      partialType* p_site_j        = p_site_mixture;
+                const partialType* p_site_left_j   = p_site_mixture_left;
+                const partialType* p_site_right_j  = p_site_mixture_right;
+                // iterate over all starting states
+                for (; f_j != f_end; ++f_j)
+                {
+                    // add the probability of starting from this state
+                    *p_site_j = double(*p_site_left_j) * *p_site_right_j * *f_j;
 
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset; p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset;
+                    // increment pointers
+                    ++p_site_j; ++p_site_left_j; ++p_site_right_j;
+                }
 
-        } // end-for over all sites (=patterns)
+                // increment the pointers to the next site
+                p_site_mixture+=this->siteOffset; p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset;
 
-        // increment the pointers to the next mixture category
-        p_mixture+=this->mixtureOffset; p_mixture_left+=this->mixtureOffset; p_mixture_right+=this->mixtureOffset;
+            } // end-for over all sites (=patterns)
 
-    } // end-for over all mixtures (=rate categories)
+            // increment the pointers to the next mixture category
+            p_mixture+=this->mixtureOffset; p_mixture_left+=this->mixtureOffset; p_mixture_right+=this->mixtureOffset;
 
+        } // end-for over all mixtures (=rate categories)
+    } );
 
 }
 
@@ -145,188 +172,248 @@ template<class charType>
 void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootLikelihood( size_t root, size_t left, size_t right, size_t middle)
 {
 
-    // get the pointers to the partial likelihoods of the left and right subtree
-          double* p        = this->partialLikelihoods + this->activeLikelihood[root]   * this->activeLikelihoodOffset + root   * this->nodeOffset;
-    const double* p_left   = this->partialLikelihoods + this->activeLikelihood[left]   * this->activeLikelihoodOffset + left   * this->nodeOffset;
-    const double* p_right  = this->partialLikelihoods + this->activeLikelihood[right]  * this->activeLikelihoodOffset + right  * this->nodeOffset;
-    const double* p_middle = this->partialLikelihoods + this->activeLikelihood[middle] * this->activeLikelihoodOffset + middle * this->nodeOffset;
+    if ( this->use_single_precision == true )
+    {
+        computeRootPartialLikelihoods( this->partialLikelihoodsSinglePrecision, root, left, right, middle );
+    }
+    else
+    {
+        computeRootPartialLikelihoods( this->partialLikelihoods, root, left, right, middle );
+    }
+
+}
+
 
-    // get pointers the likelihood for both subtrees
-          double*   p_mixture          = p;
-    const double*   p_mixture_left     = p_left;
-    const double*   p_mixture_right    = p_right;
-    const double*   p_mixture_middle   = p_middle;
+template<class charType>
+template<class partialType>
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootPartialLikelihoods( partialType *partials, size_t root, size_t left, size_t right, size_t middle)
+{
+
+    // get the pointers to the partial likelihoods of the left and right subtree
+          partialType* p        = partials + this->getPartialLikelihoodOffset(root);
+    const partialType* p_left   = partials + this->getPartialLikelihoodOffset(left);
+    const partialType* p_right  = partials + this->getPartialLikelihoodOffset(right);
+    const partialType* p_middle = partials + this->getPartialLikelihoodOffset(middle);
 
     // get the root frequencies
     std::vector<std::vector<double> >   ff;
     this->getRootFrequencies(ff);
 
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    this->computeForPatternBlocks( [&](size_t site_begin, size_t site_end)
     {
-        
-        // get the root frequencies
-        const std::vector<double> &f                    = ff[mixture % ff.size()];
-        std::vector<double>::const_iterator f_end       = f.end();
-        std::vector<double>::const_iterator f_begin     = f.begin();
-
-        // get pointers to the likelihood for this mixture category
-              double*   p_site_mixture          = p_mixture;
-        const double*   p_site_mixture_left     = p_mixture_left;
-        const double*   p_site_mixture_right    = p_mixture_right;
-        const double*   p_site_mixture_middle   = p_mixture_middle;
-        // iterate over all sites
-        for (size_t site = 0; site < this->pattern_block_size; ++site)
+        // get pointers the likelihood for both subtrees
+              partialType*   p_mixture          = p + site_begin*this->siteOffset;
+        const partialType*   p_mixture_left     = p_left + site_begin*this->siteOffset;
+        const partialType*   p_mixture_right    = p_right + site_begin*this->siteOffset;
+        const partialType*   p_mixture_middle   = p_middle + site_begin*this->siteOffset;
+
+        // iterate over all mixture categories
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
         {
 
-            // get the pointer to the stationary frequencies
-            std::vector<double>::const_iterator f_j = f_begin;
-            // get the pointers to the likelihoods for this site and mixture category
-                  double* p_site_j        = p_site_mixture;
-            const double* p_site_left_j   = p_site_mixture_left;
-            const double* p_site_right_j  = p_site_mixture_right;
-            const double* p_site_middle_j = p_site_mixture_middle;
-            // iterate over all starting states
-            for (; f_j != f_end; ++f_j)
+            // get the root frequencies
+            const std::vector<double> &f                    = ff[mixture % ff.size()];
+            std::vector<double>::const_iterator f_end       = f.end();
+            std::vector<double>::const_iterator f_begin     = f.begin();
+
+            // get pointers to the likelihood for this mixture category
+                  partialType*   p_site_mixture          = p_mixture;
+            const partialType*   p_site_mixture_left     = p_mixture_left;
+            const partialType*   p_site_mixture_right    = p_mixture_right;
+            const partialType*   p_site_mixture_middle   = p_mixture_middle;
+            // iterate over all sites
+            for (size_t site = site_begin; site < site_end; ++site)
             {
-                // add the probability of starting from this state
-                *p_site_j = *p_site_left_j * *p_site_right_j * *p_site_middle_j * *f_j;
 
-                // increment pointers
-                ++p_site_j; ++p_site_left_j; ++p_site_right_j; ++p_site_middle_j;
-            }
+                // get the pointer to the stationary frequencies
+                std::vector<double>::const_iterator f_j = f_begin;
+                // get the pointers to the likelihoods for this site and mixture category
+                      partialType* p_site_j        = p_site_mixture;
+                const partialType* p_site_left_j   = p_site_mixture_left;
+                const partialType* p_site_right_j  = p_site_mixture_right;
+                const partialType* p_site_middle_j = p_site_mixture_middle;
+                // iterate over all starting states
+                for (; f_j != f_end; ++f_j)
+                {
+                    // add the probability of starting from this state
+                    *p_site_j = double(*p_site_left_j) * *p_site_right_j * *p_site_middle_j * *f_j;
+
+                    // increment pointers
+                    ++p_site_j; ++p_site_left_j; ++p_site_right_j; ++p_site_middle_j;
+                }
 
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset; p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture_middle+=this->siteOffset;
+                // increment the pointers to the next site
+                p_site_mixture+=this->siteOffset; p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture_middle+=this->siteOffset;
 
-        } // end-for over all sites (=patterns)
+            } // end-for over all sites (=patterns)
 
-        // increment the pointers to the next mixture category
-        p_mixture+=this->mixtureOffset; p_mixture_left+=this->mixtureOffset; p_mixture_right+=this->mixtureOffset; p_mixture_middle+=this->mixtureOffset;
+            // increment the pointers to the next mixture category
+            p_mixture+=this->mixtureOffset; p_mixture_left+=this->mixtureOffset; p_mixture_right+=this->mixtureOffset; p_mixture_middle+=this->mixtureOffset;
 
-    } // end-for over all mixtures (=rate categories)
+        } // end-for over all mixtures (=rate categories)
+    } );
 
 }
 
 
 template<class charType>
 void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikelihood(const TopologyNode &node, size_t node_index, size_t left, size_t right)
+{
+
+    if ( this->use_single_precision == true )
+    {
+        computeInternalNodePartialLikelihoods( this->partialLikelihoodsSinglePrecision, node_index, left, right );
+    }
+    else
+    {
+        computeInternalNodePartialLikelihoods( this->partialLikelihoods, node_index, left, right );
+    }
+
+}
+
+
+template<class charType>
+template<class partialType>
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodePartialLikelihoods(partialType *partials, size_t node_index, size_t left, size_t right)
 {
 
     // compute the transition probability matrix
     this->updateTransitionProbabilities( node_index );
 
     // get the pointers to the partial likelihoods for this node and the two descendant subtrees
-    const double*   p_left  = this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
-    const double*   p_right = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
-    double*         p_node  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    const partialType*   p_left  = partials + this->getPartialLikelihoodOffset(left);
+    const partialType*   p_right = partials + this->getPartialLikelihoodOffset(right);
+    partialType*         p_node  = partials + this->getPartialLikelihoodOffset(node_index);
 
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    this->computeForPatternBlocks( [&](size_t site_begin, size_t site_end)
     {
-        // the transition probability matrix for this mixture category
-        const double*    tp_begin                = this->transition_prob_matrices[mixture].theMatrix;
-
-        // get the pointers to the likelihood for this mixture category
-        size_t offset = mixture*this->mixtureOffset;
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
-        // compute the per site probabilities
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
+        // iterate over all mixture categories
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
         {
-
-            // get the pointers for this mixture category and this site
-            const double*       tp_a    = tp_begin;
-            // iterate over the possible starting states
-            for (size_t c1 = 0; c1 < this->num_chars; ++c1)
+            // the transition probability matrix for this mixture category
+            const double*    tp_begin                = this->transition_prob_matrices[mixture].theMatrix;
+
+            // get the pointers to the likelihood for this mixture category
+            size_t offset = mixture*this->mixtureOffset + site_begin*this->siteOffset;
+            partialType*          p_site_mixture          = p_node + offset;
+            const partialType*    p_site_mixture_left     = p_left + offset;
+            const partialType*    p_site_mixture_right    = p_right + offset;
+            // compute the per site probabilities
+            for (size_t site = site_begin; site < site_end ; ++site)
             {
-                // temporary variable
-                double sum = 0.0;
 
-                // iterate over all possible terminal states
-                for (size_t c2 = 0; c2 < this->num_chars; ++c2 )
+                // get the pointers for this mixture category and this site
+                const double*       tp_a    = tp_begin;
+                // iterate over the possible starting states
+                for (size_t c1 = 0; c1 < this->num_chars; ++c1)
                 {
-                    sum += p_site_mixture_left[c2] * p_site_mixture_right[c2] * tp_a[c2];
+                    // temporary variable
+                    double sum = 0.0;
 
-                } // end-for over all distination character
+                    // iterate over all possible terminal states
+                    for (size_t c2 = 0; c2 < this->num_chars; ++c2 )
+                    {
+                        sum += double(p_site_mixture_left[c2]) * p_site_mixture_right[c2] * tp_a[c2];
+
+                    } // end-for over all distination character
+
+                    // store the likelihood for this starting state
+                    p_site_mixture[c1] = sum;
 
-                // store the likelihood for this starting state
-                p_site_mixture[c1] = sum;
-                
-                // increment the pointers to the next starting state
-                tp_a+=this->num_chars;
+                    // increment the pointers to the next starting state
+                    tp_a+=this->num_chars;
 
-            } // end-for over all initial characters
+                } // end-for over all initial characters
 
-            // increment the pointers to the next site
-            p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture+=this->siteOffset;
+                // increment the pointers to the next site
+                p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture+=this->siteOffset;
 
-        } // end-for over all sites (=patterns)
+            } // end-for over all sites (=patterns)
 
-    } // end-for over all mixtures (=rate-categories)
+        } // end-for over all mixtures (=rate-categories)
+    } );
 
 }
 
 
 template<class charType>
 void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikelihood(const TopologyNode &node, size_t node_index, size_t left, size_t right, size_t middle)
+{
+
+    if ( this->use_single_precision == true )
+    {
+        computeInternalNodePartialLikelihoods( this->partialLikelihoodsSinglePrecision, node_index, left, right, middle );
+    }
+    else
+    {
+        computeInternalNodePartialLikelihoods( this->partialLikelihoods, node_index, left, right, middle );
+    }
+
+}
+
+
+template<class charType>
+template<class partialType>
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodePartialLikelihoods(partialType *partials, size_t node_index, size_t left, size_t right, size_t middle)
 {
 
     // compute the transition probability matrix
     this->updateTransitionProbabilities( node_index );
 
     // get the pointers to the partial likelihoods for this node and the two descendant subtrees
-    const double*   p_left      = this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
-    const double*   p_middle    = this->partialLikelihoods + this->activeLikelihood[middle]*this->activeLikelihoodOffset + middle*this->nodeOffset;
-    const double*   p_right     = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
-    double*         p_node      = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    const partialType*   p_left      = partials + this->getPartialLikelihoodOffset(left);
+    const partialType*   p_middle    = partials + this->getPartialLikelihoodOffset(middle);
+    const partialType*   p_right     = partials + this->getPartialLikelihoodOffset(right);
+    partialType*         p_node      = partials + this->getPartialLikelihoodOffset(node_index);
 
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    this->computeForPatternBlocks( [&](size_t site_begin, size_t site_end)
     {
-        // the transition probability matrix for this mixture category
-        const double*    tp_begin                = this->transition_prob_matrices[mixture].theMatrix;
-
-        // get the pointers to the likelihood for this mixture category
-        size_t offset = mixture*this->mixtureOffset;
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_middle   = p_middle + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
-        // compute the per site probabilities
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
+        // iterate over all mixture categories
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
         {
-
-            // get the pointers for this mixture category and this site
-            const double*       tp_a    = tp_begin;
-            // iterate over the possible starting states
-            for (size_t c1 = 0; c1 < this->num_chars; ++c1)
+            // the transition probability matrix for this mixture category
+            const double*    tp_begin                = this->transition_prob_matrices[mixture].theMatrix;
+
+            // get the pointers to the likelihood for this mixture category
+            size_t offset = mixture*this->mixtureOffset + site_begin*this->siteOffset;
+            partialType*          p_site_mixture          = p_node + offset;
+            const partialType*    p_site_mixture_left     = p_left + offset;
+            const partialType*    p_site_mixture_middle   = p_middle + offset;
+            const partialType*    p_site_mixture_right    = p_right + offset;
+            // compute the per site probabilities
+            for (size_t site = site_begin; site < site_end ; ++site)
             {
-                // temporary variable
-                double sum = 0.0;
 
-                // iterate over all possible terminal states
-                for (size_t c2 = 0; c2 < this->num_chars; ++c2 )
+                // get the pointers for this mixture category and this site
+                const double*       tp_a    = tp_begin;
+                // iterate over the possible starting states
+                for (size_t c1 = 0; c1 < this->num_chars; ++c1)
                 {
-                    sum += p_site_mixture_left[c2] * p_site_mixture_middle[c2] * p_site_mixture_right[c2] * tp_a[c2];
+                    // temporary variable
+                    double sum = 0.0;
+
+                    // iterate over all possible terminal states
+                    for (size_t c2 = 0; c2 < this->num_chars; ++c2 )
+                    {
+                        sum += double(p_site_mixture_left[c2]) * p_site_mixture_middle[c2] * p_site_mixture_right[c2] * tp_a[c2];
+
+                    } // end-for over all distination character
 
-                } // end-for over all distination character
-                
-                // store the likelihood for this starting state
-                p_site_mixture[c1] = sum;
+                    // store the likelihood for this starting state
+                    p_site_mixture[c1] = sum;
 
-                // increment the pointers to the next starting state
-                tp_a+=this->num_chars;
+                    // increment the pointers to the next starting state
+                    tp_a+=this->num_chars;
 
-            } // end-for over all initial characters
+                } // end-for over all initial characters
 
-            // increment the pointers to the next site
-            p_site_mixture_left+=this->siteOffset; p_site_mixture_middle+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture+=this->siteOffset;
+                // increment the pointers to the next site
+                p_site_mixture_left+=this->siteOffset; p_site_mixture_middle+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture+=this->siteOffset;
 
-        } // end-for over all sites (=patterns)
+            } // end-for over all sites (=patterns)
 
-    } // end-for over all mixtures (=rate-categories)
+        } // end-for over all mixtures (=rate-categories)
+    } );
 
 }
 
@@ -337,7 +424,24 @@ template<class charType>
 void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeTipLikelihood(const TopologyNode &node, size_t node_index)
 {
 
-    double* p_node = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    if ( this->use_single_precision == true )
+    {
+        computeTipPartialLikelihoods( this->partialLikelihoodsSinglePrecision, node, node_index );
+    }
+    else
+    {
+        computeTipPartialLikelihoods( this->partialLikelihoods, node, node_index );
+    }
+
+}
+
+
+template<class charType>
+template<class partialType>
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeTipPartialLikelihoods(partialType *partials, const TopologyNode &node, size_t node_index)
+{
+
+    partialType* p_node = partials + this->getPartialLikelihoodOffset(node_index);
     
     // get the current correct tip index in case the whole tree change (after performing an empiricalTree Proposal)
     size_t data_tip_index = this->taxon_name_2_tip_index_map[ node.getName() ];
@@ -353,7 +457,7 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeTipLikelihood(cons
     // compute the transition probabilities
     this->updateTransitionProbabilities( node_index );
 
-    double* p_mixture = p_node;
+    partialType* p_mixture = p_node;
 
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
@@ -362,7 +466,7 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeTipLikelihood(cons
         const double* tp_begin = this->transition_prob_matrices[mixture].theMatrix;
 
         // get the pointer to the likelihoods for this site and mixture category
-        double* p_site_mixture = p_mixture;
+        partialType* p_site_mixture = p_mixture;
 
         // iterate over all sites
         for (size_t site = 0; site != this->pattern_block_size; ++site)
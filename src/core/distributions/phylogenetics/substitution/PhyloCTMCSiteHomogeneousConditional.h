@@ -28,6 +28,7 @@ namespace RevBayesCore {
 
         // public member functions
         PhyloCTMCSiteHomogeneousConditional*                clone(void) const;                                                                        //!< Create an independent clone
+        virtual bool                                        computeRegraftLnProbabilities(const DagNode *tree, const TopologyNode &pruned, const std::vector<TopologyNode*> &targets, std::vector<double> &ln_probs);
         void                                                setValue(AbstractHomologousDiscreteCharacterData *v, bool f=false);
         virtual void                                        redrawValue(void);
 
@@ -85,6 +86,9 @@ template<class charType>
 RevBayesCore::PhyloCTMCSiteHomogeneousConditional<charType>::PhyloCTMCSiteHomogeneousConditional(const TypedDagNode<Tree> *t, size_t nChars, bool c, size_t nSites, bool amb, AscertainmentBias::Coding ty, bool internal, bool gapmatch) :
     PhyloCTMCSiteHomogeneous<charType>(  t, nChars, c, nSites, amb, internal, gapmatch ), warned(false), coding(ty), N(nSites), numCorrectionMasks(0)
 {
+    // the correction and Dollo likelihoods access the partial likelihoods directly in double precision
+    this->use_single_precision = false;
+
     if (coding != AscertainmentBias::ALL)
     {
         numCorrectionMasks      = 1;
@@ -126,6 +130,18 @@ RevBayesCore::PhyloCTMCSiteHomogeneousConditional<charType>* RevBayesCore::Phylo
     return new PhyloCTMCSiteHomogeneousConditional<charType>( *this );
 }
 
+
+/**
+ * The ascertainment bias correction depends on the whole tree, so we cannot compute it from the cached partial likelihoods.
+ * The caller needs to use the regular computation instead.
+ */
+template<class charType>
+bool RevBayesCore::PhyloCTMCSiteHomogeneousConditional<charType>::computeRegraftLnProbabilities(const DagNode *tree, const TopologyNode &pruned, const std::vector<TopologyNode*> &targets, std::vector<double> &ln_probs)
+{
+
+    return false;
+}
+
 template<class charType>
 RevBayesCore::PhyloCTMCSiteHomogeneousConditional<charType>::PhyloCTMCSiteHomogeneousConditional(const PhyloCTMCSiteHomogeneousConditional &n) :
     PhyloCTMCSiteHomogeneous< charType>( n ),
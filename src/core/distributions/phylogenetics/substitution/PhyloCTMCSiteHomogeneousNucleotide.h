@@ -3,6 +3,7 @@
 
 #include "AbstractPhyloCTMCSiteHomogeneous.h"
 #include "DnaState.h"
+#include "NucleotideLikelihoodKernels.h"
 #include "RateMatrix.h"
 #include "RbVector.h"
 #include "TopologyNode.h"
@@ -11,6 +12,20 @@
 
 namespace RevBayesCore {
     
+    /**
+     * @brief Site-homogeneous PhyloCTMC specialized for 4-state (nucleotide) characters.
+     *
+     * The inner loops of the pruning algorithm are delegated to NucleotideLikelihoodKernels,
+     * which picks the widest SIMD instruction set of the CPU at runtime.
+     *
+     * If one or both children of an internal node are tips with unambiguous data (cherries),
+     * we index the transition probabilities directly by the observed states in char_matrix
+     * instead of reading the partial likelihoods of the tips. For this we store the
+     * transition probabilities of each tip branch (per mixture category and per observed state)
+     * next to the partial likelihoods, using the same active/inactive double buffering.
+     * The partial likelihoods of the tips are not rescaled, because they cannot underflow.
+     *
+     */
     template<class charType>
     class PhyloCTMCSiteHomogeneousNucleotide : public AbstractPhyloCTMCSiteHomogeneous<charType> {
         
@@ -28,10 +43,17 @@ namespace RevBayesCore {
         void                                                computeRootLikelihood( size_t root, size_t left, size_t right);
         void                                                computeRootLikelihood( size_t root, size_t left, size_t right, size_t middle);
         void                                                computeTipLikelihood(const TopologyNode &node, size_t nIdx);
+        void                                                scale(size_t i);
         
         
     private:        
         
+        double*                                             getTipStateVectors(size_t node_index, size_t mixture);                                      //!< The stored transition probabilities of a tip branch
+        bool                                                useCherryKernel(size_t node_index) const;                                                   //!< Can we compute from the observed states of this node directly?
+        
+        const NucleotideLikelihoodKernels*                  kernels;
+        std::vector<double>                                 tip_state_vectors;                                                                          //!< [active][node][mixture][state][4] with state 4 the gap
+        
     };
     
 }
@@ -47,19 +69,11 @@ namespace RevBayesCore {
 
 #include <cmath>
 #include <cstring>
-#if defined (SSE_ENABLED)
-#include <xmmintrin.h>
-#include <emmintrin.h>
-#include <pmmintrin.h>
-#elif defined ( AVX_ENABLED )
-#include <xmmintrin.h>
-#include <emmintrin.h>
-#include <pmmintrin.h>
-#include <immintrin.h>
-#endif
 
 template<class charType>
-RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::PhyloCTMCSiteHomogeneousNucleotide(const TypedDagNode<Tree> *t, bool c, size_t nSites, bool amb, bool internal, bool gapmatch) : AbstractPhyloCTMCSiteHomogeneous<charType>(  t, 4, 1, c, nSites, amb, internal, gapmatch )
+RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::PhyloCTMCSiteHomogeneousNucleotide(const TypedDagNode<Tree> *t, bool c, size_t nSites, bool amb, bool internal, bool gapmatch) : AbstractPhyloCTMCSiteHomogeneous<charType>(  t, 4, 1, c, nSites, amb, internal, gapmatch ),
+    kernels( &NucleotideLikelihoodKernels::getKernels() ),
+    tip_state_vectors()
 {
     
 }
@@ -97,38 +111,21 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeRootLike
     const double* p_left   = this->partialLikelihoods + this->activeLikelihood[left]  *this->activeLikelihoodOffset + left   * this->nodeOffset;
     const double* p_right  = this->partialLikelihoods + this->activeLikelihood[right] *this->activeLikelihoodOffset + right  * this->nodeOffset;
     
-    // get pointers the likelihood for both subtrees
-          double*   p_mixture          = p;
-    const double*   p_mixture_left     = p_left;
-    const double*   p_mixture_right    = p_right;
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    this->computeForPatternBlocks( [&](size_t site_begin, size_t site_end)
     {
-        // get the root frequencies
-        const std::vector<double> &f = ff[mixture % ff.size()];
-
-        // get pointers to the likelihood for this mixture category
-              double*   p_site_mixture          = p_mixture;
-        const double*   p_site_mixture_left     = p_mixture_left;
-        const double*   p_site_mixture_right    = p_mixture_right;
-        // iterate over all sites
-        for (size_t site = 0; site < this->pattern_block_size; ++site)
+        // iterate over all mixture categories
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
         {
+            // get the root frequencies
+            const std::vector<double> &f = ff[mixture % ff.size()];
             
-            p_site_mixture[0] = p_site_mixture_left[0] * p_site_mixture_right[0] * f[0];
-            p_site_mixture[1] = p_site_mixture_left[1] * p_site_mixture_right[1] * f[1];
-            p_site_mixture[2] = p_site_mixture_left[2] * p_site_mixture_right[2] * f[2];
-            p_site_mixture[3] = p_site_mixture_left[3] * p_site_mixture_right[3] * f[3];
+            // get pointers to the likelihood for this mixture category
+            size_t offset = mixture*this->mixtureOffset + site_begin*this->siteOffset;
             
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset; p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset;
+            kernels->root2( &f[0], p_left + offset, p_right + offset, p + offset, site_end - site_begin );
             
-        } // end-for over all sites (=patterns)
-        
-        // increment the pointers to the next mixture category
-        p_mixture+=this->mixtureOffset; p_mixture_left+=this->mixtureOffset; p_mixture_right+=this->mixtureOffset;
-        
-    } // end-for over all mixtures (=rate categories)
+        } // end-for over all mixtures (=rate categories)
+    } );
     
 }
 
@@ -149,39 +146,21 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeRootLike
     const double* p_right  = this->partialLikelihoods + this->activeLikelihood[right] *this->activeLikelihoodOffset + right  * this->nodeOffset;
     const double* p_middle = this->partialLikelihoods + this->activeLikelihood[middle]*this->activeLikelihoodOffset + middle * this->nodeOffset;
     
-    // get pointers the likelihood for both subtrees
-          double*   p_mixture          = p;
-    const double*   p_mixture_left     = p_left;
-    const double*   p_mixture_right    = p_right;
-    const double*   p_mixture_middle   = p_middle;
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    this->computeForPatternBlocks( [&](size_t site_begin, size_t site_end)
     {
-        // get the root frequencies
-        const std::vector<double> &f = ff[mixture % ff.size()];
-
-        // get pointers to the likelihood for this mixture category
-              double*   p_site_mixture          = p_mixture;
-        const double*   p_site_mixture_left     = p_mixture_left;
-        const double*   p_site_mixture_right    = p_mixture_right;
-        const double*   p_site_mixture_middle   = p_mixture_middle;
-        // iterate over all sites
-        for (size_t site = 0; site < this->pattern_block_size; ++site)
-        {   
-            p_site_mixture[0] = p_site_mixture_left[0] * p_site_mixture_right[0] * p_site_mixture_middle[0] * f[0];
-            p_site_mixture[1] = p_site_mixture_left[1] * p_site_mixture_right[1] * p_site_mixture_middle[1] * f[1];
-            p_site_mixture[2] = p_site_mixture_left[2] * p_site_mixture_right[2] * p_site_mixture_middle[2] * f[2];
-            p_site_mixture[3] = p_site_mixture_left[3] * p_site_mixture_right[3] * p_site_mixture_middle[3] * f[3];
+        // iterate over all mixture categories
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+        {
+            // get the root frequencies
+            const std::vector<double> &f = ff[mixture % ff.size()];
             
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset; p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture_middle+=this->siteOffset;
+            // get pointers to the likelihood for this mixture category
+            size_t offset = mixture*this->mixtureOffset + site_begin*this->siteOffset;
             
-        } // end-for over all sites (=patterns)
-        
-        // increment the pointers to the next mixture category
-        p_mixture+=this->mixtureOffset; p_mixture_left+=this->mixtureOffset; p_mixture_right+=this->mixtureOffset; p_mixture_middle+=this->mixtureOffset;
-        
-    } // end-for over all mixtures (=rate categories)
+            kernels->root3( &f[0], p_left + offset, p_right + offset, p_middle + offset, p + offset, site_end - site_begin );
+            
+        } // end-for over all mixtures (=rate categories)
+    } );
     
 }
 
@@ -193,189 +172,77 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeInternal
     // compute the transition probability matrix
     this->updateTransitionProbabilities( node_index );
     
-#   if defined ( SSE_ENABLED )
-    
-    double* p_left   = this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
-    double* p_right  = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
-    double* p_node   = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
-    //    __m128d* p_left   = (__m128d *) this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
-    //    __m128d* p_right  = (__m128d *) this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
-    //    __m128d* p_node   = (__m128d *) this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
-    
-#   elif defined ( AVX_ENABLED )
-
-    double* p_left   = this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
-    double* p_right  = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
-    double* p_node   = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
-
-    double* tmp_ac = new double[4];
-    double* tmp_gt = new double[4];
-//    double tmp_ac[4];
-//    double tmp_gt[4];
-    
+    // check if we can use the observed states of the children directly
+    bool left_is_tip  = useCherryKernel( left );
+    bool right_is_tip = useCherryKernel( right );
+    if ( left_is_tip == false && right_is_tip == true )
+    {
+        // the tip-internal kernel expects the tip on the left
+        std::swap( left, right );
+        std::swap( left_is_tip, right_is_tip );
+    }
     
-#   else
-
     // get the pointers to the partial likelihoods for this node and the two descendant subtrees
     const double*   p_left  = this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
     const double*   p_right = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
     double*         p_node  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
-
-#   endif
     
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    // the observed states of a tip are stored under the tip index of its taxon, which need not be its node index
+    const unsigned long* char_left  = NULL;
+    const unsigned long* char_right = NULL;
+    if ( left_is_tip == true )
     {
-        // the transition probability matrix for this mixture category
-        const double* tp_begin = this->transition_prob_matrices[mixture].theMatrix;
-        
-        // get the pointers to the likelihood for this mixture category
-        size_t offset = mixture*this->mixtureOffset;
-        
-#       if defined ( SSE_ENABLED )
-        
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
-        
-        __m128d tp_a_ac = _mm_load_pd(tp_begin);
-        __m128d tp_a_gt = _mm_load_pd(tp_begin+2);
-        __m128d tp_c_ac = _mm_load_pd(tp_begin+4);
-        __m128d tp_c_gt = _mm_load_pd(tp_begin+6);
-        __m128d tp_g_ac = _mm_load_pd(tp_begin+8);
-        __m128d tp_g_gt = _mm_load_pd(tp_begin+10);
-        __m128d tp_t_ac = _mm_load_pd(tp_begin+12);
-        __m128d tp_t_gt = _mm_load_pd(tp_begin+14);
-        
-#       elif defined ( AVX_ENABLED )
-        
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
-        
-        __m256d tp_a = _mm256_load_pd(tp_begin);
-        __m256d tp_c = _mm256_load_pd(tp_begin+4);
-        __m256d tp_g = _mm256_load_pd(tp_begin+8);
-        __m256d tp_t = _mm256_load_pd(tp_begin+12);
+        char_left = this->char_matrix[ this->taxon_name_2_tip_index_map[ this->tau->getValue().getNode( left ).getName() ] ].data();
+    }
+    if ( right_is_tip == true )
+    {
+        char_right = this->char_matrix[ this->taxon_name_2_tip_index_map[ this->tau->getValue().getNode( right ).getName() ] ].data();
+    }
+    
+    // build the lookup tables for the cherries once per mixture category
+    std::vector<double> tables;
+    if ( left_is_tip == true && right_is_tip == true )
+    {
+        tables.resize( this->num_site_mixtures * 100 );
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+        {
+            NucleotideLikelihoodKernels::computeTipTipTable( this->transition_prob_matrices[mixture].theMatrix, getTipStateVectors(left, mixture), getTipStateVectors(right, mixture), &tables[mixture*100] );
+        }
+    }
+    else if ( left_is_tip == true )
+    {
+        tables.resize( this->num_site_mixtures * 80 );
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+        {
+            NucleotideLikelihoodKernels::computeTipInternalMatrices( this->transition_prob_matrices[mixture].theMatrix, getTipStateVectors(left, mixture), &tables[mixture*80] );
+        }
+    }
+    
+    this->computeForPatternBlocks( [&](size_t site_begin, size_t site_end)
+    {
+        size_t num_block_sites = site_end - site_begin;
         
-#       else
-
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
-
-#       endif
-
-        // compute the per site probabilities
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
+        // iterate over all mixture categories
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
         {
+            // get the pointers to the likelihood for this mixture category
+            size_t offset = mixture*this->mixtureOffset + site_begin*this->siteOffset;
             
-#           if defined ( SSE_ENABLED )
-            
-            __m128d a01 = _mm_load_pd(p_site_mixture_left);
-            __m128d a23 = _mm_load_pd(p_site_mixture_left+2);
-            
-            __m128d b01 = _mm_load_pd(p_site_mixture_right);
-            __m128d b23 = _mm_load_pd(p_site_mixture_right+2);
-            
-            __m128d p01 = _mm_mul_pd(a01,b01);
-            __m128d p23 = _mm_mul_pd(a23,b23);
-            
-            __m128d a_ac = _mm_mul_pd(p01, tp_a_ac   );
-            __m128d a_gt = _mm_mul_pd(p23, tp_a_gt );
-            __m128d a_acgt = _mm_hadd_pd(a_ac,a_gt);
-            
-            __m128d c_ac = _mm_mul_pd(p01, tp_c_ac );
-            __m128d c_gt = _mm_mul_pd(p23, tp_c_gt );
-            __m128d c_acgt = _mm_hadd_pd(c_ac,c_gt);
-            
-            __m128d ac = _mm_hadd_pd(a_acgt,c_acgt);
-            _mm_store_pd(p_site_mixture,ac);
-            
-            
-            __m128d g_ac = _mm_mul_pd(p01, tp_g_ac  );
-            __m128d g_gt = _mm_mul_pd(p23, tp_g_gt );
-            __m128d g_acgt = _mm_hadd_pd(g_ac,g_gt);
-            
-            __m128d t_ac = _mm_mul_pd(p01, tp_t_ac );
-            __m128d t_gt = _mm_mul_pd(p23, tp_t_gt );
-            __m128d t_acgt = _mm_hadd_pd(t_ac,t_gt);
-            
-            __m128d gt = _mm_hadd_pd(g_acgt,t_acgt);
-            _mm_store_pd(p_site_mixture+2,gt);
- 
-#           elif defined ( AVX_ENABLED )
- 
-            __m256d a = _mm256_load_pd(p_site_mixture_left);
-            __m256d b = _mm256_load_pd(p_site_mixture_right);
-            __m256d p = _mm256_mul_pd(a,b);
-            
-            __m256d a_acgt = _mm256_mul_pd(p, tp_a );
-            __m256d c_acgt = _mm256_mul_pd(p, tp_c );
-            __m256d g_acgt = _mm256_mul_pd(p, tp_g );
-            __m256d t_acgt = _mm256_mul_pd(p, tp_t );
-            
-            __m256d ac   = _mm256_hadd_pd(a_acgt,c_acgt);
-            __m256d gt   = _mm256_hadd_pd(g_acgt,t_acgt);
-            
-            
-            _mm256_store_pd(tmp_ac,ac);
-            _mm256_store_pd(tmp_gt,gt);
-            
-            p_site_mixture[0] = tmp_ac[0] + tmp_ac[2];
-            p_site_mixture[1] = tmp_ac[1] + tmp_ac[3];
-            p_site_mixture[2] = tmp_gt[0] + tmp_gt[2];
-            p_site_mixture[3] = tmp_gt[1] + tmp_gt[3];
-
-#           else
-
-            double p0 = p_site_mixture_left[0] * p_site_mixture_right[0];
-            double p1 = p_site_mixture_left[1] * p_site_mixture_right[1];
-            double p2 = p_site_mixture_left[2] * p_site_mixture_right[2];
-            double p3 = p_site_mixture_left[3] * p_site_mixture_right[3];
-            
-            double sum = p0 * tp_begin[0];
-            sum += p1 * tp_begin[1];
-            sum += p2 * tp_begin[2];
-            sum += p3 * tp_begin[3];
-            
-            p_site_mixture[0] = sum;
-            
-            sum = p0 * tp_begin[4];
-            sum += p1 * tp_begin[5];
-            sum += p2 * tp_begin[6];
-            sum += p3 * tp_begin[7];
-            
-            p_site_mixture[1] = sum;
-            
-            sum = p0 * tp_begin[8];
-            sum += p1 * tp_begin[9];
-            sum += p2 * tp_begin[10];
-            sum += p3 * tp_begin[11];
-            
-            p_site_mixture[2] = sum;
-            
-            sum = p0 * tp_begin[12];
-            sum += p1 * tp_begin[13];
-            sum += p2 * tp_begin[14];
-            sum += p3 * tp_begin[15];
-            
-            p_site_mixture[3] = sum;
-
-#           endif
+            if ( left_is_tip == true && right_is_tip == true )
+            {
+                NucleotideLikelihoodKernels::tipTip( &tables[mixture*100], char_left + site_begin, char_right + site_begin, p_node + offset, num_block_sites );
+            }
+            else if ( left_is_tip == true )
+            {
+                kernels->tipInternal( &tables[mixture*80], char_left + site_begin, p_right + offset, p_node + offset, num_block_sites );
+            }
+            else
+            {
+                kernels->internal2( this->transition_prob_matrices[mixture].theMatrix, p_left + offset, p_right + offset, p_node + offset, num_block_sites );
+            }
             
-            // increment the pointers to the next site
-            p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture+=this->siteOffset;
-
-                        
-        } // end-for over all sites (=patterns)
-        
-    } // end-for over all mixtures (=rate-categories)
-
-# if defined ( AVX_ENABLED )
-    delete[] tmp_ac;
-    delete[] tmp_gt;
-# endif
+        } // end-for over all mixtures (=rate-categories)
+    } );
     
 }
 
@@ -394,159 +261,18 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeInternal
     const double*   p_right     = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
     double*         p_node      = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
     
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    this->computeForPatternBlocks( [&](size_t site_begin, size_t site_end)
     {
-        // the transition probability matrix for this mixture category
-        const double* tp_begin = this->transition_prob_matrices[mixture].theMatrix;
-        
-        // get the pointers to the likelihood for this mixture category
-        size_t offset = mixture*this->mixtureOffset;
-        
-#       if defined ( SSE_ENABLED )
-        
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_middle   = p_middle + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
-        
-        __m128d tp_a_ac = _mm_load_pd(tp_begin);
-        __m128d tp_a_gt = _mm_load_pd(tp_begin+2);
-        __m128d tp_c_ac = _mm_load_pd(tp_begin+4);
-        __m128d tp_c_gt = _mm_load_pd(tp_begin+6);
-        __m128d tp_g_ac = _mm_load_pd(tp_begin+8);
-        __m128d tp_g_gt = _mm_load_pd(tp_begin+10);
-        __m128d tp_t_ac = _mm_load_pd(tp_begin+12);
-        __m128d tp_t_gt = _mm_load_pd(tp_begin+14);
-        
-#       elif defined ( AVX_ENABLED )
-        
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
-        
-        __m256d tp_a = _mm256_load_pd(tp_begin);
-        __m256d tp_c = _mm256_load_pd(tp_begin+4);
-        __m256d tp_g = _mm256_load_pd(tp_begin+8);
-        __m256d tp_t = _mm256_load_pd(tp_begin+12);
-        
-#       else
-        
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_middle   = p_middle + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
-        
-#       endif
-        
-        // compute the per site probabilities
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
+        // iterate over all mixture categories
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
         {
+            // get the pointers to the likelihood for this mixture category
+            size_t offset = mixture*this->mixtureOffset + site_begin*this->siteOffset;
             
-#           if defined ( SSE_ENABLED )
-            
-            __m128d a01 = _mm_load_pd(p_site_mixture_left);
-            __m128d a23 = _mm_load_pd(p_site_mixture_left+2);
-            
-            __m128d b01 = _mm_load_pd(p_site_mixture_middle);
-            __m128d b23 = _mm_load_pd(p_site_mixture_middle+2);
-            
-            __m128d c01 = _mm_load_pd(p_site_mixture_right);
-            __m128d c23 = _mm_load_pd(p_site_mixture_right+2);
-            
-            __m128d tmp_p01 = _mm_mul_pd(a01,b01);
-            __m128d p01 = _mm_mul_pd(tmp_p01,c01);
-            __m128d tmp_p23 = _mm_mul_pd(a23,b23);
-            __m128d p23 = _mm_mul_pd(tmp_p23,c23);
-            
-            __m128d a_ac = _mm_mul_pd(p01, tp_a_ac   );
-            __m128d a_gt = _mm_mul_pd(p23, tp_a_gt );
-            __m128d a_acgt = _mm_hadd_pd(a_ac,a_gt);
-            
-            __m128d c_ac = _mm_mul_pd(p01, tp_c_ac );
-            __m128d c_gt = _mm_mul_pd(p23, tp_c_gt );
-            __m128d c_acgt = _mm_hadd_pd(c_ac,c_gt);
-            
-
-            //            *p_site_mixture = _mm_hadd_pd(a_acgt,c_acgt);
-            __m128d ac = _mm_hadd_pd(a_acgt,c_acgt);
-            _mm_store_pd(p_site_mixture,ac);
-            
-            
-            __m128d g_ac = _mm_mul_pd(p01, tp_g_ac  );
-            __m128d g_gt = _mm_mul_pd(p23, tp_g_gt );
-            __m128d g_acgt = _mm_hadd_pd(g_ac,g_gt);
-            
-            __m128d t_ac = _mm_mul_pd(p01, tp_t_ac );
-            __m128d t_gt = _mm_mul_pd(p23, tp_t_gt );
-            __m128d t_acgt = _mm_hadd_pd(t_ac,t_gt);
-            
-            //            p_site_mixture[2] = _mm_hadd_pd(g_acgt,t_acgt);
-            __m128d gt = _mm_hadd_pd(g_acgt,t_acgt);
-            _mm_store_pd(p_site_mixture+2,gt);
-            
-#           elif defined ( AVX_ENABLED )
-            
-            __m256d a = _mm256_load_pd(p_site_mixture_left);
-            __m256d b = _mm256_load_pd(p_site_mixture_right);
-            __m256d p = _mm_mul_pd(a,b);
-            
-            __m256d a_acgt = _mm256_mul_pd(p, tp_a );
-            __m256d c_acgt = _mm256_mul_pd(p, tp_c );
-            __m256d g_acgt = _mm256_mul_pd(p, tp_g );
-            __m256d t_acgt = _mm256_mul_pd(p, tp_t );
-            
-            __m256d ac   = _mm256_hadd_pd(a_acgt,c_acgt);
-            __m256d gt   = _mm256_hadd_pd(g_acgt,t_acgt)
-            
-            __m256d acgt = _mm256_hadd_pd(ac,gt);
-            
-            _mm256_store_pd(p_site_mixture,acgt);
-            
-#           else
-            
-            double p0 = p_site_mixture_left[0] * p_site_mixture_middle[0] * p_site_mixture_right[0];
-            double p1 = p_site_mixture_left[1] * p_site_mixture_middle[1] * p_site_mixture_right[1];
-            double p2 = p_site_mixture_left[2] * p_site_mixture_middle[2] * p_site_mixture_right[2];
-            double p3 = p_site_mixture_left[3] * p_site_mixture_middle[3] * p_site_mixture_right[3];
-            
-            double sum = p0 * tp_begin[0];
-            sum += p1 * tp_begin[1];
-            sum += p2 * tp_begin[2];
-            sum += p3 * tp_begin[3];
+            kernels->internal3( this->transition_prob_matrices[mixture].theMatrix, p_left + offset, p_middle + offset, p_right + offset, p_node + offset, site_end - site_begin );
             
-            p_site_mixture[0] = sum;
-            
-            sum = p0 * tp_begin[4];
-            sum += p1 * tp_begin[5];
-            sum += p2 * tp_begin[6];
-            sum += p3 * tp_begin[7];
-            
-            p_site_mixture[1] = sum;
-            
-            sum = p0 * tp_begin[8];
-            sum += p1 * tp_begin[9];
-            sum += p2 * tp_begin[10];
-            sum += p3 * tp_begin[11];
-            
-            p_site_mixture[2] = sum;
-            
-            sum = p0 * tp_begin[12];
-            sum += p1 * tp_begin[13];
-            sum += p2 * tp_begin[14];
-            sum += p3 * tp_begin[15];
-            
-            p_site_mixture[3] = sum;
-            
-#           endif
-            
-            // increment the pointers to the next site
-            p_site_mixture_left+=this->siteOffset; p_site_mixture_middle+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture+=this->siteOffset;
-            
-            
-        } // end-for over all sites (=patterns)
-        
-    } // end-for over all mixtures (=rate-categories)
+        } // end-for over all mixtures (=rate-categories)
+    } );
     
 }
 
@@ -565,6 +291,17 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeTipLikel
     // compute the transition probabilities
     this->updateTransitionProbabilities( node_index );
     
+    // store the transition probabilities per observed state for the cherry kernels of our parent
+    size_t num_tip_state_values = 2 * this->num_nodes * this->num_site_mixtures * 20;
+    if ( tip_state_vectors.size() != num_tip_state_values )
+    {
+        tip_state_vectors.resize( num_tip_state_values );
+    }
+    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    {
+        NucleotideLikelihoodKernels::computeTipStateVectors( this->transition_prob_matrices[mixture].theMatrix, getTipStateVectors(node_index, mixture) );
+    }
+    
     double*   p_mixture      = p_node;
     
     // iterate over all mixture categories
@@ -671,4 +408,45 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeTipLikel
 }
 
 
+template<class charType>
+double* RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::getTipStateVectors( size_t node_index, size_t mixture )
+{
+    
+    return &tip_state_vectors[ ((this->activeLikelihood[node_index] * this->num_nodes + node_index) * this->num_site_mixtures + mixture) * 20 ];
+}
+
+
+template<class charType>
+void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::scale( size_t node_index )
+{
+    
+    // only tips are scaled with this method
+    // their partial likelihoods are transition probabilities which cannot underflow, so we don't rescale them
+    // and the cherry kernels can use the transition probabilities directly
+    if ( RbSettings::userSettings().getUseScaling() == true )
+    {
+        std::vector<double> &node_scaling_factors = this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index];
+        for (size_t site = 0; site < this->pattern_block_size ; ++site)
+        {
+            node_scaling_factors[site] = 0;
+        }
+    }
+    
+}
+
+
+template<class charType>
+bool RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::useCherryKernel( size_t node_index ) const
+{
+    
+    // ambiguous characters are not stored as state indices
+    if ( this->using_ambiguous_characters == true )
+    {
+        return false;
+    }
+    
+    return this->tau->getValue().getNode( node_index ).isTip() == true && tip_state_vectors.empty() == false;
+}
+
+
 #endif
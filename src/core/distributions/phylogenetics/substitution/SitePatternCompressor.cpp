@@ -0,0 +1,231 @@
+#include "SitePatternCompressor.h"
+#include "AbstractDiscreteTaxonData.h"
+#include "DiscreteCharacterState.h"
+#include "RbConstants.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+
+using namespace RevBayesCore;
+
+
+SitePatternCompressor::SitePatternCompressor(const std::vector<const AbstractDiscreteTaxonData*> &t, const std::vector<size_t> &si) :
+    taxa( t ),
+    site_indices( si ),
+    code_identifiers( t.size() ),
+    code_hashes( t.size() )
+{
+
+    // give all codes with the same string value the same identifier
+    for (size_t i = 0; i < taxa.size(); ++i)
+    {
+        size_t num_codes = taxa[i]->getNumberOfCharacterCodes();
+        code_identifiers[i].resize( num_codes );
+        code_hashes[i].resize( num_codes );
+
+        std::map<std::string, size_t> identifiers;
+        for (size_t code = 0; code < num_codes; ++code)
+        {
+            std::string s = taxa[i]->getCharacterForCode( code ).getStringValue();
+
+            std::map<std::string, size_t>::const_iterator it = identifiers.find( s );
+            if ( it == identifiers.end() )
+            {
+                it = identifiers.insert( std::pair<std::string, size_t>( s, identifiers.size() ) ).first;
+            }
+            code_identifiers[i][code] = it->second;
+
+            std::uint64_t h = 14695981039346656037ULL;
+            for (size_t j = 0; j < s.size(); ++j)
+            {
+                h ^= std::uint64_t( (unsigned char)s[j] );
+                h *= 1099511628211ULL;
+            }
+            code_hashes[i][code] = h;
+        }
+    }
+
+}
+
+
+SitePatternCompressor::PatternTable::PatternTable(size_t max_num_patterns)
+{
+
+    // keep the load factor below 1/2
+    size_t capacity = 16;
+    while ( capacity < 2*max_num_patterns )
+    {
+        capacity *= 2;
+    }
+
+    hashes   = std::vector<std::uint64_t>(capacity, 0);
+    patterns = std::vector<size_t>(capacity, RbConstants::Size_t::max);
+    mask     = capacity - 1;
+
+}
+
+
+size_t SitePatternCompressor::PatternTable::findOrInsert(std::uint64_t hash, size_t site, size_t new_pattern, const std::vector<size_t> &first_sites, const SitePatternCompressor &compressor)
+{
+
+    size_t slot = size_t(hash) & mask;
+    while ( patterns[slot] != RbConstants::Size_t::max )
+    {
+        if ( hashes[slot] == hash && compressor.isEqualSite( first_sites[patterns[slot]], site ) )
+        {
+            return patterns[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    hashes[slot]   = hash;
+    patterns[slot] = new_pattern;
+
+    return new_pattern;
+}
+
+
+/**
+ * Compress the sites.
+ *
+ * First, every block of sites is compressed on its own (in parallel) into local patterns,
+ * each represented by the first site where it occurs.
+ * Then we merge the local patterns of all blocks, block by block, into the global table.
+ * Because the blocks are ordered and the local patterns of a block are ordered by their first site,
+ * the global patterns are created in the order of their first occurrence.
+ */
+void SitePatternCompressor::compress(std::vector<size_t> &pattern_counts, std::vector<size_t> &site_pattern, std::vector<size_t> &index_of_site_pattern) const
+{
+
+    size_t num_sites = site_indices.size();
+
+    pattern_counts.clear();
+    index_of_site_pattern.clear();
+    site_pattern.resize( num_sites );
+
+    if ( num_sites == 0 )
+    {
+        return;
+    }
+
+    // we want a few blocks per thread to balance the load
+    ThreadPool &pool = ThreadPool::globalInstance();
+    size_t num_threads = pool.getNumberOfThreads();
+    size_t block_size = std::max<size_t>( 4096, (num_sites + 4*num_threads - 1) / (4*num_threads) );
+    size_t num_blocks = (num_sites + block_size - 1) / block_size;
+
+    std::vector< std::vector<size_t> >          block_first_sites( num_blocks );
+    std::vector< std::vector<size_t> >          block_counts( num_blocks );
+    std::vector< std::vector<std::uint64_t> >   block_hashes( num_blocks );
+
+    // the local pattern of each site (which is later replaced by the global pattern)
+    std::vector<size_t> &local_pattern = site_pattern;
+
+    pool.parallelFor( num_blocks, [&](size_t begin, size_t end)
+    {
+        for (size_t b = begin; b < end; ++b)
+        {
+            size_t first_site = b * block_size;
+            size_t last_site  = std::min( num_sites, first_site + block_size );
+
+            std::vector<size_t>         &first_sites = block_first_sites[b];
+            std::vector<size_t>         &counts      = block_counts[b];
+            std::vector<std::uint64_t>  &hashes      = block_hashes[b];
+
+            PatternTable table( last_site - first_site );
+            for (size_t site = first_site; site < last_site; ++site)
+            {
+                std::uint64_t h = computeSiteHash( site );
+                size_t pattern = table.findOrInsert( h, site, first_sites.size(), first_sites, *this );
+                if ( pattern == first_sites.size() )
+                {
+                    first_sites.push_back( site );
+                    counts.push_back( 0 );
+                    hashes.push_back( h );
+                }
+                ++counts[pattern];
+                local_pattern[site] = pattern;
+            }
+        }
+    } );
+
+    // merge the blocks in their order
+    size_t num_local_patterns = 0;
+    for (size_t b = 0; b < num_blocks; ++b)
+    {
+        num_local_patterns += block_first_sites[b].size();
+    }
+
+    PatternTable table( num_local_patterns );
+    std::vector< std::vector<size_t> > local_to_global( num_blocks );
+    for (size_t b = 0; b < num_blocks; ++b)
+    {
+        const std::vector<size_t> &first_sites = block_first_sites[b];
+        local_to_global[b].resize( first_sites.size() );
+        for (size_t i = 0; i < first_sites.size(); ++i)
+        {
+            size_t pattern = table.findOrInsert( block_hashes[b][i], first_sites[i], index_of_site_pattern.size(), index_of_site_pattern, *this );
+            if ( pattern == index_of_site_pattern.size() )
+            {
+                index_of_site_pattern.push_back( first_sites[i] );
+                pattern_counts.push_back( 0 );
+            }
+            pattern_counts[pattern] += block_counts[b][i];
+            local_to_global[b][i] = pattern;
+        }
+    }
+
+    // finally translate the local patterns of the sites into the global ones
+    pool.parallelFor( num_blocks, [&](size_t begin, size_t end)
+    {
+        for (size_t b = begin; b < end; ++b)
+        {
+            size_t first_site = b * block_size;
+            size_t last_site  = std::min( num_sites, first_site + block_size );
+            for (size_t site = first_site; site < last_site; ++site)
+            {
+                site_pattern[site] = local_to_global[b][ local_pattern[site] ];
+            }
+        }
+    } );
+
+}
+
+
+/**
+ * Combine the FNV-1a hashes of the string values of the characters of all taxa at this site.
+ */
+std::uint64_t SitePatternCompressor::computeSiteHash(size_t site) const
+{
+
+    size_t column = site_indices[site];
+
+    std::uint64_t h = 0;
+    for (size_t i = 0; i < taxa.size(); ++i)
+    {
+        std::uint64_t char_hash = code_hashes[i][ taxa[i]->getCharacterCode( column ) ];
+        h ^= char_hash + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+    }
+
+    return h;
+}
+
+
+bool SitePatternCompressor::isEqualSite(size_t site_a, size_t site_b) const
+{
+
+    size_t column_a = site_indices[site_a];
+    size_t column_b = site_indices[site_b];
+    for (size_t i = 0; i < taxa.size(); ++i)
+    {
+        const std::vector<size_t> &identifiers = code_identifiers[i];
+        if ( identifiers[ taxa[i]->getCharacterCode( column_a ) ] != identifiers[ taxa[i]->getCharacterCode( column_b ) ] )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
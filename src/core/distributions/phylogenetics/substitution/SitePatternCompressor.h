@@ -0,0 +1,65 @@
+#ifndef SitePatternCompressor_H
+#define SitePatternCompressor_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace RevBayesCore {
+
+    class AbstractDiscreteTaxonData;
+
+    /**
+     * @brief Finds the unique site patterns of an alignment.
+     *
+     * Two sites have the same pattern if all taxa have the same character (compared by its string value) at both sites.
+     * We work on the packed character codes of the taxa: for each taxon, we first give each distinct character
+     * (i.e., each code) an identifier, such that codes with the same string value have the same identifier.
+     * Then we compute a 64-bit hash of every site (combining the hashes of the identifiers of all taxa)
+     * and look the hash up in an open-addressing table.
+     * Only if two hashes are equal we compare the identifiers of the two sites, so hash collisions never merge different patterns.
+     *
+     * The sites are split into blocks which are compressed independently on the shared thread pool.
+     * The unique patterns of the blocks are then merged in the order of the blocks,
+     * so the patterns are numbered by the site of their first occurrence, exactly as a sequential pass would do,
+     * independently of the number of threads.
+     *
+     */
+    class SitePatternCompressor {
+
+    public:
+        SitePatternCompressor(const std::vector<const AbstractDiscreteTaxonData*> &t, const std::vector<size_t> &si);
+
+        void                                            compress(std::vector<size_t> &pattern_counts, std::vector<size_t> &site_pattern, std::vector<size_t> &index_of_site_pattern) const;   //!< Compute the pattern counts, the pattern of each site and the first site of each pattern
+
+    private:
+
+        /**
+         * An open-addressing hash table (with linear probing) from site hashes to pattern indices.
+         * A hash may occur several times if different patterns have the same hash.
+         */
+        class PatternTable {
+
+        public:
+            PatternTable(size_t max_num_patterns);
+
+            size_t                                      findOrInsert(std::uint64_t hash, size_t site, size_t new_pattern, const std::vector<size_t> &first_sites, const SitePatternCompressor &compressor);   //!< Get the pattern of the site, or insert new_pattern
+
+        private:
+            std::vector<std::uint64_t>                  hashes;
+            std::vector<size_t>                         patterns;
+            size_t                                      mask;
+        };
+
+        std::uint64_t                                   computeSiteHash(size_t site) const;                                 //!< The hash of the characters of all taxa at this site
+        bool                                            isEqualSite(size_t site_a, size_t site_b) const;                    //!< Do all taxa have the same character at both sites?
+
+        std::vector<const AbstractDiscreteTaxonData*>   taxa;
+        std::vector<size_t>                             site_indices;                                                       //!< The alignment column of each (included) site
+        std::vector< std::vector<size_t> >              code_identifiers;                                                   //!< For each taxon, the identifier of each code
+        std::vector< std::vector<std::uint64_t> >       code_hashes;                                                        //!< For each taxon, the hash of the string value of each code
+    };
+
+}
+
+#endif
@@ -10,8 +10,10 @@ SSE_ODE::SSE_ODE( const std::vector<double> &m, const RateGenerator* q, double r
     mu( m ),
     num_states( q->getNumberOfStates() ),
     Q( q ),
+    events( NULL ),
     rate( r ),
     extinction_only( extinction_only ),
+    use_speciation_from_event_map( false ),
     backward_time( backward_time )
 {
     
@@ -30,26 +32,52 @@ void SSE_ODE::operator()(const state_type &x, state_type &dxdt, const double t)
         safe_x[i] = ( x[i] < 0.0 ? 0.0 : x[i] );
     }
     
+    // the cladogenetic events are stored by ancestor state (CSR format)
+    size_t num_event_states = 0;
+    const size_t*   offsets     = NULL;
+    const unsigned* ancestor    = NULL;
+    const unsigned* daughter_1  = NULL;
+    const unsigned* daughter_2  = NULL;
+    const double*   event_rates = NULL;
+    if ( use_speciation_from_event_map == true )
+    {
+        num_event_states = events->getNumberOfStates();
+        offsets          = &events->getAncestorOffsets()[0];
+        if ( events->getNumberOfEvents() > 0 )
+        {
+            ancestor    = &events->getAncestorStates()[0];
+            daughter_1  = &events->getDaughter1States()[0];
+            daughter_2  = &events->getDaughter2States()[0];
+            event_rates = &events->getEventRates()[0];
+        }
+    }
+    
+    // in forward time, the speciation events contribute to the daughter states,
+    // so we add them for all states at once after the loop
+    bool scatter_speciation_events = ( use_speciation_from_event_map == true && backward_time == false );
+    
     double age = 0.0;
     for (size_t i = 0; i < num_states; ++i)
     {
         
+        // the events with ancestor state i
+        size_t first_event = 0;
+        size_t last_event = 0;
+        if ( use_speciation_from_event_map == true && i < num_event_states )
+        {
+            first_event = offsets[i];
+            last_event  = offsets[i+1];
+        }
+        
         // calculate sum of speciation rates
         // lambda_ijk for all possible values of j and k
         double lambda_sum = 0.0;
         
         if ( use_speciation_from_event_map == true )
         {
-            std::map<std::vector<unsigned>, double>::iterator it;
-            for (it = event_map.begin(); it != event_map.end(); it++)
+            if ( i < num_event_states )
             {
-                const std::vector<unsigned>& states = it->first;
-                double curr_lambda = it->second;
-            
-                if (i == states[0])
-                {
-                    lambda_sum += curr_lambda;
-                }
+                lambda_sum = events->getSpeciationRates()[i];
             }
         }
         else
@@ -83,15 +111,9 @@ void SSE_ODE::operator()(const state_type &x, state_type &dxdt, const double t)
         // speciation event
         if ( use_speciation_from_event_map == true )
         {
-            std::map<std::vector<unsigned>, double>::iterator it;
-            for (it = event_map.begin(); it != event_map.end(); it++)
+            for (size_t k = first_event; k < last_event; ++k)
             {
-                const std::vector<unsigned>& states = it->first;
-                double curr_lambda = it->second;
-                if (i == states[0])
-                {
-                    dxdt[i] += curr_lambda * safe_x[states[1]] * safe_x[states[2]];
-                }
+                dxdt[i] += event_rates[k] * safe_x[daughter_1[k]] * safe_x[daughter_2[k]];
             }
         }
         else
@@ -121,34 +143,20 @@ void SSE_ODE::operator()(const state_type &x, state_type &dxdt, const double t)
             // no event
             dxdt[i + num_states] = -no_event_rate * safe_x[i + num_states];
             
+            // the remaining terms are added after the loop
+            if ( scatter_speciation_events == true )
+            {
+                continue;
+            }
+            
             // speciation event
             if ( use_speciation_from_event_map == true )
             {
-                std::map<std::vector<unsigned>, double>::iterator it;
-                for (it = event_map.begin(); it != event_map.end(); it++)
+                for (size_t k = first_event; k < last_event; ++k)
                 {
-                    const std::vector<unsigned>& states = it->first;
-                    double lambda = it->second;
-                    if ( backward_time == true )
-                    {
-                        if (i == states[0])
-                        {
-                            double term1 = safe_x[states[1] + num_states] * safe_x[states[2]];
-                            double term2 = safe_x[states[2] + num_states] * safe_x[states[1]];
-                            dxdt[i + num_states] += lambda * (term1 + term2 );
-                        }
-                    }
-                    else
-                    {
-                        if (i == states[1])
-                        {
-                            dxdt[i + num_states] += lambda * safe_x[states[0] + num_states] * safe_x[states[2]];
-                        }
-                        if (i == states[2])
-                        {
-                            dxdt[i + num_states] += lambda * safe_x[states[0] + num_states] * safe_x[states[1]];
-                        }
-                    }
+                    double term1 = safe_x[daughter_1[k] + num_states] * safe_x[daughter_2[k]];
+                    double term2 = safe_x[daughter_2[k] + num_states] * safe_x[daughter_1[k]];
+                    dxdt[i + num_states] += event_rates[k] * (term1 + term2 );
                 }
             }
             else
@@ -177,14 +185,39 @@ void SSE_ODE::operator()(const state_type &x, state_type &dxdt, const double t)
         
     } // end for num_states
     
+    if ( extinction_only == false && scatter_speciation_events == true )
+    {
+        // speciation event
+        // we add the events in the order of the event map, so that each state sums its terms in the same order as before
+        size_t num_events = events->getNumberOfEvents();
+        for (size_t k = 0; k < num_events; ++k)
+        {
+            double curr_lambda = event_rates[k];
+            dxdt[daughter_1[k] + num_states] += curr_lambda * safe_x[ancestor[k] + num_states] * safe_x[daughter_2[k]];
+            dxdt[daughter_2[k] + num_states] += curr_lambda * safe_x[ancestor[k] + num_states] * safe_x[daughter_1[k]];
+        }
+        
+        // anagenetic state change
+        for (size_t i = 0; i < num_states; ++i)
+        {
+            for (size_t j = 0; j < num_states; ++j)
+            {
+                if ( i != j )
+                {
+                    dxdt[i + num_states] += Q->getRate(j, i, age, rate) * safe_x[j + num_states];
+                }
+            }
+        }
+    }
+    
 }
 
 
-void SSE_ODE::setEventMap( const std::map<std::vector<unsigned>, double> &e )
+void SSE_ODE::setCladogeneticEvents( const CladogeneticEventArrays &e )
 {
     
     use_speciation_from_event_map = true;
-    event_map = e;
+    events = &e;
 }
 
 
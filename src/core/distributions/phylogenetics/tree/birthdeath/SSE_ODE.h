@@ -2,6 +2,7 @@
 #define SSE_ODE_H
 
 #include "AbstractBirthDeathProcess.h"
+#include "CladogeneticEventArrays.h"
 #include "RateMatrix.h"
 
 #include <vector>
@@ -28,7 +29,7 @@ namespace RevBayesCore {
         
         void operator() ( const state_type &x , state_type &dxdt , const double t );
         
-        void            setEventMap( const std::map<std::vector<unsigned>, double> &e );
+        void            setCladogeneticEvents( const CladogeneticEventArrays &e );
         void            setSpeciationRate( const std::vector<double> &s );
         void            setSerialSamplingRate( const std::vector<double> &s );
         
@@ -39,7 +40,7 @@ namespace RevBayesCore {
         std::vector<double>                         psi;                                //!< vector of fossilization rates, one rate for each character state
         size_t                                      num_states;                         //!< the number of character states = q->getNumberOfStates()
         const RateGenerator*                        Q;                                  //!< anagenetic rate matrix
-        std::map<std::vector<unsigned>, double>     event_map;                          //!< cladogenetic event map, with the structure pair< [ancestor_state, daughter_1_state, daughter_2_state], speciation_rate >
+        const CladogeneticEventArrays*              events;                             //!< compiled cladogenetic event map, with the events [ancestor_state, daughter_1_state, daughter_2_state] and their speciation rates
         double                                      rate;                               //!< clock rate for anagenetic change
         
         // flags to modify behabior
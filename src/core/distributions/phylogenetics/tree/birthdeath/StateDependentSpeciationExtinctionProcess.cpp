@@ -17,6 +17,7 @@
 #include "RlString.h"
 #include "StandardState.h"
 #include "StochasticNode.h"
+#include "ThreadPool.h"
 #include "TopologyNode.h"
 
 #include <algorithm>
@@ -250,197 +251,328 @@ void StateDependentSpeciationExtinctionProcess::computeNodeProbability(const Rev
         // mark as computed
         dirty_nodes[node_index] = false;
         
-        std::vector<double> &node_likelihood  = node_partial_likelihoods[node_index][active_likelihood[node_index]];
-
-        if ( node.isTip() == true )
+        // first compute the descendant nodes
+        if ( node.isTip() == false )
         {
-            // this is a tip node
-            TreeDiscreteCharacterData* tree = static_cast<TreeDiscreteCharacterData*>( this->value );
+            const TopologyNode          &left           = node.getChild(0);
+            computeNodeProbability( left, left.getIndex() );
+            const TopologyNode          &right          = node.getChild(1);
+            computeNodeProbability( right, right.getIndex() );
+        }
+        
+        computeBranchProbability( node, node_index );
+    }
+    
+}
 
-            std::vector<double> sampling(num_states, rho->getValue());
-            std::vector<double> extinction(num_states, 1.0 - rho->getValue());
 
-            if (psi != NULL && node.isFossil())
-            {
-                sampling = psi->getValue();
-                extinction = pExtinction(0.0, node.getAge());
-            }
-            
-            RbBitSet obs_state(num_states, true);
-            bool gap = true;
+/**
+ * Compute the likelihoods at the start of this node and integrate them along the branch to its parent.
+ * The likelihoods of the descendant nodes must be up to date.
+ * This function only writes the likelihoods and scaling factors of this node (and its branch),
+ * so it can be called for independent nodes in parallel.
+ */
+void StateDependentSpeciationExtinctionProcess::computeBranchProbability(const RevBayesCore::TopologyNode &node, size_t node_index) const
+{
+    
+    std::vector<double> &node_likelihood  = node_partial_likelihoods[node_index][active_likelihood[node_index]];
 
-            if ( tree->hasCharacterData() == true )
-            {
-                const DiscreteCharacterState &state = tree->getCharacterData().getTaxonData( node.getTaxon().getName() )[0];
-                obs_state = state.getState();
-                gap = (state.isMissingState() == true || state.isGapState() == true);
-            }
+    if ( node.isTip() == true )
+    {
+        // this is a tip node
+        TreeDiscreteCharacterData* tree = static_cast<TreeDiscreteCharacterData*>( this->value );
 
-            for (size_t j = 0; j < num_states; ++j)
-            {
-                
-                node_likelihood[j] = extinction[j];
-                
-                if ( obs_state.isSet( j ) == true || gap == true )
-                {
-                    node_likelihood[num_states+j] = sampling[j];
-                }
-                else
-                {
-                    node_likelihood[num_states+j] = 0.0;
-                }
-            }
-            
+        std::vector<double> sampling(num_states, rho->getValue());
+        std::vector<double> extinction(num_states, 1.0 - rho->getValue());
+
+        if (psi != NULL && node.isFossil())
+        {
+            sampling = psi->getValue();
+            extinction = pExtinction(0.0, node.getAge());
         }
-        else
+        
+        RbBitSet obs_state(num_states, true);
+        bool gap = true;
+
+        if ( tree->hasCharacterData() == true )
+        {
+            const DiscreteCharacterState &state = tree->getCharacterData().getTaxonData( node.getTaxon().getName() )[0];
+            obs_state = state.getState();
+            gap = (state.isMissingState() == true || state.isGapState() == true);
+        }
+
+        for (size_t j = 0; j < num_states; ++j)
         {
             
-            // this is an internal node
-            const TopologyNode          &left           = node.getChild(0);
-            size_t                      left_index      = left.getIndex();
-            computeNodeProbability( left, left_index );
-            const TopologyNode          &right          = node.getChild(1);
-            size_t                      right_index     = right.getIndex();
-            computeNodeProbability( right, right_index );
+            node_likelihood[j] = extinction[j];
             
-            // get the likelihoods of descendant nodes
-            const std::vector<double> &left_likelihoods  = node_partial_likelihoods[left_index][active_likelihood[left_index]];
-            const std::vector<double> &right_likelihoods = node_partial_likelihoods[right_index][active_likelihood[right_index]];
-
-            std::map<std::vector<unsigned>, double> eventMap;
-            std::vector<double> speciation_rates;
-            if ( use_cladogenetic_events == true )
+            if ( obs_state.isSet( j ) == true || gap == true )
             {
-                // get cladogenesis event map (sparse speciation rate matrix)
-                eventMap = cladogenesis_matrix->getValue().getEventMap();
+                node_likelihood[num_states+j] = sampling[j];
             }
             else
             {
-                speciation_rates = lambda->getValue();
-            }
-            
-            bool speciation_node = true;
-            if ( left.isSampledAncestor() || right.isSampledAncestor() )
-            {
-                speciation_node = (psi == NULL);
-            }
-
-            // merge descendant likelihoods
-            for (size_t i=0; i<num_states; ++i)
-            {
-                node_likelihood[i] = left_likelihoods[i];
-
-                if ( use_cladogenetic_events == true && speciation_node == true )
-                {
-                    
-                    double like_sum = 0.0;
-                    std::map<std::vector<unsigned>, double>::iterator it;
-                    for (it = eventMap.begin(); it != eventMap.end(); it++)
-                    {
-                        const std::vector<unsigned>& states = it->first;
-                        double speciation_rate = it->second;
-                        if (i == states[0])
-                        {
-                            double likelihoods = left_likelihoods[num_states + states[1]] * right_likelihoods[num_states + states[2]];
-                            like_sum += speciation_rate * likelihoods;
-                        }
-                    }
-                    node_likelihood[num_states + i] = like_sum;
-                    
-                }
-                else
-                {
-                    node_likelihood[num_states + i] = left_likelihoods[num_states + i] * right_likelihoods[num_states + i];
-                    node_likelihood[num_states + i] *= speciation_node ? speciation_rates[i] : 1.0;
-                }
+                node_likelihood[num_states+j] = 0.0;
             }
-            
         }
         
-        double begin_age = node.getAge();
-        double end_age = node.getParent().getAge();
+    }
+    else
+    {
+        
+        // this is an internal node
+        const TopologyNode          &left           = node.getChild(0);
+        size_t                      left_index      = left.getIndex();
+        const TopologyNode          &right          = node.getChild(1);
+        size_t                      right_index     = right.getIndex();
         
-        if ( node.isSampledAncestor() == false )
+        // get the likelihoods of descendant nodes
+        const std::vector<double> &left_likelihoods  = node_partial_likelihoods[left_index][active_likelihood[left_index]];
+        const std::vector<double> &right_likelihoods = node_partial_likelihoods[right_index][active_likelihood[right_index]];
+
+        std::map<std::vector<unsigned>, double> eventMap;
+        std::vector<double> speciation_rates;
+        if ( use_cladogenetic_events == true )
         {
-            // calculate likelihoods for this branch
-            if ( sample_character_history == false )
-            {
-                // numerically integrate over the entire branch length
-                numericallyIntegrateProcess(node_likelihood, begin_age, end_age, true, false);
-            }
-            else
-            {
-                // calculate the conditional likelihoods for each time slice moving
-                // along this branch backwards in time from the tip towards the root
+            // get cladogenesis event map (sparse speciation rate matrix)
+            eventMap = cladogenesis_matrix->getValue().getEventMap();
+        }
+        else
+        {
+            speciation_rates = lambda->getValue();
+        }
+        
+        bool speciation_node = true;
+        if ( left.isSampledAncestor() || right.isSampledAncestor() )
+        {
+            speciation_node = (psi == NULL);
+        }
+
+        // merge descendant likelihoods
+        for (size_t i=0; i<num_states; ++i)
+        {
+            node_likelihood[i] = left_likelihoods[i];
 
-                std::vector<std::vector<double> > branch_likelihoods;
-                size_t current_dt = 0;
+            if ( use_cladogenetic_events == true && speciation_node == true )
+            {
                 
-                // calculate partial likelihoods for each time slice and store them in branch_likelihoods
-                while ( (current_dt * dt) + begin_age < end_age )
+                double like_sum = 0.0;
+                std::map<std::vector<unsigned>, double>::iterator it;
+                for (it = eventMap.begin(); it != eventMap.end(); it++)
                 {
-
-                    std::vector<double> dt_likelihood;
-
-                    double current_dt_start = (current_dt * dt) + begin_age;
-                    double current_dt_end = ((current_dt + 1) * dt) + begin_age;
-                    if (current_dt_end > end_age)
+                    const std::vector<unsigned>& states = it->first;
+                    double speciation_rate = it->second;
+                    if (i == states[0])
                     {
-                        current_dt_end = end_age;
+                        double likelihoods = left_likelihoods[num_states + states[1]] * right_likelihoods[num_states + states[2]];
+                        like_sum += speciation_rate * likelihoods;
                     }
-                    numericallyIntegrateProcess(node_likelihood, current_dt_start, current_dt_end, true, false);
-
-                    std::vector<double>::const_iterator first = node_likelihood.begin() + num_states;
-                    std::vector<double>::const_iterator last = node_likelihood.begin() + (num_states * 2);
-                    dt_likelihood = std::vector<double>(first, last);
-
-                    branch_likelihoods.push_back(dt_likelihood);
-                    current_dt++;
-
                 }
+                node_likelihood[num_states + i] = like_sum;
                 
-                // save the branch conditional likelihoods
-                branch_partial_likelihoods[node_index] = branch_likelihoods;
+            }
+            else
+            {
+                node_likelihood[num_states + i] = left_likelihoods[num_states + i] * right_likelihoods[num_states + i];
+                node_likelihood[num_states + i] *= speciation_node ? speciation_rates[i] : 1.0;
             }
         }
         
-        if ( RbSettings::userSettings().getUseScaling() == true ) //&& node_index % RbSettings::userSettings().getScalingDensity() == 0 )
+    }
+    
+    double begin_age = node.getAge();
+    double end_age = node.getParent().getAge();
+    
+    if ( node.isSampledAncestor() == false )
+    {
+        // calculate likelihoods for this branch
+        if ( sample_character_history == false )
         {
-            // rescale the conditional likelihoods at the "end" of the branch
-            double max = 0.0;
-            for (size_t i=0; i<num_states; ++i)
+            // numerically integrate over the entire branch length
+            numericallyIntegrateProcess(node_likelihood, begin_age, end_age, true, false);
+        }
+        else
+        {
+            // calculate the conditional likelihoods for each time slice moving
+            // along this branch backwards in time from the tip towards the root
+
+            std::vector<std::vector<double> > branch_likelihoods;
+            size_t current_dt = 0;
+            
+            // calculate partial likelihoods for each time slice and store them in branch_likelihoods
+            while ( (current_dt * dt) + begin_age < end_age )
             {
-                if ( node_likelihood[num_states+i] > max )
+
+                std::vector<double> dt_likelihood;
+
+                double current_dt_start = (current_dt * dt) + begin_age;
+                double current_dt_end = ((current_dt + 1) * dt) + begin_age;
+                if (current_dt_end > end_age)
                 {
-                    max = node_likelihood[num_states+i];
+                    current_dt_end = end_age;
                 }
+                numericallyIntegrateProcess(node_likelihood, current_dt_start, current_dt_end, true, false);
+
+                std::vector<double>::const_iterator first = node_likelihood.begin() + num_states;
+                std::vector<double>::const_iterator last = node_likelihood.begin() + (num_states * 2);
+                dt_likelihood = std::vector<double>(first, last);
+
+                branch_likelihoods.push_back(dt_likelihood);
+                current_dt++;
+
             }
-//            max *= num_states;
             
-            for (size_t i=0; i<num_states; ++i)
+            // save the branch conditional likelihoods
+            branch_partial_likelihoods[node_index] = branch_likelihoods;
+        }
+    }
+    
+    if ( RbSettings::userSettings().getUseScaling() == true ) //&& node_index % RbSettings::userSettings().getScalingDensity() == 0 )
+    {
+        // rescale the conditional likelihoods at the "end" of the branch
+        double max = 0.0;
+        for (size_t i=0; i<num_states; ++i)
+        {
+            if ( node_likelihood[num_states+i] > max )
             {
-                node_likelihood[num_states+i] /= max;
+                max = node_likelihood[num_states+i];
             }
+        }
+//        max *= num_states;
+        
+        for (size_t i=0; i<num_states; ++i)
+        {
+            node_likelihood[num_states+i] /= max;
+        }
+
+        scaling_factors[node_index][active_likelihood[node_index]] = log(max);
+
+        if ( node.isTip() == false )
+        {
+            const TopologyNode          &left           = node.getChild(0);
+            size_t                      left_index      = left.getIndex();
+            const TopologyNode          &right          = node.getChild(1);
+            size_t                      right_index     = right.getIndex();
+            scaling_factors[node_index][active_likelihood[node_index]] += scaling_factors[left_index][active_likelihood[left_index]] + scaling_factors[right_index][active_likelihood[right_index]];
+        }
+    }
+    
+}
 
-            scaling_factors[node_index][active_likelihood[node_index]] = log(max);
 
-            if ( node.isTip() == false )
+/**
+ * Compute the likelihoods of all dirty nodes on the thread pool.
+ * Each node is computed as soon as both of its children are done, so independent subtrees are integrated in parallel.
+ * Afterwards no node is dirty anymore and the recursion in computeNodeProbability() stops right away.
+ * We keep the serial recursion when we sample character histories, which recomputes every node anyway.
+ */
+void StateDependentSpeciationExtinctionProcess::computeDirtyNodeProbabilities( void ) const
+{
+    
+    ThreadPool &pool = ThreadPool::globalInstance();
+    if ( sample_character_history == true || pool.getNumberOfThreads() == 1 )
+    {
+        return;
+    }
+    
+    // collect the dirty nodes (and the task of their parent) that the recursion would visit
+    const TopologyNode &root = value->getRoot();
+    std::vector<const TopologyNode*> nodes;
+    std::vector<size_t> parent_tasks;
+    std::vector<const TopologyNode*> stack;
+    std::vector<size_t> stack_parents;
+    for (size_t i = 0; i < root.getNumberOfChildren(); ++i)
+    {
+        stack.push_back( &root.getChild(i) );
+        stack_parents.push_back( RbConstants::Size_t::max );
+    }
+    while ( stack.empty() == false )
+    {
+        const TopologyNode *node = stack.back();
+        size_t parent_task = stack_parents.back();
+        stack.pop_back();
+        stack_parents.pop_back();
+        
+        if ( dirty_nodes[node->getIndex()] == true )
+        {
+            dirty_nodes[node->getIndex()] = false;
+            nodes.push_back( node );
+            parent_tasks.push_back( parent_task );
+            for (size_t i = 0; i < node->getNumberOfChildren(); ++i)
             {
-                const TopologyNode          &left           = node.getChild(0);
-                size_t                      left_index      = left.getIndex();
-                const TopologyNode          &right          = node.getChild(1);
-                size_t                      right_index     = right.getIndex();
-                scaling_factors[node_index][active_likelihood[node_index]] += scaling_factors[left_index][active_likelihood[left_index]] + scaling_factors[right_index][active_likelihood[right_index]];
+                stack.push_back( &node->getChild(i) );
+                stack_parents.push_back( nodes.size() - 1 );
             }
         }
     }
     
+    if ( nodes.empty() == true )
+    {
+        return;
+    }
+    
+    // the parameters are updated lazily when we ask for their values,
+    // so we need to do this now before several threads read them
+    updateParameterValues();
+    
+    pool.runTreeJobs( parent_tasks, [&](size_t i) { computeBranchProbability( *nodes[i], nodes[i]->getIndex() ); } );
+    
+}
+
+
+/**
+ * Make sure that the values of all parameters are up to date.
+ * Deterministic parameters are updated lazily in getValue(), which is not safe to do from several threads at once.
+ */
+void StateDependentSpeciationExtinctionProcess::updateParameterValues( void ) const
+{
+    
+    if ( cladogenesis_matrix != NULL )
+    {
+        cladogenesis_matrix->getValue();
+    }
+    if ( process_age != NULL )
+    {
+        process_age->getValue();
+    }
+    if ( mu != NULL )
+    {
+        mu->getValue();
+    }
+    if ( lambda != NULL )
+    {
+        lambda->getValue();
+    }
+    if ( psi != NULL )
+    {
+        psi->getValue();
+    }
+    if ( pi != NULL )
+    {
+        pi->getValue();
+    }
+    if ( Q != NULL )
+    {
+        Q->getValue();
+    }
+    if ( rate != NULL )
+    {
+        rate->getValue();
+    }
+    if ( rho != NULL )
+    {
+        rho->getValue();
+    }
+    
 }
 
 
 double StateDependentSpeciationExtinctionProcess::computeRootLikelihood( void ) const
 {
     // get the likelihoods of descendant nodes
+    // compute the dirty nodes in parallel if we can
+    computeDirtyNodeProbabilities();
+    
     const TopologyNode     &root            = value->getRoot();
     size_t                  node_index      = root.getIndex();
     const TopologyNode     &left            = root.getChild(0);
@@ -3031,12 +3163,9 @@ void StateDependentSpeciationExtinctionProcess::numericallyIntegrateProcess(stat
     SSE_ODE ode = SSE_ODE(extinction_rates, &getEventRateMatrix(), getEventRate(), backward_time, extinction_only);
     if ( use_cladogenetic_events == true )
     {
-        cladogenesis_matrix->getValue(); // we must call getValue() to update the speciation and extinction rates in the event map
-        
-        // get cladogenesis event map (sparse speciation rate matrix)
-        std::map<std::vector<unsigned>, double> event_map = cladogenesis_matrix->getValue().getEventMap();
-        
-        ode.setEventMap( event_map );
+        // get the cladogenesis events (sparse speciation rate matrix) compiled into flat arrays
+        // we must call getValue() to update the speciation and extinction rates in the event map
+        ode.setCladogeneticEvents( cladogenesis_matrix->getValue().getEventArrays() );
     }
     else
     {
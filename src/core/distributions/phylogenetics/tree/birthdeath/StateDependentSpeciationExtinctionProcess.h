@@ -107,8 +107,11 @@ namespace RevBayesCore {
         bool                                                            simulateTreeConditionedOnTips(size_t attempts = 0);
         std::vector<double>                                             calculateTotalAnageneticRatePerState(void);
         std::vector<double>                                             calculateTotalSpeciationRatePerState(void);
+        void                                                            computeBranchProbability(const TopologyNode &n, size_t nIdx) const;                                 //!< Compute the likelihoods of a node whose children are up to date
+        void                                                            computeDirtyNodeProbabilities(void) const;                                                          //!< Compute the likelihoods of all dirty nodes in parallel
         void                                                            computeNodeProbability(const TopologyNode &n, size_t nIdx) const;
         double                                                          computeRootLikelihood() const;
+        void                                                            updateParameterValues(void) const;                                                                  //!< Update the values of all (lazily evaluated) parameters
         
         // members
         std::string                                                     condition;                                                                                          //!< The condition of the process (none/survival/#taxa).
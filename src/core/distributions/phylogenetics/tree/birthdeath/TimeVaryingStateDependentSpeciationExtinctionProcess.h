@@ -99,8 +99,11 @@ namespace RevBayesCore {
         std::vector<double>                                             calculateExtinctionRatePerState(double a);
         size_t                                                          computeEpochIndex(double a) const;
         double                                                          computeEpochEnd(size_t i) const;
+        void                                                            computeBranchProbability(const TopologyNode &n, size_t nIdx) const;                                 //!< Compute the likelihoods of a node whose children are up to date
+        void                                                            computeDirtyNodeProbabilities(void) const;                                                          //!< Compute the likelihoods of all dirty nodes in parallel
         void                                                            computeNodeProbability(const TopologyNode &n, size_t nIdx) const;
         double                                                          computeRootLikelihood() const;
+        void                                                            updateParameterValues(void) const;                                                                  //!< Update the values of all (lazily evaluated) parameters
         std::vector<double>                                             pExtinction(double start, double end) const;                                                        //!< Compute the probability of extinction of the process (without incomplete taxon sampling).
         virtual double                                                  pSurvival(double start, double end) const;                                                          //!< Compute the probability of survival of the process (without incomplete taxon sampling).
         void                                                            recursivelyFlagNodeDirty(const TopologyNode& n);
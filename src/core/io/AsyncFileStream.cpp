@@ -0,0 +1,176 @@
+#include "AsyncFileStream.h"
+#include "AsyncFileWriter.h"
+#include "RbConstants.h"
+
+using namespace RevBayesCore;
+
+
+AsyncFileStream::AsyncFileStream( void ) : std::iostream( NULL ),
+    buffer()
+{
+
+    rdbuf( &buffer );
+}
+
+
+AsyncFileStream::~AsyncFileStream( void )
+{
+
+    buffer.close();
+}
+
+
+void AsyncFileStream::close( void )
+{
+
+    if ( buffer.isOpen() == false )
+    {
+        setstate( std::ios_base::failbit );
+    }
+    buffer.close();
+
+}
+
+
+bool AsyncFileStream::is_open( void ) const
+{
+
+    return buffer.isOpen();
+}
+
+
+void AsyncFileStream::open(const char* fn, std::ios_base::openmode mode)
+{
+
+    if ( buffer.isOpen() == true || buffer.open( fn, (mode & std::ios_base::app) != 0 ) == false )
+    {
+        setstate( std::ios_base::failbit );
+    }
+    else
+    {
+        clear();
+    }
+
+}
+
+
+void AsyncFileStream::writeToDisk( void )
+{
+
+    buffer.writeToDisk();
+}
+
+
+AsyncFileStream::Buffer::Buffer( void ) :
+    record(),
+    file( RbConstants::Size_t::max )
+{
+
+    setp( chunk, chunk + CHUNK_SIZE );
+}
+
+
+void AsyncFileStream::Buffer::close( void )
+{
+
+    if ( isOpen() == true )
+    {
+        sync();
+        AsyncFileWriter::globalInstance().closeFile( file );
+        file = RbConstants::Size_t::max;
+    }
+
+}
+
+
+void AsyncFileStream::Buffer::collect( void )
+{
+
+    record.append( pbase(), pptr() - pbase() );
+    setp( chunk, chunk + CHUNK_SIZE );
+
+}
+
+
+bool AsyncFileStream::Buffer::isOpen( void ) const
+{
+
+    return file != RbConstants::Size_t::max;
+}
+
+
+bool AsyncFileStream::Buffer::open(const std::string &fn, bool append)
+{
+
+    file = AsyncFileWriter::globalInstance().openFile( fn, append );
+    record.clear();
+    setp( chunk, chunk + CHUNK_SIZE );
+
+    return isOpen();
+}
+
+
+AsyncFileStream::Buffer::int_type AsyncFileStream::Buffer::overflow(int_type c)
+{
+
+    if ( isOpen() == false )
+    {
+        return traits_type::eof();
+    }
+
+    collect();
+    if ( traits_type::eq_int_type( c, traits_type::eof() ) == false )
+    {
+        record.push_back( traits_type::to_char_type( c ) );
+    }
+
+    return traits_type::not_eof( c );
+}
+
+
+/**
+ * We can only report the current position, which is always the end of the file:
+ * the size of the file (including the records of other streams sharing it) plus our data not yet handed over.
+ * This keeps calls like seekg(0, std::ios::end) working.
+ */
+AsyncFileStream::Buffer::pos_type AsyncFileStream::Buffer::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+
+    if ( off != 0 || dir == std::ios_base::beg || isOpen() == false )
+    {
+        return pos_type( off_type(-1) );
+    }
+
+    size_t file_size = AsyncFileWriter::globalInstance().getFileSize( file );
+
+    return pos_type( off_type( file_size + record.size() + (pptr() - pbase()) ) );
+}
+
+
+int AsyncFileStream::Buffer::sync( void )
+{
+
+    if ( isOpen() == false )
+    {
+        return -1;
+    }
+
+    collect();
+    if ( record.empty() == false )
+    {
+        AsyncFileWriter::globalInstance().write( file, record );
+    }
+
+    return 0;
+}
+
+
+void AsyncFileStream::Buffer::writeToDisk( void )
+{
+
+    if ( sync() == 0 )
+    {
+        AsyncFileWriter::globalInstance().flush( file );
+    }
+
+}
@@ -0,0 +1,71 @@
+#ifndef AsyncFileStream_H
+#define AsyncFileStream_H
+
+#include <iostream>
+#include <string>
+
+namespace RevBayesCore {
+
+    /**
+     * @brief An output file stream that writes through the background writer.
+     *
+     * The stream can be used like an std::fstream that is only written to.
+     * The formatted output is collected in memory and handed to the AsyncFileWriter
+     * whenever the stream is flushed (e.g. by std::endl at the end of each record),
+     * so flushing does not cost a system call. The writer then writes the data to disk in large chunks.
+     * Closing the stream writes all remaining data.
+     * Several streams may open the same file (e.g. the monitors of the chains of an MC^3 analysis); they then share it in the writer
+     * and every record is appended at the end of the file.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since Version 1.0, 2026-10-18
+     *
+     */
+    class AsyncFileStream : public std::iostream {
+
+    public:
+        AsyncFileStream(void);
+        virtual ~AsyncFileStream(void);
+
+        void                                close(void);                                                    //!< Hand over the remaining data and close the file
+        bool                                is_open(void) const;
+        void                                open(const char* fn, std::ios_base::openmode mode = std::ios_base::out);   //!< Open the file (appending if mode contains app, otherwise truncating it)
+        void                                writeToDisk(void);                                              //!< Flush the stream and wait until all data is written to disk
+
+    private:
+
+        /*
+         * The stream buffer collecting the formatted output
+         */
+        class Buffer : public std::streambuf {
+
+        public:
+            Buffer(void);
+
+            void                            close(void);
+            bool                            isOpen(void) const;
+            bool                            open(const std::string &fn, bool append);
+            void                            writeToDisk(void);
+
+        protected:
+            int_type                        overflow(int_type c);
+            pos_type                        seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which);
+            int                             sync(void);
+
+        private:
+            void                            collect(void);                                                  //!< Move the put area into the record
+
+            static const size_t             CHUNK_SIZE = 4096;
+
+            char                            chunk[CHUNK_SIZE];
+            std::string                     record;                                                         //!< Data not yet handed to the writer
+            size_t                          file;                                                           //!< The id of the file in the writer
+        };
+
+        Buffer                              buffer;
+    };
+
+}
+
+#endif
@@ -0,0 +1,106 @@
+#include "MappedFile.h"
+#include "RbException.h"
+
+#include <fstream>
+#include <sstream>
+
+#	ifndef RB_WIN
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#   endif
+
+using namespace RevBayesCore;
+
+
+MappedFile::MappedFile(const std::string &fn) :
+    file_name( fn ),
+    data( NULL ),
+    length( 0 ),
+    content(),
+    is_mapped( false )
+{
+
+#	ifndef RB_WIN
+
+    int fd = open( fn.c_str(), O_RDONLY );
+    if ( fd < 0 )
+    {
+        throw RbException( "Could not open file \"" + fn + "\"" );
+    }
+
+    struct stat file_stat;
+    if ( fstat( fd, &file_stat ) == 0 && file_stat.st_size > 0 )
+    {
+        length = size_t( file_stat.st_size );
+        void* p = mmap( NULL, length, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if ( p != MAP_FAILED )
+        {
+            data = static_cast<const char*>( p );
+            is_mapped = true;
+#       ifdef MADV_SEQUENTIAL
+            madvise( p, length, MADV_SEQUENTIAL );
+#       endif
+        }
+    }
+    close( fd );
+
+    if ( is_mapped == true || length == 0 )
+    {
+        return;
+    }
+
+#   endif
+
+    // we could not map the file, so we read it
+    std::ifstream in( fn.c_str(), std::ios::in | std::ios::binary );
+    if ( !in )
+    {
+        throw RbException( "Could not open file \"" + fn + "\"" );
+    }
+
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    content = buffer.str();
+    data    = content.data();
+    length  = content.size();
+
+}
+
+
+MappedFile::~MappedFile( void )
+{
+
+#	ifndef RB_WIN
+    if ( is_mapped == true )
+    {
+        munmap( const_cast<char*>( data ), length );
+    }
+#   endif
+
+}
+
+
+const char* MappedFile::begin( void ) const
+{
+    return data;
+}
+
+
+const char* MappedFile::end( void ) const
+{
+    return data + length;
+}
+
+
+const std::string& MappedFile::getFileName( void ) const
+{
+    return file_name;
+}
+
+
+size_t MappedFile::size( void ) const
+{
+    return length;
+}
@@ -0,0 +1,47 @@
+#ifndef MappedFile_H
+#define MappedFile_H
+
+#include <cstddef>
+#include <string>
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Read-only view of the content of a file.
+     *
+     * The file is mapped into memory (mmap), so that large files can be scanned and parsed
+     * without copying them into strings first. The pages are loaded by the operating system when they are accessed.
+     * On Windows we simply read the whole file into memory.
+     *
+     * The content is not terminated by '\0', so never read beyond data() + size().
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since Version 1.0, 2026-10-18
+     *
+     */
+    class MappedFile {
+
+    public:
+        MappedFile(const std::string &fn);                                              //!< Map the file (throws if the file cannot be read)
+        virtual                            ~MappedFile(void);
+
+        const char*                         begin(void) const;
+        const char*                         end(void) const;
+        const std::string&                  getFileName(void) const;
+        size_t                              size(void) const;
+
+    private:
+                                            MappedFile(const MappedFile&);              //!< Prevent copy
+        MappedFile&                         operator=(const MappedFile&);               //!< Prevent assignment
+
+        std::string                         file_name;
+        const char*                         data;
+        size_t                              length;
+        std::string                         content;                                    //!< The content if the file could not be mapped
+        bool                                is_mapped;
+    };
+
+}
+
+#endif
@@ -3,9 +3,10 @@
 #include "TopologyNode.h"
 #include "Tree.h"
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 #include <vector>
 
 using namespace RevBayesCore;
@@ -23,40 +24,81 @@ NewickConverter::~NewickConverter()
 
 
 
+namespace {
+
+    /*
+     * Find the first character in [pos,end) that is one of the stop characters.
+     */
+    inline const char* findFirstOf(const char* pos, const char* end, const char* stop)
+    {
+        while ( pos < end && std::strchr( stop, *pos ) == NULL )
+        {
+            ++pos;
+        }
+
+        return pos;
+    }
+
+    /*
+     * Parse a number from [begin,end). The range is not '\0' terminated, so we copy short numbers into a local buffer.
+     */
+    double parseDouble(const char* begin, const char* end)
+    {
+        char buffer[64];
+        size_t length = size_t(end - begin);
+        if ( length < sizeof(buffer) )
+        {
+            std::memcpy( buffer, begin, length );
+            buffer[length] = '\0';
+            return std::strtod( buffer, NULL );
+        }
+
+        return std::strtod( std::string(begin, end).c_str(), NULL );
+    }
+
+}
+
+
 Tree* NewickConverter::convertFromNewick(std::string const &n, bool reindex)
 {
     
-    // create and allocate the tree object
-    Tree *t = new Tree();
-    
-    std::vector<TopologyNode*> nodes;
-    std::vector<double> brlens;
-    
-    // create a string-stream and throw the string into it
-    std::stringstream ss (std::stringstream::in | std::stringstream::out);
-    ss << n;
+    return convertFromNewick( n.data(), n.data() + n.size(), reindex );
+}
+
+
+/**
+ * Convert the newick string in [begin,end) into a tree.
+ * We parse the characters in place; only names and parameter values are copied into the nodes.
+ */
+Tree* NewickConverter::convertFromNewick(const char* begin, const char* end, bool reindex)
+{
     
-    // ignore white spaces
+    // ignore white spaces (we only need to copy the string if there are any)
     std::string trimmed = "";
-    char c;
-    while ( ss.good() )
+    if ( std::find( begin, end, ' ' ) != end )
     {
-        // check for EOF
-        int c_int = ss.get();
-        if (c_int != EOF)
+        trimmed.reserve( end - begin );
+        for (const char* c = begin; c != end; ++c)
         {
-            c = char( c_int );
-            if ( c != ' ')
+            if ( *c != ' ' )
             {
-                trimmed += c;
+                trimmed += *c;
             }
-            
         }
-        
+        begin = trimmed.data();
+        end   = begin + trimmed.size();
     }
-	
+    
+    std::vector<TopologyNode*> nodes;
+    std::vector<double> brlens;
+    
     // construct the tree starting from the root
-    TopologyNode *root = createNode( trimmed, nodes, brlens );
+    const char* pos = begin;
+    TopologyNode *root = createNode( pos, end, nodes, brlens );
+    readNodeSuffix( pos, end, root, nodes, brlens );
+    
+    // create and allocate the tree object
+    Tree *t = new Tree();
     
     // set up the tree
     t->setRoot( root, reindex );
@@ -79,376 +121,223 @@ Tree* NewickConverter::convertFromNewick(std::string const &n, bool reindex)
 }
 
 
-
-TopologyNode* NewickConverter::createNode(const std::string &n, std::vector<TopologyNode*> &nodes, std::vector<double> &brlens) {
-    
-    // create a string-stream and throw the string into it
-    std::stringstream ss (std::stringstream::in | std::stringstream::out);
-    ss << n;
-    
-    char c = ' ';
-    ss.get(c);
+/**
+ * Create the node starting at the opening parenthesis at pos, including all its descendants.
+ * On return, pos is just behind the closing parenthesis, i.e., at the label of the node.
+ */
+TopologyNode* NewickConverter::createNode(const char* &pos, const char* end, std::vector<TopologyNode*> &nodes, std::vector<double> &brlens)
+{
     
     // the initial character has to be '('
-    if ( c != '(')
+    if ( pos == end || *pos != '(' )
     {
         throw RbException("Error while converting Newick tree. We expected an opening parenthesis, but didn't get one.");
     }
+    ++pos;
     
-    TopologyNode *node = new TopologyNode(); 
-    while ( ss.good() && ss.peek() != ')' )
+    TopologyNode *node = new TopologyNode();
+    while ( pos < end && *pos != ')' )
     {
         
-        TopologyNode *childNode;
-        if (ss.peek() == '(' )
+        TopologyNode *child_node;
+        if ( *pos == '(' )
         {
             // we received an internal node
-            int depth = 0;
-            std::string child = "";
-            do
-            {
-                ss.get(c);
-                child += c;
-                if ( c == '(' )
-                {
-                    depth++;
-                }
-                else if ( c == ')' )
-                {
-                    depth--;
-                }
-                
-            } while ( ss.good() && depth > 0 );
-        
-            // construct the child node
-            childNode = createNode( child, nodes, brlens );
+            child_node = createNode( pos, end, nodes, brlens );
         }
         else
         {
             // construct the node
-            childNode = new TopologyNode();
+            child_node = new TopologyNode();
         }
         
         // set the parent child relationship
-        node->addChild( childNode );
-        childNode->setParent( node );
+        node->addChild( child_node );
+        child_node->setParent( node );
         
-        // read the optional label
-        std::string lbl = "";
-        while ( ss.good() && (c = char( ss.peek() ) ) != ':' && c != '[' && c != ';' && c != ',' && c != ')')
-        {
-            lbl += char( ss.get() );
-        }
-        childNode->setName( lbl );
+        // read the label, parameters and branch length of the child
+        readNodeSuffix( pos, end, child_node, nodes, brlens );
         
-        // read the optional node parameters
-        if ( ss.peek() == '[' )
+        // skip comma
+        if ( pos < end && *pos == ',' )
         {
-            
-            do
-            {
-                
-                ss.ignore();
-                // ignore the '&' before parameter name
-                if ( ss.peek() == '&') 
-                {
-                    ss.ignore();
-                }
-                
-                // read the parameter name
-                std::string paramName = "";
-                while ( ss.good() && (c = char( ss.peek() ) ) != '=' && c != ',' && c != ']')
-                {
-                    paramName += char( ss.get() );
-                }
-                
-                // ignore the equal sign between parameter name and value
-                if ( ss.peek() == '=') 
-                {
-                    ss.ignore();
-                }
-                
-                // read the parameter name
-                std::string paramValue = "";
-                while ( ss.good() && (c = char( ss.peek() ) ) != ']' && c != ',' && c != ':')
-                {
-                    paramValue += char( ss.get() );
-                }
-                
-				if (paramName == "index")
-                {
-					// subtract by 1 to correct RevLanguage 1-based indexing
-                    childNode->setIndex( atoi(paramValue.c_str()) - 1 );
-					
-                }
-                else if (paramName=="species")
-                {
-                    childNode->setSpeciesName(paramValue);
-				}
-                else
-                {
-                    childNode->addNodeParameter(paramName, paramValue);
-                }
-				
-            } while ( (c = char( ss.peek() ) ) == ',' );
-            
-            // ignore the final ']'
-            if ( (c = char( ss.peek( ) ) ) == ']' )
-            {
-                ss.ignore();
-            }
-            
+            ++pos;
         }
-        
-        // read the optional branch length
-        if ( ss.peek() == ':' )
+        else if ( pos < end && *pos != ')' )
         {
-            ss.ignore();
-            std::string time = "";
-            while ( ss.good() && (c = char( ss.peek( ) ) ) != ';' && c != ',' && c != ')' && c != '[' )
-            {
-                time += char( ss.get() );
-            }
-            
-            std::istringstream stm;
-            stm.str(time);
-            double d;
-            stm >> d;
-            nodes.push_back( childNode );
-            brlens.push_back( d );
+            throw RbException("Error while converting Newick tree. We expected a ',' or ')' but got '" + std::string(1, *pos) + "'.");
         }
-        else
+        
+    }
+    
+    if ( node->getNumberOfChildren() == 1 )
+    {
+        node->setSampledAncestor( true );
+    }
+
+    // remove closing parenthesis
+    if ( pos < end )
+    {
+        ++pos;
+    }
+    
+    return node;
+}
+
+
+/**
+ * Read the branch parameters, e.g., [&rate=0.1,index=3], and add them to the node.
+ */
+void NewickConverter::readBranchParameters(const char* &pos, const char* end, TopologyNode* node)
+{
+    
+    do
+    {
+        // skip the '[' or ','
+        ++pos;
+        
+        // ignore the '&' before parameter name
+        if ( pos < end && *pos == '&' )
         {
-            nodes.push_back( childNode );
-            brlens.push_back( 0.0 );
+            ++pos;
         }
         
-        // read the optional branch parameters
-        if ( char( ss.peek() ) == '[' )
+        // read the parameter name
+        const char* name_end = findFirstOf( pos, end, "=,]" );
+        std::string param_name( pos, name_end );
+        pos = name_end;
+        
+        // ignore the equal sign between parameter name and value
+        if ( pos < end && *pos == '=' )
         {
-            
-            do
-            {
-                
-                ss.ignore();
-                
-                // ignore the '&' before parameter name
-                if ( char( ss.peek() ) == '&')
-                {
-                    ss.ignore();
-                }
-                
-                // read the parameter name
-                std::string paramName = "";
-                while ( ss.good() && (c = char( ss.peek() )) != '=' && c != ',')
-                {
-                    paramName += char( ss.get() );
-                }
-                
-                // ignore the equal sign between parameter name and value
-                if ( char( ss.peek() ) == '=')
-                {
-                    ss.ignore();
-                }
-                
-                // read the parameter name
-                std::string paramValue = "";
-                while ( ss.good() && (c = char( ss.peek() )) != ']' && c != ',' && c != ':')
-                {
-                    paramValue += char( ss.get() );
-                }
-                
-                if (paramName=="index")
-                {
-                    // subtract by 1 to correct RevLanguage 1-based indexing
-                    childNode->setIndex( atoi(paramValue.c_str()) - 1 );
-                }
-                else if (paramName=="species")
-                {
-                    childNode->setSpeciesName(paramValue);
-                }
-                else
-                {
-                    childNode->addBranchParameter(paramName, paramValue);
-                }
-                
-                
-            } while ( (c = char( ss.peek() )) != ']' );
-            
-            ss.ignore();
-            
+            ++pos;
         }
         
+        // read the parameter value
+        const char* value_end = findFirstOf( pos, end, "],:" );
+        std::string param_value( pos, value_end );
+        pos = value_end;
         
-        // skip comma
-        if ( char( ss.peek() ) == ',' )
+        if ( param_name == "index" )
         {
-            ss.ignore();
+            // subtract by 1 to correct RevLanguage 1-based indexing
+            node->setIndex( std::atoi( param_value.c_str() ) - 1 );
+        }
+        else if ( param_name == "species" )
+        {
+            node->setSpeciesName( param_value );
+        }
+        else
+        {
+            node->addBranchParameter( param_name, param_value );
         }
         
-    }
+    } while ( pos < end && *pos != ']' );
     
-    if (node->getNumberOfChildren() == 1)
+    // ignore the final ']'
+    if ( pos < end )
     {
-        node->setSampledAncestor( true );
+        ++pos;
     }
-
-    // remove closing parenthesis
-    ss.ignore();
     
-    // read the optional label, checking for EOF = '\377'
-    std::string lbl = "";
-    while ( ss.good() && (c = char( ss.peek() )) != ':' && c != ';' && c != ',' && c != '[' && c != '\377')
-    {
-        lbl += char( ss.get() );
-    }
-    node->setName( lbl );
+}
+
+
+/**
+ * Read the node parameters, e.g., [&index=3,posterior=0.9], and add them to the node.
+ */
+void NewickConverter::readNodeParameters(const char* &pos, const char* end, TopologyNode* node)
+{
     
-    // read the optional node parameters
-    if ( char( ss.peek() ) == '[' )
+    do
     {
+        // skip the '[' or ','
+        ++pos;
         
-        do
+        // ignore the '&' before parameter name
+        if ( pos < end && *pos == '&' )
         {
-            
-            ss.ignore();
-
-            // ignore the '&' before parameter name
-            if ( char( ss.peek() ) == '&') 
-            {
-                ss.ignore();
-            }
-            
-            // read the parameter name
-            std::string paramName = "";
-            while ( ss.good() && (c = char( ss.peek() )) != '=' && c != ',')
-            {
-                paramName += char( ss.get() );
-            }
-            
-            // ignore the equal sign between parameter name and value
-            if ( char( ss.peek() ) == '=') 
-            {
-                ss.ignore();
-            }
-            
-            // read the parameter name
-            std::string paramValue = "";
-            while ( ss.good() && (c = char( ss.peek() )) != ']' && c != ',' && c != ':') 
-            {
-                paramValue += char( ss.get() );
-            }
-			
-			if (paramName=="index")
-            {
-				// subtract by 1 to correct RevLanguage 1-based indexing
-				node->setIndex( atoi(paramValue.c_str()) - 1 );
-				
-			}
-            else if (paramName=="species")
-            {
-				node->setSpeciesName(paramValue);
-            }
-            else
-            {
-                node->addNodeParameter(paramName, paramValue);
-            }
-
-            
-        } while ( (c = char( ss.peek() )) == ',' );
+            ++pos;
+        }
+        
+        // read the parameter name
+        const char* name_end = findFirstOf( pos, end, "=,]" );
+        std::string param_name( pos, name_end );
+        pos = name_end;
         
-        // ignore the final ']'
-        if ( (c = char( ss.peek() )) == ']' )
+        // ignore the equal sign between parameter name and value
+        if ( pos < end && *pos == '=' )
+        {
+            ++pos;
+        }
+        
+        // read the parameter value
+        const char* value_end = findFirstOf( pos, end, "],:" );
+        std::string param_value( pos, value_end );
+        pos = value_end;
+        
+        if ( param_name == "index" )
+        {
+            // subtract by 1 to correct RevLanguage 1-based indexing
+            node->setIndex( std::atoi( param_value.c_str() ) - 1 );
+        }
+        else if ( param_name == "species" )
+        {
+            node->setSpeciesName( param_value );
+        }
+        else
         {
-            ss.ignore();
+            node->addNodeParameter( param_name, param_value );
         }
         
+    } while ( pos < end && *pos == ',' );
+    
+    // ignore the final ']'
+    if ( pos < end && *pos == ']' )
+    {
+        ++pos;
+    }
+    
+}
+
+
+/**
+ * Read everything that follows a node: the optional label, node parameters, branch length and branch parameters.
+ */
+void NewickConverter::readNodeSuffix(const char* &pos, const char* end, TopologyNode* node, std::vector<TopologyNode*> &nodes, std::vector<double> &brlens)
+{
+    
+    // read the optional label
+    const char* label_end = findFirstOf( pos, end, ":[;,)" );
+    node->setName( std::string( pos, label_end ) );
+    pos = label_end;
+    
+    // read the optional node parameters
+    if ( pos < end && *pos == '[' )
+    {
+        readNodeParameters( pos, end, node );
     }
     
     // read the optional branch length
-    if ( char( ss.peek() ) == ':' )
+    nodes.push_back( node );
+    if ( pos < end && *pos == ':' )
     {
-        ss.ignore();
-        std::string time = "";
-        while ( ss.good() && (c = char( ss.peek() )) != ';' && c != ',' && c != '[' )
-        {
-            time += char( ss.get() );
-        }
-        
-        std::istringstream stm;
-        stm.str(time);
-        double d;
-        stm >> d;
-        nodes.push_back( node );
-        brlens.push_back( d );
+        ++pos;
+        const char* time_end = findFirstOf( pos, end, ";,)[" );
+        brlens.push_back( parseDouble( pos, time_end ) );
+        pos = time_end;
     }
     else
     {
-        nodes.push_back( node );
         brlens.push_back( 0.0 );
     }
     
-    
-    
     // read the optional branch parameters
-    if ( char( ss.peek() ) == '[' )
+    if ( pos < end && *pos == '[' )
     {
-        
-        do
-        {
-            
-            ss.ignore();
-            
-            // ignore the '&' before parameter name
-            if ( char( ss.peek() ) == '&')
-            {
-                ss.ignore();
-            }
-            
-            // read the parameter name
-            std::string paramName = "";
-            while ( ss.good() && (c = char( ss.peek() )) != '=' && c != ',')
-            {
-                paramName += char( ss.get() );
-            }
-            
-            // ignore the equal sign between parameter name and value
-            if ( char( ss.peek() ) == '=')
-            {
-                ss.ignore();
-            }
-            
-            // read the parameter name
-            std::string paramValue = "";
-            while ( ss.good() && (c = char( ss.peek() )) != ']' && c != ',' && c != ':')
-            {
-                paramValue += char( ss.get() );
-            }
-            
-            if (paramName=="index")
-            {
-                // subtract by 1 to correct RevLanguage 1-based indexing
-                node->setIndex( atoi(paramValue.c_str()) - 1 );
-                
-            }
-            else if (paramName=="species")
-            {
-                node->setSpeciesName(paramValue);
-            }
-            else
-            {
-                node->addBranchParameter(paramName, paramValue);
-            }
-            
-            
-        } while ( (c = char( ss.peek() )) != ']' );
-        
-        ss.ignore();
-        
+        readBranchParameters( pos, end, node );
     }
     
-    
-    return node;
 }
 
 
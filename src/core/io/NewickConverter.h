@@ -35,10 +35,14 @@ namespace RevBayesCore {
         virtual                 ~NewickConverter();
     
         Tree*                   convertFromNewick(const std::string &n, bool reindex = true );
+        Tree*                   convertFromNewick(const char* begin, const char* end, bool reindex = true );                   //!< Convert the newick string in [begin,end)
 //        AdmixtureTree*          getAdmixtureTreeFromNewick(const std::string &n);
 
     private:
-        TopologyNode*           createNode(const std::string &n, std::vector<TopologyNode*> &nodes, std::vector<double> &brlens);
+        TopologyNode*           createNode(const char* &pos, const char* end, std::vector<TopologyNode*> &nodes, std::vector<double> &brlens);
+        void                    readBranchParameters(const char* &pos, const char* end, TopologyNode* node);
+        void                    readNodeParameters(const char* &pos, const char* end, TopologyNode* node);
+        void                    readNodeSuffix(const char* &pos, const char* end, TopologyNode* node, std::vector<TopologyNode*> &nodes, std::vector<double> &brlens);
     };
 
 }
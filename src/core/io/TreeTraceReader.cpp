@@ -0,0 +1,180 @@
+#include "NewickConverter.h"
+#include "RbException.h"
+#include "StringUtilities.h"
+#include "ThreadPool.h"
+#include "Tree.h"
+#include "TreeTraceReader.h"
+#include "TreeUtilities.h"
+
+#include <algorithm>
+
+using namespace RevBayesCore;
+
+
+/**
+ * Constructor.
+ * We map the file and record for each sample where its tree starts and ends.
+ * The first line that is neither empty nor a comment is the header.
+ */
+TreeTraceReader::TreeTraceReader(const std::string &fn, const std::string &delimiter) :
+    file( fn ),
+    parameter_name( "" ),
+    trees()
+{
+
+    if ( delimiter.empty() == true )
+    {
+        throw RbException( "The delimiter for reading the tree trace \"" + fn + "\" is empty." );
+    }
+
+    bool has_header_been_read = false;
+    size_t index = 0;
+
+    const char* pos = file.begin();
+    const char* end = file.end();
+    while ( pos < end )
+    {
+
+        // find the end of the line (we accept '\n', '\r' and "\r\n")
+        const char* line_begin = pos;
+        const char* line_end   = pos;
+        while ( line_end < end && *line_end != '\n' && *line_end != '\r' )
+        {
+            ++line_end;
+        }
+
+        pos = line_end;
+        if ( pos < end && *pos == '\r' )
+        {
+            ++pos;
+        }
+        if ( pos < end && *pos == '\n' && ( pos == line_end || *line_end == '\r' ) )
+        {
+            ++pos;
+        }
+
+        // skip empty lines and comments
+        if ( line_begin == line_end || *line_begin == '#' )
+        {
+            continue;
+        }
+
+        // we assume a header at the first line of the file
+        if ( has_header_been_read == false )
+        {
+
+            std::vector<std::string> columns;
+            StringUtilities::stringSplit( std::string( line_begin, line_end ), delimiter, columns );
+
+            for (size_t j=1; j<columns.size(); j++)
+            {
+
+                const std::string &parm_name = columns[j];
+                if ( parm_name == "Posterior" || parm_name == "Likelihood" || parm_name == "Prior" )
+                {
+                    continue;
+                }
+
+                // the trace takes its name from the first tree column, but the trees from the last one
+                if ( index == 0 )
+                {
+                    parameter_name = parm_name;
+                }
+                index = j;
+            }
+
+            if ( index == 0 )
+            {
+                throw RbException( "Could not find a tree column in the header of file \"" + fn + "\"." );
+            }
+
+            has_header_been_read = true;
+
+            continue;
+        }
+
+        // find the column with the tree
+        const char* column_begin = line_begin;
+        for (size_t j=0; j<index; ++j)
+        {
+            const char* column_end = std::search( column_begin, line_end, delimiter.begin(), delimiter.end() );
+            if ( column_end == line_end )
+            {
+                throw RbException( "Missing tree in sample " + StringUtilities::to_string( trees.size() + 1 ) + " of file \"" + fn + "\"." );
+            }
+            column_begin = column_end + delimiter.size();
+        }
+        const char* column_end = std::search( column_begin, line_end, delimiter.begin(), delimiter.end() );
+
+        trees.push_back( std::make_pair( column_begin, column_end ) );
+    }
+
+}
+
+
+size_t TreeTraceReader::getNumberOfTrees( void ) const
+{
+
+    return trees.size();
+}
+
+
+const std::string& TreeTraceReader::getParameterName( void ) const
+{
+
+    return parameter_name;
+}
+
+
+/**
+ * Parse the i-th tree of the file.
+ * Clock trees are converted so that the nodes have ages instead of branch lengths.
+ */
+Tree* TreeTraceReader::readTree(size_t i, bool clock) const
+{
+
+    NewickConverter c;
+    Tree *tau = c.convertFromNewick( trees[i].first, trees[i].second );
+
+    if ( clock == true )
+    {
+        Tree *bl_tree = tau;
+        tau = TreeUtilities::convertTree( *bl_tree );
+        delete bl_tree;
+    }
+
+    return tau;
+}
+
+
+/**
+ * Parse the trees with the given indices.
+ * The trees are independent, so we split them into blocks which are parsed by the threads of the pool.
+ */
+std::vector<Tree*> TreeTraceReader::readTrees(const std::vector<size_t> &indices, bool clock) const
+{
+
+    std::vector<Tree*> values( indices.size(), NULL );
+
+    try
+    {
+        ThreadPool::globalInstance().parallelFor( indices.size(), [&](size_t begin, size_t end)
+        {
+            for (size_t i=begin; i<end; ++i)
+            {
+                values[i] = readTree( indices[i], clock );
+            }
+        }, 16 );
+    }
+    catch (...)
+    {
+        // free the trees that we have already parsed
+        for (size_t i=0; i<values.size(); ++i)
+        {
+            delete values[i];
+        }
+        throw;
+    }
+
+    return values;
+}
@@ -0,0 +1,45 @@
+#ifndef TreeTraceReader_H
+#define TreeTraceReader_H
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace RevBayesCore {
+
+    class Tree;
+
+    /**
+     * @brief Reader for tree traces written by the tree monitors.
+     *
+     * The file is a delimited table with a header line, one sample per line and the trees given as Newick strings.
+     * The reader maps the file into memory and only records where each Newick string starts and ends.
+     * The trees themselves are parsed directly from the mapped file, in parallel if several threads are available.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since Version 1.0, 2026-10-18
+     *
+     */
+    class TreeTraceReader {
+
+    public:
+        TreeTraceReader(const std::string &fn, const std::string &delimiter);                      //!< Map the file and index its samples
+
+        size_t                                              getNumberOfTrees(void) const;
+        const std::string&                                  getParameterName(void) const;
+        Tree*                                               readTree(size_t i, bool clock) const;                                   //!< Parse the i-th tree (the caller owns the tree)
+        std::vector<Tree*>                                  readTrees(const std::vector<size_t> &indices, bool clock) const;        //!< Parse the given trees in parallel (the caller owns the trees)
+
+    private:
+        MappedFile                                          file;
+        std::string                                         parameter_name;
+        std::vector< std::pair<const char*, const char*> >  trees;                                                                  //!< The range of the Newick string of each sample
+    };
+
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include "RbConstants.h"
 
 #include <assert.h>
+#include <cmath>
 #include <vector>
 
 using namespace RevBayesCore;
@@ -41,24 +42,34 @@ void CholeskyDecomposition::computeInverse( void )
 {
     
     // first, invert the lower cholesky factor
-    MatrixReal inverseLowerFactor = MatrixReal(n, n, 0.0);
-    RbMath::matrixInverse(L, inverseLowerFactor);
-    //    MatrixReal inverseLowerFactor = L.computeInverse();
+    MatrixReal inverseLowerFactor;
+    RbMath::lowerTriangularInverse(L, inverseLowerFactor);
     
-    // now, transpose the inverse lower factor
-    MatrixReal inverseLowerFactorTranspose(n, n, 0.0);
+    // now, multiply the transposed inverse factor with the inverse factor, i.e.,
+    // inverse[i][j] = sum_{k >= max(i,j)} inverseLowerFactor[k][i] * inverseLowerFactor[k][j]
+    // we add the rows of the (triangular) inverse factor one by one and fill in the upper triangle by symmetry
+    inverseMatrix = MatrixReal(n, n, 0.0);
+    for (size_t k = 0; k < n; ++k)
+    {
+        MatrixReal::ConstRow x_k = const_cast<const MatrixReal&>(inverseLowerFactor)[k];
+        for (size_t r = 0; r <= k; ++r)
+        {
+            const double x_kr = x_k[r];
+            MatrixReal::Row inv_r = inverseMatrix[r];
+            for (size_t c = 0; c <= r; ++c)
+            {
+                inv_r[c] += x_kr * x_k[c];
+            }
+        }
+    }
     for (size_t r = 0; r < n; ++r)
     {
-        for (size_t c = 0; c <= r; ++c)
+        for (size_t c = 0; c < r; ++c)
         {
-            inverseLowerFactorTranspose[c][r] = inverseLowerFactor[r][c];
+            inverseMatrix[c][r] = inverseMatrix[r][c];
         }
     }
     
-    // now, multiply the two matrices together
-    inverseMatrix = inverseLowerFactorTranspose * inverseLowerFactor;
-//    inverseMatrix.getLogDet(); // this is just for debugging purposes: I want to force the matrix to update
-    
 }
 
 double CholeskyDecomposition::computeLogDet(void)
@@ -93,33 +104,34 @@ void CholeskyDecomposition::decomposeMatrix( void )
     is_positive_definite = true;
     is_positive_semidefinite = true;
     
+    // both the matrix and the factor are stored row by row,
+    // so the dot products below run over contiguous memory
     for (size_t r = 0; r < n; ++r)
     {
+        MatrixReal::ConstRow q_r = (*qPtr)[r];
+        MatrixReal::Row      L_r = L[r];
         for (size_t c = 0; c <= r; ++c)
         {
+            MatrixReal::ConstRow L_c = const_cast<const MatrixReal&>(L)[c];
+            double sum = 0.0;
+            for (size_t j = 0; j < c; ++j)
+            {
+                sum += L_r[j] * L_c[j];
+            }
+            
             if (c == r)
             {
-                double sum = 0.0;
-                for (size_t j = 0; j < c; ++j)
-                {
-                    sum += L[c][j] * L[c][j];
-                }
-                L[c][c] = std::sqrt((*qPtr)[c][c] - sum);
-                if ( ((*qPtr)[c][c] - sum) < 0.0) {
+                L_r[c] = std::sqrt(q_r[c] - sum);
+                if ( (q_r[c] - sum) < 0.0) {
                     is_positive_semidefinite = false;
                 }
-                if ( ((*qPtr)[c][c] - sum) <= 0.0) {
+                if ( (q_r[c] - sum) <= 0.0) {
                     is_positive_definite = false;
                 }
             }
             else
             {
-                double sum = 0.0;
-                for (size_t j = 0; j < c; ++j)
-                {
-                    sum += L[r][j] * L[c][j];
-                }
-                L[r][c] = 1.0 / L[c][c] * ( (*qPtr)[r][c] - sum );
+                L_r[c] = 1.0 / L_c[c] * ( q_r[c] - sum );
             }
         }
     }
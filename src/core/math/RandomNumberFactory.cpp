@@ -25,9 +25,12 @@
 #include <ctime>
 #include <climits>
 #include <climits>
+#include <cstdint>
 
 using namespace RevBayesCore;
 
+thread_local RandomNumberGenerator* RandomNumberFactory::thread_generator = NULL;
+
 /** Default constructor */
 RandomNumberFactory::RandomNumberFactory(void)
 {
@@ -43,6 +46,27 @@ RandomNumberFactory::~RandomNumberFactory(void) {
 }
 
 
+/**
+ * Make the given generators independent streams for chains or worker threads.
+ * We draw a single 64-bit key from the global generator (or the one of this thread),
+ * so that the streams are reproducible for a given seed, and give generator i the Philox stream i.
+ */
+void RandomNumberFactory::createIndependentStreams(std::vector<RandomNumberGenerator> &streams)
+{
+    
+    RandomNumberGenerator *rng = getGlobalRandomNumberGenerator();
+    std::uint64_t key_high = std::uint64_t( rng->uniform01() * 4294967296.0 );
+    std::uint64_t key_low  = std::uint64_t( rng->uniform01() * 4294967296.0 );
+    std::uint64_t key = (key_high << 32) | key_low;
+    
+    for (size_t i = 0; i < streams.size(); ++i)
+    {
+        streams[i].setStream( key, i );
+    }
+    
+}
+
+
 /** Delete a random number object (remove it from the pool too) */
 void RandomNumberFactory::deleteRandomNumberGenerator(RandomNumberGenerator* r) {
 
@@ -50,3 +74,18 @@ void RandomNumberFactory::deleteRandomNumberGenerator(RandomNumberGenerator* r)
     
     delete r;
 }
+
+
+/**
+ * Set the random number object that the calling thread gets as the global random number object.
+ * This allows, e.g., the chains of an MCMCMC analysis to run on several threads, each drawing from its own stream.
+ * The random number object is not owned by the factory.
+ */
+RandomNumberGenerator* RandomNumberFactory::setThreadRandomNumberGenerator(RandomNumberGenerator* r)
+{
+
+    RandomNumberGenerator* previous = thread_generator;
+    thread_generator = r;
+
+    return previous;
+}
@@ -21,6 +21,7 @@
 #ifndef RandomNumberFactory_H
 #define RandomNumberFactory_H
 
+#include <cstddef>
 #include <set>
 #include <vector>
 
@@ -38,8 +39,10 @@ namespace RevBayesCore {
                                                         static RandomNumberFactory singleRandomNumberFactory;
                                                         return singleRandomNumberFactory;
                                                     }
+		void                                        createIndependentStreams(std::vector<RandomNumberGenerator> &streams);                 //!< Turn all elements into independent Philox streams with a key drawn from the global random number object
 		void                                        deleteRandomNumberGenerator(RandomNumberGenerator* r);                                 //!< Return a random number object to the pool
-		RandomNumberGenerator*                      getGlobalRandomNumberGenerator(void) { return seedGenerator; }                         //!< Return a pointer to the global random number object
+		RandomNumberGenerator*                      getGlobalRandomNumberGenerator(void) { return ( thread_generator != NULL ? thread_generator : seedGenerator ); }   //!< Return a pointer to the global random number object (or the one set for this thread)
+		RandomNumberGenerator*                      setThreadRandomNumberGenerator(RandomNumberGenerator* r);                              //!< Use r as the global random number object of the calling thread (NULL to reset); returns the previous one
 
 	private:
                                                     RandomNumberFactory(void);                                                             //!< Default constructor
@@ -47,6 +50,7 @@ namespace RevBayesCore {
                                                     RandomNumberFactory& operator=(const RandomNumberFactory&);                            //!< Assignment operator
                                                    ~RandomNumberFactory(void);                                                             //!< Destructor
 		RandomNumberGenerator*                      seedGenerator;                                                                         //!< A random number object that generates seeds
+		static thread_local RandomNumberGenerator*  thread_generator;                                                                      //!< The random number object used instead of the global one by this thread
 		std::set<RandomNumberGenerator*>            allocatedRandomNumbers;                                                                //!< The pool of random number objects
     };
 }
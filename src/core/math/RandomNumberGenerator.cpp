@@ -1,6 +1,7 @@
 #include "RandomNumberGenerator.h"
 #include "RbException.h"
 #include <ctime>
+#include <sstream>
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 
@@ -8,8 +9,13 @@ using namespace RevBayesCore;
 
 /** Default constructor calling time to get the initial seeds */
 RandomNumberGenerator::RandomNumberGenerator(void) :
+        algorithm( RAND48 ),
         rng(),
-        zeroone(rng)
+        zeroone(rng),
+        philox_key( 0 ),
+        philox_stream( 0 ),
+        philox_counter( 0 ),
+        philox_position( 2 )
 {
     boost::posix_time::ptime t0(boost::posix_time::min_date_time);
     boost::posix_time::ptime t1 = boost::posix_time::microsec_clock::local_time();
@@ -21,6 +27,25 @@ RandomNumberGenerator::RandomNumberGenerator(void) :
 }
 
 
+/** Constructor of a Philox generator for the given key and stream */
+RandomNumberGenerator::RandomNumberGenerator(std::uint64_t key, std::uint64_t stream) :
+        algorithm( PHILOX ),
+        seed( (unsigned int)key ),
+        rng(),
+        zeroone(rng)
+{
+    
+    setStream( key, stream );
+    
+}
+
+
+RandomNumberGenerator::Algorithm RandomNumberGenerator::getAlgorithm( void ) const
+{
+    return algorithm;
+}
+
+
 /* Get the seed values */
 unsigned int RandomNumberGenerator::getSeed( void ) const
 {
@@ -28,36 +53,199 @@ unsigned int RandomNumberGenerator::getSeed( void ) const
 }
 
 
-/** Set the seed of the random number generator */
+/**
+ * Get the state of the generator as a string.
+ * Note that the uniform_01 distribution holds its own copy of the engine,
+ * which is the one that has been advanced by our draws.
+ */
+std::string RandomNumberGenerator::getState( void ) const
+{
+    std::stringstream ss;
+    if ( algorithm == PHILOX )
+    {
+        ss << "philox " << seed << " " << philox_key << " " << philox_stream << " " << philox_counter << " " << philox_position;
+    }
+    else
+    {
+        ss << seed << " " << zeroone.base();
+    }
+    
+    return ss.str();
+}
+
+
+/**
+ * Compute the next block of the Philox4x32-10 generator.
+ * The counter is made of the 64-bit block index and the 64-bit stream index.
+ */
+void RandomNumberGenerator::nextPhiloxBlock( void )
+{
+    
+    const std::uint32_t M0 = 0xD2511F53;
+    const std::uint32_t M1 = 0xCD9E8D57;
+    const std::uint32_t W0 = 0x9E3779B9;
+    const std::uint32_t W1 = 0xBB67AE85;
+    
+    std::uint32_t c0 = std::uint32_t( philox_counter );
+    std::uint32_t c1 = std::uint32_t( philox_counter >> 32 );
+    std::uint32_t c2 = std::uint32_t( philox_stream );
+    std::uint32_t c3 = std::uint32_t( philox_stream >> 32 );
+    std::uint32_t k0 = std::uint32_t( philox_key );
+    std::uint32_t k1 = std::uint32_t( philox_key >> 32 );
+    
+    for (size_t round = 0; round < 10; ++round)
+    {
+        std::uint64_t p0 = std::uint64_t(M0) * c0;
+        std::uint64_t p1 = std::uint64_t(M1) * c2;
+        
+        std::uint32_t hi0 = std::uint32_t( p0 >> 32 );
+        std::uint32_t lo0 = std::uint32_t( p0 );
+        std::uint32_t hi1 = std::uint32_t( p1 >> 32 );
+        std::uint32_t lo1 = std::uint32_t( p1 );
+        
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        
+        k0 += W0;
+        k1 += W1;
+    }
+    
+    philox_block[0] = c0;
+    philox_block[1] = c1;
+    philox_block[2] = c2;
+    philox_block[3] = c3;
+    
+    ++philox_counter;
+    
+}
+
+
+/** Change the algorithm and restart it with the current seed */
+void RandomNumberGenerator::setAlgorithm(Algorithm a)
+{
+    
+    algorithm = a;
+    setSeed( seed );
+    
+}
+
+
+/**
+ * Set the seed of the random number generator.
+ * For rand48 this gives exactly the same sequence as earlier versions of RevBayes.
+ * For Philox the seed is used as the key of stream 0.
+ */
 void RandomNumberGenerator::setSeed(unsigned int s)
 {
 
     seed = s;
     rng.seed( seed );
     zeroone = boost::uniform_01<boost::rand48>(rng);
+    
+    philox_key      = seed;
+    philox_stream   = 0;
+    philox_counter  = 0;
+    philox_position = 2;
 
 }
 
 
+/** Restore the state of the generator from a string created by getState() */
+void RandomNumberGenerator::setState(const std::string &s)
+{
+    
+    std::stringstream ss(s);
+    if ( s.compare(0, 6, "philox") == 0 )
+    {
+        std::string tag;
+        unsigned int new_seed;
+        std::uint64_t key, stream, counter;
+        size_t position;
+        ss >> tag >> new_seed >> key >> stream >> counter >> position;
+        
+        if ( ss.fail() || position > 2 || (position < 2 && counter == 0) )
+        {
+            throw RbException("Could not restore the state of the random number generator from '" + s + "'.");
+        }
+        
+        seed = new_seed;
+        setStream( key, stream );
+        
+        // recompute the current block
+        if ( position < 2 )
+        {
+            philox_counter = counter - 1;
+            nextPhiloxBlock();
+        }
+        else
+        {
+            philox_counter = counter;
+        }
+        philox_position = position;
+    }
+    else
+    {
+        unsigned int new_seed;
+        boost::rand48 new_rng;
+        ss >> new_seed >> new_rng;
+        
+        if ( ss.fail() )
+        {
+            throw RbException("Could not restore the state of the random number generator from '" + s + "'.");
+        }
+        
+        algorithm = RAND48;
+        seed = new_seed;
+        rng = new_rng;
+        zeroone = boost::uniform_01<boost::rand48>(rng);
+    }
+    
+}
+
+
+/** Use the Philox generator for the given key and stream, starting at the beginning of the stream */
+void RandomNumberGenerator::setStream(std::uint64_t key, std::uint64_t stream)
+{
+    
+    algorithm       = PHILOX;
+    philox_key      = key;
+    philox_stream   = stream;
+    philox_counter  = 0;
+    philox_position = 2;
+    
+}
+
+
 /*!
  * This function generates a uniformly-distributed random variable on the interval [0,1).
- * It is a version of the Marsaglia Multi-Carry.
- *
- * Taken from:
- *   Mathlib : A C Library of Special Functions
- *   Copyright (C) 2000, 2003  The R Development Core Team
  *
- * This random generator has a period of 2^60, which ensures it has the maximum
- * period of 2^32 for unsigned ints (32 bit ints).
+ * In compatibility mode we use boost::rand48.
+ * Otherwise, we take 53 bits from two 32-bit outputs of the Philox generator,
+ * so that every representable multiple of 2^-53 in [0,1) is equally likely.
  *
  * \brief Uniform[0,1) random variable.
  * \return Returns a uniformly-distributed random variable on the interval [0,1).
  * \throws Does not throw an error.
- * \see http://stat.fsu.edu/~geo/diehard.html
  */
 double RandomNumberGenerator::uniform01(void)
 {
 
-	// Returns a pseudo-random number between 0 and 1.
-    return zeroone();
+    if ( algorithm == RAND48 )
+    {
+        // Returns a pseudo-random number between 0 and 1.
+        return zeroone();
+    }
+    
+    if ( philox_position == 2 )
+    {
+        nextPhiloxBlock();
+        philox_position = 0;
+    }
+    
+    std::uint64_t x = ( std::uint64_t( philox_block[2*philox_position] ) << 32 ) | philox_block[2*philox_position+1];
+    ++philox_position;
+    
+    return double( x >> 11 ) * (1.0 / 9007199254740992.0);
 }
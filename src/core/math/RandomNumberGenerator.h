@@ -18,31 +18,64 @@
 #ifndef RandomNumberGenerator_H
 #define RandomNumberGenerator_H
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
 #include <vector>
 #include <boost/random/uniform_01.hpp>
 #include <boost/random/linear_congruential.hpp>
 
 namespace RevBayesCore {
 
+    /**
+     * A generator of uniform(0,1) random variables.
+     *
+     * Two algorithms are available:
+     *   - RAND48: the linear congruential generator boost::rand48. This is the default and
+     *             reproduces the random numbers of earlier versions for the same seed (compatibility mode).
+     *   - PHILOX: the counter-based Philox4x32-10 generator (Salmon et al. 2011, Random123).
+     *             Each random number is a function of a 64-bit key, a 64-bit stream index and a 64-bit counter.
+     *             Thus, independent streams for chains or worker threads are obtained by just choosing
+     *             different stream indices, and the whole state is only a few numbers.
+     *
+     * Generators are cheap to copy and not shared between threads.
+     * Use RandomNumberFactory::setThreadRandomNumberGenerator() to give each thread its own stream.
+     */
     class RandomNumberGenerator {
 
     public:
 
+        enum Algorithm { RAND48, PHILOX };
+
                                             RandomNumberGenerator(void);                            //!< Default constructor using time seed
+                                            RandomNumberGenerator(std::uint64_t key, std::uint64_t stream); //!< Philox generator for the given stream
                                             
         // Regular functions
+        Algorithm                           getAlgorithm(void) const;                               //!< Get the algorithm
         unsigned int                        getSeed(void) const;                                    //!< Get the seed values
+        std::string                         getState(void) const;                                   //!< Get the full internal state (e.g., for checkpointing)
+        void                                setAlgorithm(Algorithm a);                              //!< Change the algorithm and reseed it with the current seed
         void                                setSeed(unsigned int s);                                //!< Set the seeds of the RNG
+        void                                setState(const std::string &s);                         //!< Restore the internal state obtained from getState()
+        void                                setStream(std::uint64_t key, std::uint64_t stream);     //!< Switch to the Philox generator for the given key and stream
         double                              uniform01(void);                                        //!< Get a random [0,1) var
 
     private:
+        void                                nextPhiloxBlock(void);                                  //!< Compute the next four 32-bit random numbers
+
+        Algorithm                           algorithm;
         unsigned int                        seed;
         boost::rand48                       rng;
         boost::uniform_01<boost::rand48>    zeroone;
+        
+        std::uint64_t                       philox_key;
+        std::uint64_t                       philox_stream;
+        std::uint64_t                       philox_counter;                                         //!< The index of the next block
+        std::uint32_t                       philox_block[4];                                        //!< The current block of random numbers
+        size_t                              philox_position;                                        //!< The number of doubles used from the current block (0, 1 or 2)
 
     };
     
 }
 
 #endif
-
@@ -21,6 +21,7 @@
 #include "RbSettings.h"
 
 #include <cassert>
+#include <algorithm>
 #include <cmath>
 #include <complex>
 #include <iostream>
@@ -329,38 +330,141 @@ void RbMath::matrixInverse(const MatrixComplex& a, MatrixComplex& aInv) {
 }
 
 
+/*!
+ * Compute the inverse of a matrix using the LU decomposition (without pivoting).
+ * We decompose a copy of the matrix in place and then solve for all columns of the
+ * identity matrix at once, so that the innermost loops run over contiguous rows.
+ *
+ * \brief Matrix inverse
+ * \param a [in] The square matrix to invert
+ * \param aInv [out] The inverse of a
+ */
 void RbMath::matrixInverse(const MatrixReal& a, MatrixReal& aInv) {
 
     // get dimensions: we assume a square matrix
     size_t n = a.getNumberOfRows();
+    if ( n == 0 )
+    {
+        return;
+    }
 
-    // copy original matrix, a, into a working version, aTmp
+    // copy original matrix, a, into a working version, aTmp, which we decompose in place
+    // into the unit lower triangle (strictly below the diagonal) and the upper triangle
     MatrixReal aTmp(a);
+    double* lu = &aTmp[0][0];
+    for (size_t j=0; j<n; j++)
+    {
+        for (size_t k=0; k<j; k++)
+            for (size_t i=k+1; i<j; i++)
+                lu[i*n+j] = lu[i*n+j] - lu[i*n+k] * lu[k*n+j];
 
-    // set up some matrices for work
-    MatrixReal lMat(n, n, 0.0);
-    MatrixReal uMat(n, n, 0.0);
-    MatrixReal identity(n, n, 0.0);
+        for (size_t k=0; k<j; k++)
+            for (size_t i=j; i<n; i++)
+                lu[i*n+j] = lu[i*n+j] - lu[i*n+k] * lu[k*n+j];
+
+        for (size_t m=j+1; m<n; m++)
+            lu[m*n+j] /= lu[j*n+j];
+    }
+
+    // start with the identity matrix
+    aInv = MatrixReal(n, n, 0.0);
+    double* x = &aInv[0][0];
     for (size_t i=0; i<n; i++)
-        identity[i][i] = 1.0;
-    std::vector<double> bVec(n);
+        x[i*n+i] = 1.0;
 
-    // compute the matrix inverse
-    RbMath::computeLandU(aTmp, lMat, uMat);
+    std::vector<double> dotProduct(n);
+
+    // solve Ly = b (forward substitution)
+    for (size_t i=1; i<n; i++)
+    {
+        std::fill(dotProduct.begin(), dotProduct.end(), 0.0);
+        for (size_t j=0; j<i; j++)
+        {
+            const double l_ij = lu[i*n+j];
+            const double* x_j = x + j*n;
+            for (size_t k=0; k<n; k++)
+                dotProduct[k] += l_ij * x_j[k];
+        }
+        double* x_i = x + i*n;
+        for (size_t k=0; k<n; k++)
+            x_i[k] = x_i[k] - dotProduct[k];
+    }
+
+    // solve Ux = y (back substitution)
+    double* x_last = x + (n-1)*n;
     for (size_t k=0; k<n; k++)
+        x_last[k] /= lu[(n-1)*n+(n-1)];
+    size_t i = n-1;
+    while ( i > 0 )
     {
-        for (size_t i=0; i<n; i++)
-            bVec[i] = identity[i][k];
+        --i;
+        std::fill(dotProduct.begin(), dotProduct.end(), 0.0);
+        for (size_t j=i+1; j<n; j++)
+        {
+            const double u_ij = lu[i*n+j];
+            const double* x_j = x + j*n;
+            for (size_t k=0; k<n; k++)
+                dotProduct[k] += u_ij * x_j[k];
+        }
+        double* x_i = x + i*n;
+        const double u_ii = lu[i*n+i];
+        for (size_t k=0; k<n; k++)
+            x_i[k] = (x_i[k] - dotProduct[k]) / u_ii;
+    }
 
-        /* Answer of Ly = b (which is solving for y) is copied into b. */
-        forwardSubstitutionRow(lMat, bVec);
+}
 
-        /* Answer of Ux = y (solving for x and the y was copied into b above)
-           is also copied into b. */
-        backSubstitutionRow(uMat, bVec);
-        for (size_t i=0; i<n; i++)
-            aInv[i][k] = bVec[i];
+
+/*!
+ * Compute the inverse of a lower triangular matrix, e.g., a Cholesky factor.
+ * We solve the unit lower triangular system (L D^-1) Y = I by forward substitution for all
+ * columns at once, where D is the diagonal of L, and then compute X = D^-1 Y.
+ *
+ * \brief Inverse of a lower triangular matrix
+ * \param l [in] The lower triangular matrix
+ * \param lInv [out] The inverse of l (also lower triangular)
+ */
+void RbMath::lowerTriangularInverse(const MatrixReal& l, MatrixReal& lInv) {
+
+    size_t n = l.getNumberOfRows();
+    lInv = MatrixReal(n, n, 0.0);
+    if ( n == 0 )
+    {
+        return;
     }
+
+    const double* a = l.getData();
+    double* x = &lInv[0][0];
+
+    std::vector<double> dotProduct(n);
+    for (size_t i=0; i<n; i++)
+    {
+        // only the first i+1 columns of the rows above can be non-zero
+        std::fill(dotProduct.begin(), dotProduct.begin() + i + 1, 0.0);
+        for (size_t j=0; j<i; j++)
+        {
+            const double l_ij = a[i*n+j] / a[j*n+j];
+            const double* x_j = x + j*n;
+            for (size_t k=0; k<=j; k++)
+                dotProduct[k] += l_ij * x_j[k];
+        }
+
+        // row i of the solution of the unit triangular system
+        double* x_i = x + i*n;
+        for (size_t k=0; k<i; k++)
+            x_i[k] = 0.0 - dotProduct[k];
+        x_i[i] = 1.0 - dotProduct[i];
+    }
+
+    // finally, scale the rows by the diagonal of l
+    for (size_t i=0; i<n; i++)
+    {
+        double* x_i = x + i*n;
+        const double l_ii = a[i*n+i];
+        for (size_t k=0; k<=i; k++)
+            x_i[k] /= l_ii;
+    }
+
 }
 
 
@@ -34,6 +34,7 @@ namespace RevBayesCore {
         int                         findPadeQValue(double tolerance);                                                                                            //!< Find the pq values for controlling the tolerance of the Pade method
         void                        hadamardMult(const MatrixReal& A, const std::vector<double>& B, MatrixReal& O, bool row = true);
         void                        matrixInverse(const MatrixComplex& a, MatrixComplex& aInv);                                         //!< Compute the inverse of a matrix
+        void                        lowerTriangularInverse(const MatrixReal& l, MatrixReal& lInv);                                                             //!< Compute the inverse of a lower triangular matrix
         void                        matrixInverse(const MatrixReal& a, MatrixReal& aInv);                                                                       //!< Compute the inverse of a matrix
         int                         transposeMatrix(const MatrixReal& a, MatrixReal& t);                                                                        //!< Transpose a matrix
 
@@ -1,15 +1,15 @@
 #ifndef AbstractFileMonitor_H
 #define AbstractFileMonitor_H
 
+#include "AsyncFileStream.h"
 #include "Monitor.h"
 
-#include <fstream>
-
 namespace RevBayesCore {
 
     /** @brief Base abstract class for all file monitors
     *
     * File monitors save information to a file about one or several variable DAG node(s).
+    * The output is written by the background writer (see AsyncFileWriter), so flushing the stream after each sample is cheap.
     */
     class AbstractFileMonitor : public Monitor {
         
@@ -39,7 +39,7 @@ namespace RevBayesCore {
         virtual void                        closeStream(void);
     
     protected:
-        std::fstream                        out_stream;  //!< output file stream
+        AsyncFileStream                     out_stream;  //!< output file stream
         
         // parameters
         std::string                         filename;  //!< input name of the output file
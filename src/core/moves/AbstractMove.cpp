@@ -19,7 +19,8 @@ AbstractMove::AbstractMove( double weight, bool tuning ) :
     weight( weight ),
     auto_tuning( tuning ),
     num_tried_current_period( 0 ),
-    num_tried_total( 0 )
+    num_tried_total( 0 ),
+    timings()
 {
     
 }
@@ -40,7 +41,8 @@ AbstractMove::AbstractMove( const std::vector<DagNode*> &nodes, double weight, b
     weight( weight ),
     auto_tuning( tuning ),
     num_tried_current_period( 0 ),
-    num_tried_total( 0 )
+    num_tried_total( 0 ),
+    timings()
 {
     
     for (std::vector<DagNode*>::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
@@ -85,7 +87,8 @@ AbstractMove::AbstractMove( const AbstractMove &move ) : Move( move ),
     weight( move.weight ),
     auto_tuning( move.auto_tuning  ),
     num_tried_current_period( move.num_tried_current_period ),
-    num_tried_total( move.num_tried_total )
+    num_tried_total( move.num_tried_total ),
+    timings( move.timings )
 {
     
     
@@ -163,6 +166,7 @@ AbstractMove& AbstractMove::operator=(const RevBayesCore::AbstractMove &move)
         nodes                       = move.nodes;
         num_tried_current_period    = move.num_tried_current_period;
         num_tried_total             = move.num_tried_total;
+        timings                     = move.timings;
         
         for (size_t i = 0; i < nodes.size(); ++i)
         {
@@ -292,6 +296,17 @@ size_t AbstractMove::getNumberTriedTotal( void ) const
 }
 
 
+/**
+ * Get the time spent in this move while profiling was switched on.
+ *
+ * \return    The timings.
+ */
+const MoveTimings& AbstractMove::getTimings( void ) const
+{
+    return timings;
+}
+
+
 /**
  * Get the number of how often the move has been used.
  *
@@ -376,8 +391,25 @@ void AbstractMove::performMcmcStep( double prHeat, double lHeat, double pHeat )
     ++num_tried_current_period;
     ++num_tried_total;
     
-    // delegate to derived class
-    performMcmcMove(prHeat, lHeat, pHeat);
+    if ( Profiler::isActive() == true )
+    {
+        ++timings.num_steps;
+        size_t num_computations = Profiler::getNumberOfComputations();
+        
+        {
+            Profiler::ScopedTimer timer( timings.total );
+            
+            // delegate to derived class
+            performMcmcMove(prHeat, lHeat, pHeat);
+        }
+        
+        timings.num_computations += Profiler::getNumberOfComputations() - num_computations;
+    }
+    else
+    {
+        // delegate to derived class
+        performMcmcMove(prHeat, lHeat, pHeat);
+    }
     
 }
 
@@ -45,6 +45,7 @@ namespace RevBayesCore {
         virtual size_t                                          getNumberAcceptedTotal(void) const;                                 //!< Get update weight of InferenceMove
         size_t                                                  getNumberTriedCurrentPeriod(void) const;                            //!< Get the number of tries for this move since the last reset
         size_t                                                  getNumberTriedTotal(void) const;                                    //!< Get the number of tries for this move since the last reset
+        const MoveTimings&                                      getTimings(void) const;                                             //!< Get the time spent in this move while profiling
         double                                                  getUpdateWeight(void) const;                                        //!< Get update weight of move
         bool                                                    isActive(unsigned long gen) const;                                  //!< Is the move active at the generation 'gen'?
         void                                                    performMcmcStep(double prHeat, double lHeat, double pHeat);                        //!< Perform the move.
@@ -80,6 +81,7 @@ namespace RevBayesCore {
         bool                                                    auto_tuning;
         size_t                                                  num_tried_current_period;                                            //!< Number of times tried
         size_t                                                  num_tried_total;                                                     //!< Number of times tried
+        MoveTimings                                             timings;                                                             //!< Time spent in this move while profiling
 
     };
     
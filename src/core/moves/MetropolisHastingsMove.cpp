@@ -1,5 +1,6 @@
 #include "DagNode.h"
 #include "MetropolisHastingsMove.h"
+#include "Profiler.h"
 #include "Proposal.h"
 #include "RandomNumberFactory.h"
 #include "RandomNumberGenerator.h"
@@ -268,64 +269,73 @@ void MetropolisHastingsMove::performMcmcMove( double prHeat, double lHeat, doubl
     
     // first we touch all the nodes
     // that will set the flags for recomputation
-    for (size_t i = 0; i < touched_nodes.size(); ++i)
     {
+        Profiler::ScopedTimer timer( timings.touch );
         
-        // get the pointer to the current node
-        DagNode* the_node = touched_nodes[i];
-        
-//        // should this node be touched?
-//        std::vector<DagNode*>::iterator it = std::find( nodes_left_untouched.begin(), nodes_left_untouched.end(), the_node );
-//        bool touch_node = (it == nodes_left_untouched.end());
-        
-        // flag for recomputation
-//        if (touch_node) {
-        the_node->touch();
-//        }
+        for (size_t i = 0; i < touched_nodes.size(); ++i)
+        {
+            
+            // get the pointer to the current node
+            DagNode* the_node = touched_nodes[i];
+            
+//            // should this node be touched?
+//            std::vector<DagNode*>::iterator it = std::find( nodes_left_untouched.begin(), nodes_left_untouched.end(), the_node );
+//            bool touch_node = (it == nodes_left_untouched.end());
+            
+            // flag for recomputation
+//            if (touch_node) {
+            the_node->touch();
+//            }
+        }
     }
     
     double ln_prior_ratio = 0.0;
     double ln_likelihood_ratio = 0.0;
 
     
-    // compute the probability of the current value for each node
-    for (size_t i = 0; i < touched_nodes.size(); ++i)
     {
-        // get the pointer to the current node
-        DagNode* the_node = touched_nodes[i];
+        Profiler::ScopedTimer timer( timings.ln_probability );
         
-        if ( RbMath::isAComputableNumber(ln_prior_ratio) && RbMath::isAComputableNumber(ln_likelihood_ratio) && RbMath::isAComputableNumber(ln_hastings_ratio) )
+        // compute the probability of the current value for each node
+        for (size_t i = 0; i < touched_nodes.size(); ++i)
         {
-            if ( the_node->isClamped() )
-            {
-                ln_likelihood_ratio += the_node->getLnProbabilityRatio();
-            }
-            else
+            // get the pointer to the current node
+            DagNode* the_node = touched_nodes[i];
+        
+            if ( RbMath::isAComputableNumber(ln_prior_ratio) && RbMath::isAComputableNumber(ln_likelihood_ratio) && RbMath::isAComputableNumber(ln_hastings_ratio) )
             {
-                ln_prior_ratio += the_node->getLnProbabilityRatio();
-            }
+                if ( the_node->isClamped() )
+                {
+                    ln_likelihood_ratio += the_node->getLnProbabilityRatio();
+                }
+                else
+                {
+                    ln_prior_ratio += the_node->getLnProbabilityRatio();
+                }
             
-        }
+            }
         
-    }
+        }
     
-    // then we recompute the probability for all the affected nodes
-    for (RbOrderedSet<DagNode*>::const_iterator it = affected_nodes.begin(); it != affected_nodes.end(); ++it)
-    {
-        DagNode *the_node = *it;
-
-        if ( RbMath::isAComputableNumber(ln_prior_ratio) && RbMath::isAComputableNumber(ln_likelihood_ratio) && RbMath::isAComputableNumber(ln_hastings_ratio) )
+        // then we recompute the probability for all the affected nodes
+        for (RbOrderedSet<DagNode*>::const_iterator it = affected_nodes.begin(); it != affected_nodes.end(); ++it)
         {
-            if ( the_node->isClamped() )
-            {
-                ln_likelihood_ratio += the_node->getLnProbabilityRatio();
-            }
-            else
+            DagNode *the_node = *it;
+
+            if ( RbMath::isAComputableNumber(ln_prior_ratio) && RbMath::isAComputableNumber(ln_likelihood_ratio) && RbMath::isAComputableNumber(ln_hastings_ratio) )
             {
-                ln_prior_ratio += the_node->getLnProbabilityRatio();
+                if ( the_node->isClamped() )
+                {
+                    ln_likelihood_ratio += the_node->getLnProbabilityRatio();
+                }
+                else
+                {
+                    ln_prior_ratio += the_node->getLnProbabilityRatio();
+                }
             }
-        }
 
+        }
+    
     }
     
     // exponentiate with the chain heat
@@ -341,11 +351,15 @@ void MetropolisHastingsMove::performMcmcMove( double prHeat, double lHeat, doubl
         proposal->undoProposal();
             
         // call restore for each node
-        for (size_t i = 0; i < touched_nodes.size(); ++i)
         {
-            // get the pointer to the current node
-            DagNode* the_node = touched_nodes[i];
-            the_node->restore();
+            Profiler::ScopedTimer timer( timings.keep_restore );
+            
+            for (size_t i = 0; i < touched_nodes.size(); ++i)
+            {
+                // get the pointer to the current node
+                DagNode* the_node = touched_nodes[i];
+                the_node->restore();
+            }
         }
 	}
     else
@@ -362,11 +376,15 @@ void MetropolisHastingsMove::performMcmcMove( double prHeat, double lHeat, doubl
             num_accepted_current_period++;
         
             // call accept for each node
-            for (size_t i = 0; i < touched_nodes.size(); ++i)
             {
-                // get the pointer to the current node
-                DagNode* the_node = touched_nodes[i];
-                the_node->keep();
+                Profiler::ScopedTimer timer( timings.keep_restore );
+                
+                for (size_t i = 0; i < touched_nodes.size(); ++i)
+                {
+                    // get the pointer to the current node
+                    DagNode* the_node = touched_nodes[i];
+                    the_node->keep();
+                }
             }
         
             proposal->cleanProposal();
@@ -378,11 +396,15 @@ void MetropolisHastingsMove::performMcmcMove( double prHeat, double lHeat, doubl
             proposal->undoProposal();
         
             // call restore for each node
-            for (size_t i = 0; i < touched_nodes.size(); ++i)
             {
-                // get the pointer to the current node
-                DagNode* the_node = touched_nodes[i];
-                the_node->restore();
+                Profiler::ScopedTimer timer( timings.keep_restore );
+                
+                for (size_t i = 0; i < touched_nodes.size(); ++i)
+                {
+                    // get the pointer to the current node
+                    DagNode* the_node = touched_nodes[i];
+                    the_node->restore();
+                }
             }
         }
         else
@@ -397,11 +419,15 @@ void MetropolisHastingsMove::performMcmcMove( double prHeat, double lHeat, doubl
                 num_accepted_current_period++;
             
                 // call accept for each node
-                for (size_t i = 0; i < touched_nodes.size(); ++i)
                 {
-                    // get the pointer to the current node
-                    DagNode* the_node = touched_nodes[i];
-                    the_node->keep();
+                    Profiler::ScopedTimer timer( timings.keep_restore );
+                    
+                    for (size_t i = 0; i < touched_nodes.size(); ++i)
+                    {
+                        // get the pointer to the current node
+                        DagNode* the_node = touched_nodes[i];
+                        the_node->keep();
+                    }
                 }
             
                 proposal->cleanProposal();
@@ -413,11 +439,15 @@ void MetropolisHastingsMove::performMcmcMove( double prHeat, double lHeat, doubl
                 proposal->undoProposal();
             
                 // call restore for each node
-                for (size_t i = 0; i < touched_nodes.size(); ++i)
                 {
-                    // get the pointer to the current node
-                    DagNode* the_node = touched_nodes[i];
-                    the_node->restore();
+                    Profiler::ScopedTimer timer( timings.keep_restore );
+                    
+                    for (size_t i = 0; i < touched_nodes.size(); ++i)
+                    {
+                        // get the pointer to the current node
+                        DagNode* the_node = touched_nodes[i];
+                        the_node->restore();
+                    }
                 }
                 
             }
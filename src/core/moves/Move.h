@@ -2,6 +2,7 @@
 #define Move_H
 
 #include "Cloneable.h"
+#include "Profiler.h"
 #include "RbOrderedSet.h"
 
 #include <ostream>
@@ -41,6 +42,7 @@ namespace RevBayesCore {
         virtual size_t                                          getNumberAcceptedTotal(void) const = 0;                     //!< Get update weight of InferenceMove
         virtual size_t                                          getNumberTriedCurrentPeriod(void) const = 0;                //!< Get the number of tries for this move since the last reset
         virtual size_t                                          getNumberTriedTotal(void) const = 0;                        //!< Get the number of tries for this move since the last reset
+        virtual const MoveTimings&                              getTimings(void) const = 0;                                 //!< Get the time spent in this move while profiling
         virtual double                                          getUpdateWeight(void) const = 0;                            //!< Get update weight of InferenceMove
         virtual bool                                            isActive(unsigned long gen) const = 0;                      //!< Is this move active?
 //        virtual void                                            perform(double lHeat, double pHeat) = 0;                  //!< Perform the move.
@@ -3,6 +3,7 @@
 #include "RandomNumberGenerator.h"
 #include "RbConstants.h"
 #include "RbException.h"
+#include "RegraftLikelihoodEvaluator.h"
 #include "TypedDagNode.h"
 
 #include <cmath>
@@ -15,8 +16,9 @@ using namespace RevBayesCore;
  *
  * Here we simply allocate and initialize the Proposal object.
  */
-GibbsPruneAndRegraftProposal::GibbsPruneAndRegraftProposal( StochasticNode<Tree> *n ) : Proposal(),
-    variable( n )
+GibbsPruneAndRegraftProposal::GibbsPruneAndRegraftProposal( StochasticNode<Tree> *n, bool c ) : Proposal(),
+    variable( n ),
+    use_cached_likelihoods( c )
 {
     // tell the base class to add the node
     addNode( variable );
@@ -48,6 +50,40 @@ GibbsPruneAndRegraftProposal* GibbsPruneAndRegraftProposal::clone( void ) const
 
 
 
+/**
+ * Compute the summed ln-probabilities of the affected nodes for all re-attachment points
+ * from the cached partial likelihoods of the affected nodes.
+ *
+ * \return False if one of the affected nodes cannot do this, so that we need to regraft and recompute instead.
+ */
+bool GibbsPruneAndRegraftProposal::computeRegraftLnProbabilities(const RbOrderedSet<DagNode*> &affected, const TopologyNode &pruned, const std::vector<TopologyNode*> &targets, std::vector<double> &ln_probs)
+{
+    
+    ln_probs = std::vector<double>(targets.size(), 0.0);
+    std::vector<double> node_ln_probs;
+    for (RbOrderedSet<DagNode*>::const_iterator it = affected.begin(); it != affected.end(); ++it)
+    {
+        if ( (*it)->isStochastic() == false )
+        {
+            return false;
+        }
+        
+        RegraftLikelihoodEvaluator *evaluator = dynamic_cast<RegraftLikelihoodEvaluator*>( &(*it)->getDistribution() );
+        if ( evaluator == NULL || evaluator->computeRegraftLnProbabilities( variable, pruned, targets, node_ln_probs ) == false )
+        {
+            return false;
+        }
+        
+        for (size_t i = 0; i < targets.size(); ++i)
+        {
+            ln_probs[i] += node_ln_probs[i];
+        }
+    }
+    
+    return true;
+}
+
+
 void GibbsPruneAndRegraftProposal::findNewBrothers(std::vector<TopologyNode *> &b, TopologyNode &p, TopologyNode *n)
 {
     // security check that I'm not a tip
@@ -151,11 +187,11 @@ double GibbsPruneAndRegraftProposal::doProposal( void )
     
     TopologyNode* parent        = &node->getParent();
     TopologyNode& grandparent   = parent->getParent();
-    TopologyNode& brother       = parent->getChild( 0 );
+    TopologyNode* brother       = &parent->getChild( 0 );
     // check if we got the correct child
-    if ( &brother == node )
+    if ( brother == node )
     {
-        brother = parent->getChild( 1 );
+        brother = &parent->getChild( 1 );
     }
     
     // collect the possible reattachement points
@@ -169,6 +205,11 @@ double GibbsPruneAndRegraftProposal::doProposal( void )
         return RbConstants::Double::neginf;
     }
     
+    // if possible, we compute the likelihoods of all re-attachment points at once from the cached partial likelihoods
+    // (in parallel); then we only need to compute the tree probability for each re-attachment point
+    std::vector<double> regraft_ln_probs;
+    bool use_regraft_ln_probs = ( use_cached_likelihoods == true && computeRegraftLnProbabilities(affected, *node, new_brothers, regraft_ln_probs) == true );
+    
     std::vector<double> weights = std::vector<double>(new_brothers.size(), 0.0);
     double sumOfWeights = 0.0;
     for (size_t i = 0; i<new_brothers.size(); ++i)
@@ -177,7 +218,7 @@ double GibbsPruneAndRegraftProposal::doProposal( void )
         TopologyNode* newBro = new_brothers[i];
         
         // do the proposal
-        TopologyNode *newGrandparent = pruneAndRegraft(&brother, newBro, parent, grandparent);
+        TopologyNode *newGrandparent = pruneAndRegraft(brother, newBro, parent, grandparent);
         
         // flag for likelihood recomputation
         variable->touch();
@@ -185,15 +226,22 @@ double GibbsPruneAndRegraftProposal::doProposal( void )
         // compute the likelihood of the new value
         double priorRatio = variable->getLnProbability();
         double likelihoodRatio = 0.0;
-        for (RbOrderedSet<DagNode*>::const_iterator it = affected.begin(); it != affected.end(); ++it)
+        if ( use_regraft_ln_probs == true )
+        {
+            likelihoodRatio = regraft_ln_probs[i];
+        }
+        else
         {
-            likelihoodRatio += (*it)->getLnProbability();
+            for (RbOrderedSet<DagNode*>::const_iterator it = affected.begin(); it != affected.end(); ++it)
+            {
+                likelihoodRatio += (*it)->getLnProbability();
+            }
         }
         weights[i] = exp(priorRatio + likelihoodRatio + offset);
         sumOfWeights += weights[i];
         
         // undo proposal
-        pruneAndRegraft(newBro, &brother, parent, *newGrandparent);
+        pruneAndRegraft(newBro, brother, parent, *newGrandparent);
         
         // restore the previous likelihoods;
         variable->restore();
@@ -222,10 +270,10 @@ double GibbsPruneAndRegraftProposal::doProposal( void )
     TopologyNode* newBro = new_brothers[index];
     
     // now we store all necessary values
-    storedBrother       = &brother;
+    storedBrother       = brother;
     storedNewBrother    = newBro;
     
-    pruneAndRegraft(&brother, newBro, parent, grandparent);
+    pruneAndRegraft(brother, newBro, parent, grandparent);
     
     double forward = weights[index];
     
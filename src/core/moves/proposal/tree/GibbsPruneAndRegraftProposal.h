@@ -2,8 +2,10 @@
 #define GibbsPruneAndRegraftProposal_H
 
 #include <string>
+#include <vector>
 
 #include "Proposal.h"
+#include "RbOrderedSet.h"
 #include "StochasticNode.h"
 #include "Tree.h"
 
@@ -17,6 +19,10 @@ namespace RevBayesCore {
      * Then, we prune this node and try to attach it at all possible re-attachment points elsewhere in the tree at this node age.
      * Finally, we pick the re-attachment point according to the tree probability.
      *
+     * If the likelihoods of all re-attachment points can be computed from cached partial likelihoods
+     * (see RegraftLikelihoodEvaluator), then we use these instead of regrafting the subtree and recomputing
+     * the likelihood of each re-attachment point. This can be switched off for the comparison with the regular computation.
+     *
      *
      * @copyright Copyright 2009-
      * @author The RevBayes Development Core Team (Sebastian Hoehna)
@@ -26,7 +32,7 @@ namespace RevBayesCore {
     class GibbsPruneAndRegraftProposal : public Proposal {
         
     public:
-        GibbsPruneAndRegraftProposal( StochasticNode<Tree> *n);                                             //!<  constructor
+        GibbsPruneAndRegraftProposal( StochasticNode<Tree> *n, bool c = true);                              //!<  constructor
         
         // Basic utility functions
         void                                    cleanProposal(void);                                        //!< Clean up proposal
@@ -47,11 +53,13 @@ namespace RevBayesCore {
         
     private:
         // private helper methods
+        bool                                    computeRegraftLnProbabilities(const RbOrderedSet<DagNode*> &affected, const TopologyNode &pruned, const std::vector<TopologyNode*> &targets, std::vector<double> &ln_probs);
         void                                    findNewBrothers(std::vector<TopologyNode*> &b, TopologyNode &p, TopologyNode *n);
         TopologyNode*                           pruneAndRegraft(TopologyNode *brother, TopologyNode *newBrother, TopologyNode *parent, TopologyNode &grandparent);
         
         // parameters
         StochasticNode<Tree>*                   variable;                                                   //!< The variable the Proposal is working on
+        bool                                    use_cached_likelihoods;                                     //!< Compute the likelihoods of the re-attachment points from cached partial likelihoods if possible
         
         // stored objects to undo proposal
         bool                                    failed;
@@ -0,0 +1,346 @@
+#include "AsyncFileWriter.h"
+#include "RbConstants.h"
+#include "RbSettings.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+using namespace RevBayesCore;
+
+
+namespace {
+
+    // we always write a buffer once it is this large, so that memory stays bounded even if no flush rule applies
+    const size_t max_buffer_size = 16*1024*1024;
+
+}
+
+
+/**
+ * Get the writer. It is created (and its thread started) when the first file is opened.
+ * We never delete it, because monitors owned by other static objects may still close their files at exit;
+ * instead we write everything and stop the thread from an exit handler.
+ */
+AsyncFileWriter& AsyncFileWriter::globalInstance( void )
+{
+
+    static AsyncFileWriter* the_writer = new AsyncFileWriter();
+    return *the_writer;
+}
+
+
+AsyncFileWriter::AsyncFileWriter( void ) :
+    files(),
+    next_id( 0 ),
+    observers(),
+    next_observer_id( 0 ),
+    flush_bytes( 0 ),
+    flush_interval( 0.0 ),
+    stopping( false )
+{
+
+    writer = std::thread( &AsyncFileWriter::writerLoop, this );
+    std::atexit( &AsyncFileWriter::shutdown );
+
+}
+
+
+/**
+ * Subscribe to the file with the given name, which must currently be open in this process.
+ * The observer is first called once with all data of the file so far (both the data on disk and in the buffer)
+ * and afterwards with every record handed over for this file. Thus, the observer sees every record exactly once.
+ *
+ * \return The id of the observer, or RbConstants::Size_t::max if the file is not open.
+ */
+size_t AsyncFileWriter::addObserver(const std::string &fn, const Observer &o)
+{
+
+    std::unique_lock<std::mutex> lock( mutex );
+
+    std::map<size_t, File>::iterator it = files.begin();
+    while ( it != files.end() && it->second.name != fn )
+    {
+        ++it;
+    }
+    if ( it == files.end() )
+    {
+        return RbConstants::Size_t::max;
+    }
+
+    // wait until the data on disk is complete
+    File &f = it->second;
+    while ( f.writing == true )
+    {
+        file_condition.wait( lock );
+    }
+
+    std::stringstream content;
+    std::ifstream in( fn.c_str(), std::ios::in | std::ios::binary );
+    if ( in.is_open() == true )
+    {
+        content << in.rdbuf();
+    }
+    content << f.buffer;
+    o( content.str() );
+
+    size_t id = next_observer_id++;
+    observers.insert( std::pair<size_t, std::pair<std::string, Observer> >( id, std::pair<std::string, Observer>( fn, o ) ) );
+
+    return id;
+}
+
+
+/**
+ * Close the file for one of its users. The file itself is only written and closed when its last user closes it.
+ */
+void AsyncFileWriter::closeFile(size_t id)
+{
+
+    std::unique_lock<std::mutex> lock( mutex );
+
+    std::map<size_t, File>::iterator it = files.find( id );
+    if ( it != files.end() && --it->second.users == 0 )
+    {
+        writeFile( it->second, lock );
+        std::fclose( it->second.handle );
+        files.erase( it );
+    }
+
+}
+
+
+void AsyncFileWriter::flush(size_t id)
+{
+
+    std::unique_lock<std::mutex> lock( mutex );
+
+    std::map<size_t, File>::iterator it = files.find( id );
+    if ( it != files.end() )
+    {
+        writeFile( it->second, lock );
+    }
+
+}
+
+
+void AsyncFileWriter::flushAll( void )
+{
+
+    std::unique_lock<std::mutex> lock( mutex );
+
+    for (std::map<size_t, File>::iterator it = files.begin(); it != files.end(); ++it)
+    {
+        writeFile( it->second, lock );
+    }
+
+}
+
+
+bool AsyncFileWriter::needsFlush(const File &f) const
+{
+
+    if ( f.buffer.empty() == true )
+    {
+        return false;
+    }
+
+    if ( f.buffer.size() >= max_buffer_size || ( flush_bytes > 0 && f.buffer.size() >= flush_bytes ) )
+    {
+        return true;
+    }
+
+    return flush_interval > 0.0 && std::chrono::duration<double>( std::chrono::steady_clock::now() - f.last_flush ).count() >= flush_interval;
+}
+
+
+/**
+ * Get the size of the file, i.e., the position at which the next record handed over will be written.
+ */
+size_t AsyncFileWriter::getFileSize(size_t id)
+{
+
+    std::unique_lock<std::mutex> lock( mutex );
+
+    std::map<size_t, File>::const_iterator it = files.find( id );
+    if ( it == files.end() )
+    {
+        return 0;
+    }
+
+    return it->second.size;
+}
+
+
+/**
+ * Open the file for writing, either appending to it or truncating it.
+ * If the file is already open in this process, then we share it instead: the new user gets the same id,
+ * the file is not truncated, and all records of all users are appended at the end of the file in the order in which they are handed over.
+ */
+size_t AsyncFileWriter::openFile(const std::string &fn, bool append)
+{
+
+    std::unique_lock<std::mutex> lock( mutex );
+
+    for (std::map<size_t, File>::iterator it = files.begin(); it != files.end(); ++it)
+    {
+        if ( it->second.name == fn )
+        {
+            ++it->second.users;
+            return it->first;
+        }
+    }
+
+    std::FILE* handle = std::fopen( fn.c_str(), append ? "ab" : "wb" );
+    if ( handle == NULL )
+    {
+        return RbConstants::Size_t::max;
+    }
+
+    // in append mode we continue at the end of the existing file
+    size_t size = 0;
+    if ( append == true && std::fseek( handle, 0, SEEK_END ) == 0 )
+    {
+        long end = std::ftell( handle );
+        size = ( end > 0 ? size_t( end ) : 0 );
+    }
+
+    size_t id = next_id++;
+    files.insert( std::pair<size_t, File>( id, File(handle, fn, size) ) );
+
+    return id;
+}
+
+
+void AsyncFileWriter::removeObserver(size_t id)
+{
+
+    std::unique_lock<std::mutex> lock( mutex );
+
+    observers.erase( id );
+
+}
+
+
+/**
+ * Write all files and stop the background thread.
+ * Files that are closed afterwards (e.g. by static objects destroyed at exit) are written by the closing thread.
+ */
+void AsyncFileWriter::shutdown( void )
+{
+
+    AsyncFileWriter &w = globalInstance();
+
+    {
+        std::unique_lock<std::mutex> lock( w.mutex );
+        w.stopping = true;
+    }
+    w.work_condition.notify_one();
+    w.writer.join();
+
+    w.flushAll();
+
+}
+
+
+void AsyncFileWriter::write(size_t id, std::string &data)
+{
+
+    size_t bytes    = RbSettings::userSettings().getMonitorFlushBytes();
+    double interval = RbSettings::userSettings().getMonitorFlushInterval();
+
+    std::unique_lock<std::mutex> lock( mutex );
+
+    flush_bytes    = bytes;
+    flush_interval = interval;
+
+    std::map<size_t, File>::iterator it = files.find( id );
+    if ( it == files.end() )
+    {
+        data.clear();
+        return;
+    }
+
+    File &f = it->second;
+    for (std::map<size_t, std::pair<std::string, Observer> >::const_iterator o = observers.begin(); o != observers.end(); ++o)
+    {
+        if ( o->second.first == f.name )
+        {
+            o->second.second( data );
+        }
+    }
+    f.buffer.append( data );
+    f.size += data.size();
+    data.clear();
+
+    if ( f.buffer.size() >= max_buffer_size || ( stopping == true && needsFlush( f ) == true ) )
+    {
+        // the writer cannot keep up (or is not running anymore), so we write ourselves
+        writeFile( f, lock );
+    }
+    else if ( needsFlush( f ) == true )
+    {
+        work_condition.notify_one();
+    }
+
+}
+
+
+void AsyncFileWriter::writeFile(File &f, std::unique_lock<std::mutex> &lock)
+{
+
+    // only one thread may write to a file at a time, otherwise we could reorder the data
+    while ( f.writing == true )
+    {
+        file_condition.wait( lock );
+    }
+
+    if ( f.buffer.empty() == false )
+    {
+        std::string data;
+        data.swap( f.buffer );
+        f.writing = true;
+        std::FILE* handle = f.handle;
+
+        lock.unlock();
+        std::fwrite( data.data(), 1, data.size(), handle );
+        std::fflush( handle );
+        lock.lock();
+
+        f.writing = false;
+
+        // reuse the memory of the buffer
+        if ( f.buffer.empty() == true )
+        {
+            data.clear();
+            f.buffer.swap( data );
+        }
+
+        file_condition.notify_all();
+    }
+
+    f.last_flush = std::chrono::steady_clock::now();
+
+}
+
+
+void AsyncFileWriter::writerLoop( void )
+{
+
+    std::unique_lock<std::mutex> lock( mutex );
+
+    while ( stopping == false )
+    {
+        // we wake up regularly to apply the time based flush rule
+        work_condition.wait_for( lock, std::chrono::milliseconds(500) );
+
+        for (std::map<size_t, File>::iterator it = files.begin(); it != files.end() && stopping == false; ++it)
+        {
+            if ( it->second.writing == false && needsFlush( it->second ) == true )
+            {
+                writeFile( it->second, lock );
+            }
+        }
+    }
+
+}
@@ -0,0 +1,97 @@
+#ifndef AsyncFileWriter_H
+#define AsyncFileWriter_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace RevBayesCore {
+
+
+    /**
+     * @brief Per-process background writer for output files.
+     *
+     * Output streams (e.g., those of the file monitors) hand complete records to the writer,
+     * which appends them to an in-memory buffer of the file. A background thread writes the buffers
+     * to disk in large chunks according to the flush policy given by the user settings:
+     * a buffer is written once it holds 'monitorFlushBytes' bytes or when it was last written
+     * more than 'monitorFlushInterval' seconds ago (0 disables either rule).
+     * With both rules disabled, the data is only written when a file is flushed explicitly
+     * (e.g. at every checkpoint) or closed, or when its buffer exceeds a hard limit.
+     *
+     * Only one thread writes to a given file at a time and records are written in the order in which they were handed over.
+     * Opening a file that is already open (e.g. the monitors of all chains of an MC^3 analysis share one output file)
+     * returns the same file, so that all records are appended at its end. The file is closed when the last user closes it.
+     * All buffers are written when a file is closed, when flushAll() is called, and when the process exits normally.
+     *
+     * Observers (e.g. the convergence stopping rules) can subscribe to a file by its name and then receive
+     * the data of the file as it is handed over, so that they do not need to read the file back from disk.
+     * Observers are called while the writer is locked and must therefore not use the writer themselves.
+     *
+     */
+    class AsyncFileWriter {
+
+    public:
+        typedef std::function<void (const std::string&)>    Observer;
+
+        static AsyncFileWriter&                 globalInstance(void);                                           //!< Return a reference to the singleton writer
+
+        size_t                                  addObserver(const std::string &fn, const Observer &o);          //!< Subscribe to an open file and return the id of the observer (or RbConstants::Size_t::max)
+        void                                    closeFile(size_t id);                                           //!< Close the file for one user (the last one writes all remaining data and closes it)
+        void                                    flush(size_t id);                                               //!< Write all data of this file to disk now
+        void                                    flushAll(void);                                                 //!< Write all data of all files to disk now
+        size_t                                  getFileSize(size_t id);                                         //!< The size of the file including the data not yet written
+        size_t                                  openFile(const std::string &fn, bool append);                   //!< Open a file (or share it if it is already open) and return its id (or RbConstants::Size_t::max)
+        void                                    removeObserver(size_t id);                                      //!< Unsubscribe the observer
+        void                                    write(size_t id, std::string &data);                            //!< Append the data to the buffer of the file (the string is cleared)
+
+    private:
+
+        /*
+         * The state of one open file
+         */
+        struct File {
+
+            File(std::FILE* h, const std::string &n, size_t s) : handle( h ), name( n ), buffer(), size( s ), users( 1 ), writing( false ), last_flush( std::chrono::steady_clock::now() ) {}
+
+            std::FILE*                              handle;
+            std::string                             name;                                                       //!< The name with which the file was opened
+            std::string                             buffer;                                                     //!< Data not yet written
+            size_t                                  size;                                                       //!< The size of the file on disk plus the size of the buffer
+            size_t                                  users;                                                      //!< The number of streams that opened this file
+            bool                                    writing;                                                    //!< Is some thread currently writing to this file?
+            std::chrono::steady_clock::time_point   last_flush;
+        };
+
+                                                AsyncFileWriter(void);                                          //!< Default constructor starts the background thread
+                                                AsyncFileWriter(const AsyncFileWriter&);                        //!< Prevent copy
+        AsyncFileWriter&                        operator=(const AsyncFileWriter&);                              //!< Prevent assignment
+
+        bool                                    needsFlush(const File &f) const;                                //!< Does the flush policy ask to write this file?
+        static void                             shutdown(void);                                                 //!< Write all files and stop the background thread (at exit)
+        void                                    writeFile(File &f, std::unique_lock<std::mutex> &lock);         //!< Write the buffer of the file (the lock is released while writing)
+        void                                    writerLoop(void);                                               //!< The main loop of the background thread
+
+        std::map<size_t, File>                  files;
+        size_t                                  next_id;
+        std::map<size_t, std::pair<std::string, Observer> > observers;                                          //!< The observers with the name of the file they subscribed to
+        size_t                                  next_observer_id;
+        size_t                                  flush_bytes;                                                    //!< The flush policy (copied from the user settings)
+        double                                  flush_interval;
+        std::mutex                              mutex;
+        std::condition_variable                 work_condition;                                                 //!< Wakes up the background thread
+        std::condition_variable                 file_condition;                                                 //!< Signals that a file is not written anymore
+        std::thread                             writer;
+        bool                                    stopping;
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,108 @@
+#include "JobFarm.h"
+#include "RandomNumberFactory.h"
+#include "ThreadPool.h"
+
+using namespace RevBayesCore;
+
+
+JobFarm::JobFarm( void ) :
+    num_jobs( 0 ),
+    streams()
+{
+
+}
+
+
+JobFarm::JobFarm( size_t n ) :
+    num_jobs( n ),
+    streams()
+{
+
+}
+
+
+JobFarm::JobFarm( const JobFarm &f ) :
+    num_jobs( f.num_jobs ),
+    streams( f.streams )
+{
+
+}
+
+
+JobFarm& JobFarm::operator=( const JobFarm &f )
+{
+
+    if ( this != &f )
+    {
+        num_jobs = f.num_jobs;
+        streams  = f.streams;
+    }
+
+    return *this;
+}
+
+
+size_t JobFarm::getNumberOfJobs( void ) const
+{
+
+    return num_jobs;
+}
+
+
+size_t JobFarm::getNumberOfWorkers( void ) const
+{
+
+    size_t n = ThreadPool::globalInstance().getNumberOfThreads();
+
+    return ( n < num_jobs ? n : num_jobs );
+}
+
+
+void JobFarm::run( const std::function<void (size_t, size_t)> &f )
+{
+
+    size_t num_workers = getNumberOfWorkers();
+
+    // a single worker runs the jobs in order on the global random number generator, as a plain loop would
+    if ( num_workers <= 1 && streams.empty() == true )
+    {
+        for (size_t i = 0; i < num_jobs; ++i)
+        {
+            f(i, 0);
+        }
+        return;
+    }
+
+    if ( streams.empty() == true )
+    {
+        // the key of the streams is drawn from the global random number generator, so the jobs are reproducible for a given seed
+        streams.resize( num_jobs );
+        RandomNumberFactory::randomNumberFactoryInstance().createIndependentStreams( streams );
+    }
+
+    ThreadPool::globalInstance().runIndependentJobs( num_jobs, num_workers, [&](size_t i, size_t w)
+    {
+        RandomNumberFactory &factory = RandomNumberFactory::randomNumberFactoryInstance();
+        RandomNumberGenerator *previous_rng = factory.setThreadRandomNumberGenerator( &streams[i] );
+        try
+        {
+            f(i, w);
+        }
+        catch (...)
+        {
+            factory.setThreadRandomNumberGenerator( previous_rng );
+            throw;
+        }
+        factory.setThreadRandomNumberGenerator( previous_rng );
+    } );
+
+}
+
+
+void JobFarm::runExclusively( const std::function<void (void)> &f )
+{
+
+    std::lock_guard<std::mutex> lock( exclusive_mutex );
+    f();
+
+}
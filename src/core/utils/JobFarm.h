@@ -0,0 +1,56 @@
+#ifndef JobFarm_H
+#define JobFarm_H
+
+#include "RandomNumberGenerator.h"
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace RevBayesCore {
+
+
+    /**
+     * @brief Runs the independent jobs of an analysis (replicates, simulations, bootstrap samples) on the thread pool.
+     *
+     * The jobs are handed out one by one to at most as many workers as we have threads (see ThreadPool::runIndependentJobs).
+     * If we have several workers, each job draws its random numbers from its own random number stream, which it uses as the global
+     * random number generator while it runs. Hence, the results of a job do not depend on the number of threads or on which worker runs it.
+     * The streams are created by the first parallel run() and kept, so calling run() again continues every job's stream where it stopped.
+     * With a single worker (numThreads=1) we run the jobs one after the other on the global random number generator,
+     * so that seeded scripts give the same results as a plain loop over the jobs.
+     *
+     * The jobs must not share any DAG nodes. The caller therefore creates one copy of the model per worker
+     * (getNumberOfWorkers() tells how many) unless the jobs already have their own models.
+     * Output that is not written to a job specific file should be written within runExclusively(),
+     * so that the output of different jobs does not interleave.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     *
+     */
+    class JobFarm {
+
+    public:
+        JobFarm(void);                                                                                          //!< A farm without jobs
+        JobFarm(size_t n);                                                                                      //!< A farm for n jobs
+        JobFarm(const JobFarm &f);
+        JobFarm&                                operator=(const JobFarm &f);
+
+        size_t                                  getNumberOfJobs(void) const;
+        size_t                                  getNumberOfWorkers(void) const;                                 //!< The number of workers that run() will use
+        void                                    run(const std::function<void (size_t, size_t)> &f);             //!< Call f(i,w) for each job i, where w is the worker running it
+        void                                    runExclusively(const std::function<void (void)> &f);            //!< Call f while no other job is within runExclusively()
+
+    private:
+
+        size_t                                  num_jobs;
+        std::vector<RandomNumberGenerator>      streams;                                                        //!< The random number stream of each job (empty until the first parallel run)
+        std::mutex                              exclusive_mutex;
+
+    };
+
+}
+
+#endif
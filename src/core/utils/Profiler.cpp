@@ -0,0 +1,318 @@
+#include "DagNode.h"
+#include "Move.h"
+#include "Profiler.h"
+#include "RbException.h"
+#include "RbFileManager.h"
+#include "RbSettings.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+
+using namespace RevBayesCore;
+
+
+namespace {
+
+    // the record of the current thread (owned by the profiler)
+    thread_local void* thread_record = NULL;
+
+
+    /*
+     * The human readable name of a class, e.g. "RevBayesCore::NormalDistribution" instead of "N11RevBayesCore18NormalDistributionE".
+     */
+    std::string demangle(const char* name)
+    {
+
+        std::string n = name;
+#if defined(__GNUC__)
+        int status = 0;
+        char* d = abi::__cxa_demangle( name, NULL, NULL, &status );
+        if ( status == 0 && d != NULL )
+        {
+            n = d;
+        }
+        std::free( d );
+#endif
+        const std::string prefix = "RevBayesCore::";
+        for (std::string::size_type pos = n.find( prefix ); pos != std::string::npos; pos = n.find( prefix, pos ))
+        {
+            n.erase( pos, prefix.size() );
+        }
+
+        return n;
+    }
+
+
+    /*
+     * The name of the first variable of a move (as in the operator summary).
+     */
+    std::string parameterName(const Move &m)
+    {
+
+        const std::vector<DagNode*> &nodes = m.getDagNodes();
+
+        return nodes.empty() ? "" : nodes[0]->getName();
+    }
+
+
+    /*
+     * Quote a string for JSON.
+     */
+    std::string quote(const std::string &s)
+    {
+
+        std::string q = "\"";
+        for (size_t i=0; i<s.size(); ++i)
+        {
+            if ( s[i] == '"' || s[i] == '\\' )
+            {
+                q += '\\';
+            }
+            q += s[i];
+        }
+        q += "\"";
+
+        return q;
+    }
+
+}
+
+
+Profiler::~Profiler( void )
+{
+
+    for (size_t i=0; i<records.size(); ++i)
+    {
+        delete records[i];
+    }
+
+}
+
+
+Profiler& Profiler::globalInstance( void )
+{
+
+    static Profiler single_profiler;
+
+    return single_profiler;
+}
+
+
+void Profiler::addComputation(const std::type_info &t, double s)
+{
+
+    ThreadRecord &r = getThreadRecord();
+
+    std::pair<size_t, double> &counter = r.distributions[ std::type_index(t) ];
+    ++counter.first;
+    counter.second += s;
+
+    ++r.num_computations;
+
+}
+
+
+/**
+ * Combine the counters of all threads.
+ * The distributions are sorted by the time spent in them, the slowest first.
+ */
+std::vector<Profiler::DistributionTimings> Profiler::getDistributionTimings( void ) const
+{
+
+    std::map<std::type_index, std::pair<size_t, double> > combined;
+    {
+        std::lock_guard<std::mutex> lock( records_mutex );
+        for (size_t i=0; i<records.size(); ++i)
+        {
+            for (std::map<std::type_index, std::pair<size_t, double> >::const_iterator it=records[i]->distributions.begin(); it!=records[i]->distributions.end(); ++it)
+            {
+                std::pair<size_t, double> &counter = combined[ it->first ];
+                counter.first  += it->second.first;
+                counter.second += it->second.second;
+            }
+        }
+    }
+
+    std::vector<DistributionTimings> timings;
+    for (std::map<std::type_index, std::pair<size_t, double> >::const_iterator it=combined.begin(); it!=combined.end(); ++it)
+    {
+        DistributionTimings t;
+        t.name             = demangle( it->first.name() );
+        t.num_computations = it->second.first;
+        t.seconds          = it->second.second;
+        timings.push_back( t );
+    }
+
+    std::sort( timings.begin(), timings.end(), [](const DistributionTimings &a, const DistributionTimings &b) { return a.seconds > b.seconds; } );
+
+    return timings;
+}
+
+
+size_t Profiler::getNumberOfComputations( void )
+{
+
+    return globalInstance().getThreadRecord().num_computations;
+}
+
+
+Profiler::ThreadRecord& Profiler::getThreadRecord( void )
+{
+
+    if ( thread_record == NULL )
+    {
+        std::lock_guard<std::mutex> lock( records_mutex );
+        records.push_back( new ThreadRecord() );
+        thread_record = records.back();
+    }
+
+    return *static_cast<ThreadRecord*>( thread_record );
+}
+
+
+bool Profiler::isActive( void )
+{
+
+    return RbSettings::userSettings().getProfiling();
+}
+
+
+/**
+ * Print two tables: the time spent in each move, split into its phases, and the time spent computing the probability of each class of distributions.
+ */
+void Profiler::printSummary(std::ostream &o, const RbVector<Move> &moves) const
+{
+
+    std::streamsize previous_precision = o.precision();
+    std::ios_base::fmtflags previous_flags = o.flags();
+
+    o << std::fixed;
+    o << std::setprecision(3);
+
+    o << std::endl;
+    o << "                  Name                  | Param              |  Tried   |  Time [s]  | ms / Try | Touch  | ln Prob |Keep/Res.| Computations" << std::endl;
+    o << "=============================================================================================================================================" << std::endl;
+    for (size_t i=0; i<moves.size(); ++i)
+    {
+        const Move &m = moves[i];
+        const MoveTimings &t = m.getTimings();
+        double ms_per_try = ( t.num_steps > 0 ? 1000.0 * t.total / t.num_steps : 0.0 );
+        double total = ( t.total > 0.0 ? t.total : 1.0 );
+
+        o << std::left << std::setw(40) << m.getMoveName().substr(0, 40) << " ";
+        o << std::setw(20) << parameterName( m ).substr(0, 20) << " ";
+        o << std::right << std::setw(10) << t.num_steps << " ";
+        o << std::setw(12) << t.total << " ";
+        o << std::setw(10) << ms_per_try << " ";
+        o << std::setw(7) << std::setprecision(1) << 100.0 * t.touch / total << "% ";
+        o << std::setw(7) << 100.0 * t.ln_probability / total << "% ";
+        o << std::setw(8) << 100.0 * t.keep_restore / total << "% ";
+        o << std::setw(13) << t.num_computations << std::setprecision(3) << std::endl;
+    }
+
+    o << std::endl;
+    o << "              Distribution                                          | Computations |  Time [s]  | ms / Computation" << std::endl;
+    o << "=============================================================================================================================================" << std::endl;
+    std::vector<DistributionTimings> timings = getDistributionTimings();
+    for (size_t i=0; i<timings.size(); ++i)
+    {
+        const DistributionTimings &t = timings[i];
+        double ms_per_computation = ( t.num_computations > 0 ? 1000.0 * t.seconds / t.num_computations : 0.0 );
+
+        o << std::left << std::setw(68) << t.name.substr(0, 68) << " ";
+        o << std::right << std::setw(14) << t.num_computations << " ";
+        o << std::setw(12) << t.seconds << " ";
+        o << std::setw(12) << ms_per_computation << std::endl;
+    }
+
+    o << std::endl;
+    o.flush();
+
+    o.flags(previous_flags);
+    o.precision(previous_precision);
+
+}
+
+
+double Profiler::secondsSince(clock::time_point t)
+{
+
+    return std::chrono::duration<double>( clock::now() - t ).count();
+}
+
+
+/**
+ * Write the timings of the moves and distributions to a file.
+ * In TSV format there is one row per move and per distribution; the column 'type' tells them apart.
+ * In JSON format the file contains one object with the arrays 'moves' and 'distributions'.
+ */
+void Profiler::writeSummary(const std::string &fn, const std::string &format, const RbVector<Move> &moves) const
+{
+
+    if ( format != "tsv" && format != "json" )
+    {
+        throw RbException( "Unknown format '" + format + "' for the profile. Use either 'tsv' or 'json'." );
+    }
+
+    // create the directory if necessary
+    RbFileManager f = RbFileManager(fn);
+    f.createDirectoryForFile();
+
+    std::ofstream out;
+    out.open( f.getFullFileName().c_str(), std::fstream::out );
+    if ( out.is_open() == false )
+    {
+        throw RbException( "Could not open file \"" + fn + "\" to write the profile." );
+    }
+    out << std::setprecision(9);
+
+    std::vector<DistributionTimings> timings = getDistributionTimings();
+
+    if ( format == "tsv" )
+    {
+        out << "type\tname\tparameter\tcount\tseconds\ttouch\tln_probability\tkeep_restore\tcomputations" << std::endl;
+        for (size_t i=0; i<moves.size(); ++i)
+        {
+            const Move &m = moves[i];
+            const MoveTimings &t = m.getTimings();
+            out << "move\t" << m.getMoveName() << "\t" << parameterName( m ) << "\t" << t.num_steps << "\t" << t.total << "\t";
+            out << t.touch << "\t" << t.ln_probability << "\t" << t.keep_restore << "\t" << t.num_computations << std::endl;
+        }
+        for (size_t i=0; i<timings.size(); ++i)
+        {
+            out << "distribution\t" << timings[i].name << "\t\t" << timings[i].num_computations << "\t" << timings[i].seconds << "\t\t\t\t" << timings[i].num_computations << std::endl;
+        }
+    }
+    else
+    {
+        out << "{" << std::endl;
+        out << "  \"moves\": [";
+        for (size_t i=0; i<moves.size(); ++i)
+        {
+            const Move &m = moves[i];
+            const MoveTimings &t = m.getTimings();
+            out << ( i == 0 ? "" : "," ) << std::endl;
+            out << "    { \"name\": " << quote( m.getMoveName() ) << ", \"parameter\": " << quote( parameterName( m ) ) << ", \"tried\": " << t.num_steps;
+            out << ", \"seconds\": " << t.total << ", \"touch\": " << t.touch << ", \"ln_probability\": " << t.ln_probability;
+            out << ", \"keep_restore\": " << t.keep_restore << ", \"computations\": " << t.num_computations << " }";
+        }
+        out << std::endl << "  ]," << std::endl;
+        out << "  \"distributions\": [";
+        for (size_t i=0; i<timings.size(); ++i)
+        {
+            out << ( i == 0 ? "" : "," ) << std::endl;
+            out << "    { \"name\": " << quote( timings[i].name ) << ", \"computations\": " << timings[i].num_computations << ", \"seconds\": " << timings[i].seconds << " }";
+        }
+        out << std::endl << "  ]" << std::endl;
+        out << "}" << std::endl;
+    }
+
+    out.close();
+
+}
@@ -0,0 +1,140 @@
+#ifndef Profiler_H
+#define Profiler_H
+
+#include "RbVector.h"
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace RevBayesCore {
+
+    class Move;
+
+
+    /**
+     * @brief The time a move spent in the phases of its steps.
+     *
+     * Each move keeps its own timings because a move is only ever performed by one thread at a time.
+     * The phases are only recorded by moves that have them (e.g. the Metropolis-Hastings moves);
+     * all other moves only record their total time.
+     */
+    struct MoveTimings {
+
+        MoveTimings(void) : num_steps( 0 ), num_computations( 0 ), total( 0.0 ), touch( 0.0 ), ln_probability( 0.0 ), keep_restore( 0.0 ) {}
+
+        size_t                                      num_steps;                                                  //!< Number of steps performed while profiling was switched on
+        size_t                                      num_computations;                                           //!< Number of probability computations during these steps
+        double                                      total;                                                      //!< Seconds spent in these steps
+        double                                      touch;                                                      //!< Seconds spent touching the nodes
+        double                                      ln_probability;                                             //!< Seconds spent computing the probability ratios
+        double                                      keep_restore;                                               //!< Seconds spent in keep or restore
+    };
+
+
+    /**
+     * @brief Wall-clock profiler for MCMC moves and probability computations.
+     *
+     * Profiling is switched on and off at runtime with the user setting 'profiling' (see RbSettings).
+     * While it is switched off, the timers only check the setting and do not read the clock.
+     * The profiler uses a monotonic clock and counts, for each class of distribution, how often and for
+     * how long the probability of a stochastic node was (re)computed. Each thread counts into its own record,
+     * so the counters are not shared between threads that compute probabilities at the same time.
+     * The records are only combined for the summary, which should therefore be requested while no analysis is running.
+     *
+     * The times are inclusive, i.e., a computation that triggers the computation of another node is counted for both.
+     *
+     */
+    class Profiler {
+
+    public:
+        typedef std::chrono::steady_clock           clock;
+
+        /*
+         * The combined counters of one class of distributions
+         */
+        struct DistributionTimings {
+
+            std::string                             name;
+            size_t                                  num_computations;
+            double                                  seconds;
+        };
+
+        /**
+         * @brief Adds the time until it goes out of scope to a counter, if profiling is switched on.
+         */
+        class ScopedTimer {
+
+        public:
+            ScopedTimer(double &t) : target( Profiler::isActive() ? &t : NULL ) { if ( target != NULL ) start = clock::now(); }
+            ~ScopedTimer(void) { if ( target != NULL ) *target += Profiler::secondsSince( start ); }
+
+        private:
+            ScopedTimer(const ScopedTimer&);
+            ScopedTimer&                            operator=(const ScopedTimer&);
+
+            double*                                 target;
+            clock::time_point                       start;
+        };
+
+        /**
+         * @brief Records one probability computation of a distribution, if profiling is switched on.
+         */
+        class ComputationTimer {
+
+        public:
+            ComputationTimer(const std::type_info &t) : type( Profiler::isActive() ? &t : NULL ) { if ( type != NULL ) start = clock::now(); }
+            ~ComputationTimer(void) { if ( type != NULL ) Profiler::globalInstance().addComputation( *type, Profiler::secondsSince( start ) ); }
+
+        private:
+            ComputationTimer(const ComputationTimer&);
+            ComputationTimer&                       operator=(const ComputationTimer&);
+
+            const std::type_info*                   type;
+            clock::time_point                       start;
+        };
+
+        static Profiler&                            globalInstance(void);                                       //!< Return a reference to the singleton profiler
+        static size_t                               getNumberOfComputations(void);                              //!< The number of computations recorded by the calling thread
+        static bool                                 isActive(void);                                             //!< Is profiling switched on?
+        static double                               secondsSince(clock::time_point t);                          //!< Seconds elapsed since t
+
+        std::vector<DistributionTimings>            getDistributionTimings(void) const;                         //!< The counters of all threads combined, slowest distribution first
+        void                                        printSummary(std::ostream &o, const RbVector<Move> &moves) const;   //!< Print the timings of the moves and distributions as tables
+        void                                        writeSummary(const std::string &fn, const std::string &format, const RbVector<Move> &moves) const;  //!< Write the timings to a file (format "tsv" or "json")
+
+    private:
+
+        /*
+         * The counters of one thread
+         */
+        struct ThreadRecord {
+
+            ThreadRecord(void) : distributions(), num_computations( 0 ) {}
+
+            std::map<std::type_index, std::pair<size_t, double> >    distributions;                             //!< Number of computations and seconds per class
+            size_t                                  num_computations;
+        };
+
+                                                    Profiler(void) {}                                           //!< Default constructor
+                                                    Profiler(const Profiler&);                                  //!< Prevent copy
+        Profiler&                                   operator=(const Profiler&);                                 //!< Prevent assignment
+                                                   ~Profiler(void);                                             //!< Destructor
+
+        void                                        addComputation(const std::type_info &t, double s);          //!< Count one computation for the calling thread
+        ThreadRecord&                               getThreadRecord(void);                                      //!< The record of the calling thread
+
+        std::vector<ThreadRecord*>                  records;
+        mutable std::mutex                          records_mutex;
+    };
+
+}
+
+#endif
@@ -36,12 +36,32 @@ const std::string& RbSettings::getModuleDir( void ) const
 }
 
 
+size_t RbSettings::getMonitorFlushBytes( void ) const
+{
+    // return the internal value
+    return monitorFlushBytes;
+}
+
+
+double RbSettings::getMonitorFlushInterval( void ) const
+{
+    // return the internal value
+    return monitorFlushInterval;
+}
+
+
 size_t RbSettings::getLineWidth( void ) const
 {
     // return the internal value
     return lineWidth;
 }
 
+size_t RbSettings::getNumberOfThreads( void ) const
+{
+    // return the internal value
+    return numThreads;
+}
+
 size_t RbSettings::getScalingDensity( void ) const
 {
     // return the internal value
@@ -54,12 +74,24 @@ bool RbSettings::getUseScaling( void ) const
     return useScaling;
 }
 
+bool RbSettings::getUseSinglePrecision( void ) const
+{
+    // return the internal value
+    return useSinglePrecision;
+}
+
 bool RbSettings::getCollapseSampledAncestors( void ) const
 {
     // return the internal value
     return collapseSampledAncestors;
 }
 
+bool RbSettings::getProfiling( void ) const
+{
+    // return the internal value
+    return profiling;
+}
+
 std::string RbSettings::getOption(const std::string &key) const
 {
     if ( key == "moduledir" )
@@ -94,6 +126,30 @@ std::string RbSettings::getOption(const std::string &key) const
     {
         return collapseSampledAncestors ? "true" : "false";
     }
+    else if ( key == "numThreads" )
+    {
+        return StringUtilities::to_string(numThreads);
+    }
+    else if ( key == "useSinglePrecision" )
+    {
+        return useSinglePrecision ? "true" : "false";
+    }
+    else if ( key == "transitionProbabilityCacheSize" )
+    {
+        return StringUtilities::to_string(transitionProbabilityCacheSize);
+    }
+    else if ( key == "monitorFlushBytes" )
+    {
+        return StringUtilities::to_string(monitorFlushBytes);
+    }
+    else if ( key == "monitorFlushInterval" )
+    {
+        return StringUtilities::to_string(monitorFlushInterval);
+    }
+    else if ( key == "profiling" )
+    {
+        return profiling ? "true" : "false";
+    }
     else
     {
         std::cout << "Unknown user setting with key '" << key << "'." << std::endl;
@@ -124,6 +180,13 @@ double RbSettings::getTolerance( void ) const
 }
 
 
+size_t RbSettings::getTransitionProbabilityCacheSize( void ) const
+{
+    // return the internal value
+    return transitionProbabilityCacheSize;
+}
+
+
 const std::string& RbSettings::getWorkingDirectory( void ) const
 {
     
@@ -143,6 +206,12 @@ void RbSettings::initializeUserSettings(void)
     outputPrecision = 7;
     printNodeIndex = true;      // print node indices of tree nodes as comments
     collapseSampledAncestors = true;
+    numThreads = 1;             // by default we do not use additional threads
+    useSinglePrecision = false; // by default we store the partial likelihoods in double precision
+    transitionProbabilityCacheSize = 0;     // by default we do not cache transition probability matrices
+    monitorFlushBytes = 1048576;            // write buffered monitor output once a file has 1MB buffered
+    monitorFlushInterval = 10.0;            // or at least every 10 seconds
+    profiling = false;                      // by default we do not time the moves
     
     std::string user_dir = RevBayesCore::RbFileManager::expandUserDir("~");
     
@@ -217,6 +286,12 @@ void RbSettings::listOptions() const
     std::cout << "useScaling = " << (useScaling ? "true" : "false") << std::endl;
     std::cout << "scalingDensity = " << scalingDensity << std::endl;
     std::cout << "collapseSampledAncestors = " << (collapseSampledAncestors ? "true" : "false") << std::endl;
+    std::cout << "numThreads = " << numThreads << std::endl;
+    std::cout << "useSinglePrecision = " << (useSinglePrecision ? "true" : "false") << std::endl;
+    std::cout << "transitionProbabilityCacheSize = " << transitionProbabilityCacheSize << std::endl;
+    std::cout << "monitorFlushBytes = " << monitorFlushBytes << std::endl;
+    std::cout << "monitorFlushInterval = " << monitorFlushInterval << std::endl;
+    std::cout << "profiling = " << (profiling ? "true" : "false") << std::endl;
 }
 
 
@@ -237,6 +312,29 @@ void RbSettings::setModuleDir(const std::string &md)
 }
 
 
+void RbSettings::setMonitorFlushBytes(size_t b)
+{
+    // replace the internal value with this new value
+    monitorFlushBytes = b;
+
+    // save the current settings for the future.
+    writeUserSettings();
+}
+
+
+void RbSettings::setMonitorFlushInterval(double s)
+{
+    if (s < 0.0)
+        throw(RbException("monitorFlushInterval must be a number greater or equal to 0"));
+
+    // replace the internal value with this new value
+    monitorFlushInterval = s;
+
+    // save the current settings for the future.
+    writeUserSettings();
+}
+
+
 void RbSettings::setLineWidth(size_t w)
 {
     // replace the internal value with this new value
@@ -255,6 +353,15 @@ void RbSettings::setUseScaling(bool w)
     writeUserSettings();
 }
 
+void RbSettings::setUseSinglePrecision(bool w)
+{
+    // replace the internal value with this new value
+    useSinglePrecision = w;
+
+    // save the current settings for the future.
+    writeUserSettings();
+}
+
 void RbSettings::setScalingDensity(size_t w)
 {
     // replace the internal value with this new value
@@ -275,6 +382,19 @@ void RbSettings::setCollapseSampledAncestors(bool w)
 }
 
 
+void RbSettings::setNumberOfThreads(size_t n)
+{
+    if (n < 1)
+        throw(RbException("numThreads must be an integer greater than 0"));
+
+    // replace the internal value with this new value
+    numThreads = n;
+
+    // save the current settings for the future.
+    writeUserSettings();
+}
+
+
 void RbSettings::setOption(const std::string &key, const std::string &v, bool write)
 {
 
@@ -321,6 +441,46 @@ void RbSettings::setOption(const std::string &key, const std::string &v, bool wr
     {
         collapseSampledAncestors = value == "true";
     }
+    else if ( key == "numThreads" )
+    {
+        int n = atoi(value.c_str());
+        if (n < 1)
+            throw(RbException("numThreads must be an integer greater than 0"));
+
+        numThreads = size_t(n);
+    }
+    else if ( key == "useSinglePrecision" )
+    {
+        useSinglePrecision = value == "true";
+    }
+    else if ( key == "transitionProbabilityCacheSize" )
+    {
+        int s = atoi(value.c_str());
+        if (s < 0)
+            throw(RbException("transitionProbabilityCacheSize must be an integer greater or equal to 0"));
+
+        transitionProbabilityCacheSize = size_t(s);
+    }
+    else if ( key == "monitorFlushBytes" )
+    {
+        int b = atoi(value.c_str());
+        if (b < 0)
+            throw(RbException("monitorFlushBytes must be an integer greater or equal to 0"));
+
+        monitorFlushBytes = size_t(b);
+    }
+    else if ( key == "monitorFlushInterval" )
+    {
+        double t = (double)atof(value.c_str());
+        if (t < 0.0)
+            throw(RbException("monitorFlushInterval must be a number greater or equal to 0"));
+
+        monitorFlushInterval = t;
+    }
+    else if ( key == "profiling" )
+    {
+        profiling = value == "true";
+    }
     else
     {
         std::cout << "Unknown user setting with key '" << key << "'." << std::endl;
@@ -351,6 +511,16 @@ void RbSettings::setPrintNodeIndex(bool tf)
 }
 
 
+void RbSettings::setProfiling(bool tf)
+{
+    // replace the internal value with this new value
+    profiling = tf;
+
+    // save the current settings for the future.
+    writeUserSettings();
+}
+
+
 void RbSettings::setTolerance(double t)
 {
     // replace the internal value with this new value
@@ -361,6 +531,16 @@ void RbSettings::setTolerance(double t)
 }
 
 
+void RbSettings::setTransitionProbabilityCacheSize(size_t s)
+{
+    // replace the internal value with this new value
+    transitionProbabilityCacheSize = s;
+
+    // save the current settings for the future.
+    writeUserSettings();
+}
+
+
 void RbSettings::setWorkingDirectory(const std::string &wd)
 {
     
@@ -396,6 +576,12 @@ void RbSettings::writeUserSettings( void )
     writeStream << "useScaling=" << (useScaling ? "true" : "false") << std::endl;
     writeStream << "scalingDensity=" << scalingDensity << std::endl;
     writeStream << "collapseSampledAncestors=" << (collapseSampledAncestors ? "true" : "false") << std::endl;
+    writeStream << "numThreads=" << numThreads << std::endl;
+    writeStream << "useSinglePrecision=" << (useSinglePrecision ? "true" : "false") << std::endl;
+    writeStream << "transitionProbabilityCacheSize=" << transitionProbabilityCacheSize << std::endl;
+    writeStream << "monitorFlushBytes=" << monitorFlushBytes << std::endl;
+    writeStream << "monitorFlushInterval=" << monitorFlushInterval << std::endl;
+    writeStream << "profiling=" << (profiling ? "true" : "false") << std::endl;
     fm.closeFile( writeStream );
 
 }
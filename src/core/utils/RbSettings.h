@@ -19,12 +19,18 @@ class RbSettings {
         bool                        getCollapseSampledAncestors(void) const;            //!< Retrieve the whether to should display sampled ancestors as 2-degree nodes when printing
         size_t                      getLineWidth(void) const;                           //!< Retrieve the line width that will be used for the screen width when printing
         const std::string&          getModuleDir(void) const;                           //!< Retrieve the module directory name
+        size_t                      getMonitorFlushBytes(void) const;                   //!< Retrieve the number of buffered bytes after which monitor files are written (0 = never)
+        double                      getMonitorFlushInterval(void) const;                //!< Retrieve the number of seconds after which buffered monitor output is written (0 = never)
+        size_t                      getNumberOfThreads(void) const;                     //!< Retrieve the number of threads used for shared-memory parallel computations
         std::string                 getOption(const std::string &k) const;              //!< Retrieve a user option
         size_t                      getOutputPrecision(void) const;                     //!< Retrieve the default output precision width
+        bool                        getProfiling(void) const;                           //!< Retrieve the flag whether we should time the moves and the probability computations
         bool                        getPrintNodeIndex(void) const;                      //!< Retrieve the flag whether we should print node indices
         size_t                      getScalingDensity(void) const;                      //!< Retrieve the scaling density that determines how often to scale the likelihood in CTMC models
         double                      getTolerance(void) const;                           //!< Retrieve the tolerance for comparing doubles
+        size_t                      getTransitionProbabilityCacheSize(void) const;      //!< Retrieve the maximal size (in MB) of the cache for transition probability matrices
         bool                        getUseScaling(void) const;                          //!< Retrieve the flag whether we should scale the likelihood in CTMC models
+        bool                        getUseSinglePrecision(void) const;                  //!< Retrieve the flag whether CTMC models should store partial likelihoods in single precision
         const std::string&          getWorkingDirectory(void) const;                    //!< Retrieve the current working directory
         void                        listOptions(void) const;                            //!< Retrieve a list of all user options and their current values
 
@@ -32,12 +38,18 @@ class RbSettings {
         void                        setCollapseSampledAncestors(bool);                  //!< Set whether to should display sampled ancestors as 2-degree nodes when printing
         void                        setLineWidth(size_t w);                             //!< Set the line width that will be used for the screen width when printing
         void                        setModuleDir(const std::string &md);                //!< Set the module directory name
+        void                        setMonitorFlushBytes(size_t b);                     //!< Set the number of buffered bytes after which monitor files are written (0 = never)
+        void                        setMonitorFlushInterval(double s);                  //!< Set the number of seconds after which buffered monitor output is written (0 = never)
+        void                        setNumberOfThreads(size_t n);                       //!< Set the number of threads used for shared-memory parallel computations (min 1)
         void                        setOutputPrecision(size_t p);                       //!< Set the default output precision width
         void                        setOption(const std::string &k, const std::string &v, bool write);  //!< Set the key value pair.
         void                        setPrintNodeIndex(bool tf);                         //!< Set the flag whether we should print node indices
+        void                        setProfiling(bool tf);                              //!< Set the flag whether we should time the moves and the probability computations
         void                        setScalingDensity(size_t w);                        //!< Set the scaling density n, where CTMC likelihoods are scaled every n-th node (min 1)
         void                        setTolerance(double t);                             //!< Set the tolerance for comparing double
+        void                        setTransitionProbabilityCacheSize(size_t s);        //!< Set the maximal size (in MB) of the cache for transition probability matrices (0 disables the cache)
         void                        setUseScaling(bool s);                              //!< Set the flag whether we should scale the likelihood in CTMC models
+        void                        setUseSinglePrecision(bool s);                      //!< Set the flag whether CTMC models should store partial likelihoods in single precision
         void                        setWorkingDirectory(const std::string &wd);         //!< Set the current working directory
     
     private:
@@ -53,11 +65,17 @@ class RbSettings {
         bool                        collapseSampledAncestors;
         size_t                      lineWidth;
         std::string                 moduleDir;
+        size_t                      monitorFlushBytes;                                  //!< Write buffered monitor output once a file has this many bytes buffered
+        double                      monitorFlushInterval;                               //!< Write buffered monitor output at least every this many seconds
+        size_t                      numThreads;                                         //!< Number of threads used to parallelize computations within a process
         size_t                      outputPrecision;
         bool                        printNodeIndex;                                     //!< Should the node index of a tree be printed as a comment?
+        bool                        profiling;                                          //!< Should we record the time spent in moves and probability computations?
         size_t                      scalingDensity;
         double                      tolerance;                                          //!< Tolerance for comparison of doubles
+        size_t                      transitionProbabilityCacheSize;                     //!< Maximal memory (in MB) used to cache transition probability matrices
         bool                        useScaling;
+        bool                        useSinglePrecision;                                 //!< Store the partial likelihoods of new CTMC models as float instead of double
         std::string                 workingDirectory;
     
 };
@@ -0,0 +1,440 @@
+#include "ThreadPool.h"
+#include "RbSettings.h"
+
+#include <atomic>
+#include <exception>
+
+using namespace RevBayesCore;
+
+
+namespace {
+
+    // flag whether the current thread is a worker of a thread pool
+    thread_local bool is_pool_worker = false;
+
+    /*
+     * Book-keeping for one call to runJobs: how many jobs are still running
+     * and the first exception thrown by any of them.
+     */
+    struct JobGroup {
+
+        JobGroup(size_t n) : remaining( n ), error() {}
+
+        std::mutex                  mutex;
+        std::condition_variable     finished;
+        size_t                      remaining;
+        std::exception_ptr          error;
+    };
+
+}
+
+
+/** Default constructor. We do not start any threads until someone asks for parallel work. */
+ThreadPool::ThreadPool( void ) :
+    workers(),
+    queue(),
+    stopping( false )
+{
+
+}
+
+
+/** Destructor. Stop and join all worker threads. */
+ThreadPool::~ThreadPool( void )
+{
+
+    stopWorkers();
+}
+
+
+/**
+ * Get the number of threads that will be used for parallel jobs (including the calling thread).
+ * If the user changed the setting since the last call, then we also resize the pool.
+ */
+size_t ThreadPool::getNumberOfThreads( void )
+{
+
+    // jobs nested inside a worker are computed serially
+    if ( is_pool_worker == true )
+    {
+        return 1;
+    }
+
+    size_t n = RbSettings::userSettings().getNumberOfThreads();
+    if ( n < 1 )
+    {
+        n = 1;
+    }
+
+    std::lock_guard<std::mutex> lock( resize_mutex );
+    if ( workers.size() + 1 != n )
+    {
+        resize( n );
+    }
+
+    return n;
+}
+
+
+bool ThreadPool::isWorkerThread( void )
+{
+
+    return is_pool_worker;
+}
+
+
+/**
+ * Split the range [0,n) into at most as many contiguous blocks as we have threads and call f(begin,end) for each block.
+ * The blocks are never smaller than min_block_size, so small ranges are computed on the calling thread only.
+ * The function returns only after all blocks are computed.
+ */
+void ThreadPool::parallelFor(size_t n, const std::function<void (size_t, size_t)> &f, size_t min_block_size)
+{
+
+    if ( min_block_size < 1 )
+    {
+        min_block_size = 1;
+    }
+
+    size_t num_blocks = getNumberOfThreads();
+    size_t max_blocks = n / min_block_size;
+    if ( max_blocks < num_blocks )
+    {
+        num_blocks = max_blocks;
+    }
+
+    if ( num_blocks <= 1 )
+    {
+        f(0, n);
+        return;
+    }
+
+    std::vector< std::function<void (void)> > jobs;
+    jobs.reserve( num_blocks );
+    for (size_t i = 0; i < num_blocks; ++i)
+    {
+        size_t begin = (n * i) / num_blocks;
+        size_t end   = (n * (i+1)) / num_blocks;
+        jobs.push_back( [&f, begin, end]() { f(begin, end); } );
+    }
+
+    runJobs( jobs );
+}
+
+
+/**
+ * Call f(i,w) for each of n long running, independent jobs i (e.g. the replicates of an analysis).
+ * We start num_workers workers (at most one per thread), and each worker w takes the next job as soon as it finished its previous one,
+ * so that jobs of very different lengths are balanced. The worker index tells f which per-worker data (e.g. a copy of the model) to use.
+ * Parallel work requested from within a job is computed serially, because all threads are already busy with jobs.
+ * If f throws, no new jobs are started and the first exception is rethrown here.
+ */
+void ThreadPool::runIndependentJobs(size_t n, size_t num_workers, const std::function<void (size_t, size_t)> &f)
+{
+
+    if ( num_workers > n )
+    {
+        num_workers = n;
+    }
+
+    if ( num_workers <= 1 )
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            f(i, 0);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next_job( 0 );
+    std::atomic<bool>   failed( false );
+
+    std::vector< std::function<void (void)> > jobs;
+    for (size_t w = 0; w < num_workers; ++w)
+    {
+        jobs.push_back( [&, w]()
+        {
+            // the calling thread also runs a worker, and its nested parallel work has to be serial as well
+            bool was_pool_worker = is_pool_worker;
+            is_pool_worker = true;
+            try
+            {
+                for (size_t i = next_job++; i < n && failed == false; i = next_job++)
+                {
+                    f(i, w);
+                }
+            }
+            catch (...)
+            {
+                failed = true;
+                is_pool_worker = was_pool_worker;
+                throw;
+            }
+            is_pool_worker = was_pool_worker;
+        } );
+    }
+
+    runJobs( jobs );
+}
+
+
+/**
+ * Call f(i) for each task i of a tree of tasks, where parents[i] is the task that has to wait for i
+ * (or any value not smaller than parents.size() if no task waits for i). Typically the tasks are the nodes of a phylogeny
+ * and f computes the partial likelihood of a node from those of its children.
+ * Independent subtrees are computed in parallel: each thread takes the next task whose children are done,
+ * and a parent becomes ready as soon as its last child is finished.
+ * If f throws, no new tasks are started and the first exception is rethrown here.
+ */
+void ThreadPool::runTreeJobs(const std::vector<size_t> &parents, const std::function<void (size_t)> &f)
+{
+
+    size_t n = parents.size();
+
+    // count the children of each task
+    std::vector<size_t> num_pending_children( n, 0 );
+    for (size_t i = 0; i < n; ++i)
+    {
+        if ( parents[i] < n )
+        {
+            ++num_pending_children[ parents[i] ];
+        }
+    }
+
+    std::deque<size_t> ready;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if ( num_pending_children[i] == 0 )
+        {
+            ready.push_back( i );
+        }
+    }
+
+    size_t num_workers = getNumberOfThreads();
+    if ( n < num_workers )
+    {
+        num_workers = n;
+    }
+
+    if ( num_workers <= 1 )
+    {
+        while ( ready.empty() == false )
+        {
+            size_t i = ready.front();
+            ready.pop_front();
+            f( i );
+            if ( parents[i] < n && --num_pending_children[ parents[i] ] == 0 )
+            {
+                ready.push_back( parents[i] );
+            }
+        }
+        return;
+    }
+
+    std::mutex              tree_mutex;
+    std::condition_variable tree_condition;
+    size_t                  num_remaining = n;
+    bool                    failed = false;
+
+    std::function<void (void)> worker = [&]()
+    {
+        while ( true )
+        {
+            size_t i = 0;
+            {
+                std::unique_lock<std::mutex> lock( tree_mutex );
+                while ( ready.empty() == true && num_remaining > 0 && failed == false )
+                {
+                    tree_condition.wait( lock );
+                }
+                if ( ready.empty() == true || failed == true )
+                {
+                    return;
+                }
+                i = ready.front();
+                ready.pop_front();
+            }
+
+            try
+            {
+                f( i );
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock( tree_mutex );
+                failed = true;
+                tree_condition.notify_all();
+                throw;
+            }
+
+            std::lock_guard<std::mutex> lock( tree_mutex );
+            --num_remaining;
+            if ( parents[i] < n && --num_pending_children[ parents[i] ] == 0 )
+            {
+                ready.push_back( parents[i] );
+                tree_condition.notify_one();
+            }
+            if ( num_remaining == 0 )
+            {
+                tree_condition.notify_all();
+            }
+        }
+    };
+
+    runJobs( std::vector< std::function<void (void)> >( num_workers, worker ) );
+}
+
+
+/**
+ * Stop and restart the workers so that the pool uses n threads in total.
+ * The calling thread counts as one thread, so we start n-1 workers.
+ */
+void ThreadPool::resize(size_t n)
+{
+
+    stopWorkers();
+
+    for (size_t i = 1; i < n; ++i)
+    {
+        workers.push_back( std::thread( &ThreadPool::workerLoop, this ) );
+    }
+
+}
+
+
+/**
+ * Run the jobs on the pool and wait until all have finished.
+ * The calling thread helps to work off the queue while it waits.
+ * If any job throws, the first exception is rethrown here after all jobs have finished.
+ */
+void ThreadPool::runJobs(const std::vector< std::function<void (void)> > &jobs)
+{
+
+    if ( jobs.empty() == true )
+    {
+        return;
+    }
+
+    // we run all jobs serially if we are a worker ourselves or if there are no workers
+    if ( jobs.size() == 1 || getNumberOfThreads() == 1 )
+    {
+        for (size_t i = 0; i < jobs.size(); ++i)
+        {
+            jobs[i]();
+        }
+        return;
+    }
+
+    JobGroup group( jobs.size() );
+
+    {
+        std::lock_guard<std::mutex> lock( queue_mutex );
+        for (size_t i = 0; i < jobs.size(); ++i)
+        {
+            const std::function<void (void)> *job = &jobs[i];
+            JobGroup *g = &group;
+            queue.push_back( [job, g]()
+            {
+                std::exception_ptr error;
+                try
+                {
+                    (*job)();
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> group_lock( g->mutex );
+                if ( error && !g->error )
+                {
+                    g->error = error;
+                }
+                --g->remaining;
+                if ( g->remaining == 0 )
+                {
+                    g->finished.notify_all();
+                }
+            } );
+        }
+    }
+    queue_condition.notify_all();
+
+    // help with the queued jobs instead of idling
+    while ( true )
+    {
+        std::function<void (void)> task;
+        {
+            std::lock_guard<std::mutex> lock( queue_mutex );
+            if ( queue.empty() == true )
+            {
+                break;
+            }
+            task = queue.front();
+            queue.pop_front();
+        }
+        task();
+    }
+
+    std::unique_lock<std::mutex> group_lock( group.mutex );
+    while ( group.remaining > 0 )
+    {
+        group.finished.wait( group_lock );
+    }
+
+    if ( group.error )
+    {
+        std::rethrow_exception( group.error );
+    }
+
+}
+
+
+void ThreadPool::stopWorkers( void )
+{
+
+    {
+        std::lock_guard<std::mutex> lock( queue_mutex );
+        stopping = true;
+    }
+    queue_condition.notify_all();
+
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        workers[i].join();
+    }
+    workers.clear();
+
+    std::lock_guard<std::mutex> lock( queue_mutex );
+    stopping = false;
+}
+
+
+void ThreadPool::workerLoop( void )
+{
+
+    is_pool_worker = true;
+
+    while ( true )
+    {
+        std::function<void (void)> task;
+        {
+            std::unique_lock<std::mutex> lock( queue_mutex );
+            while ( stopping == false && queue.empty() == true )
+            {
+                queue_condition.wait( lock );
+            }
+
+            if ( queue.empty() == true )
+            {
+                // we have been asked to stop and there is nothing left to do
+                return;
+            }
+
+            task = queue.front();
+            queue.pop_front();
+        }
+        task();
+    }
+
+}
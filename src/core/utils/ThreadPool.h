@@ -0,0 +1,65 @@
+#ifndef ThreadPool_H
+#define ThreadPool_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace RevBayesCore {
+
+
+    /**
+     * @brief Shared-memory thread pool.
+     *
+     * The thread pool keeps a fixed set of worker threads alive for the lifetime of the process
+     * so that fine grained jobs, e.g., computing the partial likelihoods for a block of site patterns,
+     * do not pay the cost of creating threads. The number of threads is taken from the user setting
+     * 'numThreads' (see RbSettings) and the pool is resized lazily whenever that setting changes.
+     *
+     * Jobs submitted from within a worker thread are executed directly by the calling thread.
+     * This prevents dead-locks when a parallel job (e.g. one chain of an MC^3 analysis)
+     * itself asks for parallel work (e.g. the likelihood computation of that chain).
+     *
+     */
+    class ThreadPool {
+
+    public:
+        static ThreadPool&                      globalInstance(void)                                                        //!< Return a reference to the singleton pool
+                                                {
+                                                    static ThreadPool single_thread_pool;
+                                                    return single_thread_pool;
+                                                }
+
+        size_t                                  getNumberOfThreads(void);                                                   //!< The number of threads (including the calling thread) used for parallel jobs
+        static bool                             isWorkerThread(void);                                                       //!< Is the current thread one of the workers of a pool?
+        void                                    parallelFor(size_t n, const std::function<void (size_t, size_t)> &f, size_t min_block_size = 1);   //!< Apply f to contiguous blocks [begin,end) of [0,n)
+        void                                    runIndependentJobs(size_t n, size_t num_workers, const std::function<void (size_t, size_t)> &f);   //!< Call f(i,w) for each job i of [0,n), where the jobs are handed out one by one to the workers w
+        void                                    runJobs(const std::vector< std::function<void (void)> > &jobs);           //!< Run independent jobs and wait until all of them are finished
+        void                                    runTreeJobs(const std::vector<size_t> &parents, const std::function<void (size_t)> &f);   //!< Call f(i) for each node i of a tree, but only after it was called for all children of i
+
+    private:
+                                                ThreadPool(void);                                                           //!< Default constructor
+                                                ThreadPool(const ThreadPool&);                                              //!< Prevent copy
+        ThreadPool&                             operator=(const ThreadPool&);                                               //!< Prevent assignment
+                                               ~ThreadPool(void);                                                           //!< Destructor joins all worker threads
+
+        void                                    resize(size_t n);                                                           //!< Start or stop workers so that we use n threads
+        void                                    stopWorkers(void);                                                          //!< Join all current workers
+        void                                    workerLoop(void);                                                           //!< The main loop of each worker thread
+
+        std::vector<std::thread>                workers;
+        std::deque< std::function<void (void)> > queue;
+        std::mutex                              queue_mutex;
+        std::condition_variable                 queue_condition;
+        std::mutex                              resize_mutex;
+        bool                                    stopping;
+
+    };
+
+}
+
+#endif
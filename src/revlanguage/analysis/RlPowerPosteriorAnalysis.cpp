@@ -78,6 +78,7 @@ void PowerPosteriorAnalysis::constructInternalObject( void )
     const double                                    alpha   = static_cast<const RealPos &>( alphaVal->getRevObject() ).getValue();
     const int                                       sf      = (int)static_cast<const Natural &>( sampFreq->getRevObject() ).getValue();
     const int                                       k       = (int)static_cast<const Natural &>( proc_per_lik->getRevObject() ).getValue();
+    const int                                       n_adapt = (int)static_cast<const Natural &>( adaptive_stones->getRevObject() ).getValue();
 
     RevBayesCore::Mcmc *m = new RevBayesCore::Mcmc(mdl, mvs, mntr);
     m->setScheduleType( "random" );
@@ -101,6 +102,7 @@ void PowerPosteriorAnalysis::constructInternalObject( void )
 
     value->setPowers( beta );
     value->setSampleFreq( sf );
+    value->setAdaptiveStones( size_t(n_adapt) );
 }
 
 
@@ -194,6 +196,7 @@ const MemberRules& PowerPosteriorAnalysis::getParameterRules(void) const
         member_rules.push_back( new ArgumentRule("alpha"      , RealPos::getClassTypeSpec()                 , "The alpha parameter of the beta distribution if no powers are specified.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RealPos(0.2) ) );
         member_rules.push_back( new ArgumentRule("sampleFreq" , Natural::getClassTypeSpec()                 , "The sampling frequency of the likelihood values.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(100) ) );
         member_rules.push_back( new ArgumentRule("procPerLikelihood" , Natural::getClassTypeSpec()          , "Number of processors used to compute the likelihood.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(1) ) );
+        member_rules.push_back( new ArgumentRule("adaptiveStones" , Natural::getClassTypeSpec()             , "The number of additional stones placed where the mean log-likelihood curve is most curved.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(0L) ) );
 
         rules_set = true;
     }
@@ -260,6 +263,10 @@ void PowerPosteriorAnalysis::setConstParameter(const std::string& name, const Re
     {
         proc_per_lik = var;
     }
+    else if ( name == "adaptiveStones" )
+    {
+        adaptive_stones = var;
+    }
     else
     {
         RevObject::setConstParameter(name, var);
@@ -145,6 +145,17 @@ RevPtr<RevVariable> MonteCarloAnalysis::executeMethod(std::string const &name, c
         
         return NULL;
     }
+    else if ( name == "writeProfile")
+    {
+        found = true;
+        
+        const std::string &filename = static_cast<const RlString &>( args[0].getVariable()->getRevObject() ).getValue();
+        const std::string &format   = static_cast<const RlString &>( args[1].getVariable()->getRevObject() ).getValue();
+        
+        value->writeProfile( filename, format );
+        
+        return NULL;
+    }
     else if ( name == "initializeFromTrace")
     {
         found = true;
@@ -268,6 +279,14 @@ void MonteCarloAnalysis::initializeMethods()
     operatorSummaryArgRules->push_back( new ArgumentRule( "currentPeriod" , RlBoolean::getClassTypeSpec(), "Should the operator summary (number of tries and acceptance, and the acceptance ratio) of only the current period (i.e., after the last tuning) be printed?", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlBoolean(false) ) );
     methods.addFunction( new MemberProcedure( "operatorSummary", RlUtils::Void, operatorSummaryArgRules) );
     
+    ArgumentRules* write_profile_arg_rules = new ArgumentRules();
+    write_profile_arg_rules->push_back( new ArgumentRule( "filename", RlString::getClassTypeSpec(), "The name of the file for the time spent in each move and distribution (requires the option 'profiling' to be set to true).", ArgumentRule::BY_VALUE, ArgumentRule::ANY ) );
+    std::vector<std::string> options_profile_format;
+    options_profile_format.push_back( "tsv" );
+    options_profile_format.push_back( "json" );
+    write_profile_arg_rules->push_back( new OptionRule( "format", new RlString( "tsv" ), options_profile_format, "The format of the file." ) );
+    methods.addFunction( new MemberProcedure( "writeProfile", RlUtils::Void, write_profile_arg_rules) );
+    
     ArgumentRules* initialize_trace_arg_rules = new ArgumentRules();
     initialize_trace_arg_rules->push_back( new ArgumentRule("trace", WorkspaceVector<ModelTrace>::getClassTypeSpec(), "The sample trace object.", ArgumentRule::BY_CONSTANT_REFERENCE, ArgumentRule::ANY ) );
     methods.addFunction( new MemberProcedure( "initializeFromTrace", RlUtils::Void, initialize_trace_arg_rules) );
@@ -90,6 +90,13 @@ void RateGenerator::initMethods(void) {
     transitionProbabilityArgRules->push_back( new ArgumentRule( "endAge", RealPos::getClassTypeSpec(), "The end age of the process.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RealPos(0.0) ) );
     methods.addFunction( new MemberFunction<RateGenerator, ModelVector<ModelVector<RealPos> > >( "getTransitionProbabilities", this, transitionProbabilityArgRules   ) );
     
+    ArgumentRules* transitionProbabilityActionArgRules = new ArgumentRules();
+    transitionProbabilityActionArgRules->push_back( new ArgumentRule( "values", ModelVector<Real>::getClassTypeSpec(), "The vector v with one value per state.", ArgumentRule::BY_VALUE, ArgumentRule::ANY ) );
+    transitionProbabilityActionArgRules->push_back( new ArgumentRule( "rate", RealPos::getClassTypeSpec(), "The rate of the process (or duration of the process assuming rate=1).", ArgumentRule::BY_VALUE, ArgumentRule::ANY ) );
+    transitionProbabilityActionArgRules->push_back( new ArgumentRule( "startAge", RealPos::getClassTypeSpec(), "The start age of the process.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RealPos(1.0) ) );
+    transitionProbabilityActionArgRules->push_back( new ArgumentRule( "endAge", RealPos::getClassTypeSpec(), "The end age of the process.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RealPos(0.0) ) );
+    methods.addFunction( new MemberFunction<RateGenerator, ModelVector<Real> >( "applyTransitionProbabilities", this, transitionProbabilityActionArgRules   ) );
+    
 }
 
 /**
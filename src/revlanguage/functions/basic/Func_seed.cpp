@@ -11,11 +11,13 @@
 #include "DeterministicNode.h"
 #include "Ellipsis.h"
 #include "Natural.h"
+#include "OptionRule.h"
 #include "RandomNumberGenerator.h"
 #include "RandomNumberFactory.h"
 #include "RbUtil.h"
 #include "RevNullObject.h"
 #include "RealPos.h"
+#include "RlString.h"
 #include "TypedDagNode.h"
 #include "TypeSpec.h"
 
@@ -42,7 +44,10 @@ RevPtr<RevVariable> Func_seed::execute( void )
     const Natural &val1 = static_cast<const Natural &>( args[0].getVariable()->getRevObject() );
     s = (unsigned int) val1.getValue();
     
+    const std::string &generator = static_cast<const RlString &>( args[1].getVariable()->getRevObject() ).getValue();
+    
     RevBayesCore::RandomNumberGenerator *rng = RevBayesCore::GLOBAL_RNG;
+    rng->setAlgorithm( generator == "philox" ? RevBayesCore::RandomNumberGenerator::PHILOX : RevBayesCore::RandomNumberGenerator::RAND48 );
     rng->setSeed( s );
         
     return NULL;
@@ -60,6 +65,11 @@ const ArgumentRules& Func_seed::getArgumentRules( void ) const
     {
         
         argumentRules.push_back( new ArgumentRule( "x", Natural::getClassTypeSpec(), "The number used to seed the random number generator.", ArgumentRule::BY_VALUE, ArgumentRule::ANY ) );
+        
+        std::vector<std::string> generator_options;
+        generator_options.push_back( "rand48" );
+        generator_options.push_back( "philox" );
+        argumentRules.push_back( new OptionRule( "generator", new RlString("rand48"), generator_options, "The random number generator. 'rand48' gives the same random numbers as earlier versions of RevBayes." ) );
         rules_set = true;
     }
     
@@ -0,0 +1,237 @@
+#include "ArgumentRule.h"
+#include "Func_transitionProbabilityCacheStatistic.h"
+#include "Natural.h"
+#include "OptionRule.h"
+#include "RlBoolean.h"
+#include "RlString.h"
+#include "TransitionProbabilityMatrixCache.h"
+#include "TypeSpec.h"
+
+using namespace RevLanguage;
+
+/** Default constructor */
+Func_transitionProbabilityCacheStatistic::Func_transitionProbabilityCacheStatistic( void ) : Procedure()
+{
+    
+}
+
+
+/**
+ * The clone function is a convenience function to create proper copies of inherited objected.
+ * E.g. a.clone() will create a clone of the correct type even if 'a' is of derived type 'b'.
+ *
+ * \return A new copy of the process.
+ */
+Func_transitionProbabilityCacheStatistic* Func_transitionProbabilityCacheStatistic::clone( void ) const
+{
+    
+    return new Func_transitionProbabilityCacheStatistic( *this );
+}
+
+
+/** Execute function: read the requested counter and clear the cache if asked to */
+RevPtr<RevVariable> Func_transitionProbabilityCacheStatistic::execute( void )
+{
+    
+    const std::string &statistic = static_cast<const RlString &>( args[0].getVariable()->getRevObject() ).getValue();
+    bool reset                   = static_cast<const RlBoolean &>( args[1].getVariable()->getRevObject() ).getValue();
+    
+    RevBayesCore::TransitionProbabilityMatrixCache &cache = RevBayesCore::TransitionProbabilityMatrixCache::globalInstance();
+    
+    long value = 0;
+    if ( statistic == "hits" )
+    {
+        value = cache.getNumberOfHits();
+    }
+    else if ( statistic == "misses" )
+    {
+        value = cache.getNumberOfMisses();
+    }
+    else if ( statistic == "entries" )
+    {
+        value = cache.getNumberOfEntries();
+    }
+    else if ( statistic == "memory" )
+    {
+        value = cache.getMemoryUsage();
+    }
+    
+    if ( reset == true )
+    {
+        cache.clear();
+    }
+    
+    return new RevVariable( new Natural( value ) );
+}
+
+
+/** Get argument rules */
+const ArgumentRules& Func_transitionProbabilityCacheStatistic::getArgumentRules( void ) const
+{
+    
+    static ArgumentRules argument_rules = ArgumentRules();
+    static bool rules_set = false;
+    
+    if ( !rules_set )
+    {
+        std::vector<std::string> options;
+        options.push_back( "hits" );
+        options.push_back( "misses" );
+        options.push_back( "entries" );
+        options.push_back( "memory" );
+        argument_rules.push_back( new OptionRule( "statistic", new RlString("hits"), options, "The counter of the cache we want to read." ) );
+        argument_rules.push_back( new ArgumentRule( "reset", RlBoolean::getClassTypeSpec(), "Should we clear the cache and reset its counters afterwards?", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlBoolean( false ) ) );
+        
+        rules_set = true;
+    }
+    
+    return argument_rules;
+}
+
+
+/** Get Rev type of object */
+const std::string& Func_transitionProbabilityCacheStatistic::getClassType(void)
+{
+    
+    static std::string rev_type = "Func_transitionProbabilityCacheStatistic";
+    
+    return rev_type;
+}
+
+
+/** Get class type spec describing type of object */
+const TypeSpec& Func_transitionProbabilityCacheStatistic::getClassTypeSpec(void)
+{
+    
+    static TypeSpec rev_type_spec = TypeSpec( getClassType(), new TypeSpec( Function::getClassTypeSpec() ) );
+    
+    return rev_type_spec;
+}
+
+
+/**
+ * Get the primary Rev name for this function.
+ */
+std::string Func_transitionProbabilityCacheStatistic::getFunctionName( void ) const
+{
+    // create a name variable that is the same for all instance of this class
+    std::string f_name = "transitionProbabilityCacheStatistic";
+    
+    return f_name;
+}
+
+
+/**
+ * Get the author(s) of this function so they can receive credit (and blame) for it.
+ */
+std::vector<std::string> Func_transitionProbabilityCacheStatistic::getHelpAuthor(void) const
+{
+    // create a vector of authors for this function
+    std::vector<std::string> authors;
+    authors.push_back( "The RevBayes Development Core Team" );
+    
+    return authors;
+}
+
+
+/**
+ * Get the (brief) description for this function
+ */
+std::string Func_transitionProbabilityCacheStatistic::getHelpDescription(void) const
+{
+    // create a variable for the description of the function
+    std::string description = "Get a counter of the transition probability matrix cache.";
+    
+    return description;
+}
+
+
+/**
+ * Get the more detailed description of the function
+ */
+std::string Func_transitionProbabilityCacheStatistic::getHelpDetails(void) const
+{
+    // create a variable for the description of the function
+    std::string details = "";
+    details += "The transition probability matrix cache is only used if the option 'transitionProbabilityCacheSize' is larger than 0. ";
+    details += "The counters are shared by all models and chains in this process.";
+    
+    return details;
+}
+
+
+/**
+ * Get an executable and instructive example.
+ * These example should help the users to show how this function works but
+ * are also used to test if this function still works.
+ */
+std::string Func_transitionProbabilityCacheStatistic::getHelpExample(void) const
+{
+    // create an example as a single string variable.
+    std::string example = "";
+    
+    example += "setOption(\"transitionProbabilityCacheSize\", \"16\")\n";
+    example += "# ... run an analysis ...\n";
+    example += "transitionProbabilityCacheStatistic(\"hits\")\n";
+    example += "transitionProbabilityCacheStatistic(\"misses\", reset=TRUE)\n";
+    
+    return example;
+}
+
+
+/**
+ * Get some references/citations for this function
+ *
+ */
+std::vector<RevBayesCore::RbHelpReference> Func_transitionProbabilityCacheStatistic::getHelpReferences(void) const
+{
+    // create an entry for each reference
+    std::vector<RevBayesCore::RbHelpReference> references;
+    
+    
+    return references;
+}
+
+
+/**
+ * Get the names of similar and suggested other functions
+ */
+std::vector<std::string> Func_transitionProbabilityCacheStatistic::getHelpSeeAlso(void) const
+{
+    // create an entry for each suggested function
+    std::vector<std::string> see_also;
+    see_also.push_back( "setOption" );
+    
+    
+    return see_also;
+}
+
+
+/**
+ * Get the title of this help entry
+ */
+std::string Func_transitionProbabilityCacheStatistic::getHelpTitle(void) const
+{
+    // create a title variable
+    std::string title = "Transition probability cache statistics";
+    
+    return title;
+}
+
+
+/** Get type spec */
+const TypeSpec& Func_transitionProbabilityCacheStatistic::getTypeSpec( void ) const
+{
+    
+    static TypeSpec type_spec = getClassTypeSpec();
+    
+    return type_spec;
+}
+
+
+/** Get return type */
+const TypeSpec& Func_transitionProbabilityCacheStatistic::getReturnType( void ) const
+{
+    
+    return Natural::getClassTypeSpec();
+}
@@ -0,0 +1,55 @@
+#ifndef Func_transitionProbabilityCacheStatistic_H
+#define Func_transitionProbabilityCacheStatistic_H
+
+#include "Procedure.h"
+
+namespace RevLanguage {
+    
+    /**
+     * @brief Rev function to query the transition probability matrix cache.
+     *
+     * Returns one of the counters of the process wide transition probability matrix cache:
+     * the number of hits, the number of misses, the number of cached matrices or the used memory in bytes.
+     * Optionally, the cache is cleared (and its counters reset) after reading the statistic.
+     *
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     *
+     */
+    class Func_transitionProbabilityCacheStatistic : public Procedure {
+        
+    public:
+        Func_transitionProbabilityCacheStatistic( void );
+        
+        // Basic utility functions
+        Func_transitionProbabilityCacheStatistic*       clone(void) const;                                          //!< Clone the object
+        static const std::string&                       getClassType(void);                                         //!< Get Rev type
+        static const TypeSpec&                          getClassTypeSpec(void);                                     //!< Get class type spec
+        std::string                                     getFunctionName(void) const;                                //!< Get the primary name of the function in Rev
+        const TypeSpec&                                 getTypeSpec(void) const;                                    //!< Get language type of the object
+        
+        // Regular functions
+        const ArgumentRules&                            getArgumentRules(void) const;                               //!< Get argument rules
+        const TypeSpec&                                 getReturnType(void) const;                                  //!< Get type of return value
+        
+        
+        RevPtr<RevVariable>                             execute(void);                                              //!< Execute function
+        
+    protected:
+        
+        std::vector<std::string>                        getHelpAuthor(void) const;                                  //!< Get the author(s) of this function
+        std::string                                     getHelpDescription(void) const;                             //!< Get the description for this function
+        std::string                                     getHelpDetails(void) const;                                 //!< Get the more detailed description of the function
+        std::string                                     getHelpExample(void) const;                                 //!< Get an executable and instructive example
+        std::vector<RevBayesCore::RbHelpReference>      getHelpReferences(void) const;                              //!< Get some references/citations for this function
+        std::vector<std::string>                        getHelpSeeAlso(void) const;                                 //!< Get suggested other functions
+        std::string                                     getHelpTitle(void) const;                                   //!< Get the title of this help entry
+        
+    };
+    
+}
+
+
+#endif
+
@@ -4,7 +4,6 @@
 #include "Func_readTreeTrace.h"
 #include "ModelVector.h"
 #include "NclReader.h"
-#include "NewickConverter.h"
 #include "OptionRule.h"
 #include "Probability.h"
 #include "ProgressBar.h"
@@ -19,8 +18,9 @@
 #include "RlUtils.h"
 #include "StringUtilities.h"
 #include "TraceTree.h"
-#include "TreeUtilities.h"
+#include "TreeTraceReader.h"
 
+#include <algorithm>
 #include <map>
 #include <set>
 #include <sstream>
@@ -252,167 +252,63 @@ TraceTree* Func_readTreeTrace::readTrees(const std::vector<std::string> &vector_
     
     std::vector<RevBayesCore::TraceTree> data;
     
-    // Set up a map with the file name to be read as the key and the file type as the value. Note that we may not
-    // read all of the files in the string called "vectorOfFileNames" because some of them may not be in a format
-    // that can be read.
-    std::map<std::string,std::string> file_ap;
     for (std::vector<std::string>::const_iterator p = vector_of_file_names.begin(); p != vector_of_file_names.end(); ++p)
     {
-        bool has_header_been_read = false;
         const std::string &fn = *p;
         
         RevBayesCore::RbFileManager fm = RevBayesCore::RbFileManager(fn);
         
-        // let us quickly count the number of lines
-        size_t lines = 0;
-        std::ifstream tmp_in_file( fm.getFullFileName().c_str() );
+        // map the file and find the trees in it
+        RevBayesCore::TreeTraceReader reader( fm.getFullFileName(), delimitter );
         
-        if ( !tmp_in_file )
+        if ( data.empty() == true )
         {
-            throw RbException( "Could not open file \"" + fn + "\"" );
-        }
-        while ( tmp_in_file.good() )
-        {
-            // Read a line
-            std::string line;
-            RevBayesCore::RbFileManager reader = RevBayesCore::RbFileManager();
-            reader.safeGetline(tmp_in_file, line);
-            if (line.length() == 0 || line[0] == '#')
-            {
-                continue;
-            }
-            ++lines;
+            RevBayesCore::TraceTree t = RevBayesCore::TraceTree( clock );
+            
+            t.setParameterName( reader.getParameterName() );
+            t.setFileName( fn );
+            
+            data.push_back( t );
         }
-        tmp_in_file.close();
-        
-        RevBayesCore::ProgressBar progress = RevBayesCore::ProgressBar( lines, 0 );
-
-        // now we actually process the input
+        RevBayesCore::TraceTree& t = data[0];
         
-        /* Open file */
-        std::ifstream in_file( fm.getFullFileName().c_str() );
+        RBOUT( "Processing file \"" + fn + "\"");
         
-        if ( !in_file )
+        // we only keep every n-th sample in case of thinning
+        size_t n_samples = reader.getNumberOfTrees();
+        std::vector<size_t> samples;
+        for (size_t i = 0; i < n_samples; i += thinning)
         {
-            throw RbException( "Could not open file \"" + fn + "\"" );
+            samples.push_back( i );
         }
         
-        /* Initialize */
-        std::string commandLine;
-        RBOUT( "Processing file \"" + fn + "\"");
-        
-        size_t n_samples = 0;
-        size_t index = 0;
+        RevBayesCore::ProgressBar progress = RevBayesCore::ProgressBar( n_samples, 0 );
         progress.start();
         
-        /* Command-processing loop */
-        while ( in_file.good() )
+        // the trees are parsed in parallel, block by block so that we can show the progress
+        size_t block_size = 1000;
+        for (size_t begin = 0; begin < samples.size(); begin += block_size)
         {
+            size_t end = std::min( begin + block_size, samples.size() );
+            std::vector<size_t> block( samples.begin() + begin, samples.begin() + end );
             
-            // Read a line
-            std::string line;
-            RevBayesCore::RbFileManager reader = RevBayesCore::RbFileManager();
-            reader.safeGetline(in_file, line);
-            
-            // skip empty lines
-            //line = StringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-            if (line.length() == 0)
-            {
-                continue;
-            }
-            
-            
-            // removing comments
-            if (line[0] == '#')
-            {
-                continue;
-            }
-            
-            // splitting every line into its columns
-            std::vector<std::string> columns;
-            
-            // we should provide other delimiters too
-            StringUtilities::stringSplit(line, delimitter, columns);
-            
-            // we assume a header at the first line of the file
-            if ( has_header_been_read == false )
-            {
-                
-                for (size_t j=1; j<columns.size(); j++)
-                {
-                    
-                    std::string parmName = columns[j];
-                    if ( parmName == "Posterior" || parmName == "Likelihood" || parmName == "Prior")
-                    {
-                        continue;
-                    }
-                    index = j;
-                    
-                    RevBayesCore::TraceTree t = RevBayesCore::TraceTree( clock );
-                    
-                    t.setParameterName(parmName);
-                    t.setFileName(fn);
-                    
-                    data.push_back( t );
-                }
-                
-                has_header_been_read = true;
-                
-                continue;
-            }
-            
-            // increase our sample counter
-            ++n_samples;
-            
-            // we need to check if we skip this sample in case of thinning.
-            if ( (n_samples-1) % thinning > 0 )
-            {
-                continue;
-            }
-            
-            // adding values to the Traces
-            RevBayesCore::TraceTree& t = data[0];
-            
-            RevBayesCore::Tree *tau = NULL;
-            if ( clock == true )
-            {
-                RevBayesCore::NewickConverter c;
-                RevBayesCore::Tree *blTree = c.convertFromNewick( columns[index] );
-                tau = RevBayesCore::TreeUtilities::convertTree( *blTree );
-            }
-            else
+            std::vector<RevBayesCore::Tree*> trees = reader.readTrees( block, clock );
+            for (size_t i = 0; i < trees.size(); ++i)
             {
-                RevBayesCore::NewickConverter c;
-                tau = c.convertFromNewick( columns[index] );
-                
-                // moved the reroot functionality below into
-                // RevBayesCore::TreeSummary<BranchLengthTree>::summarizeTrees()
-                // so that tree traces retain their original topology
-                // will freyman 12/12/14
-                
-                //            if ( outgroup == "" )
-                //            {
-                //                RevBayesCore::BranchLengthTree& referenceTree = *tau;
-                //                outgroup = referenceTree.getTipNode(0).getName();
-                //            }
-                //            // re-root the tree so that we can compare the the trees
-                //            tau->reroot( outgroup );
-                
-                //                if ( outgroup.size() > 0 )
-                //                {
-                //                    //                tau->reroot( outgroup, false );
-                //                }
+                t.addObject( trees[i] );
             }
             
-            t.addObject( tau );
-            progress.update( n_samples );
-            
+            progress.update( block.back() + 1 );
         }
-        in_file.close();
         
         progress.finish();
     }
     
+    if ( data.empty() == true )
+    {
+        throw RbException( "No tree trace file could be read." );
+    }
+    
     return new TraceTree( data[0] );
 }
 
@@ -445,8 +341,9 @@ TraceTree *Func_readTreeTrace::readTreesNexus(const std::vector<string> &fns, bo
         int nsamples = 0;
         for (size_t j=0; j<tmp.size(); ++j)
         {
-            RevBayesCore::Tree* t = tmp[i];
+            RevBayesCore::Tree* t = tmp[j];
             if(nsamples % thin == 0) tt.addObject(t);
+            else delete t;
             nsamples++;
         }
     }
@@ -6,6 +6,7 @@
 #include "RbException.h"
 #include "RealPos.h"
 #include "RevObject.h"
+#include "RlBoolean.h"
 #include "RlTimeTree.h"
 #include "TypedDagNode.h"
 #include "TypeSpec.h"
@@ -41,8 +42,9 @@ void Move_GibbsPruneAndRegraft::constructInternalObject( void )
     RevBayesCore::TypedDagNode<RevBayesCore::Tree> *tmp = static_cast<const TimeTree &>( tree->getRevObject() ).getDagNode();
     double w = static_cast<const RealPos &>( weight->getRevObject() ).getValue();
     RevBayesCore::StochasticNode<RevBayesCore::Tree> *t = static_cast<RevBayesCore::StochasticNode<RevBayesCore::Tree> *>( tmp );
+    bool c = static_cast<const RlBoolean &>( cached_likelihoods->getRevObject() ).getValue();
     
-    RevBayesCore::Proposal *p = new RevBayesCore::GibbsPruneAndRegraftProposal(t);
+    RevBayesCore::Proposal *p = new RevBayesCore::GibbsPruneAndRegraftProposal(t, c);
     value = new RevBayesCore::MetropolisHastingsMove(p,w);
     
 }
@@ -90,6 +92,7 @@ const MemberRules& Move_GibbsPruneAndRegraft::getParameterRules(void) const
     {
         
         memberRules.push_back( new ArgumentRule( "tree", TimeTree::getClassTypeSpec(), "The tree variable on which this move operates.", ArgumentRule::BY_REFERENCE, ArgumentRule::STOCHASTIC ) );
+        memberRules.push_back( new ArgumentRule( "useCachedLikelihoods", RlBoolean::getClassTypeSpec(), "Should we compute the likelihoods of all re-attachment points from the cached partial likelihoods (if the likelihood model supports this)?", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlBoolean( true ) ) );
         
         /* Inherit weight from Move, put it after variable */
         const MemberRules& inheritedRules = Move::getParameterRules();
@@ -131,6 +134,9 @@ void Move_GibbsPruneAndRegraft::setConstParameter(const std::string& name, const
     if ( name == "tree" ) {
         tree = var;
     }
+    else if ( name == "useCachedLikelihoods" ) {
+        cached_likelihoods = var;
+    }
     else {
         Move::setConstParameter(name, var);
     }
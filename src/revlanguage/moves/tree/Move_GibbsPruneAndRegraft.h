@@ -42,6 +42,7 @@ namespace RevLanguage {
         void                                        setConstParameter(const std::string& name, const RevPtr<const RevVariable> &var);       //!< Set member variable
         
         RevPtr<const RevVariable>                   tree;
+        RevPtr<const RevVariable>                   cached_likelihoods;
         
     };
     
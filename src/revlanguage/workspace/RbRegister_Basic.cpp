@@ -125,6 +125,7 @@
 #include "Func_structure.h"
 #include "Func_system.h"
 #include "Func_time.h"
+#include "Func_transitionProbabilityCacheStatistic.h"
 #include "Func_type.h"
 #include "Func_workspaceVector.h"
 
@@ -304,6 +305,7 @@ void RevLanguage::Workspace::initializeBasicGlobalWorkspace(void)
         addFunction( new Func_structure()                   );
         addFunction( new Func_system()                      );
         addFunction( new Func_time()                        );
+        addFunction( new Func_transitionProbabilityCacheStatistic() );
         addFunction( new Func_type()                        );
 
         /* Internal functions (in folder "functions/internal") */